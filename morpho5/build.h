@@ -21,6 +21,11 @@
 
 #define MORPHO_EXTENSION ".morpho"
 
+/** @brief Directory, relative to the home directory, where the compiled bytecode of modules and the help index are cached */
+#define MORPHO_CACHEDIRECTORY ".cache/morpho"
+
+#define MORPHO_CACHEEXTENSION ".mbc"
+
 /* **********************************************************************
  * Features
  * ********************************************************************** */
@@ -83,6 +88,15 @@
 /** @brief Maximum number of object types */
 #define MORPHO_MAXIMUMOBJECTDEFNS 64
 
+/** @brief Objects up to this size are allocated from pools of freed objects of the same size class */
+#define MORPHO_OBJECTPOOLMAXSIZE 256
+
+/** @brief Spacing of the size classes of object pools */
+#define MORPHO_OBJECTPOOLGRANULARITY 16
+
+/** @brief Maximum number of bytes of freed objects retained by each object pool */
+#define MORPHO_OBJECTPOOLLIMIT 1048576
+
 /* **********************************************************************
 * Performance
 * ********************************************************************** */
@@ -101,6 +115,15 @@
 /** @brief Controls how rapidly the GC tries to collect garbage */
 #define MORPHO_GCGROWTHFACTOR 2
 
+/** @brief Number of bytes of new objects to bind before a minor collection of the young generation */
+#define MORPHO_GCNURSERYSIZE 1048576
+
+/** @brief Default pause target for incremental collection, as the bytes of heap marked or swept per slice */
+#define MORPHO_GCPAUSETARGET 262144
+
+/** @brief Bytes of heap an incremental collection marks or sweeps for each byte bound */
+#define MORPHO_GCSTEPMULTIPLIER 2
+
 /** @brief Initial size of the stack */
 #define MORPHO_STACKINITIALSIZE 256
 
@@ -110,6 +133,27 @@
 /** @brief Limits size of statically allocated arrays on the C stack */
 #define MORPHO_MAXIMUMSTACKALLOC 256
 
+/** @brief Number of property slots allocated together with an instance */
+#define MORPHO_INSTANCESLOTS 4
+
+/** @brief Divide large sparse matrix products between threads */
+#define MORPHO_SPARSE_THREADS
+
+/** @brief Number of multiply-adds below which sparse products run on a single thread */
+#define MORPHO_SPARSE_PARALLELTHRESHOLD 262144
+
+/** @brief Maximum number of threads used for sparse products */
+#define MORPHO_SPARSE_MAXTHREADS 8
+
+/** @brief Number of sparsity pattern unions kept for reuse when adding sparse matrices */
+#define MORPHO_SPARSE_UNIONCACHESIZE 4
+
+/** @brief Maximum number of passes the optimizer makes over newly compiled code */
+#define MORPHO_OPTIMIZERPASSES 4
+
+/** @brief Number of executions with matching operand types before an arithmetic instruction is specialised for them */
+#define MORPHO_QUICKENTHRESHOLD 8
+
 /** @brief Avoid using global variables (suitable for small programs only) */
 //#define MORPHO_NOGLOBALS
 
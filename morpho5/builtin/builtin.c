@@ -13,6 +13,7 @@
 #include "matrix.h"
 #include "cmplx.h"
 #include "sparse.h"
+#include "blocksparse.h"
 #include "mesh.h"
 #include "selection.h"
 #include "functional.h"
@@ -226,6 +227,7 @@ value builtin_addclass(char *name, builtinclassentry desc[], value superclass) {
             }
             
             dictionary_insert(&new->methods, selector, MORPHO_OBJECT(method));
+            CLASS_MODIFIED(new);
         }
     }
     
@@ -282,6 +284,7 @@ void builtin_initialize(void) {
     file_initialize();
     matrix_initialize();
     sparse_initialize();
+    blocksparse_initialize();
     mesh_initialize();
     selection_initialize();
     field_initialize();
@@ -299,4 +302,5 @@ void builtin_finalize(void) {
     varray_valueclear(&builtin_objects);
     
     file_finalize();
+    sparse_finalize();
 }
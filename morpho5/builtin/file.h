@@ -70,6 +70,7 @@ typedef struct {
 bool file_getsize(FILE *f, size_t *s);
 
 void file_setworkingdirectory(const char *script);
+void file_relativepath(const char *fname, varray_char *name);
 
 FILE *file_openrelative(const char *fname, const char *mode);
 
@@ -22,7 +22,7 @@ value Object_getindex(vm *v, int nargs, value *args) {
     if (nargs==1 &&
         MORPHO_ISSTRING(MORPHO_GETARG(args, 0)) &&
         MORPHO_ISINSTANCE(self)) {
-        if (!dictionary_get(&MORPHO_GETINSTANCE(self)->fields, MORPHO_GETARG(args, 0), &out)) {
+        if (!objectinstance_getpropertybyname(MORPHO_GETINSTANCE(self), MORPHO_GETARG(args, 0), &out)) {
             morpho_runtimeerror(v, VM_OBJECTLACKSPROPERTY, MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)));
         }
     }
@@ -37,7 +37,7 @@ value Object_setindex(vm *v, int nargs, value *args) {
     if (nargs==2 &&
         MORPHO_ISSTRING(MORPHO_GETARG(args, 0)) &&
         MORPHO_ISINSTANCE(self)) {
-        dictionary_insert(&MORPHO_GETINSTANCE(self)->fields, MORPHO_GETARG(args, 0), MORPHO_GETARG(args, 1));
+        objectinstance_setpropertybyname(MORPHO_GETINSTANCE(self), MORPHO_GETARG(args, 0), MORPHO_GETARG(args, 1));
     } else morpho_runtimeerror(v, SETINDEX_ARGS);
     
     return MORPHO_NIL;
@@ -77,7 +77,7 @@ value Object_has(vm *v, int nargs, value *args) {
 
     if (nargs==1 &&
         MORPHO_ISSTRING(MORPHO_GETARG(args, 0))) {
-        return MORPHO_BOOL(dictionary_get(&MORPHO_GETINSTANCE(self)->fields, MORPHO_GETARG(args, 0), NULL));
+        return MORPHO_BOOL(objectinstance_getpropertybyname(MORPHO_GETINSTANCE(self), MORPHO_GETARG(args, 0), NULL));
         
     } else MORPHO_RAISE(v, RESPONDSTO_ARG);
     
@@ -129,7 +129,7 @@ value Object_count(vm *v, int nargs, value *args) {
     
     if (MORPHO_ISINSTANCE(self)) {
         objectinstance *obj = MORPHO_GETINSTANCE(self);
-        return MORPHO_INTEGER(obj->fields.count);
+        return MORPHO_INTEGER(OBJECTINSTANCE_COUNT(obj));
     } else if (MORPHO_ISCLASS(self)) {
         return MORPHO_INTEGER(0);
     }
@@ -146,18 +146,12 @@ value Object_enumerate(vm *v, int nargs, value *args) {
         int n=MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0));
        
         if (MORPHO_ISINSTANCE(self)) {
-            dictionary *dict= &MORPHO_GETINSTANCE(self)->fields;
+            objectinstance *obj = MORPHO_GETINSTANCE(self);
             
             if (n<0) {
-                out=MORPHO_INTEGER(dict->count);
-            } else if (n<dict->count) {
-                unsigned int k=0;
-                for (unsigned int i=0; i<dict->capacity; i++) {
-                    if (!MORPHO_ISNIL(dict->contents[i].key)) {
-                        if (k==n) return dict->contents[i].key;
-                        k++;
-                    }
-                }
+                out=MORPHO_INTEGER(OBJECTINSTANCE_COUNT(obj));
+            } else if (n<OBJECTINSTANCE_COUNT(obj)) {
+                return objectinstance_getkey(obj, n);
             } else morpho_runtimeerror(v, VM_OUTOFBOUNDS);
         } else if (MORPHO_ISCLASS(self)) {
             if (n<0) out = MORPHO_INTEGER(0);
@@ -181,9 +175,13 @@ value Object_clone(vm *v, int nargs, value *args) {
         objectinstance *instance = MORPHO_GETINSTANCE(self);
         objectinstance *new = object_newinstance(instance->klass);
         if (new) {
-            dictionary_copy(&instance->fields, &new->fields);
-            out = MORPHO_OBJECT(new);
-            morpho_bindobjects(v, 1, &out);
+            if (objectinstance_copyproperties(instance, new)) {
+                out = MORPHO_OBJECT(new);
+                morpho_bindobjects(v, 1, &out);
+            } else {
+                object_free((object *) new);
+                morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+            }
         }
     }
     
@@ -0,0 +1,551 @@
+/** @file blocksparse.c
+ *  @author T bj Atherton
+ *
+ *  @brief Veneer class over the objectblocksparse type that provides block sparse matrices
+ */
+
+#include "build.h"
+#include "blocksparse.h"
+#include "morpho.h"
+#include "common.h"
+#include "matrix.h"
+#include "builtin.h"
+#include "veneer.h"
+
+#include <string.h>
+
+/* ***************************************
+ * objectblocksparse definition
+ * *************************************** */
+
+objecttype objectblocksparsetype;
+
+/** Releases the pattern and blocks */
+static void blocksparse_clear(objectblocksparse *a) {
+    sparseccs_clear(&a->pattern);
+    if (a->blocks) MORPHO_FREE(a->blocks);
+    a->blocks=NULL;
+}
+
+/** Block sparse object definitions */
+void objectblocksparse_printfn(object *obj) {
+    printf("<BlockSparse>");
+}
+
+void objectblocksparse_freefn(object *obj) {
+    blocksparse_clear((objectblocksparse *) obj);
+}
+
+size_t objectblocksparse_sizefn(object *obj) {
+    objectblocksparse *a = (objectblocksparse *) obj;
+    return sizeof(objectblocksparse) +
+           (a->pattern.cptr ? sizeof(int)*(a->pattern.ncols+1) : 0) +
+           a->pattern.nentries*(sizeof(int)+sizeof(double)*a->bs*a->bs);
+}
+
+objecttypedefn objectblocksparsedefn = {
+    .printfn=objectblocksparse_printfn,
+    .markfn=NULL,
+    .freefn=objectblocksparse_freefn,
+    .sizefn=objectblocksparse_sizefn
+};
+
+/** Creates an empty block sparse matrix with a given block size */
+objectblocksparse *object_newblocksparse(int bs) {
+    objectblocksparse *new = (objectblocksparse *) object_new(sizeof(objectblocksparse), OBJECT_BLOCKSPARSE);
+    
+    if (new) {
+        new->bs=bs;
+        sparseccs_init(&new->pattern);
+        new->blocks=NULL;
+    }
+    
+    return new;
+}
+
+/* ***************************************
+ * Block sparse interface
+ * *************************************** */
+
+/** Finds the position of block (bi,bj) in the pattern by bisection, or returns -1 if it is absent */
+static int blocksparse_findblock(objectblocksparse *a, int bi, int bj) {
+    int lo=a->pattern.cptr[bi], hi=a->pattern.cptr[bi+1]-1;
+    int *rix=a->pattern.rix;
+    
+    while (lo<=hi) {
+        int mid=lo+(hi-lo)/2;
+        if (rix[mid]==bj) return mid;
+        if (rix[mid]<bj) lo=mid+1; else hi=mid-1;
+    }
+    return -1;
+}
+
+/** Builds the block pattern from block indices and allocates zeroed blocks to match */
+static bool blocksparse_buildpattern(objectblocksparse *a, int nbrows, int nbcols, unsigned int n, int *brows, int *bcols) {
+    if (!sparseccs_fromtriplets(&a->pattern, nbcols, nbrows, n, bcols, brows, NULL)) return false;
+    
+    size_t bsize=(size_t) a->bs*a->bs;
+    a->blocks=MORPHO_MALLOC(sizeof(double)*bsize*(a->pattern.nentries>0 ? a->pattern.nentries : 1));
+    if (!a->blocks) return false;
+    memset(a->blocks, 0, sizeof(double)*bsize*a->pattern.nentries);
+    return true;
+}
+
+/** Assembles a block sparse matrix from element blocks, summing blocks that share a position
+ * @param[in] bs - block size
+ * @param[in] nbrows } number of block rows and columns; pass negative values to size the matrix to fit the indices
+ * @param[in] nbcols }
+ * @param[in] n - number of blocks
+ * @param[in] brows - block row of each block
+ * @param[in] bcols - block column of each block
+ * @param[in] vals - n blocks of bs*bs values, each in column major order
+ * @returns the new matrix, or NULL if the indices are invalid */
+objectblocksparse *blocksparse_fromblocks(int bs, int nbrows, int nbcols, unsigned int n, int *brows, int *bcols, double *vals) {
+    if (bs<1) return NULL;
+    if (nbrows<0) for (unsigned int k=0; k<n; k++) if (brows[k]>=nbrows) nbrows=brows[k]+1;
+    if (nbcols<0) for (unsigned int k=0; k<n; k++) if (bcols[k]>=nbcols) nbcols=bcols[k]+1;
+    if (nbrows<0) nbrows=0;
+    if (nbcols<0) nbcols=0;
+    
+    objectblocksparse *new=object_newblocksparse(bs);
+    if (!new) return NULL;
+    
+    if (!blocksparse_buildpattern(new, nbrows, nbcols, n, brows, bcols)) {
+        object_free((object *) new);
+        return NULL;
+    }
+    
+    size_t bsize=(size_t) bs*bs;
+    for (unsigned int k=0; k<n; k++) {
+        double *blk=new->blocks+bsize*blocksparse_findblock(new, brows[k], bcols[k]);
+        for (size_t m=0; m<bsize; m++) blk[m]+=vals[bsize*k+m];
+    }
+    
+    return new;
+}
+
+/** Converts a sparse matrix into block sparse form; any block that holds an entry of a is stored in full
+ * @param[in] a - the sparse matrix, whose dimensions must be multiples of bs
+ * @param[in] bs - block size
+ * @returns the new matrix, or NULL on failure */
+objectblocksparse *blocksparse_fromsparse(objectsparse *a, int bs) {
+    if (bs<1 || !sparse_checkformat(a, SPARSE_CCS, true, true)) return NULL;
+    sparseccs *ccs=&a->ccs;
+    if (ccs->nrows%bs!=0 || ccs->ncols%bs!=0) return NULL;
+    
+    unsigned int n=ccs->nentries;
+    int *brows=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    int *bcols=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    objectblocksparse *new=NULL;
+    
+    if (brows && bcols) {
+        for (int j=0; j<ccs->ncols; j++) {
+            for (int k=SPARSECCS_COLSTART(ccs, j); k<SPARSECCS_COLSTART(ccs, j+1); k++) {
+                brows[k]=ccs->rix[k]/bs;
+                bcols[k]=j/bs;
+            }
+        }
+    
+        new=object_newblocksparse(bs);
+        if (new && blocksparse_buildpattern(new, ccs->nrows/bs, ccs->ncols/bs, n, brows, bcols)) {
+            if (ccs->values) for (int j=0; j<ccs->ncols; j++) {
+                for (int k=SPARSECCS_COLSTART(ccs, j); k<SPARSECCS_COLSTART(ccs, j+1); k++) {
+                    int i=ccs->rix[k];
+                    double *blk=new->blocks+(size_t) bs*bs*blocksparse_findblock(new, i/bs, j/bs);
+                    blk[(i%bs)+(j%bs)*bs]=ccs->values[k];
+                }
+            }
+        } else if (new) {
+            object_free((object *) new);
+            new=NULL;
+        }
+    }
+    
+    if (brows) MORPHO_FREE(brows);
+    if (bcols) MORPHO_FREE(bcols);
+    return new;
+}
+
+/** Expands a block sparse matrix into scalar CCS form
+ * @param[in] a - the matrix
+ * @param[in] rowform - if true, produce the transpose, i.e. the matrix in compressed row form
+ * @param[out] out - the scalar matrix; every entry of every block is kept */
+static bool blocksparse_toccs(objectblocksparse *a, bool rowform, sparseccs *out) {
+    int bs=a->bs;
+    size_t bsize=(size_t) bs*bs, n=bsize*a->pattern.nentries;
+    int *rows=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    int *cols=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    bool success=false;
+    
+    if (rows && cols) {
+        size_t m=0;
+        for (int bi=0; bi<a->pattern.ncols; bi++) {
+            for (int k=a->pattern.cptr[bi]; k<a->pattern.cptr[bi+1]; k++) {
+                int bj=a->pattern.rix[k];
+                for (int c=0; c<bs; c++) for (int r=0; r<bs; r++, m++) {
+                    rows[m]=bi*bs+r;
+                    cols[m]=bj*bs+c;
+                }
+            }
+        }
+    
+        if (rowform) success=sparseccs_fromtriplets(out, BLOCKSPARSE_NCOLS(a), BLOCKSPARSE_NROWS(a), (unsigned int) n, cols, rows, a->blocks);
+        else success=sparseccs_fromtriplets(out, BLOCKSPARSE_NROWS(a), BLOCKSPARSE_NCOLS(a), (unsigned int) n, rows, cols, a->blocks);
+    }
+    
+    if (rows) MORPHO_FREE(rows);
+    if (cols) MORPHO_FREE(cols);
+    return success;
+}
+
+/** Converts a block sparse matrix to a sparse matrix */
+objectsparse *blocksparse_tosparse(objectblocksparse *a) {
+    objectsparse *new=object_newsparse(NULL, NULL);
+    
+    if (new && !blocksparse_toccs(a, false, &new->ccs)) {
+        object_free((object *) new);
+        new=NULL;
+    }
+    
+    return new;
+}
+
+/** Gets a scalar element; entries outside the stored blocks are zero */
+bool blocksparse_getelement(objectblocksparse *a, int i, int j, double *val) {
+    if (i<0 || j<0 || i>=BLOCKSPARSE_NROWS(a) || j>=BLOCKSPARSE_NCOLS(a)) return false;
+    
+    int bs=a->bs, k=blocksparse_findblock(a, i/bs, j/bs);
+    *val=(k<0 ? 0.0 : a->blocks[(size_t) bs*bs*k+(i%bs)+(j%bs)*bs]);
+    return true;
+}
+
+/** Number of stored scalar entries */
+unsigned int blocksparse_count(objectblocksparse *a) {
+    return a->pattern.nentries*a->bs*a->bs;
+}
+
+/* ***************************************
+ * Products
+ * *************************************** */
+
+/** Product of a block sparse matrix with a single vector */
+typedef void (*blocksparsekernel) (objectblocksparse *a, double *x, double *y);
+
+/** Defines a kernel for a fixed block size; the inner loops have constant trip counts and are unrolled by the compiler */
+#define BLOCKSPARSE_KERNEL(BS) \
+static void blocksparse_kernel##BS(objectblocksparse *a, double *x, double *y) { \
+    sparseccs *p=&a->pattern; \
+    for (int bi=0; bi<p->ncols; bi++) { \
+        double acc[BS]; \
+        for (int r=0; r<BS; r++) acc[r]=0.0; \
+        for (int k=p->cptr[bi]; k<p->cptr[bi+1]; k++) { \
+            double *blk=a->blocks+(size_t) BS*BS*k, *xj=x+(size_t) BS*p->rix[k]; \
+            for (int c=0; c<BS; c++) for (int r=0; r<BS; r++) acc[r]+=blk[r+c*BS]*xj[c]; \
+        } \
+        for (int r=0; r<BS; r++) y[(size_t) BS*bi+r]=acc[r]; \
+    } \
+}
+
+BLOCKSPARSE_KERNEL(1)
+BLOCKSPARSE_KERNEL(2)
+BLOCKSPARSE_KERNEL(3)
+BLOCKSPARSE_KERNEL(4)
+
+/** Kernel for any block size */
+static void blocksparse_kernelgeneric(objectblocksparse *a, double *x, double *y) {
+    sparseccs *p=&a->pattern;
+    int bs=a->bs;
+    
+    for (int bi=0; bi<p->ncols; bi++) {
+        double *yi=y+(size_t) bs*bi;
+        for (int r=0; r<bs; r++) yi[r]=0.0;
+        for (int k=p->cptr[bi]; k<p->cptr[bi+1]; k++) {
+            double *blk=a->blocks+(size_t) bs*bs*k, *xj=x+(size_t) bs*p->rix[k];
+            for (int c=0; c<bs; c++) for (int r=0; r<bs; r++) yi[r]+=blk[r+c*bs]*xj[c];
+        }
+    }
+}
+
+/** Selects the kernel for the block size */
+static blocksparsekernel blocksparse_getkernel(objectblocksparse *a) {
+    switch (a->bs) {
+        case 1: return blocksparse_kernel1;
+        case 2: return blocksparse_kernel2;
+        case 3: return blocksparse_kernel3;
+        case 4: return blocksparse_kernel4;
+        default: return blocksparse_kernelgeneric;
+    }
+}
+
+/** Multiplies a block sparse matrix by a dense matrix held as a column major array
+ * @param[in] a - block sparse matrix
+ * @param[in] ncols - number of columns of x
+ * @param[in] x - dense rhs with as many rows as a has columns
+ * @param[out] y - a*x, with as many rows as a; must not alias x */
+void blocksparse_muldense(objectblocksparse *a, int ncols, double *x, double *y) {
+    blocksparsekernel kernel=blocksparse_getkernel(a);
+    size_t nrows=BLOCKSPARSE_NROWS(a), nx=BLOCKSPARSE_NCOLS(a);
+    
+    for (int c=0; c<ncols; c++) kernel(a, x+nx*c, y+nrows*c);
+}
+
+/** Multiply a block sparse matrix by a dense matrix
+ * @param[in] a - block sparse matrix
+ * @param[in] b - dense matrix
+ * @param[out] out - a*b */
+objectsparseerror blocksparse_mulmatrix(objectblocksparse *a, objectmatrix *b, objectmatrix *out) {
+    if (BLOCKSPARSE_NCOLS(a)!=b->nrows || out->nrows!=BLOCKSPARSE_NROWS(a) || out->ncols!=b->ncols || out==b) return SPARSE_INCMPTBLDIM;
+    
+    blocksparse_muldense(a, b->ncols, b->elements, out->elements);
+    MATRIX_MODIFIED(out);
+    return SPARSE_OK;
+}
+
+/* ***************************************
+ * Iterative solvers
+ * *************************************** */
+
+/** Operator for a block sparse matrix */
+static void blocksparse_operator(void *ref, double *x, double *y) {
+    objectblocksparse *a=(objectblocksparse *) ref;
+    blocksparse_getkernel(a)(a, x, y);
+}
+
+/** Solves A x = b with an iterative method
+ * @param[in] a - square block sparse matrix
+ * @param[in] method - the method to use
+ * @param[in] opt - solver options
+ * @param[in] b - right hand side
+ * @param[in,out] x - on entry, the initial guess; on exit, the solution
+ * @details Products use the block kernels; a scalar row form of a is built only if a preconditioner is requested. */
+objectsparseerror blocksparse_solve(objectblocksparse *a, sparsesolvermethod method, sparsesolveroptions *opt, objectmatrix *b, objectmatrix *x) {
+    if (BLOCKSPARSE_NROWS(a)!=BLOCKSPARSE_NCOLS(a)) return SPARSE_INCMPTBLDIM;
+    
+    sparseccs csr;
+    sparseccs_init(&csr);
+    if (opt->precond!=SPARSE_PRECONDNONE && !blocksparse_toccs(a, true, &csr)) return SPARSE_CONVFAILED;
+    
+    objectsparseerror err=sparse_solveoperator(blocksparse_operator, a, BLOCKSPARSE_NROWS(a), (opt->precond!=SPARSE_PRECONDNONE ? &csr : NULL), method, opt, b, x);
+    
+    sparseccs_clear(&csr);
+    return err;
+}
+
+/* ***************************************
+ * BlockSparse class
+ * *************************************** */
+
+/** Creates a block sparse matrix from Lists or Matrices of block rows and columns, and a List of blocks */
+static objectblocksparse *blocksparse_fromblockvalues(vm *v, int bs, int nbrows, int nbcols, value rows, value cols, value blocks) {
+    objectblocksparse *new=NULL;
+    unsigned int n, nc;
+    
+    if (bs<1 || !MORPHO_ISLIST(blocks) ||
+        !(sparse_tripletcount(rows, &n) && sparse_tripletcount(cols, &nc)) ||
+        nc!=n || MORPHO_GETLIST(blocks)->val.count!=n) {
+        morpho_runtimeerror(v, BLOCKSPARSE_BLOCKS);
+        return NULL;
+    }
+    
+    size_t bsize=(size_t) bs*bs;
+    int *rix=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    int *cix=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    double *x=MORPHO_MALLOC(sizeof(double)*bsize*(n>0 ? n : 1));
+    
+    if (rix && cix && x) {
+        bool success=(sparse_tripletindices(rows, n, rix) && sparse_tripletindices(cols, n, cix));
+    
+        for (unsigned int k=0; success && k<n; k++) {
+            value el=MORPHO_GETLIST(blocks)->val.data[k];
+            objectmatrix *m=(MORPHO_ISMATRIX(el) ? MORPHO_GETMATRIX(el) : NULL);
+            if (m && m->nrows==bs && m->ncols==bs) {
+                memcpy(x+bsize*k, m->elements, sizeof(double)*bsize);
+            } else success=false;
+        }
+    
+        if (success) new=blocksparse_fromblocks(bs, nbrows, nbcols, n, rix, cix, x);
+        if (!new) morpho_runtimeerror(v, BLOCKSPARSE_BLOCKS);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    
+    if (rix) MORPHO_FREE(rix);
+    if (cix) MORPHO_FREE(cix);
+    if (x) MORPHO_FREE(x);
+    
+    return new;
+}
+
+/** Constructs a BlockSparse object */
+value blocksparse_constructor(vm *v, int nargs, value *args) {
+    objectblocksparse *new=NULL;
+    value out=MORPHO_NIL;
+    
+    if (nargs==2 &&
+        MORPHO_ISSPARSE(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISINTEGER(MORPHO_GETARG(args, 1))) {
+        new=blocksparse_fromsparse(MORPHO_GETSPARSE(MORPHO_GETARG(args, 0)), MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 1)));
+        if (!new) morpho_runtimeerror(v, BLOCKSPARSE_BLOCKSIZE);
+    } else if (nargs==4 &&
+               MORPHO_ISINTEGER(MORPHO_GETARG(args, 0))) {
+        new=blocksparse_fromblockvalues(v, MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0)), -1, -1, MORPHO_GETARG(args, 1), MORPHO_GETARG(args, 2), MORPHO_GETARG(args, 3));
+    } else if (nargs==6 &&
+               MORPHO_ISINTEGER(MORPHO_GETARG(args, 0)) &&
+               MORPHO_ISINTEGER(MORPHO_GETARG(args, 1)) &&
+               MORPHO_ISINTEGER(MORPHO_GETARG(args, 2))) {
+        new=blocksparse_fromblockvalues(v, MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0)), MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 1)), MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 2)), MORPHO_GETARG(args, 3), MORPHO_GETARG(args, 4), MORPHO_GETARG(args, 5));
+    } else {
+        morpho_runtimeerror(v, BLOCKSPARSE_CONSTRUCTOR);
+    }
+    
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    }
+    
+    return out;
+}
+
+/** Gets a scalar element */
+value BlockSparse_getindex(vm *v, int nargs, value *args) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    unsigned int indx[2]={0,0};
+    double val=0.0;
+    
+    if (!array_valuelisttoindices(nargs, args+1, indx) ||
+        !blocksparse_getelement(a, indx[0], indx[1], &val)) {
+        morpho_runtimeerror(v, MATRIX_INVLDINDICES);
+    }
+    
+    return MORPHO_FLOAT(val);
+}
+
+/** Multiplies by a Matrix */
+value BlockSparse_mul(vm *v, int nargs, value *args) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+    
+        objectmatrix *new = object_newmatrix(BLOCKSPARSE_NROWS(a), b->ncols, false);
+        if (new) {
+            objectsparseerror err=blocksparse_mulmatrix(a, b, new);
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+            if (err!=SPARSE_OK) {
+                sparse_raiseerror(v, err);
+                out=MORPHO_NIL;
+            }
+        } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    } else morpho_runtimeerror(v, MATRIX_ARITHARGS);
+    
+    return out;
+}
+
+/** Common implementation of the iterative solver methods */
+static value blocksparse_iterativesolve(vm *v, int nargs, value *args, sparsesolvermethod method) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    sparsesolveroptions opt;
+    objectmatrix *b;
+    value out=MORPHO_NIL;
+    
+    if (sparse_solverargs(v, nargs, args, &opt, &b, &out)) {
+        objectsparseerror err=blocksparse_solve(a, method, &opt, b, MORPHO_GETMATRIX(out));
+        if (err!=SPARSE_OK) {
+            sparse_raiseerror(v, err);
+            out=MORPHO_NIL;
+        }
+    }
+    
+    return out;
+}
+
+/** Conjugate gradient */
+value BlockSparse_cg(vm *v, int nargs, value *args) {
+    return blocksparse_iterativesolve(v, nargs, args, SPARSE_CG);
+}
+
+/** Minimal residual */
+value BlockSparse_minres(vm *v, int nargs, value *args) {
+    return blocksparse_iterativesolve(v, nargs, args, SPARSE_MINRES);
+}
+
+/** Biconjugate gradient stabilized */
+value BlockSparse_bicgstab(vm *v, int nargs, value *args) {
+    return blocksparse_iterativesolve(v, nargs, args, SPARSE_BICGSTAB);
+}
+
+/** Restarted GMRES */
+value BlockSparse_gmres(vm *v, int nargs, value *args) {
+    return blocksparse_iterativesolve(v, nargs, args, SPARSE_GMRES);
+}
+
+/** Converts to a Sparse matrix */
+value BlockSparse_sparse(vm *v, int nargs, value *args) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    objectsparse *new=blocksparse_tosparse(a);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    
+    return out;
+}
+
+/** Number of stored entries */
+value BlockSparse_count(vm *v, int nargs, value *args) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    return MORPHO_INTEGER(blocksparse_count(a));
+}
+
+/** Block size */
+value BlockSparse_blocksize(vm *v, int nargs, value *args) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    return MORPHO_INTEGER(a->bs);
+}
+
+/** Dimensions of the matrix in scalar rows and columns */
+value BlockSparse_dimensions(vm *v, int nargs, value *args) {
+    objectblocksparse *a=MORPHO_GETBLOCKSPARSE(MORPHO_SELF(args));
+    value dim[2] = { MORPHO_INTEGER(BLOCKSPARSE_NROWS(a)), MORPHO_INTEGER(BLOCKSPARSE_NCOLS(a)) };
+    value out=MORPHO_NIL;
+    
+    objectlist *new=object_newlist(2, dim);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    
+    return out;
+}
+
+MORPHO_BEGINCLASS(BlockSparse)
+MORPHO_METHOD(MORPHO_GETINDEX_METHOD, BlockSparse_getindex, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_MUL_METHOD, BlockSparse_mul, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_CG_METHOD, BlockSparse_cg, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_MINRES_METHOD, BlockSparse_minres, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_BICGSTAB_METHOD, BlockSparse_bicgstab, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_GMRES_METHOD, BlockSparse_gmres, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(BLOCKSPARSE_SPARSE_METHOD, BlockSparse_sparse, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_COUNT_METHOD, BlockSparse_count, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(BLOCKSPARSE_BLOCKSIZE_METHOD, BlockSparse_blocksize, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DIMENSIONS_METHOD, BlockSparse_dimensions, BUILTIN_FLAGSEMPTY)
+MORPHO_ENDCLASS
+
+/* ***************************************
+ * Initialization
+ * *************************************** */
+
+void blocksparse_initialize(void) {
+    objectblocksparsetype=object_addtype(&objectblocksparsedefn);
+    
+    builtin_addfunction(BLOCKSPARSE_CLASSNAME, blocksparse_constructor, BUILTIN_FLAGSEMPTY);
+    
+    value blocksparseclass=builtin_addclass(BLOCKSPARSE_CLASSNAME, MORPHO_GETCLASSDEFINITION(BlockSparse), MORPHO_NIL);
+    object_setveneerclass(OBJECT_BLOCKSPARSE, blocksparseclass);
+    
+    morpho_defineerror(BLOCKSPARSE_CONSTRUCTOR, ERROR_HALT, BLOCKSPARSE_CONSTRUCTOR_MSG);
+    morpho_defineerror(BLOCKSPARSE_BLOCKS, ERROR_HALT, BLOCKSPARSE_BLOCKS_MSG);
+    morpho_defineerror(BLOCKSPARSE_BLOCKSIZE, ERROR_HALT, BLOCKSPARSE_BLOCKSIZE_MSG);
+}
@@ -0,0 +1,83 @@
+/** @file blocksparse.h
+ *  @author T J Atherton
+ *
+ *  @brief Veneer class over the objectblocksparse type that provides block sparse matrices
+ */
+
+#ifndef blocksparse_h
+#define blocksparse_h
+
+#include <stdio.h>
+#include "object.h"
+#include "morpho.h"
+#include "matrix.h"
+#include "sparse.h"
+
+/* ***************************************
+ * Block sparse objects
+ * *************************************** */
+
+extern objecttype objectblocksparsetype;
+#define OBJECT_BLOCKSPARSE objectblocksparsetype
+
+/** A block sparse row (BSR) matrix, made of dense bs x bs blocks
+ * @details The block pattern is held by rows: column I of pattern lists the block columns of block row I in order, so pattern.ncols is the number of block rows and pattern.nrows the number of block columns. */
+typedef struct {
+    object obj;
+    int bs; // Block size
+    sparseccs pattern; // Block pattern by rows
+    double *blocks; // One block per entry of pattern, each stored in column major order
+} objectblocksparse;
+
+/** Tests whether an object is a block sparse matrix */
+#define MORPHO_ISBLOCKSPARSE(val) object_istype(val, OBJECT_BLOCKSPARSE)
+
+/** Gets the object as a block sparse matrix */
+#define MORPHO_GETBLOCKSPARSE(val)   ((objectblocksparse *) MORPHO_GETOBJECT(val))
+
+/** Number of scalar rows and columns */
+#define BLOCKSPARSE_NROWS(a) ((a)->pattern.ncols*(a)->bs)
+#define BLOCKSPARSE_NCOLS(a) ((a)->pattern.nrows*(a)->bs)
+
+objectblocksparse *object_newblocksparse(int bs);
+
+/* ***************************************
+ * The BlockSparse class
+ * *************************************** */
+
+#define BLOCKSPARSE_CLASSNAME "BlockSparse"
+
+#define BLOCKSPARSE_SPARSE_METHOD "sparse"
+#define BLOCKSPARSE_BLOCKSIZE_METHOD "blocksize"
+
+#define BLOCKSPARSE_CONSTRUCTOR           "BlkSprsCns"
+#define BLOCKSPARSE_CONSTRUCTOR_MSG       "BlockSparse() should be called with a block size and Lists of block rows, block columns and blocks, optionally with the number of block rows and columns, or with a Sparse matrix and a block size."
+
+#define BLOCKSPARSE_BLOCKS                "BlkSprsBlks"
+#define BLOCKSPARSE_BLOCKS_MSG            "BlockSparse() requires block rows, columns and blocks of equal length, with integer indices within the dimensions and each block a square Matrix of the block size."
+
+#define BLOCKSPARSE_BLOCKSIZE             "BlkSprsBlkSz"
+#define BLOCKSPARSE_BLOCKSIZE_MSG         "Block size must be positive and divide the dimensions of the Sparse matrix."
+
+/* ***************************************
+ * Block sparse interface
+ * *************************************** */
+
+objectblocksparse *blocksparse_fromblocks(int bs, int nbrows, int nbcols, unsigned int n, int *brows, int *bcols, double *vals);
+objectblocksparse *blocksparse_fromsparse(objectsparse *a, int bs);
+objectsparse *blocksparse_tosparse(objectblocksparse *a);
+
+bool blocksparse_getelement(objectblocksparse *a, int i, int j, double *val);
+unsigned int blocksparse_count(objectblocksparse *a);
+
+void blocksparse_muldense(objectblocksparse *a, int ncols, double *x, double *y);
+objectsparseerror blocksparse_mulmatrix(objectblocksparse *a, objectmatrix *b, objectmatrix *out);
+objectsparseerror blocksparse_solve(objectblocksparse *a, sparsesolvermethod method, sparsesolveroptions *opt, objectmatrix *b, objectmatrix *x);
+
+/* ***************************************
+ * Initialization
+ * *************************************** */
+
+void blocksparse_initialize(void);
+
+#endif /* blocksparse_h */
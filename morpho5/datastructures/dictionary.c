@@ -10,7 +10,6 @@
 #include "common.h"
 #include "memory.h"
 #include "object.h"
-#include "sparse.h"
 
 /*
  * Macros that control the behavior of the dictionary.
@@ -116,13 +115,6 @@ static inline hash dictionary_hashstring(const char* key, size_t length) {
   return dictionary_hashint(hash);
 }
 
-/** Fibonacci hash function for pairs of integers. */
-static inline hash dictionary_hashdokkey(objectdokkey *key) {
-    uint64_t i1 = MORPHO_GETDOKKEYROW(key);
-    uint64_t i2 = MORPHO_GETDOKKEYCOL(key);
-    return ((i1<<32 | i2) * 11400714819323198485llu)>> 32;
-}
-
 /*
  * Implementation
  */
@@ -138,8 +130,6 @@ static hash dictionary_hash(value key, bool intern) {
         } else {
             if (MORPHO_ISSTRING(key)) {
                 return dictionary_hashstring(MORPHO_GETCSTRING(key), MORPHO_GETSTRINGLENGTH(key));
-            } else if (MORPHO_ISDOKKEY(key)) {
-                return dictionary_hashdokkey(MORPHO_GETDOKKEY(key));
             } else {
                 return dictionary_hashpointer(MORPHO_GETOBJECT(key));
             }
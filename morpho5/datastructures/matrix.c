@@ -45,6 +45,7 @@ objectmatrix *object_newmatrix(unsigned int nrows, unsigned int ncols, bool zero
     if (new) {
         new->ncols=ncols;
         new->nrows=nrows;
+        new->version=0;
         new->elements=new->matrixdata;
         if (zero) {
             memset(new->elements, 0, sizeof(double)*nel);
@@ -227,6 +228,7 @@ objectmatrix *object_clonematrix(objectmatrix *in) {
 bool matrix_setelement(objectmatrix *matrix, unsigned int row, unsigned int col, double value) {
     if (col<matrix->ncols && row<matrix->nrows) {
         matrix->elements[col*matrix->nrows+row]=value;
+        MATRIX_MODIFIED(matrix);
         return true;
     }
     return false;
@@ -263,6 +265,7 @@ bool matrix_getcolumn(objectmatrix *matrix, unsigned int col, double **v) {
 bool matrix_setcolumn(objectmatrix *matrix, unsigned int col, double *v) {
     if (col<matrix->ncols) {
         cblas_dcopy(matrix->nrows, v, 1, &matrix->elements[col*matrix->nrows], 1);
+        MATRIX_MODIFIED(matrix);
         return true;
     }
     return false;
@@ -277,11 +280,193 @@ bool matrix_setcolumn(objectmatrix *matrix, unsigned int col, double *v) {
 bool matrix_addtocolumn(objectmatrix *m, unsigned int col, double alpha, double *v) {
     if (col<m->ncols) {
         cblas_daxpy(m->nrows, alpha, v, 1, &m->elements[col*m->nrows], 1);
+        MATRIX_MODIFIED(m);
         return true;
     }
     return false;
 }
 
+/* **********************************************************************
+ * Small matrix kernels
+ * ********************************************************************* */
+
+/* For the small matrices that occur in integrands and per-element calculations,
+   the call overhead of blas and lapack dominates the arithmetic. These kernels
+   handle matrices up to MATRIX_KERNELSIZE in each dimension explicitly. Elements
+   are stored in column major order, so a[i+j*n] is the (i,j) element. */
+
+/** Generates a fixed size kernel for the product of two square N x N matrices */
+#define MATRIX_MULKERNEL(N) \
+static void matrix_mul##N(double *a, double *b, double *out) { \
+    for (int j=0; j<N; j++) { \
+        for (int i=0; i<N; i++) { \
+            double sum=0.0; \
+            for (int k=0; k<N; k++) sum+=a[i+k*N]*b[k+j*N]; \
+            out[i+j*N]=sum; \
+        } \
+    } \
+}
+
+MATRIX_MULKERNEL(2)
+MATRIX_MULKERNEL(3)
+MATRIX_MULKERNEL(4)
+
+/** Product of an m x p matrix with a p x n matrix for arbitrary small dimensions */
+static void matrix_mulsmall(int m, int p, int n, double *a, double *b, double *out) {
+    for (int j=0; j<n; j++) {
+        for (int i=0; i<m; i++) {
+            double sum=0.0;
+            for (int k=0; k<p; k++) sum+=a[i+k*m]*b[k+j*p];
+            out[i+j*m]=sum;
+        }
+    }
+}
+
+/** Determinant of a 2x2 matrix */
+static inline double matrix_det2(double *a) {
+    return a[0]*a[3]-a[2]*a[1];
+}
+
+/** Determinant of a 3x3 matrix by expansion along the first row */
+static inline double matrix_det3(double *a) {
+    return a[0]*(a[4]*a[8]-a[7]*a[5])
+          -a[3]*(a[1]*a[8]-a[7]*a[2])
+          +a[6]*(a[1]*a[5]-a[4]*a[2]);
+}
+
+/** Determinant of a 4x4 matrix by expansion in 2x2 minors of the first two and last two columns */
+static inline double matrix_det4(double *a) {
+    double s0=a[0]*a[5]-a[1]*a[4], s1=a[0]*a[6]-a[2]*a[4], s2=a[0]*a[7]-a[3]*a[4];
+    double s3=a[1]*a[6]-a[2]*a[5], s4=a[1]*a[7]-a[3]*a[5], s5=a[2]*a[7]-a[3]*a[6];
+    double c5=a[10]*a[15]-a[11]*a[14], c4=a[9]*a[15]-a[11]*a[13], c3=a[9]*a[14]-a[10]*a[13];
+    double c2=a[8]*a[15]-a[11]*a[12], c1=a[8]*a[14]-a[10]*a[12], c0=a[8]*a[13]-a[9]*a[12];
+    
+    return s0*c5-s1*c4+s2*c3+s3*c2-s4*c1+s5*c0;
+}
+
+/** Determinant of a small square matrix of dimension n<=MATRIX_KERNELSIZE */
+static double matrix_detsmall(int n, double *a) {
+    switch (n) {
+        case 1: return a[0];
+        case 2: return matrix_det2(a);
+        case 3: return matrix_det3(a);
+        default: return matrix_det4(a);
+    }
+}
+
+/** Inverts a small square matrix of dimension n<=MATRIX_KERNELSIZE using the adjugate
+ * @param[in] n - dimension
+ * @param[in] a - matrix to invert
+ * @param[out] out - the inverse; must not alias a
+ * @returns MATRIX_OK on success or MATRIX_SING if a is singular */
+static objectmatrixerror matrix_inversesmall(int n, double *a, double *out) {
+    switch (n) {
+        case 1:
+            if (a[0]==0.0) return MATRIX_SING;
+            out[0]=1.0/a[0];
+            break;
+        case 2: {
+            double det=matrix_det2(a);
+            if (det==0.0) return MATRIX_SING;
+            double idet=1.0/det;
+            out[0]=a[3]*idet; out[1]=-a[1]*idet;
+            out[2]=-a[2]*idet; out[3]=a[0]*idet;
+        }
+            break;
+        case 3: {
+            double det=matrix_det3(a);
+            if (det==0.0) return MATRIX_SING;
+            double idet=1.0/det;
+            out[0]=(a[4]*a[8]-a[7]*a[5])*idet;
+            out[1]=(a[7]*a[2]-a[1]*a[8])*idet;
+            out[2]=(a[1]*a[5]-a[4]*a[2])*idet;
+            out[3]=(a[6]*a[5]-a[3]*a[8])*idet;
+            out[4]=(a[0]*a[8]-a[6]*a[2])*idet;
+            out[5]=(a[3]*a[2]-a[0]*a[5])*idet;
+            out[6]=(a[3]*a[7]-a[6]*a[4])*idet;
+            out[7]=(a[6]*a[1]-a[0]*a[7])*idet;
+            out[8]=(a[0]*a[4]-a[3]*a[1])*idet;
+        }
+            break;
+        default: {
+            /* 2x2 minors of the first two and last two columns, as in matrix_det4 */
+            double s0=a[0]*a[5]-a[1]*a[4], s1=a[0]*a[6]-a[2]*a[4], s2=a[0]*a[7]-a[3]*a[4];
+            double s3=a[1]*a[6]-a[2]*a[5], s4=a[1]*a[7]-a[3]*a[5], s5=a[2]*a[7]-a[3]*a[6];
+            double c5=a[10]*a[15]-a[11]*a[14], c4=a[9]*a[15]-a[11]*a[13], c3=a[9]*a[14]-a[10]*a[13];
+            double c2=a[8]*a[15]-a[11]*a[12], c1=a[8]*a[14]-a[10]*a[12], c0=a[8]*a[13]-a[9]*a[12];
+            
+            double det=s0*c5-s1*c4+s2*c3+s3*c2-s4*c1+s5*c0;
+            if (det==0.0) return MATRIX_SING;
+            double idet=1.0/det;
+            
+            out[0]=(a[5]*c5-a[6]*c4+a[7]*c3)*idet;
+            out[4]=(-a[4]*c5+a[6]*c2-a[7]*c1)*idet;
+            out[8]=(a[4]*c4-a[5]*c2+a[7]*c0)*idet;
+            out[12]=(-a[4]*c3+a[5]*c1-a[6]*c0)*idet;
+            
+            out[1]=(-a[1]*c5+a[2]*c4-a[3]*c3)*idet;
+            out[5]=(a[0]*c5-a[2]*c2+a[3]*c1)*idet;
+            out[9]=(-a[0]*c4+a[1]*c2-a[3]*c0)*idet;
+            out[13]=(a[0]*c3-a[1]*c1+a[2]*c0)*idet;
+            
+            out[2]=(a[13]*s5-a[14]*s4+a[15]*s3)*idet;
+            out[6]=(-a[12]*s5+a[14]*s2-a[15]*s1)*idet;
+            out[10]=(a[12]*s4-a[13]*s2+a[15]*s0)*idet;
+            out[14]=(-a[12]*s3+a[13]*s1-a[14]*s0)*idet;
+            
+            out[3]=(-a[9]*s5+a[10]*s4-a[11]*s3)*idet;
+            out[7]=(a[8]*s5-a[10]*s2+a[11]*s1)*idet;
+            out[11]=(-a[8]*s4+a[9]*s2-a[11]*s0)*idet;
+            out[15]=(a[8]*s3-a[9]*s1+a[10]*s0)*idet;
+        }
+            break;
+    }
+    return MATRIX_OK;
+}
+
+/** Solves a.x = b for a small square matrix a of dimension n<=MATRIX_KERNELSIZE by Gaussian elimination with partial pivoting
+ * @param[in] n - dimension of a
+ * @param[in] nrhs - number of right hand sides
+ * @param[in] a - the matrix, which is left unchanged
+ * @param[in] b - right hand sides, stored as an n x nrhs matrix
+ * @param[out] x - solutions; may alias b
+ * @returns MATRIX_OK on success or MATRIX_SING if a is singular */
+static objectmatrixerror matrix_solvesmall(int n, int nrhs, double *a, double *b, double *x) {
+    double lu[MATRIX_KERNELSIZE*MATRIX_KERNELSIZE];
+    memcpy(lu, a, sizeof(double)*n*n);
+    if (x!=b) memcpy(x, b, sizeof(double)*n*nrhs);
+    
+    for (int k=0; k<n; k++) {
+        /* Find the pivot */
+        int p=k;
+        for (int i=k+1; i<n; i++) if (fabs(lu[i+k*n])>fabs(lu[p+k*n])) p=i;
+        if (lu[p+k*n]==0.0) return MATRIX_SING;
+        
+        if (p!=k) {
+            for (int j=k; j<n; j++) { double t=lu[k+j*n]; lu[k+j*n]=lu[p+j*n]; lu[p+j*n]=t; }
+            for (int j=0; j<nrhs; j++) { double t=x[k+j*n]; x[k+j*n]=x[p+j*n]; x[p+j*n]=t; }
+        }
+        
+        /* Eliminate below the pivot, carrying the right hand sides along */
+        for (int i=k+1; i<n; i++) {
+            double f=lu[i+k*n]/lu[k+k*n];
+            for (int j=k+1; j<n; j++) lu[i+j*n]-=f*lu[k+j*n];
+            for (int j=0; j<nrhs; j++) x[i+j*n]-=f*x[k+j*n];
+        }
+    }
+    
+    /* Back substitution */
+    for (int j=0; j<nrhs; j++) {
+        for (int i=n-1; i>=0; i--) {
+            double sum=x[i+j*n];
+            for (int k=i+1; k<n; k++) sum-=lu[i+k*n]*x[k+j*n];
+            x[i+j*n]=sum/lu[i+i*n];
+        }
+    }
+    
+    return MATRIX_OK;
+}
+
 /* **********************************************************************
  * Matrix arithmetic
  * ********************************************************************* */
@@ -289,6 +474,7 @@ bool matrix_addtocolumn(objectmatrix *m, unsigned int col, double alpha, double
 objectmatrixerror matrix_copy(objectmatrix *a, objectmatrix *out) {
     if (a->ncols==out->ncols && a->nrows==out->nrows) {
         cblas_dcopy(a->ncols * a->nrows, a->elements, 1, out->elements, 1);
+        MATRIX_MODIFIED(out);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
@@ -300,6 +486,7 @@ objectmatrixerror matrix_add(objectmatrix *a, objectmatrix *b, objectmatrix *out
         a->nrows==b->nrows && a->nrows==out->nrows) {
         if (a!=out) cblas_dcopy(a->ncols * a->nrows, a->elements, 1, out->elements, 1);
         cblas_daxpy(a->ncols * a->nrows, 1.0, b->elements, 1, out->elements, 1);
+        MATRIX_MODIFIED(out);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
@@ -311,6 +498,7 @@ objectmatrixerror matrix_addscalar(objectmatrix *a, double lambda, double beta,
         for (unsigned int i=0; i<out->nrows*out->ncols; i++) {
             out->elements[i]=lambda*a->elements[i]+beta;
         }
+        MATRIX_MODIFIED(out);
         return MATRIX_OK;
     }
 
@@ -321,6 +509,7 @@ objectmatrixerror matrix_addscalar(objectmatrix *a, double lambda, double beta,
 objectmatrixerror matrix_accumulate(objectmatrix *a, double lambda, objectmatrix *b) {
     if (a->ncols==b->ncols && a->nrows==b->nrows ) {
         cblas_daxpy(a->ncols * a->nrows, lambda, b->elements, 1, a->elements, 1);
+        MATRIX_MODIFIED(a);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
@@ -332,6 +521,7 @@ objectmatrixerror matrix_sub(objectmatrix *a, objectmatrix *b, objectmatrix *out
         a->nrows==b->nrows && a->nrows==out->nrows) {
         if (a!=out) cblas_dcopy(a->ncols * a->nrows, a->elements, 1, out->elements, 1);
         cblas_daxpy(a->ncols * a->nrows, -1.0, b->elements, 1, out->elements, 1);
+        MATRIX_MODIFIED(out);
         return MATRIX_OK;
     }
     return MATRIX_INCMPTBLDIM;
@@ -339,11 +529,51 @@ objectmatrixerror matrix_sub(objectmatrix *a, objectmatrix *b, objectmatrix *out
 
 /** Performs a * b -> out */
 objectmatrixerror matrix_mul(objectmatrix *a, objectmatrix *b, objectmatrix *out) {
-    if (a->ncols==b->nrows && a->nrows==out->nrows && b->ncols==out->ncols) {
+    if (!(a->ncols==b->nrows && a->nrows==out->nrows && b->ncols==out->ncols)) return MATRIX_INCMPTBLDIM;
+    
+    if (MATRIX_ISKERNELSIZE(a) && MATRIX_ISKERNELSIZE(b)) {
+        int n=(a->nrows==a->ncols && b->nrows==b->ncols ? a->nrows : 0);
+        switch (n) {
+            case 2: matrix_mul2(a->elements, b->elements, out->elements); break;
+            case 3: matrix_mul3(a->elements, b->elements, out->elements); break;
+            case 4: matrix_mul4(a->elements, b->elements, out->elements); break;
+            default: matrix_mulsmall(a->nrows, a->ncols, b->ncols, a->elements, b->elements, out->elements);
+        }
+    } else {
         cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, a->nrows, b->ncols, a->ncols, 1.0, a->elements, a->nrows, b->elements, b->nrows, 0.0, out->elements, out->nrows);
-        return MATRIX_OK;
     }
-    return MATRIX_INCMPTBLDIM;
+    MATRIX_MODIFIED(out);
+    
+    return MATRIX_OK;
+}
+
+/** Performs alpha * a * b + beta * out -> out
+ * @param[in] alpha - scale for the product
+ * @param[in] a - lhs
+ * @param[in] b - rhs
+ * @param[in] beta - scale for the existing contents of out; if zero, out need not be initialized
+ * @param[in,out] out - destination, which must not alias a or b
+ * @returns objectmatrixerror indicating the status; MATRIX_OK indicates success. */
+objectmatrixerror matrix_gemm(double alpha, objectmatrix *a, objectmatrix *b, double beta, objectmatrix *out) {
+    if (!(a->ncols==b->nrows && a->nrows==out->nrows && b->ncols==out->ncols)) return MATRIX_INCMPTBLDIM;
+    
+    if (MATRIX_ISKERNELSIZE(a) && MATRIX_ISKERNELSIZE(b)) {
+        int m=a->nrows, p=a->ncols;
+        for (int j=0; j<b->ncols; j++) {
+            for (int i=0; i<m; i++) {
+                double sum=0.0;
+                for (int k=0; k<p; k++) sum+=a->elements[i+k*m]*b->elements[k+j*p];
+                out->elements[i+j*m]=alpha*sum + (beta==0.0 ? 0.0 : beta*out->elements[i+j*m]);
+            }
+        }
+    } else if (b->ncols==1) {
+        cblas_dgemv(CblasColMajor, CblasNoTrans, a->nrows, a->ncols, alpha, a->elements, a->nrows, b->elements, 1, beta, out->elements, 1);
+    } else {
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, a->nrows, b->ncols, a->ncols, alpha, a->elements, a->nrows, b->elements, b->nrows, beta, out->elements, out->nrows);
+    }
+    MATRIX_MODIFIED(out);
+    
+    return MATRIX_OK;
 }
 
 /** Finds the Frobenius inner product of two matrices  */
@@ -366,6 +596,11 @@ objectmatrixerror matrix_inner(objectmatrix *a, objectmatrix *b, double *out) {
  * */
 static objectmatrixerror matrix_div(objectmatrix *a, objectmatrix *b, objectmatrix *out, double *lu, int *pivot) {
     int n=a->nrows, nrhs = b->ncols, info;
+    MATRIX_MODIFIED(out);
+    
+    if (a->nrows==a->ncols && MATRIX_ISKERNELSIZE(a)) {
+        return matrix_solvesmall(n, nrhs, a->elements, b->elements, out->elements);
+    }
     
     cblas_dcopy(a->ncols * a->nrows, a->elements, 1, lu, 1);
     if (b!=out) cblas_dcopy(b->ncols * b->nrows, b->elements, 1, out->elements, 1);
@@ -414,6 +649,11 @@ objectmatrixerror matrix_divl(objectmatrix *a, objectmatrix *b, objectmatrix *ou
 objectmatrixerror matrix_inverse(objectmatrix *a, objectmatrix *out) {
     int nrows=a->nrows, ncols=a->ncols, info;
     if (!(a->ncols==out->nrows && a->ncols == out->nrows)) return MATRIX_INCMPTBLDIM;
+    MATRIX_MODIFIED(out);
+    
+    if (nrows==ncols && nrows>0 && MATRIX_ISKERNELSIZE(a) && a!=out) {
+        return matrix_inversesmall(nrows, a->elements, out->elements);
+    }
     
     int pivot[nrows];
     
@@ -436,6 +676,54 @@ objectmatrixerror matrix_inverse(objectmatrix *a, objectmatrix *out) {
     return (info==0 ? MATRIX_OK : (info>0 ? MATRIX_SING : MATRIX_INVLD));
 }
 
+/** Computes the determinant of a square matrix
+ * @param[in] a - the matrix
+ * @param[out] out - the determinant
+ * @returns objectmatrixerror indicating the status; MATRIX_OK indicates success.
+ * @details Small matrices use closed form expressions; larger ones are LU factorized. */
+objectmatrixerror matrix_det(objectmatrix *a, double *out) {
+    int n=a->nrows, info;
+    if (a->nrows!=a->ncols) return MATRIX_NSQ;
+    if (n==0) { *out=1.0; return MATRIX_OK; }
+    
+    if (MATRIX_ISKERNELSIZE(a)) {
+        *out=matrix_detsmall(n, a->elements);
+        return MATRIX_OK;
+    }
+    
+    int *pivot=MORPHO_MALLOC(sizeof(int)*n);
+    double *lu=MORPHO_MALLOC(sizeof(double)*n*n);
+    objectmatrixerror ret=MATRIX_ALLOC;
+    
+    if (pivot && lu) {
+        cblas_dcopy(n*n, a->elements, 1, lu, 1);
+#ifdef MORPHO_LINALG_USE_LAPACKE
+        info=LAPACKE_dgetrf(LAPACK_COL_MAJOR, n, n, lu, n, pivot);
+#else
+        dgetrf_(&n, &n, lu, &n, pivot, &info);
+#endif
+        if (info<0) {
+            ret=MATRIX_INVLD;
+        } else if (info>0) { // An exactly zero pivot
+            *out=0.0;
+            ret=MATRIX_OK;
+        } else {
+            double det=1.0;
+            for (int i=0; i<n; i++) {
+                det*=lu[i*(n+1)];
+                if (pivot[i]!=i+1) det=-det; // Pivots are 1-indexed
+            }
+            *out=det;
+            ret=MATRIX_OK;
+        }
+    }
+    
+    if (pivot) MORPHO_FREE(pivot);
+    if (lu) MORPHO_FREE(lu);
+    
+    return ret;
+}
+
 /** Sums all elements of a matrix using Kahan summation */
 double matrix_sum(objectmatrix *a) {
     unsigned int nel=a->ncols*a->nrows;
@@ -464,12 +752,19 @@ objectmatrixerror matrix_transpose(objectmatrix *a, objectmatrix *out) {
     for (unsigned int i=0; i<a->ncols; i++) {
         cblas_dcopy(a->nrows, a->elements+(i*a->nrows), 1, out->elements+i, a->ncols);
     }
+    MATRIX_MODIFIED(out);
     return MATRIX_OK;
 }
 
 /** Calculate the trace of a matrix */
 objectmatrixerror matrix_trace(objectmatrix *a, double *out) {
     if (a->nrows!=a->ncols) return MATRIX_NSQ;
+    if (MATRIX_ISKERNELSIZE(a)) {
+        double tr=0.0;
+        for (int i=0; i<a->nrows; i++) tr+=a->elements[i*(a->nrows+1)];
+        *out=tr;
+        return MATRIX_OK;
+    }
     *out=1.0;
     *out=cblas_ddot(a->nrows, a->elements, a->ncols+1, out, 0);
     
@@ -479,6 +774,7 @@ objectmatrixerror matrix_trace(objectmatrix *a, double *out) {
 /** Scale a matrix */
 objectmatrixerror matrix_scale(objectmatrix *a, double scale) {
     cblas_dscal(a->ncols*a->nrows, scale, a->elements, 1);
+    MATRIX_MODIFIED(a);
     
     return MATRIX_OK;
 }
@@ -487,6 +783,7 @@ objectmatrixerror matrix_scale(objectmatrix *a, double scale) {
 objectmatrixerror matrix_identity(objectmatrix *a) {
     if (a->ncols!=a->nrows) return MATRIX_NSQ;
     for (int i=0; i<a->nrows; i++) for (int j=0; j<a->ncols; j++) a->elements[i+a->nrows*j]=(i==j ? 1.0 : 0.0);
+    MATRIX_MODIFIED(a);
     
     return MATRIX_OK;
 }
@@ -649,13 +946,21 @@ value Matrix_getcolumn(vm *v, int nargs, value *args) {
     objectmatrix *m=MORPHO_GETMATRIX(MORPHO_SELF(args));
     value out=MORPHO_NIL;
     
-    if (nargs==1 &&
+    if ((nargs==1 || (nargs==2 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 1)))) &&
         MORPHO_ISINTEGER(MORPHO_GETARG(args, 0))) {
         unsigned int col = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0));
         
         if (col<m->ncols) {
             double *vals;
-            if (matrix_getcolumn(m, col, &vals)) {
+            if (!matrix_getcolumn(m, col, &vals)) return MORPHO_NIL;
+            
+            if (nargs==2) { // Copy into the destination matrix provided
+                objectmatrix *dest=MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
+                if (dest->nrows==m->nrows && dest->ncols==1) {
+                    matrix_setcolumn(dest, 0, vals);
+                    out=MORPHO_GETARG(args, 1);
+                } else morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+            } else {
                 objectmatrix *new=object_matrixfromfloats(m->nrows, 1, vals);
                 if (new) {
                     out=MORPHO_OBJECT(new);
@@ -919,6 +1224,134 @@ value Matrix_acc(vm *v, int nargs, value *args) {
     return MORPHO_NIL;
 }
 
+/** Copies the contents of another matrix of the same shape into this one */
+value Matrix_copyfrom(vm *v, int nargs, value *args) {
+    objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    
+    if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        
+        if (matrix_copy(b, a)!=MATRIX_OK) morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+    } else morpho_runtimeerror(v, MATRIX_INPLACEARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Multiplies this matrix by a number in place */
+value Matrix_scale(vm *v, int nargs, value *args) {
+    objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    double scale;
+    
+    if (nargs==1 && morpho_valuetofloat(MORPHO_GETARG(args, 0), &scale)) {
+        matrix_scale(a, scale);
+    } else morpho_runtimeerror(v, MATRIX_INPLACEARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Computes a matrix product into this matrix: self = alpha*A*B + beta*self, with alpha and beta optional */
+static void matrix_gemmhelper(vm *v, objectmatrix *out, objectmatrix *a, objectmatrix *b, double alpha, double beta) {
+    if (out==a || out==b) {
+        morpho_runtimeerror(v, MATRIX_ALIASED);
+    } else if (matrix_gemm(alpha, a, b, beta, out)!=MATRIX_OK) {
+        morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+    }
+}
+
+/** General matrix-matrix product into this matrix, self = alpha*A*B + beta*self */
+value Matrix_gemm(vm *v, int nargs, value *args) {
+    objectmatrix *out=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    double alpha=1.0, beta=0.0;
+    
+    if (nargs>=2 && nargs<=4 &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 1)) &&
+        (nargs<3 || morpho_valuetofloat(MORPHO_GETARG(args, 2), &alpha)) &&
+        (nargs<4 || morpho_valuetofloat(MORPHO_GETARG(args, 3), &beta))) {
+        matrix_gemmhelper(v, out, MORPHO_GETMATRIX(MORPHO_GETARG(args, 0)), MORPHO_GETMATRIX(MORPHO_GETARG(args, 1)), alpha, beta);
+    } else morpho_runtimeerror(v, MATRIX_INPLACEARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Matrix-vector product into this column vector, self = A*x + beta*self */
+value Matrix_gemv(vm *v, int nargs, value *args) {
+    objectmatrix *out=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    double beta=0.0;
+    
+    if (nargs>=2 && nargs<=3 &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 1)) &&
+        (nargs<3 || morpho_valuetofloat(MORPHO_GETARG(args, 2), &beta))) {
+        objectmatrix *x=MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
+        
+        if (x->ncols==1) {
+            matrix_gemmhelper(v, out, MORPHO_GETMATRIX(MORPHO_GETARG(args, 0)), x, 1.0, beta);
+        } else morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+    } else morpho_runtimeerror(v, MATRIX_INPLACEARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Multiplies this matrix by another, storing the result in a given destination matrix */
+value Matrix_mulinto(vm *v, int nargs, value *args) {
+    objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    if (nargs==2 &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 1))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        objectmatrix *dest=MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
+        
+        if (dest==a || dest==b) {
+            morpho_runtimeerror(v, MATRIX_ALIASED);
+        } else if (matrix_mul(a, b, dest)==MATRIX_OK) {
+            out=MORPHO_GETARG(args, 1);
+        } else morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+    } else morpho_runtimeerror(v, MATRIX_INPLACEARGS);
+    
+    return out;
+}
+
+/** Adds or subtracts a matrix, writing the result into a given destination */
+static value matrix_addinto(vm *v, int nargs, value *args, double sign) {
+    objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    if (nargs==2 &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISMATRIX(MORPHO_GETARG(args, 1))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        objectmatrix *dest=MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
+        objectmatrixerror err;
+        
+        if (dest==a || dest==b) {
+            morpho_runtimeerror(v, MATRIX_ALIASED);
+            return out;
+        }
+        
+        if (sign>0) err=matrix_add(a, b, dest);
+        else err=matrix_sub(a, b, dest);
+        
+        if (err==MATRIX_OK) {
+            out=MORPHO_GETARG(args, 1);
+        } else morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+    } else morpho_runtimeerror(v, MATRIX_INPLACEARGS);
+    
+    return out;
+}
+
+/** Adds a matrix, writing the sum into a destination */
+value Matrix_addinto(vm *v, int nargs, value *args) {
+    return matrix_addinto(v, nargs, args, 1.0);
+}
+
+/** Subtracts a matrix, writing the difference into a destination */
+value Matrix_subinto(vm *v, int nargs, value *args) {
+    return matrix_addinto(v, nargs, args, -1.0);
+}
+
 /** Frobenius inner product */
 value Matrix_inner(vm *v, int nargs, value *args) {
     objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
@@ -979,6 +1412,23 @@ value Matrix_trace(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Determinant of a matrix */
+value Matrix_det(vm *v, int nargs, value *args) {
+    objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    if (a->nrows==a->ncols) {
+        double det;
+        objectmatrixerror err=matrix_det(a, &det);
+        if (err==MATRIX_OK) out=MORPHO_FLOAT(det);
+        else if (err==MATRIX_ALLOC) morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    } else {
+        morpho_runtimeerror(v, MATRIX_NOTSQ);
+    }
+    
+    return out;
+}
+
 /** Enumerate protocol */
 value Matrix_enumerate(vm *v, int nargs, value *args) {
     objectmatrix *a=MORPHO_GETMATRIX(MORPHO_SELF(args));
@@ -1048,11 +1498,20 @@ MORPHO_METHOD(MORPHO_MUL_METHOD, Matrix_mul, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_MULR_METHOD, Matrix_mulr, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_DIV_METHOD, Matrix_div, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ACC_METHOD, Matrix_acc, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_AXPY_METHOD, Matrix_acc, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_GEMV_METHOD, Matrix_gemv, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_GEMM_METHOD, Matrix_gemm, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_MULINTO_METHOD, Matrix_mulinto, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_ADDINTO_METHOD, Matrix_addinto, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_SUBINTO_METHOD, Matrix_subinto, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_COPYFROM_METHOD, Matrix_copyfrom, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_SCALE_METHOD, Matrix_scale, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_INNER_METHOD, Matrix_inner, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SUM_METHOD, Matrix_sum, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_NORM_METHOD, Matrix_norm, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_TRANSPOSE_METHOD, Matrix_transpose, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_TRACE_METHOD, Matrix_trace, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MATRIX_DET_METHOD, Matrix_det, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ENUMERATE_METHOD, Matrix_enumerate, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_COUNT_METHOD, Matrix_count, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_DIMENSIONS_METHOD, Matrix_dimensions, BUILTIN_FLAGSEMPTY),
@@ -1081,4 +1540,6 @@ void matrix_initialize(void) {
     morpho_defineerror(MATRIX_SINGULAR, ERROR_HALT, MATRIX_SINGULAR_MSG);
     morpho_defineerror(MATRIX_NOTSQ, ERROR_HALT, MATRIX_NOTSQ_MSG);
     morpho_defineerror(MATRIX_SETCOLARGS, ERROR_HALT, MATRIX_SETCOLARGS_MSG);
+    morpho_defineerror(MATRIX_INPLACEARGS, ERROR_HALT, MATRIX_INPLACEARGS_MSG);
+    morpho_defineerror(MATRIX_ALIASED, ERROR_HALT, MATRIX_ALIASED_MSG);
 }
@@ -42,6 +42,7 @@ typedef struct {
     object obj;
     unsigned int nrows;
     unsigned int ncols;
+    unsigned int version; // Incremented whenever the elements are modified in place
     double *elements;
     double matrixdata[];
 } objectmatrix;
@@ -61,6 +62,9 @@ objectmatrix *object_matrixfromarray(objectarray *array);
 /** Creates a new matrix from an existing matrix */
 objectmatrix *object_clonematrix(objectmatrix *array);
 
+/** Records that the elements of a matrix have been modified in place */
+#define MATRIX_MODIFIED(m) ((m)->version++)
+
 /** @brief Use to create static matrices on the C stack
     @details Intended for small matrices; Caller needs to supply a double array of size nr*nc. */
 #define MORPHO_STATICMATRIX(darray, nr, nc)      { .obj.type=OBJECT_MATRIX, .obj.status=OBJECT_ISUNMANAGED, .obj.next=NULL, .elements=darray, .nrows=nr, .ncols=nc }
@@ -68,6 +72,12 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 /** Macro to decide if a matrix is 'small' or 'large' and hence static or dynamic allocation should be used. */
 #define MATRIX_ISSMALL(m) (m->nrows*m->ncols<MORPHO_MAXIMUMSTACKALLOC)
 
+/** Largest dimension handled by the fixed size kernels in place of blas and lapack */
+#define MATRIX_KERNELSIZE 4
+
+/** Macro to decide if a matrix is small enough for the fixed size kernels */
+#define MATRIX_ISKERNELSIZE(m) ((m)->nrows<=MATRIX_KERNELSIZE && (m)->ncols<=MATRIX_KERNELSIZE)
+
 /* -------------------------------------------------------
  * Matrix class
  * ------------------------------------------------------- */
@@ -83,6 +93,14 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 #define MATRIX_NORM_METHOD "norm"
 #define MATRIX_GETCOLUMN_METHOD "column"
 #define MATRIX_SETCOLUMN_METHOD "setcolumn"
+#define MATRIX_AXPY_METHOD "axpy"
+#define MATRIX_GEMV_METHOD "gemv"
+#define MATRIX_GEMM_METHOD "gemm"
+#define MATRIX_MULINTO_METHOD "mulinto"
+#define MATRIX_ADDINTO_METHOD "addinto"
+#define MATRIX_SUBINTO_METHOD "subinto"
+#define MATRIX_COPYFROM_METHOD "copyfrom"
+#define MATRIX_SCALE_METHOD "scale"
 
 #define MATRIX_DIMENSIONS_METHOD "dimensions"
 
@@ -116,6 +134,12 @@ objectmatrix *object_clonematrix(objectmatrix *array);
 #define MATRIX_SETCOLARGS                 "MtrxStClArgs"
 #define MATRIX_SETCOLARGS_MSG             "Method setcolumn expects an integer column index and a column matrix as arguments."
 
+#define MATRIX_INPLACEARGS                "MtrxInPlcArgs"
+#define MATRIX_INPLACEARGS_MSG            "In place matrix methods expect matrices as operands and numbers as coefficients."
+
+#define MATRIX_ALIASED                    "MtrxAlsd"
+#define MATRIX_ALIASED_MSG                "Destination of a matrix product must be distinct from its operands."
+
 /* -------------------------------------------------------
  * Matrix errors
  * ------------------------------------------------------- */
@@ -144,6 +168,7 @@ objectmatrixerror matrix_add(objectmatrix *a, objectmatrix *b, objectmatrix *out
 objectmatrixerror matrix_accumulate(objectmatrix *a, double lambda, objectmatrix *b);
 objectmatrixerror matrix_sub(objectmatrix *a, objectmatrix *b, objectmatrix *out);
 objectmatrixerror matrix_mul(objectmatrix *a, objectmatrix *b, objectmatrix *out);
+objectmatrixerror matrix_gemm(double alpha, objectmatrix *a, objectmatrix *b, double beta, objectmatrix *out);
 objectmatrixerror matrix_inner(objectmatrix *a, objectmatrix *b, double *out);
 objectmatrixerror matrix_divs(objectmatrix *a, objectmatrix *b, objectmatrix *out);
 objectmatrixerror matrix_divl(objectmatrix *a, objectmatrix *b, objectmatrix *out);
@@ -153,7 +178,7 @@ objectmatrixerror matrix_trace(objectmatrix *a, double *out);
 objectmatrixerror matrix_scale(objectmatrix *a, double scale);
 objectmatrixerror matrix_identity(objectmatrix *a);
 double matrix_sum(objectmatrix *a);
-//objectmatrixerror matrix_det(objectmatrix *a, double *out);
+objectmatrixerror matrix_det(objectmatrix *a, double *out);
 //objectmatrixerror matrix_eigensystem(objectmatrix *a, double *val, objectmatrix *vec);
 
 void matrix_print(objectmatrix *m);
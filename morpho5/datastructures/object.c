@@ -16,14 +16,72 @@
 #include "common.h"
 
 /* **********************************************************************
- * Reuse pool
+ * Object pools
  * ********************************************************************** */
 
-#ifdef MORPHO_REUSEPOOL
-#define POOLMAX 1000
-int npool;
-object *pool;
-#endif
+/* Small objects are allocated in size classes that are multiples of MORPHO_OBJECTPOOLGRANULARITY
+   bytes. When freed, they're kept on a free list for their size class and reused by object_new,
+   rather than being returned to the allocator. */
+
+#define OBJECTPOOL_NCLASSES (MORPHO_OBJECTPOOLMAXSIZE/MORPHO_OBJECTPOOLGRANULARITY)
+
+/** A pool of freed objects of the same size class */
+typedef struct {
+    object *free; /** Free list, linked through the object's next field */
+    unsigned int count; /** Number of objects on the free list */
+} objectpool;
+
+/** Pools indexed by size class; size class 0 is for objects that aren't pooled */
+objectpool objectpools[OBJECTPOOL_NCLASSES+1];
+
+/** Allocates memory for an object, reusing a freed object of the same size class if possible */
+static object *objectpool_allocate(size_t size) {
+    unsigned int sizeclass = (unsigned int) ((size+MORPHO_OBJECTPOOLGRANULARITY-1)/MORPHO_OBJECTPOOLGRANULARITY);
+    object *new;
+    
+    if (sizeclass>OBJECTPOOL_NCLASSES) {
+        new = MORPHO_MALLOC(size);
+        sizeclass = 0;
+    } else if (objectpools[sizeclass].free) {
+        new = objectpools[sizeclass].free;
+        objectpools[sizeclass].free=new->next;
+        objectpools[sizeclass].count--;
+    } else new = MORPHO_MALLOC(sizeclass*MORPHO_OBJECTPOOLGRANULARITY);
+    
+    if (new) new->sizeclass=sizeclass;
+    return new;
+}
+
+/** Returns the memory used by an object to its pool, or to the allocator if the pool is full */
+static void objectpool_release(object *obj) {
+    unsigned int sizeclass = obj->sizeclass;
+    if (sizeclass>0 && sizeclass<=OBJECTPOOL_NCLASSES &&
+        objectpools[sizeclass].count*sizeclass*MORPHO_OBJECTPOOLGRANULARITY<MORPHO_OBJECTPOOLLIMIT) {
+        obj->next=objectpools[sizeclass].free;
+        objectpools[sizeclass].free=obj;
+        objectpools[sizeclass].count++;
+    } else MORPHO_FREE(obj);
+}
+
+/** Initializes the object pools */
+static void objectpool_initialize(void) {
+    for (unsigned int i=0; i<=OBJECTPOOL_NCLASSES; i++) {
+        objectpools[i].free=NULL;
+        objectpools[i].count=0;
+    }
+}
+
+/** Returns all pooled objects to the allocator */
+static void objectpool_finalize(void) {
+    for (unsigned int i=0; i<=OBJECTPOOL_NCLASSES; i++) {
+        object *next=NULL;
+        for (object *obj=objectpools[i].free; obj!=NULL; obj=next) {
+            next=obj->next;
+            MORPHO_FREE(obj);
+        }
+    }
+    objectpool_initialize();
+}
 
 /* **********************************************************************
  * Object definitions
@@ -73,12 +131,14 @@ objectclass *object_getveneerclass(objecttype type) {
  * ********************************************************************** */
 
 /** @brief Initializes an object to be a certain type
+ *  @details The size class is left alone, as it is set by object_new when memory is allocated
  *  @param obj    object to initialize
  *  @param type   type to initialize with */
 void object_init(object *obj, objecttype type) {
     obj->next=NULL;
     obj->hsh=HASH_EMPTY;
     obj->status=OBJECT_ISUNMANAGED;
+    obj->generation=OBJECT_ISYOUNG;
     obj->type=type;
 }
 
@@ -92,7 +152,7 @@ void object_free(object *obj) {
     }
 #endif
     if (object_getdefn(obj)->freefn) object_getdefn(obj)->freefn(obj);
-    MORPHO_FREE(obj);
+    objectpool_release(obj);
 }
 
 /** Free an object if it is unmanaged */
@@ -115,7 +175,7 @@ size_t object_size(object *obj) {
  *  @param size   size of memory to reserve
  *  @param type   type to initialize with */
 object *object_new(size_t size, objecttype type) {
-    object *new = MORPHO_MALLOC(size);
+    object *new = objectpool_allocate(size);
     
     if (new) object_init(new, type);
     
@@ -343,6 +403,84 @@ objectclosure *object_newclosure(objectfunction *sf, objectfunction *func, indx
     return new;
 }
 
+/* **********************************************************************
+ * Shapes
+ * ********************************************************************** */
+
+/** Creates a shape
+ * @param[in] parent - shape to derive from, or NULL to create a root shape
+ * @param[in] key - the property added to the parent, which must be interned
+ * @returns the new shape, or NULL if allocation failed */
+objectshape *objectshape_new(objectshape *parent, value key) {
+    objectshape *new = MORPHO_MALLOC(sizeof(objectshape));
+    
+    if (new) {
+        new->parent=parent;
+        new->child=NULL;
+        new->sibling=NULL;
+        new->key=key;
+        new->nslots=0;
+        dictionary_init(&new->slots);
+        
+        if (parent) {
+            if (!dictionary_copy(&parent->slots, &new->slots) ||
+                !dictionary_insertintern(&new->slots, key, MORPHO_INTEGER(parent->nslots))) {
+                dictionary_clear(&new->slots);
+                MORPHO_FREE(new);
+                return NULL;
+            }
+            new->nslots=parent->nslots+1;
+            new->sibling=parent->child;
+            parent->child=new;
+        }
+    }
+    
+    return new;
+}
+
+/** Frees a shape together with all shapes derived from it */
+void objectshape_free(objectshape *shape) {
+    objectshape *next=NULL;
+    for (objectshape *s=shape->child; s!=NULL; s=next) {
+        next=s->sibling;
+        objectshape_free(s);
+    }
+    dictionary_clear(&shape->slots);
+    MORPHO_FREE(shape);
+}
+
+/** Finds the shape that results from adding a property to a shape, creating it if necessary
+ * @param[in] shape - the current shape
+ * @param[in] key - property to add, which must be interned
+ * @returns the derived shape, or NULL if allocation failed */
+objectshape *objectshape_transition(objectshape *shape, value key) {
+    for (objectshape *s=shape->child; s!=NULL; s=s->sibling) {
+        if (MORPHO_ISSAME(s->key, key)) return s;
+    }
+    return objectshape_new(shape, key);
+}
+
+/** Finds the slot that holds a property
+ * @param[in] shape - the shape
+ * @param[in] key - property name, which must be interned
+ * @param[out] slot - the slot index
+ * @returns true if the shape holds the property */
+bool objectshape_getslot(objectshape *shape, value key, unsigned int *slot) {
+    value indx;
+    if (dictionary_getintern(&shape->slots, key, &indx)) {
+        *slot=MORPHO_GETINTEGERVALUE(indx);
+        return true;
+    }
+    return false;
+}
+
+/** Finds the name of the property held in a given slot */
+value objectshape_getkey(objectshape *shape, unsigned int slot) {
+    objectshape *s=shape;
+    while (s && s->nslots>slot+1) s=s->parent;
+    return (s && s->nslots==slot+1 ? s->key : MORPHO_NIL);
+}
+
 /* **********************************************************************
  * Classes
  * ********************************************************************** */
@@ -365,6 +503,7 @@ void objectclass_freefn(object *obj) {
     objectclass *klass = (objectclass *) obj;
     morpho_freeobject(klass->name);
     dictionary_clear(&klass->methods);
+    if (klass->shape) objectshape_free(klass->shape);
 }
 
 size_t objectclass_sizefn(object *obj) {
@@ -385,6 +524,12 @@ objectclass *object_newclass(value name) {
         newclass->name=object_clonestring(name);
         dictionary_init(&newclass->methods);
         newclass->superclass=NULL;
+        newclass->version=0;
+        newclass->shape=objectshape_new(NULL, MORPHO_NIL);
+        if (!newclass->shape) {
+            object_free((object *) newclass);
+            return NULL;
+        }
     }
     
     return newclass;
@@ -409,26 +554,22 @@ void objectinstance_printfn(object *obj) {
 
 void objectinstance_markfn(object *obj, void *v) {
     objectinstance *c = (objectinstance *) obj;
+    for (unsigned int i=0; i<c->shape->nslots; i++) morpho_markvalue(v, c->slots[i]);
     morpho_markdictionary(v, &c->fields);
 }
 
 void objectinstance_freefn(object *obj) {
     objectinstance *instance = (objectinstance *) obj;
     
-#ifdef MORPHO_REUSEPOOL
-    if (npool<POOLMAX) {
-        obj->next=pool;
-        pool=obj;
-        npool++;
-        return;
-    }
-#endif
-
+    if (instance->slots!=instance->inlineslots) MORPHO_FREE(instance->slots);
     dictionary_clear(&instance->fields);
 }
 
 size_t objectinstance_sizefn(object *obj) {
-    return sizeof(objectinstance);
+    objectinstance *instance = (objectinstance *) obj;
+    size_t size = sizeof(objectinstance)+sizeof(value)*MORPHO_INSTANCESLOTS;
+    if (instance->slots!=instance->inlineslots) size+=sizeof(value)*instance->capacity;
+    return size;
 }
 
 objecttypedefn objectinstancedefn = {
@@ -440,34 +581,50 @@ objecttypedefn objectinstancedefn = {
 
 /** Create an instance */
 objectinstance *object_newinstance(objectclass *klass) {
-    objectinstance *new;
-    
-#ifdef MORPHO_REUSEPOOL
-    if (npool>0) {
-        new = (objectinstance *) pool;
-        pool = new->obj.next;
-        npool--;
-        
-        new->obj.next=NULL;
-        new->obj.hsh=HASH_EMPTY;
-        new->obj.status=OBJECT_ISUNMANAGED;
-        dictionary_wipe(&new->fields);
-        
-        new->klass=klass;
-        return new;
-    }
-#endif
-    
-    new = (objectinstance *) object_new(sizeof(objectinstance), OBJECT_INSTANCE);
+    /* The first few slots are allocated alongside the instance */
+    objectinstance *new = (objectinstance *) object_new(sizeof(objectinstance)+sizeof(value)*MORPHO_INSTANCESLOTS, OBJECT_INSTANCE);
     
     if (new) {
         new->klass=klass;
+        new->shape=klass->shape;
+        new->slots=new->inlineslots;
+        new->capacity=MORPHO_INSTANCESLOTS;
         dictionary_init(&new->fields);
     }
     
     return new;
 }
 
+/** Ensures an instance has room for at least n slots */
+static bool objectinstance_reserve(objectinstance *obj, unsigned int n) {
+    if (n<=obj->capacity) return true;
+    
+    unsigned int capacity=(obj->capacity ? 2*obj->capacity : 1);
+    while (capacity<n) capacity*=2;
+    
+    value *new;
+    if (obj->slots==obj->inlineslots) { /* Move out of the slots allocated with the instance */
+        new=MORPHO_MALLOC(sizeof(value)*capacity);
+        if (new && obj->capacity) memcpy(new, obj->slots, sizeof(value)*obj->capacity);
+    } else new=morpho_allocate(obj->slots, sizeof(value)*obj->capacity, sizeof(value)*capacity);
+    if (!new) return false;
+    
+    obj->slots=new;
+    obj->capacity=capacity;
+    return true;
+}
+
+/** Adds a property to an instance, moving it to a new shape */
+static bool objectinstance_addslot(objectinstance *obj, value key, value val) {
+    objectshape *shape=objectshape_transition(obj->shape, key);
+    
+    if (!shape || !objectinstance_reserve(obj, shape->nslots)) return false;
+    
+    obj->slots[shape->nslots-1]=val;
+    obj->shape=shape;
+    return true;
+}
+
 /* @brief Inserts a value into a property
  * @param obj   the object
  * @param key   key to use @warning: This MUST have been previously interned into a symboltable
@@ -475,7 +632,18 @@ objectinstance *object_newinstance(objectclass *klass) {
  * @param val   value to use
  * @returns true on success  */
 bool objectinstance_setproperty(objectinstance *obj, value key, value val) {
-    return dictionary_insertintern(&obj->fields, key, val);
+    unsigned int slot;
+    if (objectshape_getslot(obj->shape, key, &slot)) {
+        obj->slots[slot]=val;
+        return true;
+    }
+    
+    /* A property previously set with a dynamic key stays in the dictionary */
+    if (obj->fields.count>0 && dictionary_get(&obj->fields, key, NULL)) {
+        return dictionary_insert(&obj->fields, key, val);
+    }
+    
+    return objectinstance_addslot(obj, key, val);
 }
 
 /* @brief Gets a value into a property
@@ -485,9 +653,71 @@ bool objectinstance_setproperty(objectinstance *obj, value key, value val) {
  * @param[out] val   stores the value
  * @returns true on success  */
 bool objectinstance_getproperty(objectinstance *obj, value key, value *val) {
+    unsigned int slot;
+    if (objectshape_getslot(obj->shape, key, &slot)) {
+        *val=obj->slots[slot];
+        return true;
+    }
     return dictionary_getintern(&obj->fields, key, val);
 }
 
+/* @brief Sets a property using a key that need not be interned
+ * @details Properties already held in the instance's shape are updated in place;
+ *          otherwise the property is stored in the dictionary of dynamic fields.
+ * @param obj   the object
+ * @param key   key to use
+ * @param val   value to use
+ * @returns true on success  */
+bool objectinstance_setpropertybyname(objectinstance *obj, value key, value val) {
+    value indx;
+    if (dictionary_get(&obj->shape->slots, key, &indx)) {
+        obj->slots[MORPHO_GETINTEGERVALUE(indx)]=val;
+        return true;
+    }
+    return dictionary_insert(&obj->fields, key, val);
+}
+
+/* @brief Gets a property using a key that need not be interned
+ * @param obj   the object
+ * @param key   key to use
+ * @param[out] val   stores the value; may be NULL
+ * @returns true if the object has the property  */
+bool objectinstance_getpropertybyname(objectinstance *obj, value key, value *val) {
+    value indx;
+    if (dictionary_get(&obj->shape->slots, key, &indx)) {
+        if (val) *val=obj->slots[MORPHO_GETINTEGERVALUE(indx)];
+        return true;
+    }
+    return dictionary_get(&obj->fields, key, val);
+}
+
+/* @brief Copies all properties of one instance to another instance of the same class, which should have no properties
+ * @returns true on success  */
+bool objectinstance_copyproperties(objectinstance *src, objectinstance *dest) {
+    if (!objectinstance_reserve(dest, src->shape->nslots)) return false;
+    for (unsigned int i=0; i<src->shape->nslots; i++) dest->slots[i]=src->slots[i];
+    dest->shape=src->shape;
+    
+    return dictionary_copy(&src->fields, &dest->fields);
+}
+
+/* @brief Gets the name of the i'th property of an instance
+ * @details Properties held in slots come first, in the order they were added, followed by dynamic fields.
+ * @returns the name, or nil if i is out of range */
+value objectinstance_getkey(objectinstance *obj, unsigned int i) {
+    if (i<obj->shape->nslots) return objectshape_getkey(obj->shape, i);
+    
+    unsigned int k=obj->shape->nslots;
+    dictionary *dict=&obj->fields;
+    for (unsigned int j=0; j<dict->capacity; j++) {
+        if (!MORPHO_ISNIL(dict->contents[j].key)) {
+            if (k==i) return dict->contents[j].key;
+            k++;
+        }
+    }
+    return MORPHO_NIL;
+}
+
 /* **********************************************************************
  * Invocations
  * ********************************************************************** */
@@ -846,10 +1076,7 @@ objecttype objectlisttype;
 objecttype objectrangetype;
 
 void object_initialize(void) {
-#ifdef MORPHO_REUSEPOOL
-    pool=NULL;
-    npool=0;
-#endif
+    objectpool_initialize();
     
     objectfunctiontype=object_addtype(&objectfunctiondefn);
     objectupvaluetype=object_addtype(&objectupvaluedefn);
@@ -866,4 +1093,5 @@ void object_initialize(void) {
 }
 
 void object_finalize(void) {
+    objectpool_finalize();
 }
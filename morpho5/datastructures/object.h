@@ -23,6 +23,13 @@ void object_finalize(void);
 /** Categorizes the type of an object */
 typedef int objecttype;
 
+/** Generations used by the garbage collector */
+enum {
+    OBJECT_ISYOUNG, /* Bound since the last collection */
+    OBJECT_ISOLD, /* Survived a collection */
+    OBJECT_ISREMEMBERED /* Old, but may refer to young objects */
+};
+
 /** Simplest object */
 struct sobject {
     objecttype type;
@@ -31,6 +38,8 @@ struct sobject {
         OBJECT_ISUNMARKED,
         OBJECT_ISMARKED
     } status;
+    unsigned int generation : 8; /* Generation, for the garbage collector */
+    unsigned int sizeclass : 8; /* Size class of the pool the object was allocated from; set by object_new */
     hash hsh;
     struct sobject *next; 
 };
@@ -209,6 +218,30 @@ objectclosure *object_newclosure(objectfunction *sf, objectfunction *func, indx
 /** Retrieve the function object from a closure */
 #define MORPHO_GETCLOSUREFUNCTION(val)  (((objectclosure *) MORPHO_GETOBJECT(val))->func)
 
+/* ---------------------------
+ * Shapes
+ * --------------------------- */
+
+/** @brief The layout of the properties held by an instance
+ *  @details Instances of a class that acquire the same properties in the same order share a shape,
+ *  which maps each property name to a slot in the instance. Shapes form a tree rooted at the class:
+ *  adding a property to an instance moves it to a child of its current shape. Shapes aren't
+ *  objects; they belong to their class and are freed with it. */
+typedef struct sobjectshape {
+    struct sobjectshape *parent; /** Shape this one was derived from; NULL for the root */
+    struct sobjectshape *child; /** First shape derived from this one */
+    struct sobjectshape *sibling; /** Next shape derived from the same parent */
+    value key; /** Property added in the transition from the parent; this must be interned */
+    unsigned int nslots; /** Number of properties */
+    dictionary slots; /** Maps property names to slot indices */
+} objectshape;
+
+objectshape *objectshape_new(objectshape *parent, value key);
+void objectshape_free(objectshape *shape);
+objectshape *objectshape_transition(objectshape *shape, value key);
+bool objectshape_getslot(objectshape *shape, value key, unsigned int *slot);
+value objectshape_getkey(objectshape *shape, unsigned int slot);
+
 /* ---------------------------
  * Classes
  * --------------------------- */
@@ -221,6 +254,8 @@ typedef struct sobjectclass {
     struct sobjectclass *superclass;
     value name;
     dictionary methods;
+    unsigned int version; // Incremented whenever methods are added
+    objectshape *shape; // Root of the tree of instance shapes
 } objectclass;
 
 /** Tests whether an object is a class */
@@ -232,6 +267,9 @@ typedef struct sobjectclass {
 /** Gets the superclass */
 #define MORPHO_GETSUPERCLASS(val)   (MORPHO_GETCLASS(val)->superclass)
 
+/** Records that the methods of a class have changed, invalidating any inline caches that refer to it */
+#define CLASS_MODIFIED(k) ((k)->version++)
+
 objectclass *object_newclass(value name);
 
 objectclass *morpho_lookupclass(value obj);
@@ -246,7 +284,11 @@ extern objecttype objectinstancetype;
 typedef struct {
     object obj;
     objectclass *klass;
-    dictionary fields;
+    objectshape *shape; // Layout of the properties held in slots
+    value *slots; // Properties named by interned symbols, indexed by the shape
+    unsigned int capacity; // Allocated size of slots
+    dictionary fields; // Properties with dynamic keys that were not found in the shape
+    value inlineslots[]; // The first MORPHO_INSTANCESLOTS slots, allocated with the instance
 } objectinstance;
 
 /** Tests whether an object is a class */
@@ -257,8 +299,15 @@ typedef struct {
 
 objectinstance *object_newinstance(objectclass *klass);
 
+/** Number of properties held by an instance */
+#define OBJECTINSTANCE_COUNT(obj) ((obj)->shape->nslots + (obj)->fields.count)
+
 bool objectinstance_setproperty(objectinstance *obj, value key, value val);
 bool objectinstance_getproperty(objectinstance *obj, value key, value *val);
+bool objectinstance_setpropertybyname(objectinstance *obj, value key, value val);
+bool objectinstance_getpropertybyname(objectinstance *obj, value key, value *val);
+bool objectinstance_copyproperties(objectinstance *src, objectinstance *dest);
+value objectinstance_getkey(objectinstance *obj, unsigned int i);
 
 /* ---------------------------
  * Bound methods
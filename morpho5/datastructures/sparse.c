@@ -15,6 +15,12 @@
 
 #include <limits.h>
 #include <stdlib.h>
+#include <float.h>
+
+#ifdef MORPHO_SPARSE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 /* ***************************************
  * Compatibility with Sparse libraries
@@ -26,6 +32,7 @@
 
 /* Convert a CCS structure into a CSPARSE structure */
 void sparse_ccstocsparse(sparseccs *s, cs *out) {
+    sparseccs_expand(s); // CSparse requires explicit column pointers
     out->nzmax=s->nentries;
     out->m=s->nrows;
     out->n=s->ncols;
@@ -50,102 +57,140 @@ void sparse_csparsetoccs(cs *in, sparseccs *out) {
  * Dictionary of keys format
  * *************************************** */
 
-objecttype objectdokkeytype;
-
-/** DOK key object definitions */
-void objectdokkey_printfn(object *obj) {
-    printf("<DOK key>");
-}
-
-size_t objectdokkey_sizefn(object *obj) {
-    return sizeof(objectdokkey);
-}
-
-objecttypedefn objectdokkeydefn = {
-    .printfn=objectdokkey_printfn,
-    .markfn=NULL,
-    .freefn=NULL,
-    .sizefn=objectdokkey_sizefn
-};
-
+#define SPARSEDOK_EMPTY     -1
+#define SPARSEDOK_TOMBSTONE -2
 
-DEFINE_VARRAY(dokkey, objectdokkey);
+#define SPARSEDOK_MINTABLESIZE 16
 
 /** Initializes a sparsedok structure */
 void sparsedok_init(sparsedok *dok) {
     dok->nrows=0;
     dok->ncols=0;
-    dictionary_init(&dok->dict);
-    dok->keys=NULL;
+    dok->count=0;
+    dok->nentries=0;
+    dok->capacity=0;
+    dok->tablesize=0;
+    dok->entries=NULL;
+    dok->table=NULL;
 }
 
 /** Clears a sparsedok structure */
 void sparsedok_clear(sparsedok *dok) {
-    objectdokkey *next=NULL;
-    for (objectdokkey *key=dok->keys; key!=NULL; key=next) {
-        next=(objectdokkey *) key->obj.next;
-        MORPHO_FREE(key);
-    }
-    dictionary_clear(&dok->dict);
+    if (dok->entries) MORPHO_FREE(dok->entries);
+    if (dok->table) MORPHO_FREE(dok->table);
     sparsedok_init(dok);
 }
 
-/** Create a new key from a pair of indices */
-static objectdokkey *sparsedok_newkey(sparsedok *dok, int i, int j) {
-    objectdokkey *key = MORPHO_MALLOC(sizeof(objectdokkey));
+/** Fibonacci hash of a packed key, reduced to a table of given size */
+static inline unsigned int sparsedok_hash(sparsedokkey key, unsigned int tablesize) {
+    return (unsigned int) ((key * 11400714819323198485llu) >> 32) & (tablesize-1);
+}
+
+/** Finds the slot in the hash table that refers to a given key, or -1 if not present */
+static int sparsedok_find(sparsedok *dok, sparsedokkey key) {
+    if (!dok->tablesize) return -1;
+    unsigned int mask=dok->tablesize-1;
     
-    if (key) {
-        object_init((object *) key, OBJECT_DOKKEY);
-        key->row=i;
-        key->col=j;
+    for (unsigned int k=sparsedok_hash(key, dok->tablesize); ; k=(k+1) & mask) {
+        int indx=dok->table[k];
+        if (indx==SPARSEDOK_EMPTY) return -1;
+        if (indx!=SPARSEDOK_TOMBSTONE && dok->entries[indx].key==key) return k;
     }
-    return key;
 }
 
-/** Adds a key to a dok structure.
- * @returns the key added. */
-static objectdokkey *sparsedok_addkey(sparsedok *dok, int i, int j) {
-    objectdokkey *out=sparsedok_newkey(dok, i, j);
+/** Rebuilds the hash table with room for at least n entries, discarding removed entries */
+static bool sparsedok_rehash(sparsedok *dok, unsigned int n) {
+    unsigned int size=SPARSEDOK_MINTABLESIZE;
+    while (size<4*n) size<<=1; // Keep the load factor below 1/4 after a rebuild
     
-    if (out) {
-        out->obj.next=(object *) dok->keys;
-        dok->keys=out;
-    }
+    int *table=MORPHO_MALLOC(sizeof(int)*size);
+    if (!table) return false;
+    for (unsigned int k=0; k<size; k++) table[k]=SPARSEDOK_EMPTY;
+    
+    /* Compact the entries, preserving their order */
+    unsigned int m=0;
+    for (unsigned int i=0; i<dok->nentries; i++) {
+        if (dok->entries[i].key==SPARSEDOK_REMOVED) continue;
+        dok->entries[m]=dok->entries[i];
         
-    return out;
+        unsigned int k=sparsedok_hash(dok->entries[m].key, size);
+        while (table[k]!=SPARSEDOK_EMPTY) k=(k+1) & (size-1);
+        table[k]=m;
+        m++;
+    }
+    dok->nentries=m;
+    
+    if (dok->table) MORPHO_FREE(dok->table);
+    dok->table=table;
+    dok->tablesize=size;
+    return true;
 }
 
 /** Inserts a matrix element (i,j) -> val into a sparsedok structure
- * @returns true on success. */
+ * @returns true on success */
 bool sparsedok_insert(sparsedok *dok, int i, int j, value val) {
-    objectdokkey key=MORPHO_STATICDOKKEY(i, j);
-    if (!dictionary_get(&dok->dict, MORPHO_OBJECT(&key), NULL)) {
-        objectdokkey *newkey=sparsedok_addkey(dok, i, j);
-        if (newkey) {
-            if (dok->nrows==0 || i>=dok->nrows) dok->nrows=i+1;
-            if (dok->ncols==0 || j>=dok->ncols) dok->ncols=j+1;
-            return dictionary_insert(&dok->dict, MORPHO_OBJECT(newkey), val);
-        }
-    } else {
-        return dictionary_insert(&dok->dict, MORPHO_OBJECT(&key), val);
+    if (i<0 || j<0) return false;
+    sparsedokkey key=SPARSEDOK_KEY(i, j);
+    
+    int slot=sparsedok_find(dok, key);
+    if (slot>=0) {
+        dok->entries[dok->table[slot]].val=val;
+        return true;
     }
     
-    return false;
+    /* Occupied slots, including tombstones, may fill at most half the table */
+    if (2*(dok->nentries+1)>dok->tablesize) {
+        if (!sparsedok_rehash(dok, dok->count+1)) return false;
+    }
+    
+    if (dok->nentries>=dok->capacity) {
+        unsigned int capacity=(dok->capacity ? 2*dok->capacity : SPARSEDOK_MINTABLESIZE);
+        sparsedokentry *entries=MORPHO_REALLOC(dok->entries, sizeof(sparsedokentry)*capacity);
+        if (!entries) return false;
+        dok->entries=entries;
+        dok->capacity=capacity;
+    }
+    
+    unsigned int mask=dok->tablesize-1;
+    unsigned int k=sparsedok_hash(key, dok->tablesize);
+    while (dok->table[k]>=0) k=(k+1) & mask;
+    
+    dok->table[k]=dok->nentries;
+    dok->entries[dok->nentries].key=key;
+    dok->entries[dok->nentries].val=val;
+    dok->nentries++;
+    dok->count++;
+    
+    if (dok->nrows==0 || i>=dok->nrows) dok->nrows=i+1;
+    if (dok->ncols==0 || j>=dok->ncols) dok->ncols=j+1;
+    
+    return true;
 }
 
 /** Retrieves a matrix element (i,j) from a sparsedok structure
- * @returns true on success. */
+ * @returns true if the element exists; value is copied into val */
 bool sparsedok_get(sparsedok *dok, int i, int j, value *val) {
-    objectdokkey key=MORPHO_STATICDOKKEY(i, j);
-    return dictionary_get(&dok->dict, MORPHO_OBJECT(&key), val);
+    if (i<0 || j<0) return false;
+    int slot=sparsedok_find(dok, SPARSEDOK_KEY(i, j));
+    if (slot<0) return false;
+    if (val) *val=dok->entries[dok->table[slot]].val;
+    return true;
 }
 
 /** Removes a matrix element (i,j) from a sparsedok
- * @returns true on success.
- * @warning Use sparingly as the deleted key is not recovered. */
+ * @returns true if the element was found; value is copied into val */
 bool sparsedok_remove(sparsedok *dok, int i, int j, value *val) {
-    objectdokkey key=MORPHO_STATICDOKKEY(i, j);
-    return dictionary_remove(&dok->dict, MORPHO_OBJECT(&key));
+    if (i<0 || j<0) return false;
+    int slot=sparsedok_find(dok, SPARSEDOK_KEY(i, j));
+    if (slot<0) return false;
+    
+    sparsedokentry *entry=&dok->entries[dok->table[slot]];
+    if (val) *val=entry->val;
+    entry->key=SPARSEDOK_REMOVED;
+    entry->val=MORPHO_NIL;
+    dok->table[slot]=SPARSEDOK_TOMBSTONE;
+    dok->count--;
+    return true;
 }
 
 /** Sets the dimensions of the matrix
@@ -177,14 +222,14 @@ void sparsedok_print(sparsedok *dok) {
 
 /** Number of entries in a sparsedok */
 unsigned int sparsedok_count(sparsedok *dok) {
-    return dok->dict.count;
+    return dok->count;
 }
 
 /** Loop over dok keys - initializer
  * @param[in] dok - the dictionary of keys to loop over
  * @returns Initial value for the loop counter */
 void *sparsedok_loopstart(sparsedok *dok) {
-    return dok->keys;
+    return (void *) (uintptr_t) dok->nentries;
 }
 
 /** Loop over dok keys
@@ -192,15 +237,22 @@ void *sparsedok_loopstart(sparsedok *dok) {
  * @param[in] cntr - Pointer to loop counter of type (void *)
  * @param[out] i - row index.
  * @param[out] j - column index
- * @returns true if i, j contain valid data; cntri is updated */
+ * @returns true if i, j contain valid data; cntri is updated
+ * @details Entries are visited from the most recently inserted; the counter holds the number of entries still to be visited. */
 bool sparsedok_loop(sparsedok *dok, void **cntr, int *i, int *j) {
-    objectdokkey *key = *cntr;
-    if (key) {
-        *i = key->row;
-        *j = key->col;
-        *cntr=key->obj.next;
+    uintptr_t k = (uintptr_t) *cntr;
+    while (k>0) {
+        k--;
+        sparsedokkey key=dok->entries[k].key;
+        if (key!=SPARSEDOK_REMOVED) {
+            *i = SPARSEDOK_KEYROW(key);
+            *j = SPARSEDOK_KEYCOL(key);
+            *cntr=(void *) k;
+            return true;
+        }
     }
-    return key;
+    *cntr=(void *) k;
+    return false;
 }
 
 /* Copies a sparsedok object */
@@ -211,6 +263,18 @@ bool sparsedok_copy(sparsedok *src, sparsedok *dest) {
     
     if (!sparsedok_setdimensions(dest, src->nrows, src->ncols)) return false;
     
+    /* An empty destination can take a copy of the entries and rebuild its table in one pass */
+    if (!dest->nentries && src->count) {
+        sparsedokentry *entries=MORPHO_MALLOC(sizeof(sparsedokentry)*src->nentries);
+        if (!entries) return false;
+        memcpy(entries, src->entries, sizeof(sparsedokentry)*src->nentries);
+        if (dest->entries) MORPHO_FREE(dest->entries);
+        dest->entries=entries;
+        dest->capacity=dest->nentries=src->nentries;
+        dest->count=src->count;
+        return sparsedok_rehash(dest, src->count);
+    }
+    
     while (sparsedok_loop(src, &ctr, &i, &j)) {
         if (sparsedok_get(src, i, j, &entry)) {
             if (!sparsedok_insert(dest, i, j, entry)) return false;
@@ -229,6 +293,7 @@ void sparseccs_init(sparseccs *ccs) {
     ccs->nentries=0;
     ccs->nrows=0;
     ccs->ncols=0;
+    ccs->arity=0;
     ccs->cptr=NULL;
     ccs->rix=NULL;
     ccs->values=NULL;
@@ -244,6 +309,7 @@ void sparseccs_clear(sparseccs *ccs) {
 
 /** Resizes a sparseccs */
 bool sparseccs_resize(sparseccs *ccs, int nrows, int ncols, unsigned int nentries, bool values) {
+    if (!sparseccs_expand(ccs)) goto sparseccs_resize_error;
     if (ncols>ccs->ncols) {
         ccs->cptr=MORPHO_REALLOC(ccs->cptr, sizeof(int)*(ncols+1));
         if (ccs->values || values) {
@@ -271,8 +337,9 @@ sparseccs_resize_error:
  * @param[out] entries  the entries themselves */
 bool sparseccs_getrowindices(sparseccs *ccs, int col, int *nentries, int **entries) {
     if (col>=ccs->ncols) return false;
-    *nentries=ccs->cptr[col+1]-ccs->cptr[col];
-    *entries=ccs->rix+ccs->cptr[col];
+    int start=SPARSECCS_COLSTART(ccs, col);
+    *nentries=SPARSECCS_COLSTART(ccs, col+1)-start;
+    *entries=ccs->rix+start;
     return true;
 }
 
@@ -284,8 +351,9 @@ bool sparseccs_getrowindices(sparseccs *ccs, int col, int *nentries, int **entri
  * @warning Use with caution */
 bool sparseccs_setrowindices(sparseccs *ccs, int col, int nentries, int *entries) {
     if (col>=ccs->ncols) return false;
-    if (nentries!=ccs->cptr[col+1]-ccs->cptr[col]) return false;
-    int *e=ccs->rix+ccs->cptr[col];
+    int start=SPARSECCS_COLSTART(ccs, col);
+    if (nentries!=SPARSECCS_COLSTART(ccs, col+1)-start) return false;
+    int *e=ccs->rix+start;
     for (unsigned int i=0; i<nentries; i++) e[i]=entries[i];
     
     return true;
@@ -300,7 +368,7 @@ bool sparseccs_getcolindices(sparseccs *ccs, int maxentries, int *nentries, int
     int k=0;
     
     for (int i=0; i<ccs->ncols; i++) {
-        if (ccs->cptr[i+1]!=ccs->cptr[i]) {
+        if (SPARSECCS_COLSTART(ccs, i+1)!=SPARSECCS_COLSTART(ccs, i)) {
             if (entries && k<maxentries) entries[k]=i;
             k++;
         }
@@ -320,7 +388,7 @@ bool sparseccs_getcolindicesforrow(sparseccs *ccs, int row, int maxentries, int
     int col=0, k=0;
     
     for (unsigned int i=0; i<ccs->nentries; i++) {
-        while (ccs->cptr[col+1]<=i) col++;
+        while (SPARSECCS_COLSTART(ccs, col+1)<=i) col++;
         if (ccs->rix[i]==row) {
             if (entries && k<maxentries) entries[k]=col;
             k++;
@@ -335,7 +403,8 @@ bool sparseccs_getcolindicesforrow(sparseccs *ccs, int row, int maxentries, int
  * @returns true if the element exists in the given sparsity structure, false otherwise. */
 bool sparseccs_set(sparseccs *ccs, int i, int j, double val) {
     int k;
-    for (k=ccs->cptr[j]; k<ccs->cptr[j+1]; k++) {
+    if (j>=ccs->ncols) return false;
+    for (k=SPARSECCS_COLSTART(ccs, j); k<SPARSECCS_COLSTART(ccs, j+1); k++) {
         if (ccs->rix[k]==i) {
             if (ccs->values) ccs->values[k]=val;
             return true;
@@ -348,7 +417,8 @@ bool sparseccs_set(sparseccs *ccs, int i, int j, double val) {
  * @returns true on success. */
 bool sparseccs_get(sparseccs *ccs, int i, int j, double *val) {
     int k;
-    for (k=ccs->cptr[j]; k<ccs->cptr[j+1]; k++) {
+    if (j>=ccs->ncols) return false;
+    for (k=SPARSECCS_COLSTART(ccs, j); k<SPARSECCS_COLSTART(ccs, j+1); k++) {
         if (ccs->rix[k]==i) {
             if (val) *val=(ccs->values ? ccs->values[k] : 1.0);
             return true;
@@ -365,7 +435,7 @@ static int sparseccs_compareuint(const void * a, const void * b) {
 
 /** Converts a DOK matrix to a CCS matrix */
 bool sparseccs_doktoccs(sparsedok *in, sparseccs *out, bool copyvals) {
-    int nentries=in->dict.count;
+    int nentries=in->count;
     
     sparseccs_init(out);
     if (!sparseccs_resize(out, in->nrows, in->ncols, nentries, copyvals)) return false;
@@ -374,9 +444,9 @@ bool sparseccs_doktoccs(sparsedok *in, sparseccs *out, bool copyvals) {
     for (int i=0; i<in->ncols+1; i++) out->cptr[i]=0;
         
     /* Count number of entries per column */
-    for (unsigned int i=0; i<in->dict.capacity; i++) {
-        value key=in->dict.contents[i].key;
-        if (MORPHO_ISDOKKEY(key)) out->cptr[MORPHO_GETDOKCOLWVAL(key)]++;
+    for (unsigned int i=0; i<in->nentries; i++) {
+        sparsedokkey key=in->entries[i].key;
+        if (key!=SPARSEDOK_REMOVED) out->cptr[SPARSEDOK_KEYCOL(key)]++;
     }
     
     /* Construct the column pointer array */
@@ -391,12 +461,12 @@ bool sparseccs_doktoccs(sparsedok *in, sparseccs *out, bool copyvals) {
     for (int i=0; i<nentries; i++) out->rix[i]=-1;
     
     /* Copy entries into appropriate rowindex */
-    for (unsigned int i=0; i<in->dict.capacity; i++) {
-        value key=in->dict.contents[i].key;
-        if (MORPHO_ISDOKKEY(key)) {
-            int k=out->cptr[MORPHO_GETDOKCOLWVAL(key)];
+    for (unsigned int i=0; i<in->nentries; i++) {
+        sparsedokkey key=in->entries[i].key;
+        if (key!=SPARSEDOK_REMOVED) {
+            int k=out->cptr[SPARSEDOK_KEYCOL(key)];
             while (out->rix[k]!=-1) k++;
-            out->rix[k]=MORPHO_GETDOKROWWVAL(key);
+            out->rix[k]=SPARSEDOK_KEYROW(key);
         }
     }
     
@@ -427,6 +497,55 @@ bool sparseccs_doktoccs(sparsedok *in, sparseccs *out, bool copyvals) {
     return true;
 }
 
+/** Converts a CCS matrix back to a DOK matrix, e.g. so that it can be edited
+ * @details Entries of pattern-only matrices become 1, consistent with sparseccs_get. */
+bool sparseccs_ccstodok(sparseccs *in, sparsedok *out) {
+    if (!sparsedok_setdimensions(out, in->nrows, in->ncols)) return false;
+    
+    for (int j=0; j<in->ncols; j++) {
+        for (int k=SPARSECCS_COLSTART(in, j); k<SPARSECCS_COLSTART(in, j+1); k++) {
+            value val = (in->values ? MORPHO_FLOAT(in->values[k]) : MORPHO_INTEGER(1));
+            if (!sparsedok_insert(out, in->rix[k], j, val)) return false;
+        }
+    }
+    
+    return true;
+}
+
+/** Converts a CCS matrix to compact pattern-only storage, discarding any values.
+ *  If every column has the same number of entries, as is the case for simplex connectivity, the column pointer array is discarded too. */
+bool sparseccs_compactpattern(sparseccs *ccs) {
+    if (ccs->values) {
+        MORPHO_FREE(ccs->values);
+        ccs->values=NULL;
+    }
+    
+    if (!ccs->cptr || ccs->ncols<1) return true;
+    
+    int arity=ccs->cptr[1]-ccs->cptr[0];
+    if (arity<1) return true;
+    for (int j=1; j<ccs->ncols; j++) if (ccs->cptr[j+1]-ccs->cptr[j]!=arity) return true;
+    
+    MORPHO_FREE(ccs->cptr);
+    ccs->cptr=NULL;
+    ccs->arity=arity;
+    
+    return true;
+}
+
+/** Restores the explicit column pointer array of a fixed arity matrix */
+bool sparseccs_expand(sparseccs *ccs) {
+    if (ccs->cptr || !ccs->arity) return true;
+    
+    ccs->cptr=MORPHO_MALLOC(sizeof(int)*(ccs->ncols+1));
+    if (!ccs->cptr) return false;
+    
+    for (int j=0; j<=ccs->ncols; j++) ccs->cptr[j]=j*ccs->arity;
+    ccs->arity=0;
+    
+    return true;
+}
+
 /** Prints a sparsedok matrix */
 void sparseccs_print(sparseccs *ccs) {
     double val;
@@ -445,10 +564,104 @@ unsigned int sparseccs_count(sparseccs *ccs) {
     return ccs->nentries;
 }
 
+/** Builds a CCS matrix from triplets (COO format), summing duplicate entries
+ * @param[out] out - the matrix; any existing contents are discarded
+ * @param[in] nrows } dimensions of the matrix
+ * @param[in] ncols }
+ * @param[in] n - number of triplets
+ * @param[in] rows - row index of each triplet
+ * @param[in] cols - column index of each triplet
+ * @param[in] vals - value of each triplet, or NULL to build a pattern-only matrix
+ * @returns true on success, false if an index is out of range or allocation failed
+ * @details Triplets are bucketed by row and then by column with two counting sorts, which leaves the row indices within each column in order. This takes O(n+nrows+ncols) time and never touches the DOK. */
+bool sparseccs_fromtriplets(sparseccs *out, int nrows, int ncols, unsigned int n, int *rows, int *cols, double *vals) {
+    bool success=false;
+    unsigned int nalloc=(n>0 ? n : 1);
+    int *rptr=NULL, *order=NULL, *cptr=NULL, *rix=NULL;
+    double *values=NULL;
+    
+    if (nrows<0 || ncols<0) return false;
+    for (unsigned int k=0; k<n; k++) {
+        if (rows[k]<0 || rows[k]>=nrows || cols[k]<0 || cols[k]>=ncols) return false;
+    }
+    
+    rptr=MORPHO_MALLOC(sizeof(int)*(nrows+1));
+    order=MORPHO_MALLOC(sizeof(int)*nalloc);
+    cptr=MORPHO_MALLOC(sizeof(int)*(ncols+1));
+    rix=MORPHO_MALLOC(sizeof(int)*nalloc);
+    if (vals) values=MORPHO_MALLOC(sizeof(double)*nalloc);
+    if (!(rptr && order && cptr && rix) || (vals && !values)) goto sparseccs_fromtriplets_cleanup;
+    
+    /* Bucket the triplets by row */
+    for (int i=0; i<=nrows; i++) rptr[i]=0;
+    for (unsigned int k=0; k<n; k++) rptr[rows[k]+1]++;
+    for (int i=0; i<nrows; i++) rptr[i+1]+=rptr[i];
+    for (unsigned int k=0; k<n; k++) order[rptr[rows[k]]++]=k;
+    
+    /* Bucket by column, visiting triplets in row order; afterwards cptr[j] marks the end of column j */
+    for (int j=0; j<=ncols; j++) cptr[j]=0;
+    for (unsigned int k=0; k<n; k++) cptr[cols[k]+1]++;
+    for (int j=0; j<ncols; j++) cptr[j+1]+=cptr[j];
+    for (unsigned int m=0; m<n; m++) {
+        int k=order[m], p=cptr[cols[k]]++;
+        rix[p]=rows[k];
+        if (values) values[p]=vals[k];
+    }
+    
+    /* Sum duplicates, compacting each column in place */
+    int nnz=0, start=0;
+    for (int j=0; j<ncols; j++) {
+        int end=cptr[j];
+        cptr[j]=nnz;
+        for (int p=start; p<end; p++) {
+            if (nnz>cptr[j] && rix[nnz-1]==rix[p]) {
+                if (values) values[nnz-1]+=values[p];
+            } else {
+                rix[nnz]=rix[p];
+                if (values) values[nnz]=values[p];
+                nnz++;
+            }
+        }
+        start=end;
+    }
+    cptr[ncols]=nnz;
+    
+    sparseccs_clear(out);
+    out->nrows=nrows;
+    out->ncols=ncols;
+    out->nentries=nnz;
+    out->cptr=cptr;
+    out->rix=rix;
+    out->values=values;
+    success=true;
+    
+sparseccs_fromtriplets_cleanup:
+    if (rptr) MORPHO_FREE(rptr);
+    if (order) MORPHO_FREE(order);
+    if (!success) {
+        if (cptr) MORPHO_FREE(cptr);
+        if (rix) MORPHO_FREE(rix);
+        if (values) MORPHO_FREE(values);
+    }
+    return success;
+}
+
 /** Copies one sparseccs matrix to another, reallocating as necessary */
 bool sparseccs_copy(sparseccs *src, sparseccs *dest) {
     bool success=false;
-    if (sparseccs_resize(dest, src->nrows, src->ncols, src->nentries, src->values)) {
+    if (!src->cptr && src->arity) { // Fixed arity matrices have no column pointers
+        sparseccs_clear(dest);
+        dest->rix=MORPHO_MALLOC(sizeof(int)*src->nentries);
+        if (!dest->rix) return false;
+        memcpy(dest->rix, src->rix, sizeof(int)*(src->nentries));
+        dest->nrows=src->nrows;
+        dest->ncols=src->ncols;
+        dest->nentries=src->nentries;
+        dest->arity=src->arity;
+        return true;
+    }
+    
+    if (src->cptr && sparseccs_resize(dest, src->nrows, src->ncols, src->nentries, src->values)) {
         memcpy(dest->cptr, src->cptr, sizeof(int)*(src->ncols+1));
         memcpy(dest->rix, src->rix, sizeof(int)*(src->nentries));
         if (src->values) memcpy(dest->values, src->values, sizeof(double)*src->nentries);
@@ -457,6 +670,98 @@ bool sparseccs_copy(sparseccs *src, sparseccs *dest) {
     return success;
 }
 
+/** Transposes a CCS matrix; the result is equivalently the input in compressed row format
+ * @details Entries are bucketed by row with a counting sort, which leaves the row indices of the output sorted within each column. Pattern-only matrices give a pattern-only transpose. */
+bool sparseccs_transpose(sparseccs *in, sparseccs *out) {
+    sparseccs_init(out);
+    
+    int nrows=in->ncols, ncols=in->nrows;
+    unsigned int n=in->nentries;
+    out->cptr=MORPHO_MALLOC(sizeof(int)*(ncols+1));
+    out->rix=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    if (in->values) out->values=MORPHO_MALLOC(sizeof(double)*(n>0 ? n : 1));
+    if (!out->cptr || !out->rix || (in->values && !out->values)) goto sparseccs_transpose_error;
+    
+    out->nrows=nrows;
+    out->ncols=ncols;
+    out->nentries=n;
+    
+    /* Count entries in each row of the input */
+    for (int i=0; i<=ncols; i++) out->cptr[i]=0;
+    for (unsigned int k=0; k<n; k++) out->cptr[in->rix[k]+1]++;
+    for (int i=0; i<ncols; i++) out->cptr[i+1]+=out->cptr[i];
+    
+    /* Scatter, using cptr as a running offset that ends up shifted by one row */
+    for (int j=0; j<in->ncols; j++) {
+        for (int k=SPARSECCS_COLSTART(in, j); k<SPARSECCS_COLSTART(in, j+1); k++) {
+            int p=out->cptr[in->rix[k]]++;
+            out->rix[p]=j;
+            if (in->values) out->values[p]=in->values[k];
+        }
+    }
+    for (int i=ncols; i>0; i--) out->cptr[i]=out->cptr[i-1];
+    out->cptr[0]=0;
+    
+    return true;
+    
+sparseccs_transpose_error:
+    sparseccs_clear(out);
+    return false;
+}
+
+/** Checks whether two CCS matrices have the same dimensions and pattern */
+static bool sparseccs_samepattern(sparseccs *a, sparseccs *b) {
+    if (a->nrows!=b->nrows || a->ncols!=b->ncols || a->nentries!=b->nentries) return false;
+    for (int j=0; j<=a->ncols; j++) if (SPARSECCS_COLSTART(a, j)!=SPARSECCS_COLSTART(b, j)) return false;
+    return (memcmp(a->rix, b->rix, sizeof(int)*a->nentries)==0);
+}
+
+/** Copies the pattern of a CCS matrix, with explicit column pointers
+ * @param[in] src - the source
+ * @param[out] dest - the copy; any existing contents are discarded
+ * @param[in] values - whether to allocate (uninitialized) values */
+static bool sparseccs_copypattern(sparseccs *src, sparseccs *dest, bool values) {
+    sparseccs_clear(dest);
+    dest->cptr=MORPHO_MALLOC(sizeof(int)*(src->ncols+1));
+    dest->rix=MORPHO_MALLOC(sizeof(int)*(src->nentries>0 ? src->nentries : 1));
+    if (values) dest->values=MORPHO_MALLOC(sizeof(double)*(src->nentries>0 ? src->nentries : 1));
+    if (!dest->cptr || !dest->rix || (values && !dest->values)) {
+        sparseccs_clear(dest);
+        return false;
+    }
+    
+    for (int j=0; j<=src->ncols; j++) dest->cptr[j]=SPARSECCS_COLSTART(src, j);
+    memcpy(dest->rix, src->rix, sizeof(int)*src->nentries);
+    dest->nrows=src->nrows;
+    dest->ncols=src->ncols;
+    dest->nentries=src->nentries;
+    return true;
+}
+
+/** Finds the position of entry (i,j), or returns -1 if it is not in the pattern */
+static int sparseccs_find(sparseccs *ccs, int i, int j) {
+    if (j<0 || j>=ccs->ncols) return -1;
+    for (int k=SPARSECCS_COLSTART(ccs, j); k<SPARSECCS_COLSTART(ccs, j+1); k++) {
+        if (ccs->rix[k]==i) return k;
+    }
+    return -1;
+}
+
+/** Gives a pattern-only matrix explicit values, all equal to one */
+static bool sparseccs_ensurevalues(sparseccs *ccs) {
+    if (ccs->values) return true;
+    ccs->values=MORPHO_MALLOC(sizeof(double)*(ccs->nentries>0 ? ccs->nentries : 1));
+    if (!ccs->values) return false;
+    for (unsigned int k=0; k<ccs->nentries; k++) ccs->values[k]=1.0;
+    return true;
+}
+
+/** Value of an entry of a row, allowing for pattern-only matrices */
+static inline double sparse_entry(sparseccs *csr, int p) {
+    return (csr->values ? csr->values[p] : 1.0);
+}
+
+
 /* ***************************************
  * Object sparse interface
  * *************************************** */
@@ -470,12 +775,17 @@ bool sparseccs_copy(sparseccs *src, sparseccs *dest) {
 bool sparse_checkformat(objectsparse *sparse, objectsparseformat format, bool force, bool copyvals) {
     switch (format) {
         case SPARSE_DOK:
-            return (sparse->dok.ncols>0 && sparse->dok.nrows>0)||(sparse->dok.dict.count>0);
+            if ((sparse->dok.ncols>0 && sparse->dok.nrows>0)||(sparse->dok.count>0)) return true;
+            if (force && sparse->ccs.rix) { // Pattern-only matrices hold their data in CCS format
+                return sparseccs_ccstodok(&sparse->ccs, &sparse->dok);
+            }
+            return false;
         case SPARSE_CCS:
-            if (force && !sparse->ccs.cptr) {
+            if (force && !sparse->ccs.cptr && !sparse->ccs.arity) {
                 return sparseccs_doktoccs(&sparse->dok, &sparse->ccs, copyvals);
-            } else return (sparse->ccs.cptr);
+            } else return (sparse->ccs.cptr || sparse->ccs.arity);
     }
+    return false;
 }
 
 /** Removes data structures for a given format */
@@ -484,9 +794,17 @@ void sparse_removeformat(objectsparse *s,  objectsparseformat format) {
         sparsedok_clear(&s->dok);
     } else {
         sparseccs_clear(&s->ccs);
+        sparseccs_clear(&s->trans);
     }
 }
 
+/** Converts a sparse matrix that will not be edited, e.g. mesh connectivity, to compact pattern-only CCS storage. The DOK is discarded; it is rebuilt from the CCS if the matrix is later modified. */
+bool sparse_compactpattern(objectsparse *s) {
+    if (!sparse_checkformat(s, SPARSE_CCS, true, false)) return false;
+    sparse_removeformat(s, SPARSE_DOK);
+    return sparseccs_compactpattern(&s->ccs);
+}
+
 /* ***************************************
  * Testing code
  * *************************************** */
@@ -532,7 +850,8 @@ void objectsparse_printfn(object *obj) {
 
 void objectsparse_markfn(object *obj, void *v) {
     objectsparse *c = (objectsparse *) obj;
-    morpho_markdictionary(v, &c->dok.dict);}
+    for (unsigned int i=0; i<c->dok.nentries; i++) morpho_markvalue(v, c->dok.entries[i].val);
+}
 
 void objectsparse_freefn(object *obj) {
     objectsparse *s = (objectsparse *) obj;
@@ -550,6 +869,65 @@ objecttypedefn objectsparsedefn = {
     .sizefn=objectsparse_sizefn
 };
 
+/* ***************************************
+ * objectsparsefactorization definition
+ * *************************************** */
+
+objecttype objectsparsefactorizationtype;
+
+/** Releases the symbolic analysis and numerical factors */
+static void sparse_factorizationclear(objectsparsefactorization *f) {
+#ifdef MORPHO_LINALG_USE_CSPARSE
+    if (f->numeric) cs_nfree((csn *) f->numeric);
+    if (f->symbolic) cs_sfree((css *) f->symbolic);
+#endif
+    f->numeric=NULL;
+    f->symbolic=NULL;
+    sparseccs_clear(&f->pattern);
+}
+
+/** Sparse factorization object definitions */
+void objectsparsefactorization_printfn(object *obj) {
+    printf("<SparseFactorization>");
+}
+
+void objectsparsefactorization_freefn(object *obj) {
+    sparse_factorizationclear((objectsparsefactorization *) obj);
+}
+
+size_t objectsparsefactorization_sizefn(object *obj) {
+    objectsparsefactorization *f = (objectsparsefactorization *) obj;
+    size_t size = sizeof(objectsparsefactorization) +
+                  (f->pattern.cptr ? sizeof(int)*(f->pattern.ncols+1+f->pattern.nentries) : 0);
+#ifdef MORPHO_LINALG_USE_CSPARSE
+    csn *N = (csn *) f->numeric;
+    if (N && N->L) size+=N->L->nzmax*(sizeof(int)+sizeof(double));
+    if (N && N->U) size+=N->U->nzmax*(sizeof(int)+sizeof(double));
+#endif
+    return size;
+}
+
+objecttypedefn objectsparsefactorizationdefn = {
+    .printfn=objectsparsefactorization_printfn,
+    .markfn=NULL,
+    .freefn=objectsparsefactorization_freefn,
+    .sizefn=objectsparsefactorization_sizefn
+};
+
+/** Creates an empty sparse factorization object */
+objectsparsefactorization *object_newsparsefactorization(sparsefactorizationtype type) {
+    objectsparsefactorization *new = (objectsparsefactorization *) object_new(sizeof(objectsparsefactorization), OBJECT_SPARSEFACTORIZATION);
+    
+    if (new) {
+        new->type=type;
+        sparseccs_init(&new->pattern);
+        new->symbolic=NULL;
+        new->numeric=NULL;
+    }
+    
+    return new;
+}
+
 /* ***************************************
  * objectsparse objects
  * *************************************** */
@@ -563,6 +941,7 @@ objectsparse *object_newsparse(int *nrows, int *ncols) {
     if (new) {
         sparsedok_init(&new->dok);
         sparseccs_init(&new->ccs);
+        sparseccs_init(&new->trans);
         if (nrows) sparsedok_setdimensions(&new->dok, *nrows, *ncols);
     }
     
@@ -621,6 +1000,29 @@ objectsparse *object_sparsefromlist(objectlist *list) {
     return new;
 }
 
+/** Creates a sparse matrix from triplets, summing duplicate entries
+ * @param[in] nrows } dimensions of the matrix; pass negative values to size the matrix to fit the indices
+ * @param[in] ncols }
+ * @param[in] n - number of triplets
+ * @param[in] rows - row indices
+ * @param[in] cols - column indices
+ * @param[in] vals - values, or NULL for a pattern-only matrix
+ * @returns the new matrix, held in CCS format, or NULL if the indices are invalid */
+objectsparse *sparse_fromtriplets(int nrows, int ncols, unsigned int n, int *rows, int *cols, double *vals) {
+    if (nrows<0) for (unsigned int k=0; k<n; k++) if (rows[k]>=nrows) nrows=rows[k]+1;
+    if (ncols<0) for (unsigned int k=0; k<n; k++) if (cols[k]>=ncols) ncols=cols[k]+1;
+    if (nrows<0) nrows=0;
+    if (ncols<0) ncols=0;
+    
+    objectsparse *new=object_newsparse(NULL, NULL);
+    if (new && !sparseccs_fromtriplets(&new->ccs, nrows, ncols, n, rows, cols, vals)) {
+        object_free((object *) new);
+        new=NULL;
+    }
+    
+    return new;
+}
+
 /** Clones a sparse matrix */
 objectsparse *sparse_clone(objectsparse *s) {
     objectsparse *new = object_newsparse(NULL, NULL);
@@ -635,6 +1037,20 @@ objectsparse *sparse_clone(objectsparse *s) {
 
 /** Set an element */
 bool sparse_setelement(objectsparse *s, int row, int col, value val) {
+    double x;
+    int k;
+    if (s->ccs.values && morpho_valuetofloat(val, &x) &&
+        (k=sparseccs_find(&s->ccs, row, col))>=0) { // Entries already in the pattern are updated in place, keeping the CCS
+        if (sparse_checkformat(s, SPARSE_DOK, false, false) && !sparsedok_insert(&s->dok, row, col, val)) return false;
+        s->ccs.values[k]=x;
+        sparseccs_clear(&s->trans);
+        return true;
+    }
+    
+    if (!sparse_checkformat(s, SPARSE_DOK, false, false) && s->ccs.rix) {
+        if (!sparse_checkformat(s, SPARSE_DOK, true, false)) return false; // Restore DOK for editing
+    }
+    
     if (sparsedok_insert(&s->dok, row, col, val)) {
         sparse_removeformat(s, SPARSE_CCS);
         return true;
@@ -655,6 +1071,7 @@ bool sparse_getelement(objectsparse *s, int row, int col, value *val) {
         double v;
         if (sparseccs_get(&s->ccs, row, col, &v)) {
             if (val) *val = MORPHO_FLOAT(v);
+            return true;
         }
     }
     return false;
@@ -664,45 +1081,221 @@ bool sparse_getelement(objectsparse *s, int row, int col, value *val) {
 bool sparse_enumerate(objectsparse *s, int i, value *out) {
     if (sparse_checkformat(s, SPARSE_CCS, false, false)) {
         if (i<0) { *out=MORPHO_INTEGER(s->ccs.nentries); return true; }
-        if (i<s->ccs.nentries) { *out=MORPHO_FLOAT(s->ccs.values[i]); return true; }
+        if (i<s->ccs.nentries) { *out=MORPHO_FLOAT(s->ccs.values ? s->ccs.values[i] : 1.0); return true; }
     } else if (sparse_checkformat(s, SPARSE_DOK, false, false)) {
-        if (i<0) { *out=MORPHO_INTEGER(s->dok.dict.count); return true; }
-        if (i<s->dok.dict.count) {
-            objectdokkey *key = s->dok.keys;
-            for (int k=0; k<i; k++) if (key) key=(objectdokkey *) key->obj.next;
+        if (i<0) { *out=MORPHO_INTEGER(s->dok.count); return true; }
+        if (i<s->dok.count) {
+            if (s->dok.count==s->dok.nentries) { // No removed entries, so index directly in loop order
+                *out=s->dok.entries[s->dok.nentries-1-i].val;
+                return true;
+            }
             
-            if (key) return dictionary_get(&s->dok.dict, MORPHO_OBJECT(key), out);
+            void *ctr=sparsedok_loopstart(&s->dok);
+            int row, col;
+            for (int k=0; k<=i; k++) if (!sparsedok_loop(&s->dok, &ctr, &row, &col)) return false;
+            
+            return sparsedok_get(&s->dok, row, col, out);
         }
     }
     
     return false;
 }
 
+/* ***************************************
+ * Pattern union cache
+ * *************************************** */
+
+/** The union of two sparsity patterns, with the position in the union of each entry of the operands */
+typedef struct {
+    sparseccs a; // Pattern of the first operand
+    sparseccs b; // Pattern of the second operand
+    sparseccs out; // Pattern of the union
+    int *amap; // Position in out of each entry of a
+    int *bmap; // Position in out of each entry of b
+    unsigned int lastused;
+} sparseunion;
+
+/** Unions are kept so that sums of matrices whose patterns recur, e.g. in each step of an iteration, only combine values */
+static sparseunion sparse_unioncache[MORPHO_SPARSE_UNIONCACHESIZE];
+static unsigned int sparse_unionclock;
+
+/** Clears a pattern union */
+static void sparseunion_clear(sparseunion *u) {
+    sparseccs_clear(&u->a);
+    sparseccs_clear(&u->b);
+    sparseccs_clear(&u->out);
+    if (u->amap) MORPHO_FREE(u->amap);
+    if (u->bmap) MORPHO_FREE(u->bmap);
+    u->amap=NULL;
+    u->bmap=NULL;
+    u->lastused=0;
+}
+
+/** Computes the union of two patterns of the same dimensions
+ * @details Each column of the union lists the entries of a in order, followed by any entries of b not in a; if the pattern of b is contained in that of a, the union is therefore identical to a. */
+static bool sparseunion_build(sparseunion *u, sparseccs *a, sparseccs *b) {
+    int nrows=a->nrows, ncols=a->ncols;
+    unsigned int nmax=a->nentries+b->nentries;
+    int *w=MORPHO_MALLOC(sizeof(int)*(nrows>0 ? nrows : 1)); // Position in the union of each row of the current column
+    bool success=false;
+    
+    sparseunion_clear(u);
+    u->amap=MORPHO_MALLOC(sizeof(int)*(a->nentries>0 ? a->nentries : 1));
+    u->bmap=MORPHO_MALLOC(sizeof(int)*(b->nentries>0 ? b->nentries : 1));
+    u->out.cptr=MORPHO_MALLOC(sizeof(int)*(ncols+1));
+    u->out.rix=MORPHO_MALLOC(sizeof(int)*(nmax>0 ? nmax : 1));
+    if (!(w && u->amap && u->bmap && u->out.cptr && u->out.rix) ||
+        !sparseccs_copypattern(a, &u->a, false) ||
+        !sparseccs_copypattern(b, &u->b, false)) goto sparseunion_build_cleanup;
+    
+    for (int i=0; i<nrows; i++) w[i]=-1;
+    
+    int nz=0;
+    for (int j=0; j<ncols; j++) {
+        int start=nz; // Positions from earlier columns all lie before start
+        u->out.cptr[j]=start;
+        for (int k=SPARSECCS_COLSTART(a, j); k<SPARSECCS_COLSTART(a, j+1); k++) {
+            int r=a->rix[k];
+            if (w[r]<start) { w[r]=nz; u->out.rix[nz++]=r; }
+            u->amap[k]=w[r];
+        }
+        for (int k=SPARSECCS_COLSTART(b, j); k<SPARSECCS_COLSTART(b, j+1); k++) {
+            int r=b->rix[k];
+            if (w[r]<start) { w[r]=nz; u->out.rix[nz++]=r; }
+            u->bmap[k]=w[r];
+        }
+    }
+    u->out.cptr[ncols]=nz;
+    u->out.nrows=nrows;
+    u->out.ncols=ncols;
+    u->out.nentries=nz;
+    success=true;
+    
+sparseunion_build_cleanup:
+    if (w) MORPHO_FREE(w);
+    if (!success) sparseunion_clear(u);
+    return success;
+}
+
+/** Finds the union of two patterns of the same dimensions in the cache, computing it if necessary
+ * @returns the union, which remains valid until the next call, or NULL on failure */
+static sparseunion *sparse_getunion(sparseccs *a, sparseccs *b) {
+    sparseunion *u=sparse_unioncache;
+    
+    for (int i=0; i<MORPHO_SPARSE_UNIONCACHESIZE; i++) {
+        sparseunion *c=sparse_unioncache+i;
+        if (c->out.cptr && sparseccs_samepattern(&c->a, a) && sparseccs_samepattern(&c->b, b)) {
+            c->lastused=++sparse_unionclock;
+            return c;
+        }
+        if (c->lastused<u->lastused) u=c; // Least recently used, or empty
+    }
+    
+    if (!sparseunion_build(u, a, b)) return NULL;
+    u->lastused=++sparse_unionclock;
+    return u;
+}
+
 /** Add two matrices
  * @param[in] a - sparse matrix
  * @param[in] b - sparse matrix
  * @param[in] alpha - scale for a
  * @param[in] beta - scale for b
- * @param[out] out - alpha*a+beta*b. */
+ * @param[out] out - alpha*a+beta*b; must not be a or b.
+ * @details Matrices with the same pattern are added entry by entry; otherwise the union of the patterns is taken from the cache. */
 objectsparseerror sparse_add(objectsparse *a, objectsparse *b, double alpha, double beta, objectsparse *out) {
     if (!(sparse_checkformat(a, SPARSE_CCS, true, true) &&
           sparse_checkformat(b, SPARSE_CCS, true, true)) ) return SPARSE_CONVFAILED;
     
     if (a->ccs.ncols!=b->ccs.ncols || a->ccs.nrows != b->ccs.nrows) return SPARSE_INCMPTBLDIM;
-    sparsedok_clear(&out->dok);
-    sparseccs_clear(&out->ccs);
-#ifdef MORPHO_LINALG_USE_CSPARSE
-    cs A, B;
-    sparse_ccstocsparse(&a->ccs, &A);
-    sparse_ccstocsparse(&b->ccs, &B);
-    cs *ret=cs_add(&A, &B, alpha, beta);
-    if (ret) {
-        sparse_csparsetoccs(ret, &out->ccs);
-        free(ret);
+    sparse_clear(out);
+    
+    if (sparseccs_samepattern(&a->ccs, &b->ccs)) {
+        if (!sparseccs_copypattern(&a->ccs, &out->ccs, true)) return SPARSE_FAILED;
+        for (unsigned int k=0; k<a->ccs.nentries; k++) {
+            out->ccs.values[k]=alpha*sparse_entry(&a->ccs, k)+beta*sparse_entry(&b->ccs, k);
+        }
         return SPARSE_OK;
     }
-#endif
-    return SPARSE_FAILED;
+    
+    sparseunion *u=sparse_getunion(&a->ccs, &b->ccs);
+    if (!u || !sparseccs_copypattern(&u->out, &out->ccs, true)) return SPARSE_FAILED;
+    
+    double *val=out->ccs.values;
+    for (unsigned int k=0; k<u->out.nentries; k++) val[k]=0.0;
+    for (unsigned int k=0; k<a->ccs.nentries; k++) val[u->amap[k]]+=alpha*sparse_entry(&a->ccs, k);
+    for (unsigned int k=0; k<b->ccs.nentries; k++) val[u->bmap[k]]+=beta*sparse_entry(&b->ccs, k);
+    
+    return SPARSE_OK;
+}
+
+/** Prepares a matrix for its values to be changed in place, keeping the CCS pattern
+ * @details The DOK and cached transpose would become stale, so are discarded; the DOK is rebuilt from the CCS if the matrix is later edited by element. */
+static bool sparse_beginupdate(objectsparse *a) {
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true) ||
+        !sparseccs_expand(&a->ccs) ||
+        !sparseccs_ensurevalues(&a->ccs)) return false;
+    sparse_removeformat(a, SPARSE_DOK);
+    sparseccs_clear(&a->trans);
+    return true;
+}
+
+/** Accumulates a multiple of one matrix into another in place
+ * @param[in] a - sparse matrix, overwritten with a+alpha*b
+ * @param[in] alpha - scale for b
+ * @param[in] b - sparse matrix
+ * @details If the pattern of b is contained in that of a, only the values of a are touched; otherwise a takes the union of the patterns. */
+objectsparseerror sparse_acc(objectsparse *a, double alpha, objectsparse *b) {
+    if (a==b) return sparse_scale(a, 1.0+alpha);
+    if (!(sparse_checkformat(a, SPARSE_CCS, true, true) &&
+          sparse_checkformat(b, SPARSE_CCS, true, true)) ) return SPARSE_CONVFAILED;
+    if (a->ccs.ncols!=b->ccs.ncols || a->ccs.nrows != b->ccs.nrows) return SPARSE_INCMPTBLDIM;
+    if (!sparse_beginupdate(a)) return SPARSE_FAILED;
+    
+    double *val=a->ccs.values;
+    if (sparseccs_samepattern(&a->ccs, &b->ccs)) {
+        for (unsigned int k=0; k<a->ccs.nentries; k++) val[k]+=alpha*sparse_entry(&b->ccs, k);
+        return SPARSE_OK;
+    }
+    
+    sparseunion *u=sparse_getunion(&a->ccs, &b->ccs);
+    if (!u) return SPARSE_FAILED;
+    
+    if (u->out.nentries!=a->ccs.nentries) { // The pattern grows, so values of a move to their place in the union
+        sparseccs new;
+        sparseccs_init(&new);
+        if (!sparseccs_copypattern(&u->out, &new, true)) return SPARSE_FAILED;
+        for (unsigned int k=0; k<new.nentries; k++) new.values[k]=0.0;
+        for (unsigned int k=0; k<a->ccs.nentries; k++) new.values[u->amap[k]]=val[k];
+        sparseccs_clear(&a->ccs);
+        a->ccs=new;
+        val=new.values;
+    }
+    
+    for (unsigned int k=0; k<b->ccs.nentries; k++) val[u->bmap[k]]+=alpha*sparse_entry(&b->ccs, k);
+    
+    return SPARSE_OK;
+}
+
+/** Scales a matrix in place
+ * @param[in] a - sparse matrix, overwritten with s*a
+ * @param[in] s - scale factor */
+objectsparseerror sparse_scale(objectsparse *a, double s) {
+    if (!sparse_beginupdate(a)) return SPARSE_FAILED;
+    for (unsigned int k=0; k<a->ccs.nentries; k++) a->ccs.values[k]*=s;
+    return SPARSE_OK;
+}
+
+/** Replaces the values of a matrix in place, keeping its pattern
+ * @param[in] a - sparse matrix
+ * @param[in] n - number of values, which must match the number of entries of a
+ * @param[in] values - new values, in the order of the entries in CCS format */
+objectsparseerror sparse_setvalues(objectsparse *a, unsigned int n, double *values) {
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true)) return SPARSE_CONVFAILED;
+    if (n!=a->ccs.nentries) return SPARSE_INCMPTBLDIM;
+    if (!sparse_beginupdate(a)) return SPARSE_FAILED;
+    memcpy(a->ccs.values, values, sizeof(double)*n);
+    return SPARSE_OK;
 }
 
 /** Multiply two matrices
@@ -713,8 +1306,7 @@ objectsparseerror sparse_mul(objectsparse *a, objectsparse *b, objectsparse *out
     if (!(sparse_checkformat(a, SPARSE_CCS, true, true) &&
           sparse_checkformat(b, SPARSE_CCS, true, true)) ) return SPARSE_CONVFAILED;
     if (a->ccs.ncols!=b->ccs.nrows) return SPARSE_INCMPTBLDIM;
-    sparsedok_clear(&out->dok);
-    sparseccs_clear(&out->ccs);
+    sparse_clear(out);
     
 #ifdef MORPHO_LINALG_USE_CSPARSE
     cs A, B;
@@ -761,55 +1353,1112 @@ objectsparseerror sparse_div(objectsparse *a, objectmatrix *b, objectmatrix *out
  * @param[out] out - transpose(A). */
 objectsparseerror sparse_transpose(objectsparse *a, objectsparse *out) {
     if (!(sparse_checkformat(a, SPARSE_CCS, true, true)) ) return SPARSE_CONVFAILED;
-    sparsedok_clear(&out->dok);
-    sparseccs_clear(&out->ccs);
+    sparse_clear(out);
     
-#ifdef MORPHO_LINALG_USE_CSPARSE
-    cs A;
-    sparse_ccstocsparse(&a->ccs, &A);
-    cs *ret=cs_transpose(&A, true);
-    if (ret) {
-        sparse_csparsetoccs(ret, &out->ccs);
-        free(ret);
-        return SPARSE_OK;
-    }
-#endif
-    return SPARSE_FAILED;
+    bool success;
+    if (a->trans.cptr) success=sparseccs_copy(&a->trans, &out->ccs);
+    else success=sparseccs_transpose(&a->ccs, &out->ccs);
+    
+    return (success ? SPARSE_OK : SPARSE_FAILED);
 }
 
-/** Clears any data attached to a sparse matrix */
-void sparse_clear(objectsparse *a) {
-    sparsedok_clear(&a->dok);
-    sparseccs_clear(&a->ccs);
-}
+/* ***************************************
+ * Products with dense matrices
+ * *************************************** */
 
-/** Calculate the size of a sparse matrix structure */
-size_t sparse_size(objectsparse *a) {
-    return sizeof(objectsparse)+
-           a->dok.dict.capacity*sizeof(dictionaryentry) +
-           sizeof(int)*(a->ccs.ncols+1) +
-           sizeof(int)*(a->ccs.nentries) +
-           ( a->ccs.values ? sizeof(double)*(a->ccs.nentries) : 0);
+/** Number of threads used for large products; set in sparse_initialize */
+static int sparse_nthreads = 1;
+
+/** A block of rows of a product y = A x, computed from the compressed row form of A */
+typedef struct {
+    sparseccs *csr; // Transpose of A in CCS format, i.e. A in compressed row format
+    int ncols; // Number of columns of x and y
+    double *x; // Dense rhs with csr->nrows rows, column major
+    double *y; // Dense output with csr->ncols rows, column major
+    int rstart; // First row of y to compute
+    int rend; // One past the last row of y to compute
+} sparse_productblock;
+
+/** Dot product of a row of A with a column of x, using independent accumulators so the loop pipelines */
+static inline double sparse_dotrow(int start, int end, int *cix, double *val, double *x) {
+    double s0=0.0, s1=0.0, s2=0.0, s3=0.0;
+    int p=start;
+    
+    if (val) {
+        for (; p+4<=end; p+=4) {
+            s0+=val[p]*x[cix[p]];
+            s1+=val[p+1]*x[cix[p+1]];
+            s2+=val[p+2]*x[cix[p+2]];
+            s3+=val[p+3]*x[cix[p+3]];
+        }
+        for (; p<end; p++) s0+=val[p]*x[cix[p]];
+    } else { // Pattern-only matrices have unit entries
+        for (; p+4<=end; p+=4) {
+            s0+=x[cix[p]];
+            s1+=x[cix[p+1]];
+            s2+=x[cix[p+2]];
+            s3+=x[cix[p+3]];
+        }
+        for (; p<end; p++) s0+=x[cix[p]];
+    }
+    
+    return (s0+s1)+(s2+s3);
 }
 
-/* ***************************************
- * Sparse builtin class
- * *************************************** */
+/** Computes a block of rows of the product; columns of x are processed four at a time so that each entry of A is loaded once per group */
+static void *sparse_productrows(void *ref) {
+    sparse_productblock *b = (sparse_productblock *) ref;
+    int *rptr=b->csr->cptr, *cix=b->csr->rix;
+    double *val=b->csr->values;
+    int n=b->csr->nrows, m=b->csr->ncols;
+    int c=0;
+    
+    for (; c+4<=b->ncols; c+=4) {
+        double *x0=b->x+c*n, *x1=x0+n, *x2=x1+n, *x3=x2+n;
+        double *y0=b->y+c*m, *y1=y0+m, *y2=y1+m, *y3=y2+m;
+        
+        for (int i=b->rstart; i<b->rend; i++) {
+            double s0=0.0, s1=0.0, s2=0.0, s3=0.0;
+            for (int p=rptr[i]; p<rptr[i+1]; p++) {
+                int j=cix[p];
+                double a=(val ? val[p] : 1.0);
+                s0+=a*x0[j]; s1+=a*x1[j]; s2+=a*x2[j]; s3+=a*x3[j];
+            }
+            y0[i]=s0; y1[i]=s1; y2[i]=s2; y3[i]=s3;
+        }
+    }
+    
+    for (; c<b->ncols; c++) {
+        double *x=b->x+c*n, *y=b->y+c*m;
+        for (int i=b->rstart; i<b->rend; i++) y[i]=sparse_dotrow(rptr[i], rptr[i+1], cix, val, x);
+    }
+    
+    return NULL;
+}
 
-void sparse_raiseerror(vm *v, objectsparseerror err) {
-    switch(err) {
-        case SPARSE_OK: break;
-        case SPARSE_INCMPTBLDIM: morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES); break;
-        case SPARSE_CONVFAILED: morpho_runtimeerror(v, SPARSE_CONVFAILEDERR); break;
-        case SPARSE_FAILED: morpho_runtimeerror(v, SPARSE_OPFAILEDERR); break;
+/** Gets the cached transpose of a sparse matrix, computing it if necessary */
+static sparseccs *sparse_gettranspose(objectsparse *a) {
+    if (!a->trans.cptr) {
+        if (!sparse_checkformat(a, SPARSE_CCS, true, true)) return NULL;
+        if (!sparseccs_transpose(&a->ccs, &a->trans)) return NULL;
     }
+    return &a->trans;
 }
 
-/** Constructs a Matrix object */
-value sparse_constructor(vm *v, int nargs, value *args) {
-    int nrows, ncols;
-    objectsparse *new=NULL;
-    value out=MORPHO_NIL; 
+/** Multiplies a sparse matrix by a dense matrix held as a column major array
+ * @param[in] a - sparse matrix
+ * @param[in] ncols - number of columns of x
+ * @param[in] x - dense rhs with as many rows as a has columns
+ * @param[out] y - a*x, with as many rows as a; must not alias x
+ * @details Rows of the output are divided between threads in blocks of roughly equal numbers of entries when the product is large. */
+objectsparseerror sparse_muldense(objectsparse *a, int ncols, double *x, double *y) {
+    sparseccs *csr=sparse_gettranspose(a);
+    if (!csr) return SPARSE_CONVFAILED;
+    
+    int nrows=csr->ncols;
+    sparse_productblock block[MORPHO_SPARSE_MAXTHREADS];
+    int nthreads=1;
+    
+#ifdef MORPHO_SPARSE_THREADS
+    if ((size_t) csr->nentries*ncols>=MORPHO_SPARSE_PARALLELTHRESHOLD) nthreads=sparse_nthreads;
+    if (nthreads>nrows) nthreads=(nrows>0 ? nrows : 1);
+#endif
+    
+    /* Partition rows so that each block has about the same number of entries */
+    int r=0;
+    for (int t=0; t<nthreads; t++) {
+        block[t] = (sparse_productblock) { .csr=csr, .ncols=ncols, .x=x, .y=y, .rstart=r };
+        if (t==nthreads-1) r=nrows;
+        else {
+            size_t target=((size_t) csr->nentries*(t+1))/nthreads;
+            while (r<nrows && csr->cptr[r+1]<=target) r++;
+        }
+        block[t].rend=r;
+    }
+    
+#ifdef MORPHO_SPARSE_THREADS
+    pthread_t thread[MORPHO_SPARSE_MAXTHREADS];
+    bool started[MORPHO_SPARSE_MAXTHREADS];
+    for (int t=1; t<nthreads; t++) {
+        started[t]=(pthread_create(&thread[t], NULL, sparse_productrows, &block[t])==0);
+        if (!started[t]) sparse_productrows(&block[t]);
+    }
+    sparse_productrows(&block[0]);
+    for (int t=1; t<nthreads; t++) if (started[t]) pthread_join(thread[t], NULL);
+#else
+    sparse_productrows(&block[0]);
+#endif
+    
+    return SPARSE_OK;
+}
+
+/** Multiply a sparse matrix by a dense matrix
+ * @param[in] a - sparse matrix
+ * @param[in] b - dense matrix
+ * @param[out] out - a*b */
+objectsparseerror sparse_mulmatrix(objectsparse *a, objectmatrix *b, objectmatrix *out) {
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true)) return SPARSE_CONVFAILED;
+    if (a->ccs.ncols!=b->nrows || out->nrows!=a->ccs.nrows || out->ncols!=b->ncols || out==b) return SPARSE_INCMPTBLDIM;
+    
+    objectsparseerror err=sparse_muldense(a, b->ncols, b->elements, out->elements);
+    if (err==SPARSE_OK) MATRIX_MODIFIED(out);
+    return err;
+}
+
+/* ***************************************
+ * Iterative solvers
+ * *************************************** */
+
+/** Preconditioner data, built from the compressed row form of the matrix */
+typedef struct {
+    sparseprecondtype type;
+    int n;
+    sparseccs *csr; // Rows of the matrix, with sorted column indices
+    double omega; // Relaxation parameter for SSOR
+    int *dptr; // Position of the diagonal entry in each row
+    double *diag; // Inverse diagonal for Jacobi
+    double *lu; // Incomplete factors, stored in the pattern of csr
+} sparseprecond;
+
+/** State shared by the iterative solvers */
+typedef struct {
+    sparseoperatorfn op; // Computes y = A x
+    void *ref; // Reference passed to op
+    int n;
+    double tol;
+    int maxiter;
+    int restart;
+    sparseprecond precond;
+} sparsesolver;
+
+/** Initializes solver options with their defaults */
+void sparse_solveroptionsinit(sparsesolveroptions *opt) {
+    opt->tol=1e-8;
+    opt->maxiter=0;
+    opt->restart=30;
+    opt->precond=SPARSE_PRECONDNONE;
+    opt->omega=1.0;
+}
+
+/** Clears a preconditioner */
+static void sparseprecond_clear(sparseprecond *p) {
+    if (p->dptr) MORPHO_FREE(p->dptr);
+    if (p->diag) MORPHO_FREE(p->diag);
+    if (p->lu) MORPHO_FREE(p->lu);
+    p->dptr=NULL;
+    p->diag=NULL;
+    p->lu=NULL;
+}
+
+/** Incomplete LU factorization with no fill; L has unit diagonal and is stored below the diagonal of lu, U on and above it */
+static bool sparseprecond_ilu0(sparseprecond *p) {
+    sparseccs *csr=p->csr;
+    int *rptr=csr->cptr, *cix=csr->rix;
+    int *w=MORPHO_MALLOC(sizeof(int)*(p->n>0 ? p->n : 1)); // Maps columns to positions in the current row
+    if (!w) return false;
+    bool success=true;
+    
+    for (int i=0; i<p->n; i++) w[i]=-1;
+    
+    for (int i=0; i<p->n && success; i++) {
+        for (int q=rptr[i]; q<rptr[i+1]; q++) w[cix[q]]=q;
+        
+        for (int q=rptr[i]; q<rptr[i+1] && cix[q]<i; q++) {
+            int k=cix[q];
+            double pivot=p->lu[p->dptr[k]];
+            if (pivot==0.0) { success=false; break; }
+            
+            double mult = (p->lu[q]/=pivot);
+            for (int r=p->dptr[k]+1; r<rptr[k+1]; r++) {
+                if (w[cix[r]]>=0) p->lu[w[cix[r]]]-=mult*p->lu[r];
+            }
+        }
+        if (p->lu[p->dptr[i]]==0.0) success=false;
+        
+        for (int q=rptr[i]; q<rptr[i+1]; q++) w[cix[q]]=-1;
+    }
+    
+    MORPHO_FREE(w);
+    return success;
+}
+
+/** Incomplete Cholesky factorization with no fill, using the lower triangle; L is stored on and below the diagonal of lu */
+static bool sparseprecond_ic0(sparseprecond *p) {
+    sparseccs *csr=p->csr;
+    int *rptr=csr->cptr, *cix=csr->rix;
+    
+    for (int i=0; i<p->n; i++) {
+        double d=p->lu[p->dptr[i]];
+        for (int q=rptr[i]; q<p->dptr[i]; q++) {
+            int k=cix[q];
+            
+            /* Subtract the dot product of rows i and k to the left of column k */
+            double s=p->lu[q];
+            for (int a=rptr[i], b=rptr[k]; a<q && b<p->dptr[k]; ) {
+                if (cix[a]==cix[b]) { s-=p->lu[a]*p->lu[b]; a++; b++; }
+                else if (cix[a]<cix[b]) a++;
+                else b++;
+            }
+            
+            p->lu[q]=s/p->lu[p->dptr[k]];
+            d-=p->lu[q]*p->lu[q];
+        }
+        if (d<=0.0) return false;
+        p->lu[p->dptr[i]]=sqrt(d);
+    }
+    return true;
+}
+
+/** Builds a preconditioner
+ * @returns true on success, or false if the matrix lacks a nonzero diagonal or the factorization breaks down */
+static bool sparseprecond_init(sparseprecond *p, int n, sparseccs *csr, sparseprecondtype type, double omega) {
+    p->type=type;
+    p->n=n;
+    p->csr=csr;
+    p->omega=omega;
+    p->dptr=NULL;
+    p->diag=NULL;
+    p->lu=NULL;
+    if (type==SPARSE_PRECONDNONE) return true;
+    
+    p->dptr=MORPHO_MALLOC(sizeof(int)*(p->n>0 ? p->n : 1));
+    if (!p->dptr) return false;
+    
+    for (int i=0; i<p->n; i++) {
+        p->dptr[i]=-1;
+        for (int q=csr->cptr[i]; q<csr->cptr[i+1]; q++) {
+            if (csr->rix[q]==i) { p->dptr[i]=q; break; }
+        }
+        if (p->dptr[i]<0 || sparse_entry(csr, p->dptr[i])==0.0) goto sparseprecond_init_error;
+    }
+    
+    switch (type) {
+        case SPARSE_PRECONDJACOBI:
+            p->diag=MORPHO_MALLOC(sizeof(double)*(p->n>0 ? p->n : 1));
+            if (!p->diag) goto sparseprecond_init_error;
+            for (int i=0; i<p->n; i++) p->diag[i]=1.0/sparse_entry(csr, p->dptr[i]);
+            break;
+        case SPARSE_PRECONDSSOR:
+            if (omega<=0.0 || omega>=2.0) goto sparseprecond_init_error;
+            break;
+        case SPARSE_PRECONDILU0:
+        case SPARSE_PRECONDIC0:
+            p->lu=MORPHO_MALLOC(sizeof(double)*(csr->nentries>0 ? csr->nentries : 1));
+            if (!p->lu) goto sparseprecond_init_error;
+            for (int q=0; q<csr->nentries; q++) p->lu[q]=sparse_entry(csr, q);
+            if (!(type==SPARSE_PRECONDILU0 ? sparseprecond_ilu0(p) : sparseprecond_ic0(p))) goto sparseprecond_init_error;
+            break;
+        default: break;
+    }
+    return true;
+    
+sparseprecond_init_error:
+    sparseprecond_clear(p);
+    return false;
+}
+
+/** Applies a preconditioner, z = M^-1 r */
+static void sparseprecond_apply(sparseprecond *p, double *r, double *z) {
+    int n=p->n;
+    int *rptr=(p->csr ? p->csr->cptr : NULL), *cix=(p->csr ? p->csr->rix : NULL);
+    
+    switch (p->type) {
+        case SPARSE_PRECONDNONE:
+            if (z!=r) memcpy(z, r, sizeof(double)*n);
+            break;
+        case SPARSE_PRECONDJACOBI:
+            for (int i=0; i<n; i++) z[i]=p->diag[i]*r[i];
+            break;
+        case SPARSE_PRECONDSSOR: { // M = (D+wL) D^-1 (D+wU) / (w(2-w))
+            double w=p->omega, scale=w*(2.0-w);
+            for (int i=0; i<n; i++) {
+                double s=scale*r[i];
+                for (int q=rptr[i]; q<p->dptr[i]; q++) s-=w*sparse_entry(p->csr, q)*z[cix[q]];
+                z[i]=s/sparse_entry(p->csr, p->dptr[i]);
+            }
+            for (int i=0; i<n; i++) z[i]*=sparse_entry(p->csr, p->dptr[i]);
+            for (int i=n-1; i>=0; i--) {
+                double s=z[i];
+                for (int q=p->dptr[i]+1; q<rptr[i+1]; q++) s-=w*sparse_entry(p->csr, q)*z[cix[q]];
+                z[i]=s/sparse_entry(p->csr, p->dptr[i]);
+            }
+        }
+            break;
+        case SPARSE_PRECONDILU0:
+            for (int i=0; i<n; i++) {
+                double s=r[i];
+                for (int q=rptr[i]; q<p->dptr[i]; q++) s-=p->lu[q]*z[cix[q]];
+                z[i]=s;
+            }
+            for (int i=n-1; i>=0; i--) {
+                double s=z[i];
+                for (int q=p->dptr[i]+1; q<rptr[i+1]; q++) s-=p->lu[q]*z[cix[q]];
+                z[i]=s/p->lu[p->dptr[i]];
+            }
+            break;
+        case SPARSE_PRECONDIC0:
+            for (int i=0; i<n; i++) {
+                double s=r[i];
+                for (int q=rptr[i]; q<p->dptr[i]; q++) s-=p->lu[q]*z[cix[q]];
+                z[i]=s/p->lu[p->dptr[i]];
+            }
+            for (int i=n-1; i>=0; i--) { // Solve with the transpose by columns
+                z[i]/=p->lu[p->dptr[i]];
+                for (int q=rptr[i]; q<p->dptr[i]; q++) z[cix[q]]-=p->lu[q]*z[i];
+            }
+            break;
+    }
+}
+
+/** Computes r = b - A x */
+static void sparse_residual(sparsesolver *s, double *b, double *x, double *r) {
+    s->op(s->ref, x, r);
+    for (int i=0; i<s->n; i++) r[i]=b[i]-r[i];
+}
+
+/** Preconditioned conjugate gradients, for symmetric positive definite matrices */
+static objectsparseerror sparse_cg(sparsesolver *s, double *b, double *x, double *work) {
+    int n=s->n;
+    double *r=work, *z=r+n, *p=z+n, *q=p+n;
+    double bnorm=cblas_dnrm2(n, b, 1);
+    
+    sparse_residual(s, b, x, r);
+    if (cblas_dnrm2(n, r, 1)<=s->tol*bnorm) return SPARSE_OK;
+    
+    sparseprecond_apply(&s->precond, r, z);
+    cblas_dcopy(n, z, 1, p, 1);
+    double rz=cblas_ddot(n, r, 1, z, 1);
+    
+    for (int it=0; it<s->maxiter; it++) {
+        s->op(s->ref, p, q);
+        double pq=cblas_ddot(n, p, 1, q, 1);
+        if (pq==0.0) return SPARSE_NOTCONVERGED;
+        
+        double alpha=rz/pq;
+        cblas_daxpy(n, alpha, p, 1, x, 1);
+        cblas_daxpy(n, -alpha, q, 1, r, 1);
+        if (cblas_dnrm2(n, r, 1)<=s->tol*bnorm) return SPARSE_OK;
+        
+        sparseprecond_apply(&s->precond, r, z);
+        double rznew=cblas_ddot(n, r, 1, z, 1);
+        double beta=rznew/rz;
+        rz=rznew;
+        for (int i=0; i<n; i++) p[i]=z[i]+beta*p[i];
+    }
+    
+    return SPARSE_NOTCONVERGED;
+}
+
+/** Preconditioned MINRES, for symmetric and possibly indefinite matrices with a symmetric positive definite preconditioner
+ * @details Follows Paige and Saunders; convergence is measured by the recurrence estimate of the residual in the norm defined by the preconditioner */
+static objectsparseerror sparse_minres(sparsesolver *s, double *b, double *x, double *work) {
+    int n=s->n;
+    double *r1=work, *r2=r1+n, *y=r2+n, *v=y+n, *w=v+n, *w1=w+n, *w2=w1+n, *tmp;
+    
+    sparse_residual(s, b, x, r1);
+    sparseprecond_apply(&s->precond, r1, y);
+    double beta1=cblas_ddot(n, r1, 1, y, 1);
+    if (beta1<0.0) return SPARSE_PRECONDFAILED;
+    beta1=sqrt(beta1);
+    if (beta1==0.0) return SPARSE_OK;
+    
+    double bnorm;
+    sparseprecond_apply(&s->precond, b, v);
+    bnorm=sqrt(fabs(cblas_ddot(n, b, 1, v, 1)));
+    
+    double oldb=0.0, beta=beta1, dbar=0.0, epsln=0.0, phibar=beta1, cs=-1.0, sn=0.0;
+    cblas_dcopy(n, r1, 1, r2, 1);
+    for (int i=0; i<n; i++) w[i]=w2[i]=0.0;
+    
+    for (int it=0; it<s->maxiter; it++) {
+        for (int i=0; i<n; i++) v[i]=y[i]/beta;
+        s->op(s->ref, v, y);
+        if (it>0) cblas_daxpy(n, -beta/oldb, r1, 1, y, 1);
+        
+        double alfa=cblas_ddot(n, v, 1, y, 1);
+        cblas_daxpy(n, -alfa/beta, r2, 1, y, 1);
+        tmp=r1; r1=r2; r2=y; y=tmp;
+        
+        sparseprecond_apply(&s->precond, r2, y);
+        oldb=beta;
+        beta=cblas_ddot(n, r2, 1, y, 1);
+        if (beta<0.0) return SPARSE_PRECONDFAILED;
+        beta=sqrt(beta);
+        
+        /* Apply the previous rotation, then compute and apply the next one */
+        double oldeps=epsln;
+        double delta=cs*dbar+sn*alfa;
+        double gbar=sn*dbar-cs*alfa;
+        epsln=sn*beta;
+        dbar=-cs*beta;
+        double gamma=hypot(gbar, beta);
+        if (gamma==0.0) gamma=DBL_EPSILON;
+        cs=gbar/gamma;
+        sn=beta/gamma;
+        double phi=cs*phibar;
+        phibar=sn*phibar;
+        
+        /* Update the search direction and solution */
+        tmp=w1; w1=w2; w2=w; w=tmp;
+        for (int i=0; i<n; i++) w[i]=(v[i]-oldeps*w1[i]-delta*w2[i])/gamma;
+        cblas_daxpy(n, phi, w, 1, x, 1);
+        
+        if (phibar<=s->tol*bnorm) return SPARSE_OK;
+        if (beta==0.0) return SPARSE_OK; // The Krylov space is exhausted, so x is exact
+    }
+    
+    return SPARSE_NOTCONVERGED;
+}
+
+/** Right preconditioned BiCGSTAB, for general matrices */
+static objectsparseerror sparse_bicgstab(sparsesolver *s, double *b, double *x, double *work) {
+    int n=s->n;
+    double *r=work, *rhat=r+n, *p=rhat+n, *v=p+n, *phat=v+n, *sv=phat+n, *shat=sv+n, *t=shat+n;
+    double bnorm=cblas_dnrm2(n, b, 1);
+    
+    sparse_residual(s, b, x, r);
+    if (cblas_dnrm2(n, r, 1)<=s->tol*bnorm) return SPARSE_OK;
+    cblas_dcopy(n, r, 1, rhat, 1);
+    
+    double rho=1.0, alpha=1.0, omega=1.0;
+    for (int i=0; i<n; i++) p[i]=v[i]=0.0;
+    
+    for (int it=0; it<s->maxiter; it++) {
+        double rhonew=cblas_ddot(n, rhat, 1, r, 1);
+        if (rhonew==0.0) return SPARSE_NOTCONVERGED;
+        
+        double beta=(rhonew/rho)*(alpha/omega);
+        for (int i=0; i<n; i++) p[i]=r[i]+beta*(p[i]-omega*v[i]);
+        rho=rhonew;
+        
+        sparseprecond_apply(&s->precond, p, phat);
+        s->op(s->ref, phat, v);
+        double rv=cblas_ddot(n, rhat, 1, v, 1);
+        if (rv==0.0) return SPARSE_NOTCONVERGED;
+        alpha=rho/rv;
+        
+        for (int i=0; i<n; i++) sv[i]=r[i]-alpha*v[i];
+        if (cblas_dnrm2(n, sv, 1)<=s->tol*bnorm) {
+            cblas_daxpy(n, alpha, phat, 1, x, 1);
+            return SPARSE_OK;
+        }
+        
+        sparseprecond_apply(&s->precond, sv, shat);
+        s->op(s->ref, shat, t);
+        double tt=cblas_ddot(n, t, 1, t, 1);
+        if (tt==0.0) return SPARSE_NOTCONVERGED;
+        omega=cblas_ddot(n, t, 1, sv, 1)/tt;
+        
+        cblas_daxpy(n, alpha, phat, 1, x, 1);
+        cblas_daxpy(n, omega, shat, 1, x, 1);
+        for (int i=0; i<n; i++) r[i]=sv[i]-omega*t[i];
+        
+        if (cblas_dnrm2(n, r, 1)<=s->tol*bnorm) return SPARSE_OK;
+        if (omega==0.0) return SPARSE_NOTCONVERGED;
+    }
+    
+    return SPARSE_NOTCONVERGED;
+}
+
+/** Right preconditioned GMRES, restarted every s->restart iterations, for general matrices */
+static objectsparseerror sparse_gmres(sparsesolver *s, double *b, double *x, double *work) {
+    int n=s->n, m=s->restart;
+    double *V=work, *H=V+n*(m+1), *c=H+(m+1)*m, *sn=c+m, *g=sn+m, *z=g+m+1, *w=z+n;
+    double bnorm=cblas_dnrm2(n, b, 1);
+    
+#define GMRES_H(i,j) H[(j)*(m+1)+(i)]
+    
+    for (int it=0; it<s->maxiter; ) {
+        sparse_residual(s, b, x, V);
+        double beta=cblas_dnrm2(n, V, 1);
+        if (beta<=s->tol*bnorm) return SPARSE_OK;
+        cblas_dscal(n, 1.0/beta, V, 1);
+        
+        for (int i=0; i<=m; i++) g[i]=0.0;
+        g[0]=beta;
+        
+        int k=0;
+        bool converged=false;
+        for (int j=0; j<m && it<s->maxiter; j++, it++) {
+            double *vj=V+j*n, *vnext=vj+n;
+            sparseprecond_apply(&s->precond, vj, z);
+            s->op(s->ref, z, vnext);
+            
+            /* Modified Gram-Schmidt */
+            for (int i=0; i<=j; i++) {
+                GMRES_H(i,j)=cblas_ddot(n, vnext, 1, V+i*n, 1);
+                cblas_daxpy(n, -GMRES_H(i,j), V+i*n, 1, vnext, 1);
+            }
+            GMRES_H(j+1,j)=cblas_dnrm2(n, vnext, 1);
+            if (GMRES_H(j+1,j)!=0.0) cblas_dscal(n, 1.0/GMRES_H(j+1,j), vnext, 1);
+            
+            /* Apply previous Givens rotations and eliminate the new subdiagonal entry */
+            for (int i=0; i<j; i++) {
+                double h0=GMRES_H(i,j), h1=GMRES_H(i+1,j);
+                GMRES_H(i,j)=c[i]*h0+sn[i]*h1;
+                GMRES_H(i+1,j)=-sn[i]*h0+c[i]*h1;
+            }
+            double d=hypot(GMRES_H(j,j), GMRES_H(j+1,j));
+            if (d==0.0) break;
+            c[j]=GMRES_H(j,j)/d;
+            sn[j]=GMRES_H(j+1,j)/d;
+            GMRES_H(j,j)=d;
+            GMRES_H(j+1,j)=0.0;
+            g[j+1]=-sn[j]*g[j];
+            g[j]=c[j]*g[j];
+            
+            k=j+1;
+            if (fabs(g[j+1])<=s->tol*bnorm) { it++; converged=true; break; }
+        }
+        if (k==0) return SPARSE_NOTCONVERGED;
+        
+        /* Solve the upper triangular least squares system, then update x with M^-1 V y */
+        for (int i=k-1; i>=0; i--) {
+            double yi=g[i];
+            for (int l=i+1; l<k; l++) yi-=GMRES_H(i,l)*g[l];
+            g[i]=yi/GMRES_H(i,i);
+        }
+        for (int i=0; i<n; i++) w[i]=0.0;
+        for (int i=0; i<k; i++) cblas_daxpy(n, g[i], V+i*n, 1, w, 1);
+        sparseprecond_apply(&s->precond, w, z);
+        cblas_daxpy(n, 1.0, z, 1, x, 1);
+        
+        if (converged) return SPARSE_OK;
+    }
+    
+#undef GMRES_H
+    
+    return SPARSE_NOTCONVERGED;
+}
+
+/** Operator for a sparse matrix */
+static void sparse_operator(void *ref, double *x, double *y) {
+    sparse_muldense((objectsparse *) ref, 1, x, y);
+}
+
+/** Solves A x = b with an iterative method
+ * @param[in] a - square sparse matrix
+ * @param[in] method - the method to use
+ * @param[in] opt - solver options
+ * @param[in] b - right hand side; each column is solved for in turn
+ * @param[in,out] x - on entry, the initial guess; on exit, the solution */
+objectsparseerror sparse_solve(objectsparse *a, sparsesolvermethod method, sparsesolveroptions *opt, objectmatrix *b, objectmatrix *x) {
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true)) return SPARSE_CONVFAILED;
+    if (a->ccs.ncols!=a->ccs.nrows) return SPARSE_INCMPTBLDIM;
+    
+    sparseccs *csr=sparse_gettranspose(a);
+    if (!csr) return SPARSE_CONVFAILED;
+    
+    return sparse_solveoperator(sparse_operator, a, a->ccs.nrows, csr, method, opt, b, x);
+}
+
+/** Solves A x = b with an iterative method, where A is given as an operator
+ * @param[in] op - function that computes y = A x
+ * @param[in] ref - reference passed to op
+ * @param[in] n - size of A
+ * @param[in] csr - rows of A with sorted column indices, from which preconditioners are built; may be NULL if there is no preconditioner
+ * @param[in] method - the method to use
+ * @param[in] opt - solver options
+ * @param[in] b - right hand side; each column is solved for in turn
+ * @param[in,out] x - on entry, the initial guess; on exit, the solution */
+objectsparseerror sparse_solveoperator(sparseoperatorfn op, void *ref, int n, sparseccs *csr, sparsesolvermethod method, sparsesolveroptions *opt, objectmatrix *b, objectmatrix *x) {
+    if (b->nrows!=n || x->nrows!=n || x->ncols!=b->ncols) return SPARSE_INCMPTBLDIM;
+    if (!csr && opt->precond!=SPARSE_PRECONDNONE) return SPARSE_PRECONDFAILED;
+    
+    sparsesolver s = { .op=op, .ref=ref, .n=n, .tol=opt->tol, .restart=(opt->restart>0 ? opt->restart : 30) };
+    s.maxiter=(opt->maxiter>0 ? opt->maxiter : 10*n);
+    if (s.restart>n && n>0) s.restart=n;
+    if (!sparseprecond_init(&s.precond, n, csr, opt->precond, opt->omega)) return SPARSE_PRECONDFAILED;
+    
+    size_t nwork=8*(size_t) n;
+    if (method==SPARSE_GMRES) nwork=(size_t) n*(s.restart+3)+(size_t) (s.restart+1)*s.restart+3*s.restart+1;
+    double *work=MORPHO_MALLOC(sizeof(double)*(nwork>0 ? nwork : 1));
+    objectsparseerror err=SPARSE_FAILED;
+    
+    if (work) {
+        err=SPARSE_OK;
+        for (int j=0; j<b->ncols && err==SPARSE_OK; j++) {
+            double *bj=b->elements+j*n, *xj=x->elements+j*n;
+            if (cblas_dnrm2(n, bj, 1)==0.0) { // The solution of a homogeneous system is zero
+                for (int i=0; i<n; i++) xj[i]=0.0;
+                continue;
+            }
+            
+            switch (method) {
+                case SPARSE_CG: err=sparse_cg(&s, bj, xj, work); break;
+                case SPARSE_MINRES: err=sparse_minres(&s, bj, xj, work); break;
+                case SPARSE_BICGSTAB: err=sparse_bicgstab(&s, bj, xj, work); break;
+                case SPARSE_GMRES: err=sparse_gmres(&s, bj, xj, work); break;
+            }
+        }
+        MORPHO_FREE(work);
+        MATRIX_MODIFIED(x);
+    }
+    
+    sparseprecond_clear(&s.precond);
+    return err;
+}
+
+/* ***************************************
+ * Direct factorizations
+ * *************************************** */
+
+#define SPARSE_CHOLESKYORDER 1 // Approximate minimum degree ordering of A
+#define SPARSE_LUORDER 2 // Approximate minimum degree ordering of A'A
+#define SPARSE_LUPIVOTTOL 1.0 // Partial pivoting
+
+/** Computes numerical factors of a matrix, reusing the symbolic analysis held by f */
+static objectsparseerror sparse_numericfactor(objectsparsefactorization *f, objectsparse *a) {
+#ifdef MORPHO_LINALG_USE_CSPARSE
+    cs A;
+    sparse_ccstocsparse(&a->ccs, &A);
+    csn *N = (f->type==SPARSE_CHOLESKY ? cs_chol(&A, (css *) f->symbolic) :
+                                         cs_lu(&A, (css *) f->symbolic, SPARSE_LUPIVOTTOL));
+    if (!N) return SPARSE_FAILED;
+    
+    if (f->numeric) cs_nfree((csn *) f->numeric);
+    f->numeric=N;
+    return SPARSE_OK;
+#else
+    return SPARSE_FAILED;
+#endif
+}
+
+/** Factorizes a square sparse matrix
+ * @param[in] a - the matrix
+ * @param[in] f - factorization object, whose type selects Cholesky or LU; any previous factorization is discarded
+ * @details The symbolic analysis and the pattern of a are kept so that sparse_refactorize can reuse them. */
+objectsparseerror sparse_factorize(objectsparse *a, objectsparsefactorization *f) {
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true) || !a->ccs.values) return SPARSE_CONVFAILED;
+    if (a->ccs.nrows!=a->ccs.ncols) return SPARSE_INCMPTBLDIM;
+    sparse_factorizationclear(f);
+    
+#ifdef MORPHO_LINALG_USE_CSPARSE
+    cs A;
+    sparse_ccstocsparse(&a->ccs, &A);
+    f->symbolic = (f->type==SPARSE_CHOLESKY ? cs_schol(SPARSE_CHOLESKYORDER, &A) :
+                                              cs_sqr(SPARSE_LUORDER, &A, false));
+    if (!f->symbolic) return SPARSE_FAILED;
+    
+    if (!sparseccs_copy(&a->ccs, &f->pattern)) return SPARSE_FAILED;
+    if (f->pattern.values) {
+        MORPHO_FREE(f->pattern.values);
+        f->pattern.values=NULL;
+    }
+    
+    return sparse_numericfactor(f, a);
+#else
+    return SPARSE_FAILED;
+#endif
+}
+
+/** Refactorizes a matrix with the same pattern as the one originally factorized, skipping the symbolic analysis */
+objectsparseerror sparse_refactorize(objectsparsefactorization *f, objectsparse *a) {
+    if (!f->symbolic) return SPARSE_FAILED;
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true) || !a->ccs.values) return SPARSE_CONVFAILED;
+    if (!sparseccs_samepattern(&a->ccs, &f->pattern)) return SPARSE_PATTERNMISMATCH;
+    
+    return sparse_numericfactor(f, a);
+}
+
+/** Solves A x = b for dense right hand sides held as column major arrays, using a factorization of A
+ * @param[in] f - the factorization
+ * @param[in] ncols - number of columns of b
+ * @param[in] b - right hand side
+ * @param[out] x - solution; may be the same as b */
+static objectsparseerror sparse_factorsolvedense(objectsparsefactorization *f, int ncols, double *b, double *x) {
+    int n=f->pattern.nrows;
+    if (!f->numeric) return SPARSE_FAILED;
+    
+#ifdef MORPHO_LINALG_USE_CSPARSE
+    css *S = (css *) f->symbolic;
+    csn *N = (csn *) f->numeric;
+    double *work=MORPHO_MALLOC(sizeof(double)*(n>0 ? n : 1));
+    if (!work) return SPARSE_FAILED;
+    
+    for (int j=0; j<ncols; j++) {
+        double *bj=b+j*n, *xj=x+j*n;
+        if (f->type==SPARSE_CHOLESKY) { // P'L L'P x = b
+            cs_ipvec(S->pinv, bj, work, n);
+            cs_lsolve(N->L, work);
+            cs_ltsolve(N->L, work);
+            cs_pvec(S->pinv, work, xj, n);
+        } else { // P'L U Q' x = b
+            cs_ipvec(N->pinv, bj, work, n);
+            cs_lsolve(N->L, work);
+            cs_usolve(N->U, work);
+            cs_ipvec(S->q, work, xj, n);
+        }
+    }
+    
+    MORPHO_FREE(work);
+    return SPARSE_OK;
+#else
+    return SPARSE_FAILED;
+#endif
+}
+
+/** Solves A x = b using a factorization of A
+ * @param[in] f - the factorization
+ * @param[in] b - right hand side; may have several columns
+ * @param[out] x - solution, with the same shape as b; may be the same as b */
+objectsparseerror sparse_factorsolve(objectsparsefactorization *f, objectmatrix *b, objectmatrix *x) {
+    int n=f->pattern.nrows;
+    if (!f->numeric) return SPARSE_FAILED;
+    if (b->nrows!=n || x->nrows!=n || x->ncols!=b->ncols) return SPARSE_INCMPTBLDIM;
+    
+    objectsparseerror err=sparse_factorsolvedense(f, b->ncols, b->elements, x->elements);
+    if (err==SPARSE_OK) MATRIX_MODIFIED(x);
+    return err;
+}
+
+/* ***************************************
+ * Eigensolver
+ * *************************************** */
+
+/** Which Ritz values to keep */
+typedef enum { SPARSE_RITZSMALLEST, SPARSE_RITZLARGEST, SPARSE_RITZMAGNITUDE } sparseritzselect;
+
+/** Initializes eigensolver options with their defaults */
+void sparse_eigenoptionsinit(sparseeigenoptions *opt) {
+    opt->which=SPARSE_EIGENSMALLEST;
+    opt->shifted=false;
+    opt->shift=0.0;
+    opt->tol=1e-8;
+    opt->maxiter=1000;
+}
+
+/** Finds the eigenvalues and eigenvectors of a dense symmetric matrix
+ * @param[in] n - size of the matrix
+ * @param[in,out] a - on entry, the matrix in column major order; on exit, the eigenvectors
+ * @param[out] w - eigenvalues in ascending order */
+static bool sparse_symmetriceigen(int n, double *a, double *w) {
+    int info;
+#ifdef MORPHO_LINALG_USE_LAPACKE
+    info=LAPACKE_dsyev(LAPACK_COL_MAJOR, 'V', 'U', n, a, n, w);
+#else
+    char jobz='V', uplo='U';
+    int lwork=-1;
+    double query;
+    dsyev_(&jobz, &uplo, &n, a, &n, w, &query, &lwork, &info);
+    lwork=(int) query;
+    double *work=MORPHO_MALLOC(sizeof(double)*(lwork>0 ? lwork : 1));
+    if (!work) return false;
+    dsyev_(&jobz, &uplo, &n, a, &n, w, work, &lwork, &info);
+    MORPHO_FREE(work);
+#endif
+    return (info==0);
+}
+
+/** Orthogonalizes column j of v against columns 0...j-1, which are orthonormal, and normalizes it
+ * @returns false if the column is numerically dependent on the others
+ * @details Classical Gram-Schmidt is applied twice, which keeps the basis orthogonal to working precision. */
+static bool sparse_orthonormalize(int n, int j, double *v, double *h) {
+    double *x=v+(size_t) n*j;
+    double norm0=cblas_dnrm2(n, x, 1);
+    if (norm0==0.0) return false;
+    
+    for (int pass=0; pass<2 && j>0; pass++) {
+        cblas_dgemv(CblasColMajor, CblasTrans, n, j, 1.0, v, n, x, 1, 0.0, h, 1);
+        cblas_dgemv(CblasColMajor, CblasNoTrans, n, j, -1.0, v, n, h, 1, 1.0, x, 1);
+    }
+    
+    double norm=cblas_dnrm2(n, x, 1);
+    if (norm<=1e-10*norm0) return false;
+    cblas_dscal(n, 1.0/norm, x, 1);
+    return true;
+}
+
+/** Restarted block Lanczos method for a few extreme eigenpairs of a symmetric operator
+ * @param[in] op - function that computes y = A x
+ * @param[in] ref - reference passed to op
+ * @param[in] n - size of A
+ * @param[in] k - number of eigenpairs
+ * @param[in] select - which eigenvalues to find
+ * @param[in] tol - residual, relative to the largest Ritz value, at which an eigenpair is converged
+ * @param[in] maxiter - maximum number of restarts
+ * @param[out] theta - the eigenvalues
+ * @param[out] x - the eigenvectors, as n*k column major array
+ * @details A block Krylov space is grown from the current k approximate eigenvectors, with full reorthogonalization, and the k wanted Ritz pairs from it start the next cycle. All k modes therefore converge together. */
+static objectsparseerror sparse_blocklanczos(sparseoperatorfn op, void *ref, int n, int k, sparseritzselect select, double tol, int maxiter, double *theta, double *x) {
+    int m=(4*k>k+20 ? 4*k : k+20); // Largest dimension of the Krylov space
+    if (m>n) m=n;
+    
+    double *v=MORPHO_MALLOC(sizeof(double)*n*m); // Basis
+    double *av=MORPHO_MALLOC(sizeof(double)*n*m); // Operator applied to the basis
+    double *h=MORPHO_MALLOC(sizeof(double)*m*m); // Projected operator, and then its eigenvectors
+    double *w=MORPHO_MALLOC(sizeof(double)*m); // Ritz values
+    double *r=MORPHO_MALLOC(sizeof(double)*(n>m ? n : m)); // Residual and workspace
+    int *sel=MORPHO_MALLOC(sizeof(int)*k);
+    objectsparseerror err=SPARSE_FAILED;
+    if (!(v && av && h && w && r && sel)) goto sparse_blocklanczos_cleanup;
+    
+    /* Start from a reproducible pseudorandom block */
+    uint32_t seed=2463534242u;
+    for (size_t i=0; i<(size_t) n*k; i++) {
+        seed^=seed<<13; seed^=seed>>17; seed^=seed<<5;
+        x[i]=((double) seed)/UINT32_MAX-0.5;
+    }
+    
+    err=SPARSE_NOTCONVERGED;
+    for (int iter=0; iter<maxiter; iter++) {
+        int ncv=0;
+        double *block=x;
+        int nblock=k;
+        
+        /* Grow the Krylov space a block at a time */
+        while (ncv<m) {
+            int start=ncv;
+            for (int c=0; c<nblock && ncv<m; c++) {
+                memcpy(v+(size_t) n*ncv, block+(size_t) n*c, sizeof(double)*n);
+                if (sparse_orthonormalize(n, ncv, v, r)) ncv++;
+            }
+            if (ncv==start) break; // The space is invariant
+            
+            for (int j=start; j<ncv; j++) op(ref, v+(size_t) n*j, av+(size_t) n*j);
+            block=av+(size_t) n*start;
+            nblock=ncv-start;
+        }
+        if (ncv<k) { err=SPARSE_FAILED; break; }
+        
+        /* Rayleigh-Ritz */
+        cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, ncv, ncv, n, 1.0, v, n, av, n, 0.0, h, ncv);
+        for (int i=0; i<ncv; i++) for (int j=0; j<i; j++) {
+            double sym=0.5*(h[i+j*ncv]+h[j+i*ncv]);
+            h[i+j*ncv]=sym; h[j+i*ncv]=sym;
+        }
+        if (!sparse_symmetriceigen(ncv, h, w)) { err=SPARSE_FAILED; break; }
+        
+        for (int i=0, lo=0, hi=ncv-1; i<k; i++) {
+            switch (select) {
+                case SPARSE_RITZSMALLEST: sel[i]=lo++; break;
+                case SPARSE_RITZLARGEST: sel[i]=hi--; break;
+                case SPARSE_RITZMAGNITUDE: sel[i]=(fabs(w[hi])>=fabs(w[lo]) ? hi-- : lo++); break;
+            }
+        }
+        
+        /* Form Ritz vectors and check their residuals */
+        double scale=fmax(fabs(w[0]), fabs(w[ncv-1]));
+        bool converged=true;
+        for (int i=0; i<k; i++) {
+            double *y=h+(size_t) ncv*sel[i], *xi=x+(size_t) n*i;
+            theta[i]=w[sel[i]];
+            cblas_dgemv(CblasColMajor, CblasNoTrans, n, ncv, 1.0, v, n, y, 1, 0.0, xi, 1);
+            cblas_dgemv(CblasColMajor, CblasNoTrans, n, ncv, 1.0, av, n, y, 1, 0.0, r, 1);
+            cblas_daxpy(n, -theta[i], xi, 1, r, 1);
+            if (cblas_dnrm2(n, r, 1)>tol*scale) converged=false;
+        }
+        
+        if (converged || ncv==n) { err=SPARSE_OK; break; }
+    }
+    
+sparse_blocklanczos_cleanup:
+    if (v) MORPHO_FREE(v);
+    if (av) MORPHO_FREE(av);
+    if (h) MORPHO_FREE(h);
+    if (w) MORPHO_FREE(w);
+    if (r) MORPHO_FREE(r);
+    if (sel) MORPHO_FREE(sel);
+    return err;
+}
+
+/** Operator for shift-invert, y = (A - shift I)^-1 x */
+static void sparse_shiftinvertoperator(void *ref, double *x, double *y) {
+    sparse_factorsolvedense((objectsparsefactorization *) ref, 1, x, y);
+}
+
+/** Finds a few eigenvalues and eigenvectors of a symmetric sparse matrix
+ * @param[in] a - the matrix
+ * @param[in] k - number of eigenpairs
+ * @param[in] opt - options
+ * @param[out] values - the eigenvalues in ascending order
+ * @param[out] vectors - the corresponding unit eigenvectors, as an n*k column major array
+ * @details Without a shift, the smallest or largest eigenvalues are found with a block Lanczos method using products with a. With a shift, a - shift I is factorized and the same method applied to its inverse, which finds the eigenvalues closest to the shift in far fewer iterations. */
+objectsparseerror sparse_eigen(objectsparse *a, int k, sparseeigenoptions *opt, double *values, double *vectors) {
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true)) return SPARSE_CONVFAILED;
+    int n=a->ccs.nrows;
+    if (a->ccs.ncols!=n || k<1 || k>n) return SPARSE_INCMPTBLDIM;
+    
+    objectsparseerror err;
+    if (opt->shifted) {
+        objectsparse id, shifted;
+        objectsparsefactorization f;
+        sparsedok_init(&id.dok); sparseccs_init(&id.ccs); sparseccs_init(&id.trans);
+        sparsedok_init(&shifted.dok); sparseccs_init(&shifted.ccs); sparseccs_init(&shifted.trans);
+        f.type=SPARSE_LU;
+        sparseccs_init(&f.pattern);
+        f.symbolic=NULL;
+        f.numeric=NULL;
+        
+        int *diag=MORPHO_MALLOC(sizeof(int)*n);
+        if (diag) {
+            for (int i=0; i<n; i++) diag[i]=i;
+            err=(sparseccs_fromtriplets(&id.ccs, n, n, n, diag, diag, NULL) ? SPARSE_OK : SPARSE_FAILED);
+            MORPHO_FREE(diag);
+        } else err=SPARSE_FAILED;
+        
+        if (err==SPARSE_OK) err=sparse_add(a, &id, 1.0, -opt->shift, &shifted);
+        if (err==SPARSE_OK) err=sparse_factorize(&shifted, &f);
+        if (err==SPARSE_OK) err=sparse_blocklanczos(sparse_shiftinvertoperator, &f, n, k, SPARSE_RITZMAGNITUDE, opt->tol, opt->maxiter, values, vectors);
+        
+        /* Eigenvalues of a from the Rayleigh quotients of the eigenvectors */
+        if (err==SPARSE_OK) {
+            double *ax=MORPHO_MALLOC(sizeof(double)*n);
+            if (ax) {
+                for (int i=0; i<k; i++) {
+                    sparse_muldense(a, 1, vectors+(size_t) n*i, ax);
+                    values[i]=cblas_ddot(n, vectors+(size_t) n*i, 1, ax, 1);
+                }
+                MORPHO_FREE(ax);
+            } else err=SPARSE_FAILED;
+        }
+        
+        sparse_clear(&id);
+        sparse_clear(&shifted);
+        sparse_factorizationclear(&f);
+    } else {
+        err=sparse_blocklanczos(sparse_operator, a, n, k, (opt->which==SPARSE_EIGENLARGEST ? SPARSE_RITZLARGEST : SPARSE_RITZSMALLEST), opt->tol, opt->maxiter, values, vectors);
+    }
+    if (err!=SPARSE_OK) return err;
+    
+    /* Sort into ascending order */
+    for (int i=1; i<k; i++) {
+        for (int j=i; j>0 && values[j-1]>values[j]; j--) {
+            double t=values[j]; values[j]=values[j-1]; values[j-1]=t;
+            cblas_dswap(n, vectors+(size_t) n*j, 1, vectors+(size_t) n*(j-1), 1);
+        }
+    }
+    
+    return SPARSE_OK;
+}
+
+/* ***************************************
+ * Sparse matrix storage
+ * *************************************** */
+
+/** Clears any data attached to a sparse matrix */
+void sparse_clear(objectsparse *a) {
+    sparsedok_clear(&a->dok);
+    sparseccs_clear(&a->ccs);
+    sparseccs_clear(&a->trans);
+}
+
+/** Calculate the size of a sparse matrix structure */
+size_t sparse_size(objectsparse *a) {
+    return sizeof(objectsparse)+
+           a->dok.capacity*sizeof(sparsedokentry) +
+           a->dok.tablesize*sizeof(int) +
+           (a->ccs.cptr ? sizeof(int)*(a->ccs.ncols+1) : 0) +
+           sizeof(int)*(a->ccs.nentries) +
+           ( a->ccs.values ? sizeof(double)*(a->ccs.nentries) : 0) +
+           (a->trans.cptr ? sizeof(int)*(a->trans.ncols+1+a->trans.nentries) : 0) +
+           (a->trans.values ? sizeof(double)*(a->trans.nentries) : 0);
+}
+
+/* ***************************************
+ * Sparse builtin class
+ * *************************************** */
+
+static value sparse_toloption;
+static value sparse_maxiteroption;
+static value sparse_restartoption;
+static value sparse_precondoption;
+static value sparse_omegaoption;
+static value sparse_whichoption;
+static value sparse_shiftoption;
+
+void sparse_raiseerror(vm *v, objectsparseerror err) {
+    switch(err) {
+        case SPARSE_OK: break;
+        case SPARSE_INCMPTBLDIM: morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES); break;
+        case SPARSE_CONVFAILED: morpho_runtimeerror(v, SPARSE_CONVFAILEDERR); break;
+        case SPARSE_FAILED: morpho_runtimeerror(v, SPARSE_OPFAILEDERR); break;
+        case SPARSE_NOTCONVERGED: morpho_runtimeerror(v, SPARSE_NOTCONVERGEDERR); break;
+        case SPARSE_PRECONDFAILED: morpho_runtimeerror(v, SPARSE_PRECONDFAILEDERR); break;
+        case SPARSE_PATTERNMISMATCH: morpho_runtimeerror(v, SPARSE_PATTERNMISMATCHERR); break;
+    }
+}
+
+/** Extracts the length of a List or Matrix used as a triplet initializer */
+bool sparse_tripletcount(value in, unsigned int *n) {
+    if (MORPHO_ISLIST(in)) {
+        *n=MORPHO_GETLIST(in)->val.count;
+    } else if (MORPHO_ISMATRIX(in)) {
+        objectmatrix *m=MORPHO_GETMATRIX(in);
+        *n=m->nrows*m->ncols;
+    } else return false;
+    return true;
+}
+
+/** Copies indices from a List or Matrix used as a triplet initializer
+ *  @returns false unless every index is a nonnegative integer that fits in an int */
+bool sparse_tripletindices(value in, unsigned int n, int *out) {
+    for (unsigned int k=0; k<n; k++) {
+        double x;
+        if (MORPHO_ISLIST(in)) {
+            value el=MORPHO_GETLIST(in)->val.data[k];
+            if (MORPHO_ISINTEGER(el)) {
+                out[k]=MORPHO_GETINTEGERVALUE(el);
+                if (out[k]<0) return false;
+                continue;
+            }
+            if (!morpho_valuetofloat(el, &x)) return false;
+        } else x=MORPHO_GETMATRIX(in)->elements[k];
+        
+        /* Converting a double that isn't representable as an int is undefined, so check before the cast */
+        if (!isfinite(x) || x<0 || x>INT_MAX || x!=trunc(x)) return false;
+        out[k]=(int) x;
+    }
+    return true;
+}
+
+/** Copies values from a List or Matrix used as a triplet initializer */
+static bool sparse_tripletvalues(value in, unsigned int n, double *out) {
+    if (MORPHO_ISMATRIX(in)) {
+        memcpy(out, MORPHO_GETMATRIX(in)->elements, sizeof(double)*n);
+    } else for (unsigned int k=0; k<n; k++) {
+        if (!morpho_valuetofloat(MORPHO_GETLIST(in)->val.data[k], out+k)) return false;
+    }
+    return true;
+}
+
+/** Creates a sparse matrix from Lists or Matrices of rows, columns and values */
+static objectsparse *sparse_fromtripletvalues(vm *v, int nrows, int ncols, value rows, value cols, value vals) {
+    objectsparse *new=NULL;
+    unsigned int n, nc, nv;
+    
+    if (!(sparse_tripletcount(rows, &n) &&
+          sparse_tripletcount(cols, &nc) &&
+          sparse_tripletcount(vals, &nv)) || nc!=n || nv!=n) {
+        morpho_runtimeerror(v, SPARSE_TRIPLETS);
+        return NULL;
+    }
+    
+    int *rix=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    int *cix=MORPHO_MALLOC(sizeof(int)*(n>0 ? n : 1));
+    double *x=MORPHO_MALLOC(sizeof(double)*(n>0 ? n : 1));
+    
+    if (rix && cix && x) {
+        if (sparse_tripletindices(rows, n, rix) &&
+            sparse_tripletindices(cols, n, cix) &&
+            sparse_tripletvalues(vals, n, x)) {
+            new=sparse_fromtriplets(nrows, ncols, n, rix, cix, x);
+        }
+        if (!new) morpho_runtimeerror(v, SPARSE_TRIPLETS);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    
+    if (rix) MORPHO_FREE(rix);
+    if (cix) MORPHO_FREE(cix);
+    if (x) MORPHO_FREE(x);
+    
+    return new;
+}
+
+/** Constructs a Matrix object */
+value sparse_constructor(vm *v, int nargs, value *args) {
+    int nrows, ncols;
+    objectsparse *new=NULL;
+    value out=MORPHO_NIL; 
     
     if ( nargs==2 &&
          MORPHO_ISINTEGER(MORPHO_GETARG(args, 0)) &&
@@ -830,6 +2479,14 @@ value sparse_constructor(vm *v, int nargs, value *args) {
                MORPHO_ISLIST(MORPHO_GETARG(args, 0))) {
         new=object_sparsefromlist(MORPHO_GETLIST(MORPHO_GETARG(args, 0)));
        if (!new) morpho_runtimeerror(v, SPARSE_INVLDARRAYINIT);
+    } else if (nargs==3) {
+        new=sparse_fromtripletvalues(v, -1, -1, MORPHO_GETARG(args, 0), MORPHO_GETARG(args, 1), MORPHO_GETARG(args, 2));
+    } else if (nargs==5 &&
+               MORPHO_ISINTEGER(MORPHO_GETARG(args, 0)) &&
+               MORPHO_ISINTEGER(MORPHO_GETARG(args, 1))) {
+        nrows = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0));
+        ncols = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 1));
+        new=sparse_fromtripletvalues(v, nrows, ncols, MORPHO_GETARG(args, 2), MORPHO_GETARG(args, 3), MORPHO_GETARG(args, 4));
     } else {
         morpho_runtimeerror(v, SPARSE_CONSTRUCTOR);
     }
@@ -944,12 +2601,59 @@ value Sparse_sub(vm *v, int nargs, value *args) {
     return out;
 }
 
-/** Multiply sparse matrices */
+/** Multiply a sparse matrix by a sparse or dense matrix */
+/** Creates a copy of a sparse matrix multiplied by a scalar */
+static value sparse_scaledclone(vm *v, objectsparse *a, value scale) {
+    value out=MORPHO_NIL;
+    double s=1.0;
+    morpho_valuetofloat(scale, &s);
+    
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true)) {
+        sparse_raiseerror(v, SPARSE_CONVFAILED);
+        return MORPHO_NIL;
+    }
+    
+    objectsparse *new = object_newsparse(NULL, NULL);
+    if (new && sparseccs_copy(&a->ccs, &new->ccs)) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+        objectsparseerror err=sparse_scale(new, s);
+        if (err!=SPARSE_OK) {
+            sparse_raiseerror(v, err);
+            out=MORPHO_NIL;
+        }
+    } else {
+        if (new) object_free((object *) new);
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    }
+    
+    return out;
+}
+
 value Sparse_mul(vm *v, int nargs, value *args) {
     objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
     value out=MORPHO_NIL;
  
-    if (nargs==1 && MORPHO_ISSPARSE(MORPHO_GETARG(args, 0))) {
+    if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        if (!sparse_checkformat(a, SPARSE_CCS, true, true)) {
+            sparse_raiseerror(v, SPARSE_CONVFAILED);
+            return MORPHO_NIL;
+        }
+        
+        objectmatrix *new = object_newmatrix(a->ccs.nrows, b->ncols, false);
+        if (new) {
+            objectsparseerror err=sparse_mulmatrix(a, b, new);
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+            if (err!=SPARSE_OK) {
+                sparse_raiseerror(v, err);
+                out=MORPHO_NIL;
+            }
+        } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    } else if (nargs==1 && MORPHO_ISNUMBER(MORPHO_GETARG(args, 0))) {
+        out=sparse_scaledclone(v, a, MORPHO_GETARG(args, 0));
+    } else if (nargs==1 && MORPHO_ISSPARSE(MORPHO_GETARG(args, 0))) {
         objectsparse *b=MORPHO_GETSPARSE(MORPHO_GETARG(args, 0));
         
         objectsparse *new = object_newsparse(NULL, NULL);
@@ -967,6 +2671,64 @@ value Sparse_mul(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Right multiplication by a scalar */
+value Sparse_mulr(vm *v, int nargs, value *args) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    if (nargs==1 && MORPHO_ISNUMBER(MORPHO_GETARG(args, 0))) {
+        out=sparse_scaledclone(v, a, MORPHO_GETARG(args, 0));
+    } else morpho_runtimeerror(v, MATRIX_ARITHARGS);
+    
+    return out;
+}
+
+/** Accumulates a multiple of another sparse matrix in place, a.acc(alpha, b) */
+value Sparse_acc(vm *v, int nargs, value *args) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    
+    if (nargs==2 && MORPHO_ISNUMBER(MORPHO_GETARG(args, 0)) &&
+        MORPHO_ISSPARSE(MORPHO_GETARG(args, 1))) {
+        double alpha=1.0;
+        morpho_valuetofloat(MORPHO_GETARG(args, 0), &alpha);
+        
+        objectsparseerror err=sparse_acc(a, alpha, MORPHO_GETSPARSE(MORPHO_GETARG(args, 1)));
+        if (err!=SPARSE_OK) sparse_raiseerror(v, err);
+    } else morpho_runtimeerror(v, SPARSE_ACCARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Scales a sparse matrix in place */
+value Sparse_scale(vm *v, int nargs, value *args) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    
+    if (nargs==1 && MORPHO_ISNUMBER(MORPHO_GETARG(args, 0))) {
+        double s=1.0;
+        morpho_valuetofloat(MORPHO_GETARG(args, 0), &s);
+        
+        objectsparseerror err=sparse_scale(a, s);
+        if (err!=SPARSE_OK) sparse_raiseerror(v, err);
+    } else morpho_runtimeerror(v, SPARSE_SCALEARGS);
+    
+    return MORPHO_NIL;
+}
+
+/** Replaces the values of a sparse matrix, keeping its pattern */
+value Sparse_setvalues(vm *v, int nargs, value *args) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    
+    if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0))) {
+        objectmatrix *m=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        
+        objectsparseerror err=sparse_setvalues(a, m->nrows*m->ncols, m->elements);
+        if (err==SPARSE_INCMPTBLDIM) morpho_runtimeerror(v, SPARSE_SETVALUESARGS);
+        else if (err!=SPARSE_OK) sparse_raiseerror(v, err);
+    } else morpho_runtimeerror(v, SPARSE_SETVALUESARGS);
+    
+    return MORPHO_NIL;
+}
+
 /** Sparse rhs not implemented */
 value Sparse_div(vm *v, int nargs, value *args) {
     return MORPHO_NIL;
@@ -1117,6 +2879,7 @@ value Sparse_setrowindices(vm *v, int nargs, value *args) {
                 if (!sparseccs_setrowindices(&s->ccs, col, nentries, entries)) {
                     morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
                 }
+                sparseccs_clear(&s->trans);
                 
             } else morpho_runtimeerror(v, MATRIX_INDICESOUTSIDEBOUNDS);
         }
@@ -1157,13 +2920,15 @@ value Sparse_indices(vm *v, int nargs, value *args) {
     value out=MORPHO_NIL;
  
     if (sparse_checkformat(s, SPARSE_DOK, true, true)) {
-        objectlist *list=object_newlist(s->dok.dict.count, NULL);
+        objectlist *list=object_newlist(s->dok.count, NULL);
         if (list) {
-            for (objectdokkey *key=s->dok.keys; key!=NULL; key=(objectdokkey *) key->obj.next) {
+            void *ctr=sparsedok_loopstart(&s->dok);
+            int row, col;
+            while (sparsedok_loop(&s->dok, &ctr, &row, &col)) {
                 objectlist *entry=object_newlist(2, NULL);
                 if (entry) {
-                    list_append(entry, MORPHO_INTEGER(key->row));
-                    list_append(entry, MORPHO_INTEGER(key->col));
+                    list_append(entry, MORPHO_INTEGER(row));
+                    list_append(entry, MORPHO_INTEGER(col));
                     list_append(list, MORPHO_OBJECT(entry));
                 } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
             }
@@ -1178,6 +2943,217 @@ value Sparse_indices(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Converts a preconditioner label to a sparseprecondtype */
+static bool sparse_precondfromvalue(value label, sparseprecondtype *out) {
+    if (MORPHO_ISNIL(label)) { *out=SPARSE_PRECONDNONE; return true; }
+    if (!MORPHO_ISSTRING(label)) return false;
+    
+    char *labels[] = { SPARSE_PRECONDNONELABEL, SPARSE_PRECONDJACOBILABEL, SPARSE_PRECONDSSORLABEL, SPARSE_PRECONDILU0LABEL, SPARSE_PRECONDIC0LABEL };
+    sparseprecondtype types[] = { SPARSE_PRECONDNONE, SPARSE_PRECONDJACOBI, SPARSE_PRECONDSSOR, SPARSE_PRECONDILU0, SPARSE_PRECONDIC0 };
+    
+    for (int i=0; i<sizeof(types)/sizeof(sparseprecondtype); i++) {
+        if (strcmp(MORPHO_GETCSTRING(label), labels[i])==0) { *out=types[i]; return true; }
+    }
+    return false;
+}
+
+/** Processes the arguments of an iterative solver method, A.method(b, [x0], tol=, maxiter=, restart=, precond=, omega=)
+ * @param[out] opt - solver options
+ * @param[out] b - the right hand side
+ * @param[out] x - a new bound Matrix holding the initial guess
+ * @returns true on success; otherwise an error has been raised */
+bool sparse_solverargs(vm *v, int nargs, value *args, sparsesolveroptions *opt, objectmatrix **b, value *x) {
+    value tol=MORPHO_NIL, maxiter=MORPHO_NIL, restart=MORPHO_NIL, precond=MORPHO_NIL, omega=MORPHO_NIL;
+    int nfixed;
+    
+    sparse_solveroptionsinit(opt);
+    
+    if (!builtin_options(v, nargs, args, &nfixed, 5,
+                         sparse_toloption, &tol,
+                         sparse_maxiteroption, &maxiter,
+                         sparse_restartoption, &restart,
+                         sparse_precondoption, &precond,
+                         sparse_omegaoption, &omega) ||
+        nfixed<1 || nfixed>2 ||
+        !MORPHO_ISMATRIX(MORPHO_GETARG(args, 0)) ||
+        (nfixed==2 && !MORPHO_ISMATRIX(MORPHO_GETARG(args, 1))) ||
+        (!MORPHO_ISNIL(tol) && !morpho_valuetofloat(tol, &opt->tol)) ||
+        (!MORPHO_ISNIL(omega) && !morpho_valuetofloat(omega, &opt->omega)) ||
+        (!MORPHO_ISNIL(maxiter) && !MORPHO_ISINTEGER(maxiter)) ||
+        (!MORPHO_ISNIL(restart) && !MORPHO_ISINTEGER(restart))) {
+        morpho_runtimeerror(v, SPARSE_SOLVERARGS);
+        return false;
+    }
+    
+    if (!sparse_precondfromvalue(precond, &opt->precond)) {
+        morpho_runtimeerror(v, SPARSE_INVLDPRECOND);
+        return false;
+    }
+    if (MORPHO_ISINTEGER(maxiter)) opt->maxiter=MORPHO_GETINTEGERVALUE(maxiter);
+    if (MORPHO_ISINTEGER(restart)) opt->restart=MORPHO_GETINTEGERVALUE(restart);
+    
+    *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+    objectmatrix *new=NULL;
+    if (nfixed==2) { // Warm start from the initial guess
+        objectmatrix *x0=MORPHO_GETMATRIX(MORPHO_GETARG(args, 1));
+        if (x0->nrows!=(*b)->nrows || x0->ncols!=(*b)->ncols) {
+            morpho_runtimeerror(v, MATRIX_INCOMPATIBLEMATRICES);
+            return false;
+        }
+        new=object_clonematrix(x0);
+    } else new=object_newmatrix((*b)->nrows, (*b)->ncols, true);
+    
+    if (!new) {
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        return false;
+    }
+    
+    *x=MORPHO_OBJECT(new);
+    morpho_bindobjects(v, 1, x);
+    return true;
+}
+
+/** Common implementation of the iterative solver methods */
+static value sparse_iterativesolve(vm *v, int nargs, value *args, sparsesolvermethod method) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    sparsesolveroptions opt;
+    objectmatrix *b;
+    value out=MORPHO_NIL;
+    
+    if (sparse_solverargs(v, nargs, args, &opt, &b, &out)) {
+        objectsparseerror err=sparse_solve(a, method, &opt, b, MORPHO_GETMATRIX(out));
+        if (err!=SPARSE_OK) {
+            sparse_raiseerror(v, err);
+            out=MORPHO_NIL;
+        }
+    }
+    
+    return out;
+}
+
+/** Solve with conjugate gradients */
+value Sparse_cg(vm *v, int nargs, value *args) {
+    return sparse_iterativesolve(v, nargs, args, SPARSE_CG);
+}
+
+/** Solve with MINRES */
+value Sparse_minres(vm *v, int nargs, value *args) {
+    return sparse_iterativesolve(v, nargs, args, SPARSE_MINRES);
+}
+
+/** Solve with BiCGSTAB */
+value Sparse_bicgstab(vm *v, int nargs, value *args) {
+    return sparse_iterativesolve(v, nargs, args, SPARSE_BICGSTAB);
+}
+
+/** Solve with restarted GMRES */
+value Sparse_gmres(vm *v, int nargs, value *args) {
+    return sparse_iterativesolve(v, nargs, args, SPARSE_GMRES);
+}
+
+/** Finds a few eigenpairs of a symmetric sparse matrix, a.eigen(k, which=, shift=, tol=, maxiter=), returning a List of the eigenvalues and the eigenvectors as Matrices */
+value Sparse_eigen(vm *v, int nargs, value *args) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    value which=MORPHO_NIL, shift=MORPHO_NIL, tol=MORPHO_NIL, maxiter=MORPHO_NIL;
+    value out=MORPHO_NIL;
+    int nfixed;
+    
+    sparseeigenoptions opt;
+    sparse_eigenoptionsinit(&opt);
+    
+    if (!builtin_options(v, nargs, args, &nfixed, 4,
+                         sparse_whichoption, &which,
+                         sparse_shiftoption, &shift,
+                         sparse_toloption, &tol,
+                         sparse_maxiteroption, &maxiter) ||
+        nfixed!=1 || !MORPHO_ISINTEGER(MORPHO_GETARG(args, 0)) ||
+        (!MORPHO_ISNIL(shift) && !morpho_valuetofloat(shift, &opt.shift)) ||
+        (!MORPHO_ISNIL(tol) && !morpho_valuetofloat(tol, &opt.tol)) ||
+        (!MORPHO_ISNIL(maxiter) && !MORPHO_ISINTEGER(maxiter))) {
+        morpho_runtimeerror(v, SPARSE_EIGENARGS);
+        return MORPHO_NIL;
+    }
+    
+    if (MORPHO_ISSTRING(which) && strcmp(MORPHO_GETCSTRING(which), SPARSE_LARGESTLABEL)==0) {
+        opt.which=SPARSE_EIGENLARGEST;
+    } else if (!(MORPHO_ISNIL(which) ||
+                 (MORPHO_ISSTRING(which) && strcmp(MORPHO_GETCSTRING(which), SPARSE_SMALLESTLABEL)==0))) {
+        morpho_runtimeerror(v, SPARSE_EIGENARGS);
+        return MORPHO_NIL;
+    }
+    opt.shifted=!MORPHO_ISNIL(shift);
+    if (MORPHO_ISINTEGER(maxiter)) opt.maxiter=MORPHO_GETINTEGERVALUE(maxiter);
+    
+    int k=MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0));
+    if (!sparse_checkformat(a, SPARSE_CCS, true, true)) {
+        sparse_raiseerror(v, SPARSE_CONVFAILED);
+        return MORPHO_NIL;
+    }
+    int n=a->ccs.nrows;
+    if (k<1 || k>n || a->ccs.ncols!=n) {
+        morpho_runtimeerror(v, SPARSE_EIGENARGS);
+        return MORPHO_NIL;
+    }
+    
+    objectmatrix *values=object_newmatrix(k, 1, true);
+    objectmatrix *vectors=object_newmatrix(n, k, true);
+    objectlist *list=object_newlist(0, NULL);
+    if (!(values && vectors && list)) {
+        if (values) object_free((object *) values);
+        if (vectors) object_free((object *) vectors);
+        if (list) object_free((object *) list);
+        morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+        return MORPHO_NIL;
+    }
+    
+    objectsparseerror err=sparse_eigen(a, k, &opt, values->elements, vectors->elements);
+    
+    list_append(list, MORPHO_OBJECT(values));
+    list_append(list, MORPHO_OBJECT(vectors));
+    list_append(list, MORPHO_OBJECT(list));
+    morpho_bindobjects(v, list->val.count, list->val.data);
+    list->val.count--;
+    
+    if (err==SPARSE_OK) {
+        out=MORPHO_OBJECT(list);
+    } else if (err==SPARSE_FAILED) {
+        morpho_runtimeerror(v, SPARSE_EIGENFAILED);
+    } else sparse_raiseerror(v, err);
+    
+    return out;
+}
+
+/** Factorize a sparse matrix, returning a SparseFactorization */
+value Sparse_factorize(vm *v, int nargs, value *args) {
+    objectsparse *a=MORPHO_GETSPARSE(MORPHO_SELF(args));
+    sparsefactorizationtype type=SPARSE_LU;
+    value out=MORPHO_NIL;
+    
+    if (nargs==1 && MORPHO_ISSTRING(MORPHO_GETARG(args, 0)) &&
+        strcmp(MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)), SPARSE_CHOLESKYLABEL)==0) {
+        type=SPARSE_CHOLESKY;
+    } else if (!(nargs==0 || (nargs==1 && MORPHO_ISSTRING(MORPHO_GETARG(args, 0)) &&
+                              strcmp(MORPHO_GETCSTRING(MORPHO_GETARG(args, 0)), SPARSE_LULABEL)==0))) {
+        morpho_runtimeerror(v, SPARSE_FACTORIZEARGS);
+        return MORPHO_NIL;
+    }
+    
+    objectsparsefactorization *new=object_newsparsefactorization(type);
+    if (new) {
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+        
+        objectsparseerror err=sparse_factorize(a, new);
+        if (err!=SPARSE_OK) {
+            if (err==SPARSE_FAILED) morpho_runtimeerror(v, SPARSE_FACTORIZEFAILED);
+            else sparse_raiseerror(v, err);
+            out=MORPHO_NIL;
+        }
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    
+    return out;
+}
+
 MORPHO_BEGINCLASS(Sparse)
 MORPHO_METHOD(MORPHO_GETINDEX_METHOD, Sparse_getindex, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SETINDEX_METHOD, Sparse_setindex, BUILTIN_FLAGSEMPTY),
@@ -1186,15 +3162,71 @@ MORPHO_METHOD(MORPHO_PRINT_METHOD, Sparse_print, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_ADD_METHOD, Sparse_add, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_SUB_METHOD, Sparse_sub, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_MUL_METHOD, Sparse_mul, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_MULR_METHOD, Sparse_mulr, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MORPHO_ACC_METHOD, Sparse_acc, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_SCALE_METHOD, Sparse_scale, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_SETVALUES_METHOD, Sparse_setvalues, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_DIVR_METHOD, Sparse_divr, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_TRANSPOSE_METHOD, Sparse_transpose, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_CG_METHOD, Sparse_cg, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_MINRES_METHOD, Sparse_minres, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_BICGSTAB_METHOD, Sparse_bicgstab, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_GMRES_METHOD, Sparse_gmres, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_COUNT_METHOD, Sparse_count, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MATRIX_DIMENSIONS_METHOD, Sparse_dimensions, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(SPARSE_ROWINDICES_METHOD, Sparse_rowindices, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(SPARSE_SETROWINDICES_METHOD, Sparse_setrowindices, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(SPARSE_COLINDICES_METHOD, Sparse_colindices, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MORPHO_CLONE_METHOD, Sparse_clone, BUILTIN_FLAGSEMPTY),
-MORPHO_METHOD(SPARSE_INDICES_METHOD, Sparse_indices, BUILTIN_FLAGSEMPTY)
+MORPHO_METHOD(SPARSE_INDICES_METHOD, Sparse_indices, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_FACTORIZE_METHOD, Sparse_factorize, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSE_EIGEN_METHOD, Sparse_eigen, BUILTIN_FLAGSEMPTY)
+MORPHO_ENDCLASS
+
+/* ***************************************
+ * SparseFactorization builtin class
+ * *************************************** */
+
+/** Solve a linear system using the factorization */
+value SparseFactorization_solve(vm *v, int nargs, value *args) {
+    objectsparsefactorization *f=MORPHO_GETSPARSEFACTORIZATION(MORPHO_SELF(args));
+    value out=MORPHO_NIL;
+    
+    if (nargs==1 && MORPHO_ISMATRIX(MORPHO_GETARG(args, 0))) {
+        objectmatrix *b=MORPHO_GETMATRIX(MORPHO_GETARG(args, 0));
+        objectmatrix *new=object_newmatrix(b->nrows, b->ncols, false);
+        
+        if (new) {
+            out=MORPHO_OBJECT(new);
+            morpho_bindobjects(v, 1, &out);
+            
+            objectsparseerror err=sparse_factorsolve(f, b, new);
+            if (err!=SPARSE_OK) {
+                sparse_raiseerror(v, err);
+                out=MORPHO_NIL;
+            }
+        } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    } else morpho_runtimeerror(v, SPARSE_SOLVEARGS);
+    
+    return out;
+}
+
+/** Refactorize with a matrix of the same pattern */
+value SparseFactorization_refactor(vm *v, int nargs, value *args) {
+    objectsparsefactorization *f=MORPHO_GETSPARSEFACTORIZATION(MORPHO_SELF(args));
+    
+    if (nargs==1 && MORPHO_ISSPARSE(MORPHO_GETARG(args, 0))) {
+        objectsparseerror err=sparse_refactorize(f, MORPHO_GETSPARSE(MORPHO_GETARG(args, 0)));
+        if (err==SPARSE_FAILED) morpho_runtimeerror(v, SPARSE_FACTORIZEFAILED);
+        else sparse_raiseerror(v, err);
+    } else morpho_runtimeerror(v, SPARSE_PATTERNMISMATCHERR);
+    
+    return MORPHO_NIL;
+}
+
+MORPHO_BEGINCLASS(SparseFactorization)
+MORPHO_METHOD(SPARSEFACTORIZATION_SOLVE_METHOD, SparseFactorization_solve, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(SPARSEFACTORIZATION_REFACTOR_METHOD, SparseFactorization_refactor, BUILTIN_FLAGSEMPTY)
 MORPHO_ENDCLASS
 
 /* ***************************************
@@ -1202,19 +3234,53 @@ MORPHO_ENDCLASS
  * *************************************** */
 
 void sparse_initialize(void) {
-    objectdokkeytype=object_addtype(&objectdokkeydefn);
     objectsparsetype=object_addtype(&objectsparsedefn);
+    objectsparsefactorizationtype=object_addtype(&objectsparsefactorizationdefn);
+    
+    sparse_toloption=builtin_internsymbolascstring(SPARSE_TOLOPTION);
+    sparse_maxiteroption=builtin_internsymbolascstring(SPARSE_MAXITEROPTION);
+    sparse_restartoption=builtin_internsymbolascstring(SPARSE_RESTARTOPTION);
+    sparse_precondoption=builtin_internsymbolascstring(SPARSE_PRECONDOPTION);
+    sparse_omegaoption=builtin_internsymbolascstring(SPARSE_OMEGAOPTION);
+    sparse_whichoption=builtin_internsymbolascstring(SPARSE_WHICHOPTION);
+    sparse_shiftoption=builtin_internsymbolascstring(SPARSE_SHIFTOPTION);
     
     builtin_addfunction(SPARSE_CLASSNAME, sparse_constructor, BUILTIN_FLAGSEMPTY);
     
     value sparseclass=builtin_addclass(SPARSE_CLASSNAME, MORPHO_GETCLASSDEFINITION(Sparse), MORPHO_NIL);
     object_setveneerclass(OBJECT_SPARSE, sparseclass);
     
+    value factorizationclass=builtin_addclass(SPARSEFACTORIZATION_CLASSNAME, MORPHO_GETCLASSDEFINITION(SparseFactorization), MORPHO_NIL);
+    object_setveneerclass(OBJECT_SPARSEFACTORIZATION, factorizationclass);
+    
     morpho_defineerror(SPARSE_CONSTRUCTOR, ERROR_HALT, SPARSE_CONSTRUCTOR_MSG);
     morpho_defineerror(SPARSE_SETFAILED, ERROR_HALT, SPARSE_SETFAILED_MSG);
     morpho_defineerror(SPARSE_INVLDARRAYINIT, ERROR_HALT, SPARSE_INVLDARRAYINIT_MSG);
     morpho_defineerror(SPARSE_CONVFAILEDERR, ERROR_HALT, SPARSE_CONVFAILEDERR_MSG);    
     morpho_defineerror(SPARSE_OPFAILEDERR, ERROR_HALT, SPARSE_OPFAILEDERR_MSG);
+    morpho_defineerror(SPARSE_TRIPLETS, ERROR_HALT, SPARSE_TRIPLETS_MSG);
+    morpho_defineerror(SPARSE_SOLVERARGS, ERROR_HALT, SPARSE_SOLVERARGS_MSG);
+    morpho_defineerror(SPARSE_INVLDPRECOND, ERROR_HALT, SPARSE_INVLDPRECOND_MSG);
+    morpho_defineerror(SPARSE_PRECONDFAILEDERR, ERROR_HALT, SPARSE_PRECONDFAILEDERR_MSG);
+    morpho_defineerror(SPARSE_NOTCONVERGEDERR, ERROR_HALT, SPARSE_NOTCONVERGEDERR_MSG);
+    morpho_defineerror(SPARSE_FACTORIZEARGS, ERROR_HALT, SPARSE_FACTORIZEARGS_MSG);
+    morpho_defineerror(SPARSE_FACTORIZEFAILED, ERROR_HALT, SPARSE_FACTORIZEFAILED_MSG);
+    morpho_defineerror(SPARSE_PATTERNMISMATCHERR, ERROR_HALT, SPARSE_PATTERNMISMATCHERR_MSG);
+    morpho_defineerror(SPARSE_SOLVEARGS, ERROR_HALT, SPARSE_SOLVEARGS_MSG);
+    morpho_defineerror(SPARSE_ACCARGS, ERROR_HALT, SPARSE_ACCARGS_MSG);
+    morpho_defineerror(SPARSE_EIGENARGS, ERROR_HALT, SPARSE_EIGENARGS_MSG);
+    morpho_defineerror(SPARSE_EIGENFAILED, ERROR_HALT, SPARSE_EIGENFAILED_MSG);
+    morpho_defineerror(SPARSE_SCALEARGS, ERROR_HALT, SPARSE_SCALEARGS_MSG);
+    morpho_defineerror(SPARSE_SETVALUESARGS, ERROR_HALT, SPARSE_SETVALUESARGS_MSG);
+    
+#ifdef MORPHO_SPARSE_THREADS
+    long ncpu=sysconf(_SC_NPROCESSORS_ONLN);
+    sparse_nthreads=(int) (ncpu<1 ? 1 : (ncpu>MORPHO_SPARSE_MAXTHREADS ? MORPHO_SPARSE_MAXTHREADS : ncpu));
+#endif
     
     //sparse_test();
 }
+
+void sparse_finalize(void) {
+    for (int i=0; i<MORPHO_SPARSE_UNIONCACHESIZE; i++) sparseunion_clear(sparse_unioncache+i);
+}
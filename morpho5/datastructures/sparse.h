@@ -10,56 +10,54 @@
 #include <stdio.h>
 #include "object.h"
 #include "morpho.h"
+#include "matrix.h"
 
 /* ***************************************
  * Sparse objects
  * *************************************** */
 
-extern objecttype objectdokkeytype;
-#define OBJECT_DOKKEY objectdokkeytype
+/** The dictionary of keys format packs the indices of each entry into a single 64 bit key */
+typedef uint64_t sparsedokkey;
 
-/** The dictionary of keys format uses this special object type to store indices, enabling use of the existing dictionary type.
-    @warning These are for internal use only and should never be  returned to user code */
-typedef struct {
-    object obj;
-    unsigned int row;
-    unsigned int col;
-} objectdokkey;
-
-/** Create */
-#define MORPHO_STATICDOKKEY(i,j)      { .obj.type=OBJECT_DOKKEY, .obj.status=OBJECT_ISUNMANAGED, .obj.next=NULL, .row=i, .col=j }
-
-/** Tests whether an object is a dok key */
-#define MORPHO_ISDOKKEY(val) object_istype(val, OBJECT_DOKKEY)
+#define SPARSEDOK_KEY(i,j)      ((((sparsedokkey) (uint32_t) (i))<<32) | ((sparsedokkey) (uint32_t) (j)))
+#define SPARSEDOK_KEYROW(key)   ((int) ((key)>>32))
+#define SPARSEDOK_KEYCOL(key)   ((int) ((key) & 0xffffffff))
 
-/** Gets the object as a dok key */
-#define MORPHO_GETDOKKEY(val)   ((objectdokkey *) MORPHO_GETOBJECT(val))
+/** Marks an entry that has been removed; never a valid key as indices are nonnegative */
+#define SPARSEDOK_REMOVED       (~((sparsedokkey) 0))
 
-/** Gets the row and column from a objectdokkey */
-#define MORPHO_GETDOKKEYROW(objptr)    ((unsigned int) (objptr)->row)
-#define MORPHO_GETDOKKEYCOL(objptr)    ((unsigned int) (objptr)->col)
-
-#define MORPHO_GETDOKROWWVAL(val)    ((unsigned int) (MORPHO_GETDOKKEY(val)->row))
-#define MORPHO_GETDOKCOLWVAL(val)    ((unsigned int) (MORPHO_GETDOKKEY(val)->col))
-
-DECLARE_VARRAY(dokkey, objectdokkey);
+/** Entries are stored inline in insertion order */
+typedef struct {
+    sparsedokkey key;
+    value val;
+} sparsedokentry;
 
+/** Dictionary of keys format
+ * @details Entries live in a dense array; an open addressing hash table with linear probing holds indices into it. */
 typedef struct {
     int nrows;
     int ncols;
-    dictionary dict;
-    objectdokkey *keys;
+    unsigned int count; // Number of live entries
+    unsigned int nentries; // Number of entries used, including removed entries
+    unsigned int capacity; // Number of entries allocated
+    unsigned int tablesize; // Size of the hash table; always a power of two
+    sparsedokentry *entries;
+    int *table;
 } sparsedok;
 
 typedef struct {
     int nentries;
     int nrows;
     int ncols;
+    int arity; // If nonzero, every column has exactly arity entries and cptr is not stored
     int *cptr; // Pointers to column entries
     int *rix; // Row indices
     double *values; // Values
 } sparseccs;
 
+/** Offset into rix of the first entry in a column */
+#define SPARSECCS_COLSTART(ccs, col) ((ccs)->cptr ? (ccs)->cptr[(col)] : (col)*(ccs)->arity)
+
 extern objecttype objectsparsetype;
 #define OBJECT_SPARSE objectsparsetype
 
@@ -67,6 +65,7 @@ typedef struct {
     object obj;
     sparsedok dok;
     sparseccs ccs;
+    sparseccs trans; // Cached transpose, i.e. the matrix in compressed row format, used for products
 } objectsparse;
 
 /** Tests whether an object is a sparse matrix */
@@ -78,6 +77,32 @@ typedef struct {
 objectsparse *object_newsparse(int *nrows, int *ncols);
 objectsparse *sparse_sparsefromarray(objectarray *array);
 
+/* ***************************************
+ * Sparse factorizations
+ * *************************************** */
+
+extern objecttype objectsparsefactorizationtype;
+#define OBJECT_SPARSEFACTORIZATION objectsparsefactorizationtype
+
+typedef enum { SPARSE_CHOLESKY, SPARSE_LU } sparsefactorizationtype;
+
+/** A factorization of a sparse matrix that keeps its symbolic analysis, so that matrices with the same pattern can be refactorized cheaply */
+typedef struct {
+    object obj;
+    sparsefactorizationtype type;
+    sparseccs pattern; // Pattern of the factorized matrix, without values
+    void *symbolic; // Symbolic analysis, i.e. ordering and elimination tree
+    void *numeric; // Numerical factors
+} objectsparsefactorization;
+
+/** Tests whether an object is a sparse factorization */
+#define MORPHO_ISSPARSEFACTORIZATION(val) object_istype(val, OBJECT_SPARSEFACTORIZATION)
+
+/** Gets the object as a sparse factorization */
+#define MORPHO_GETSPARSEFACTORIZATION(val)   ((objectsparsefactorization *) MORPHO_GETOBJECT(val))
+
+objectsparsefactorization *object_newsparsefactorization(sparsefactorizationtype type);
+
 /* ***************************************
  * The Sparse class
  * *************************************** */
@@ -88,9 +113,43 @@ objectsparse *sparse_sparsefromarray(objectarray *array);
 #define SPARSE_SETROWINDICES_METHOD "setrowindices"
 #define SPARSE_COLINDICES_METHOD "colindices"
 #define SPARSE_INDICES_METHOD "indices"
+#define SPARSE_FACTORIZE_METHOD "factorize"
+#define SPARSE_SCALE_METHOD "scale"
+#define SPARSE_SETVALUES_METHOD "setvalues"
+#define SPARSE_EIGEN_METHOD "eigen"
+
+#define SPARSE_CG_METHOD "cg"
+#define SPARSE_MINRES_METHOD "minres"
+#define SPARSE_BICGSTAB_METHOD "bicgstab"
+#define SPARSE_GMRES_METHOD "gmres"
+
+#define SPARSE_CHOLESKYLABEL "cholesky"
+#define SPARSE_LULABEL "lu"
+
+#define SPARSEFACTORIZATION_CLASSNAME "SparseFactorization"
+
+#define SPARSEFACTORIZATION_SOLVE_METHOD "solve"
+#define SPARSEFACTORIZATION_REFACTOR_METHOD "refactor"
+
+#define SPARSE_TOLOPTION "tol"
+#define SPARSE_MAXITEROPTION "maxiter"
+#define SPARSE_RESTARTOPTION "restart"
+#define SPARSE_PRECONDOPTION "precond"
+#define SPARSE_OMEGAOPTION "omega"
+#define SPARSE_WHICHOPTION "which"
+#define SPARSE_SHIFTOPTION "shift"
+
+#define SPARSE_SMALLESTLABEL "smallest"
+#define SPARSE_LARGESTLABEL "largest"
+
+#define SPARSE_PRECONDNONELABEL "none"
+#define SPARSE_PRECONDJACOBILABEL "jacobi"
+#define SPARSE_PRECONDSSORLABEL "ssor"
+#define SPARSE_PRECONDILU0LABEL "ilu0"
+#define SPARSE_PRECONDIC0LABEL "ic0"
 
 #define SPARSE_CONSTRUCTOR                "SprsCns"
-#define SPARSE_CONSTRUCTOR_MSG            "Sparse() should be called either with dimensions or an array initializer."
+#define SPARSE_CONSTRUCTOR_MSG            "Sparse() should be called either with dimensions, an array initializer or lists of rows, columns and values."
 
 #define SPARSE_SETFAILED                  "SprsSt"
 #define SPARSE_SETFAILED_MSG              "Attempt to set sparse matrix element failed."
@@ -104,6 +163,48 @@ objectsparse *sparse_sparsefromarray(objectarray *array);
 #define SPARSE_OPFAILEDERR                "SprsOpFld"
 #define SPARSE_OPFAILEDERR_MSG            "Sparse matrix operation failed."
 
+#define SPARSE_TRIPLETS                   "SprsTrplts"
+#define SPARSE_TRIPLETS_MSG               "Sparse() requires rows, columns and values to be Lists or Matrices of equal length, with integer indices within the dimensions."
+
+#define SPARSE_SOLVERARGS                 "SprsSlvrArgs"
+#define SPARSE_SOLVERARGS_MSG             "Iterative solvers expect a Matrix right hand side and optionally a Matrix initial guess, with numerical tol, omega and integer maxiter, restart options."
+
+#define SPARSE_INVLDPRECOND               "SprsInvldPrcnd"
+#define SPARSE_INVLDPRECOND_MSG           "Preconditioner should be one of 'none', 'jacobi', 'ssor', 'ilu0' or 'ic0'."
+
+#define SPARSE_PRECONDFAILEDERR           "SprsPrcndFld"
+#define SPARSE_PRECONDFAILEDERR_MSG       "Could not construct preconditioner: the matrix may have a zero on the diagonal or not be positive definite."
+
+#define SPARSE_NOTCONVERGEDERR            "SprsNtCnvrg"
+#define SPARSE_NOTCONVERGEDERR_MSG        "Iterative solver did not converge within the maximum number of iterations."
+
+#define SPARSE_FACTORIZEARGS              "SprsFctrArgs"
+#define SPARSE_FACTORIZEARGS_MSG          "Method 'factorize' expects 'cholesky' or 'lu' as an optional argument."
+
+#define SPARSE_FACTORIZEFAILED            "SprsFctrFld"
+#define SPARSE_FACTORIZEFAILED_MSG        "Sparse factorization failed: the matrix may be singular or, for a Cholesky factorization, not positive definite."
+
+#define SPARSE_PATTERNMISMATCHERR         "SprsPttrn"
+#define SPARSE_PATTERNMISMATCHERR_MSG     "Matrix passed to 'refactor' must have the same dimensions and sparsity pattern as the factorized matrix."
+
+#define SPARSE_SOLVEARGS                  "SprsFctrSlvArgs"
+#define SPARSE_SOLVEARGS_MSG              "Method 'solve' expects a Matrix right hand side."
+
+#define SPARSE_ACCARGS                    "SprsAccArgs"
+#define SPARSE_ACCARGS_MSG                "Method 'acc' expects a number and a Sparse matrix."
+
+#define SPARSE_SCALEARGS                  "SprsSclArgs"
+#define SPARSE_SCALEARGS_MSG              "Method 'scale' expects a number."
+
+#define SPARSE_SETVALUESARGS              "SprsStVls"
+#define SPARSE_SETVALUESARGS_MSG          "Method 'setvalues' expects a Matrix with one value for each stored entry."
+
+#define SPARSE_EIGENARGS                  "SprsEgnArgs"
+#define SPARSE_EIGENARGS_MSG              "Method 'eigen' expects the number of eigenvalues, between 1 and the size of a square matrix, with optional which='smallest' or 'largest', numerical shift and tol, and integer maxiter."
+
+#define SPARSE_EIGENFAILED                "SprsEgnFld"
+#define SPARSE_EIGENFAILED_MSG            "Eigensolver failed: if a shift was given, it may be an eigenvalue of the matrix."
+
 /* ***************************************
  * Dictionary of keys format
  * *************************************** */
@@ -117,6 +218,7 @@ bool sparsedok_setdimensions(sparsedok *dok, int nrows, int ncols);
 unsigned int sparsedok_count(sparsedok *dok);
 void *sparsedok_loopstart(sparsedok *dok);
 bool sparsedok_loop(sparsedok *dok, void **cntr, int *i, int *j);
+bool sparsedok_copy(sparsedok *src, sparsedok *dest);
 
 /* ***************************************
  * Compressed Column Storage Format
@@ -126,12 +228,17 @@ void sparseccs_init(sparseccs *ccs);
 void sparseccs_clear(sparseccs *ccs);
 bool sparseccs_resize(sparseccs *ccs, int nrows, int ncols, unsigned int nentries, bool values);
 bool sparseccs_get(sparseccs *ccs, int i, int j, double *val);
+bool sparseccs_transpose(sparseccs *in, sparseccs *out);
 
 bool sparseccs_getrowindices(sparseccs *ccs, int col, int *nentries, int **entries);
 bool sparseccs_setrowindices(sparseccs *ccs, int col, int nentries, int *entries);
 bool sparseccs_getcolindices(sparseccs *ccs, int maxentries, int *nentries, int *entries);
 bool sparseccs_getcolindicesforrow(sparseccs *ccs, int row, int maxentries, int *nentries, int *entries);
 bool sparseccs_doktoccs(sparsedok *in, sparseccs *out, bool copyvals);
+bool sparseccs_ccstodok(sparseccs *in, sparsedok *out);
+bool sparseccs_compactpattern(sparseccs *ccs);
+bool sparseccs_expand(sparseccs *ccs);
+bool sparseccs_fromtriplets(sparseccs *out, int nrows, int ncols, unsigned int n, int *rows, int *cols, double *vals);
 
 /* ***************************************
  * Object sparse interface
@@ -139,17 +246,66 @@ bool sparseccs_doktoccs(sparsedok *in, sparseccs *out, bool copyvals);
 
 typedef enum { SPARSE_DOK, SPARSE_CCS } objectsparseformat;
 
-typedef enum { SPARSE_OK, SPARSE_INCMPTBLDIM, SPARSE_CONVFAILED, SPARSE_FAILED } objectsparseerror;
+typedef enum { SPARSE_OK, SPARSE_INCMPTBLDIM, SPARSE_CONVFAILED, SPARSE_FAILED, SPARSE_NOTCONVERGED, SPARSE_PRECONDFAILED, SPARSE_PATTERNMISMATCH } objectsparseerror;
+
+/** Iterative solution methods */
+typedef enum { SPARSE_CG, SPARSE_MINRES, SPARSE_BICGSTAB, SPARSE_GMRES } sparsesolvermethod;
+
+/** Preconditioners for iterative solvers */
+typedef enum { SPARSE_PRECONDNONE, SPARSE_PRECONDJACOBI, SPARSE_PRECONDSSOR, SPARSE_PRECONDILU0, SPARSE_PRECONDIC0 } sparseprecondtype;
+
+/** A linear operator y = A x, used by the iterative solvers */
+typedef void (*sparseoperatorfn) (void *ref, double *x, double *y);
+
+/** Which eigenvalues to find */
+typedef enum { SPARSE_EIGENSMALLEST, SPARSE_EIGENLARGEST } sparseeigenwhich;
+
+/** Options for the eigensolver */
+typedef struct {
+    sparseeigenwhich which; // Which end of the spectrum to find, if there is no shift
+    bool shifted; // Whether to find eigenvalues closest to shift instead
+    double shift;
+    double tol; // Residual, relative to the spectral radius, at which to stop
+    int maxiter; // Maximum number of restarts
+} sparseeigenoptions;
+
+/** Options for iterative solvers */
+typedef struct {
+    double tol; // Relative residual at which to stop
+    int maxiter; // Maximum number of iterations; zero selects a default based on the matrix size
+    int restart; // Restart length for GMRES
+    sparseprecondtype precond; // Preconditioner
+    double omega; // Relaxation parameter for SSOR
+} sparsesolveroptions;
 
 bool sparse_checkformat(objectsparse *sparse, objectsparseformat format, bool force, bool copyvals);
+void sparse_removeformat(objectsparse *s, objectsparseformat format);
+bool sparse_compactpattern(objectsparse *s);
 
 objectsparse *sparse_clone(objectsparse *s);
+objectsparse *sparse_fromtriplets(int nrows, int ncols, unsigned int n, int *rows, int *cols, double *vals);
 bool sparse_setelement(objectsparse *matrix, int row, int col, value value);
 bool sparse_getelement(objectsparse *matrix, int row, int col, value *value);
 
 objectsparseerror sparse_add(objectsparse *a, objectsparse *b, double alpha, double beta, objectsparse *out);
 objectsparseerror sparse_mul(objectsparse *a, objectsparse *b, objectsparse *out);
 objectsparseerror sparse_transpose(objectsparse *a, objectsparse *out);
+objectsparseerror sparse_acc(objectsparse *a, double alpha, objectsparse *b);
+objectsparseerror sparse_scale(objectsparse *a, double s);
+objectsparseerror sparse_setvalues(objectsparse *a, unsigned int n, double *values);
+objectsparseerror sparse_muldense(objectsparse *a, int ncols, double *x, double *y);
+objectsparseerror sparse_mulmatrix(objectsparse *a, objectmatrix *b, objectmatrix *out);
+
+void sparse_solveroptionsinit(sparsesolveroptions *opt);
+objectsparseerror sparse_solve(objectsparse *a, sparsesolvermethod method, sparsesolveroptions *opt, objectmatrix *b, objectmatrix *x);
+objectsparseerror sparse_solveoperator(sparseoperatorfn op, void *ref, int n, sparseccs *csr, sparsesolvermethod method, sparsesolveroptions *opt, objectmatrix *b, objectmatrix *x);
+
+objectsparseerror sparse_factorize(objectsparse *a, objectsparsefactorization *f);
+objectsparseerror sparse_refactorize(objectsparsefactorization *f, objectsparse *a);
+objectsparseerror sparse_factorsolve(objectsparsefactorization *f, objectmatrix *b, objectmatrix *x);
+
+void sparse_eigenoptionsinit(sparseeigenoptions *opt);
+objectsparseerror sparse_eigen(objectsparse *a, int k, sparseeigenoptions *opt, double *values, double *vectors);
 
 void sparse_clear(objectsparse *a);
 size_t sparse_size(objectsparse *a);
@@ -160,10 +316,16 @@ size_t sparse_size(objectsparse *a);
 
 value Sparse_divr(vm *v, int nargs, value *args);
 
+void sparse_raiseerror(vm *v, objectsparseerror err);
+bool sparse_solverargs(vm *v, int nargs, value *args, sparsesolveroptions *opt, objectmatrix **b, value *x);
+bool sparse_tripletcount(value in, unsigned int *n);
+bool sparse_tripletindices(value in, unsigned int n, int *out);
+
 /* ***************************************
  * Initialization
  * *************************************** */
 
 void sparse_initialize(void);
+void sparse_finalize(void);
 
 #endif /* sparse_h */
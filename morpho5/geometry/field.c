@@ -136,6 +136,7 @@ objectfield *object_newfield(objectmesh *mesh, value prototype, unsigned int *do
         object_init(&new->data.obj, OBJECT_MATRIX);
         new->data.ncols=1;
         new->data.nrows=size;
+        new->data.version=0;
         new->data.elements=new->data.matrixdata;
         
         if (MORPHO_ISMATRIX(prototype)) {
@@ -226,6 +227,7 @@ bool field_addpool(objectfield *f) {
                 m[i].elements=f->data.elements+i*f->psize;
                 m[i].ncols=prototype->ncols;
                 m[i].nrows=prototype->nrows;
+                m[i].version=0;
             }
         }
         return true;
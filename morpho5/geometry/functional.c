@@ -40,6 +40,37 @@ typedef bool (functional_integrand) (vm *v, objectmesh *mesh, elementid id, int
 /** Gradient function */
 typedef bool (functional_gradient) (vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc);
 
+/** Number of elements processed together by a batched kernel */
+#define FUNCTIONAL_LANES 8
+
+/** Maximum number of vertices per element supported by batched kernels */
+#define FUNCTIONAL_BATCHMAXNV 4
+
+/** A block of elements in structure-of-arrays form, indexed by vertex, component and lane */
+typedef struct {
+    double x[FUNCTIONAL_BATCHMAXNV][3][FUNCTIONAL_LANES]; // Vertex positions
+    double size[FUNCTIONAL_LANES]; // Integrand for each element
+    double grad[FUNCTIONAL_BATCHMAXNV][3][FUNCTIONAL_LANES]; // Gradient contributions to each vertex
+} functional_block;
+
+/** Batched kernel: evaluates the integrand, and optionally the gradient, for every lane of a block. The first n lanes hold real elements; returns false if any of these is degenerate */
+typedef bool (functional_batchkernel) (functional_block *blk, int n, bool grad);
+
+/** Instruction sets for which batched kernels are compiled */
+typedef enum {
+    FUNCTIONAL_SIMD_NONE,
+    FUNCTIONAL_SIMD_AVX2,
+    FUNCTIONAL_SIMD_AVX512,
+    FUNCTIONAL_SIMD_NLEVELS
+} functional_simdlevel;
+
+/** A batched kernel for simplices with nv vertices, compiled once per instruction set */
+typedef struct {
+    int nv; // Number of vertices per element
+    bool size; // Whether the integrand is the element size, which the mesh can cache
+    functional_batchkernel *kernel[FUNCTIONAL_SIMD_NLEVELS]; // Variants indexed by functional_simdlevel
+} functional_batch;
+
 struct s_functional_mapinfo; // Resolve circular typedef dependency
 
 /** Dependencies function */
@@ -54,6 +85,7 @@ typedef struct s_functional_mapinfo {
     functional_gradient *grad; // Gradient
     functional_dependencies *dependencies; // Dependencies
     symmetrybhvr sym; // Symmetry behavior
+    functional_batch *batch; // Batched kernel, if any
     void *ref; // Reference to pass on
 } functional_mapinfo;
 
@@ -71,6 +103,7 @@ static void functional_clearmapinfo(functional_mapinfo *info) {
     info->integrand=NULL;
     info->grad=NULL;
     info->dependencies=NULL;
+    info->batch=NULL;
     info->ref=NULL;
     info->sym=SYMMETRY_NONE;
 }
@@ -122,6 +155,17 @@ static bool functional_countelements(vm *v, objectmesh *mesh, grade g, int *n, o
     return true;
 }
 
+/** Gets the element-vertex table for a grade, if available
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of elements
+ * @param[out] nv - set to the number of vertices per element if the table is available
+ * @returns the table, or NULL */
+static int *functional_elementtable(objectmesh *mesh, grade g, int *nv) {
+    int *table=mesh_elementvertextable(mesh, g);
+    if (table) *nv=g+1;
+    return table;
+}
+
 static int functional_symmetryimagelistfn(const void *a, const void *b) {
     elementid i=*(elementid *) a; elementid j=*(elementid *) b;
     return (int) i-j;
@@ -184,6 +228,153 @@ bool functional_containsvertex(int nv, int *vid, elementid id) {
     return false;
 }
 
+/* **********************************************************************
+ * Batched evaluation
+ * ********************************************************************** */
+
+/* Batched kernels gather FUNCTIONAL_LANES elements into structure-of-arrays
+ * form so that the arithmetic vectorizes. Each kernel is compiled for
+ * several instruction sets and the variant to use is chosen at startup. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FUNCTIONAL_SIMDDISPATCH
+#endif
+
+#ifdef __GNUC__
+#define FUNCTIONAL_INLINE static inline __attribute__((always_inline))
+#else
+#define FUNCTIONAL_INLINE static inline
+#endif
+
+/** Defines functional_batch name##_batch from a kernel body name, for simplices with nvert vertices */
+#ifdef FUNCTIONAL_SIMDDISPATCH
+#define FUNCTIONAL_BATCHKERNEL(name, nvert, issize) \
+static bool name##_none(functional_block *blk, int n, bool grad) { return name(blk, n, grad); } \
+__attribute__((target("avx2,fma"))) static bool name##_avx2(functional_block *blk, int n, bool grad) { return name(blk, n, grad); } \
+__attribute__((target("avx512f"))) static bool name##_avx512(functional_block *blk, int n, bool grad) { return name(blk, n, grad); } \
+static functional_batch name##_batch = { nvert, issize, { name##_none, name##_avx2, name##_avx512 } };
+#else
+#define FUNCTIONAL_BATCHKERNEL(name, nvert, issize) \
+static bool name##_none(functional_block *blk, int n, bool grad) { return name(blk, n, grad); } \
+static functional_batch name##_batch = { nvert, issize, { name##_none, name##_none, name##_none } };
+#endif
+
+/** Instruction set in use for batched kernels */
+static functional_simdlevel functional_simd=FUNCTIONAL_SIMD_NONE;
+
+/** Selects the batched kernel variants to use from the features of the host processor */
+static void functional_detectsimd(void) {
+#ifdef FUNCTIONAL_SIMDDISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) functional_simd=FUNCTIONAL_SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) functional_simd=FUNCTIONAL_SIMD_AVX2;
+#endif
+}
+
+/** Cross product of two 3-vectors for use within kernels */
+FUNCTIONAL_INLINE void functional_lanecross(double *a, double *b, double *out) {
+    out[0]=a[1]*b[2]-a[2]*b[1];
+    out[1]=a[2]*b[0]-a[0]*b[2];
+    out[2]=a[0]*b[1]-a[1]*b[0];
+}
+
+/** Checks whether a map can use its batched kernel
+ * @param[in] info - map info
+ * @returns the element-vertex table to use, or NULL if the map must be done element by element */
+static int *functional_batchtable(functional_mapinfo *info) {
+    int nv=0;
+    if (!info->batch || info->mesh->dim>3) return NULL;
+
+    int *table=functional_elementtable(info->mesh, info->g, &nv);
+    return (nv==info->batch->nv ? table : NULL);
+}
+
+/** Gathers vertex positions for a block of elements; unused lanes repeat the first element and missing components are zero */
+static void functional_batchgather(objectmesh *mesh, int nv, int *table, int n, elementid *ids, functional_block *blk) {
+    double *vert=mesh->vert->elements;
+    int dim=mesh->vert->nrows;
+
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        int *vid=table+ids[(l<n ? l : 0)]*nv;
+        for (int j=0; j<nv; j++) {
+            double *x=vert+vid[j]*dim;
+            for (int k=0; k<3; k++) blk->x[j][k][l]=(k<dim ? x[k] : 0.0);
+        }
+    }
+}
+
+/** Adds the gradient contributions of the first n lanes of a block to a force matrix */
+static void functional_batchscatter(int nv, int *table, int n, elementid *ids, functional_block *blk, objectmatrix *frc) {
+    int dim=frc->nrows;
+
+    for (int l=0; l<n; l++) {
+        int *vid=table+ids[l]*nv;
+        for (int j=0; j<nv; j++) {
+            double *f=frc->elements+vid[j]*dim;
+            for (int k=0; k<dim; k++) f[k]+=blk->grad[j][k][l];
+        }
+    }
+}
+
+/** Maps a batched kernel over the elements of a mesh or selection
+ * @param[in] info - map info; info->batch must be set
+ * @param[in] n - number of elements
+ * @param[in] table - element-vertex table from functional_batchtable
+ * @param[in] imageids - sorted list of image elements to skip, or NULL
+ * @param[in] cached - if not NULL, integrand values for every element to use in place of the kernel
+ * @param[out] sum - if not NULL, the total of the integrand
+ * @param[out] values - if not NULL, a 1 x n matrix to hold the integrand for each element
+ * @param[out] frc - if not NULL, a matrix to accumulate the gradient into
+ * @returns true on success, false if a degenerate element was found */
+static bool functional_batchmap(functional_mapinfo *info, int n, int *table, varray_elementid *imageids, double *cached, double *sum, objectmatrix *values, objectmatrix *frc) {
+    objectselection *sel = info->sel;
+    grade g = info->g;
+    functional_batchkernel *kernel = info->batch->kernel[functional_simd];
+    int nv = info->batch->nv;
+    functional_block blk;
+    elementid ids[FUNCTIONAL_LANES];
+    unsigned int k=0, kmax=(sel ? (sel->selected[g].count>0 ? sel->selected[g].capacity : 0) : n);
+    int sindx=0; // Index into imageids array
+    double c=0.0, y, t;
+
+    if (sum) *sum=0.0;
+
+    while (k<kmax) {
+        int nblk=0;
+
+        /* Collect the next block of elements */
+        for (; k<kmax && nblk<FUNCTIONAL_LANES; k++) {
+            elementid i=k;
+            if (sel) {
+                if (!MORPHO_ISINTEGER(sel->selected[g].contents[k].key)) continue;
+                i=MORPHO_GETINTEGERVALUE(sel->selected[g].contents[k].key);
+            }
+
+            // Skip this element if it's an image element
+            if (imageids && (sindx<imageids->count) && imageids->data[sindx]==i) { sindx++; continue; }
+
+            ids[nblk++]=i;
+        }
+        if (nblk==0) break;
+
+        if (cached && !frc) {
+            for (int l=0; l<nblk; l++) blk.size[l]=cached[ids[l]];
+        } else {
+            functional_batchgather(info->mesh, nv, table, nblk, ids, &blk);
+            if (!(*kernel) (&blk, nblk, frc!=NULL)) return false;
+        }
+
+        for (int l=0; l<nblk; l++) {
+            if (sum) { y=blk.size[l]-c; t=*sum+y; c=(t-*sum)-y; *sum=t; } // Kahan summation
+            if (values) matrix_setelement(values, 0, ids[l], blk.size[l]);
+        }
+
+        if (frc) functional_batchscatter(nv, table, nblk, ids, &blk, frc);
+    }
+
+    return true;
+}
+
 /* **********************************************************************
  * Map functions
  * ********************************************************************** */
@@ -210,10 +401,17 @@ bool functional_sumintegrand(vm *v, functional_mapinfo *info, value *out) {
     varray_elementidinit(&imageids);
     functional_symmetryimagelist(mesh, g, true, &imageids);
 
-    if (n>0) {
+    int *batchtable=(n>0 ? functional_batchtable(info) : NULL);
+    if (batchtable) {
+        double *cached=(info->batch->size ? mesh_getgeometry(v, mesh, MESH_GEOMETRY_SIZE, g) : NULL);
+        double sum;
+        if (!functional_batchmap(info, n, batchtable, &imageids, cached, &sum, NULL, NULL)) goto functional_sumintegrand_cleanup;
+        *out=MORPHO_FLOAT(sum);
+    } else if (n>0) {
         int vertexid; // Use this if looping over grade 0
         int *vid=(g==0 ? &vertexid : NULL),
             nv=(g==0 ? 1 : 0); // The vertex indices
+        int *table=functional_elementtable(mesh, g, &nv); // Fixed arity element-vertex table, if available
         int sindx=0; // Index into imageids array
         double sum=0.0, c=0.0, y, t, result;
 
@@ -225,7 +423,8 @@ bool functional_sumintegrand(vm *v, functional_mapinfo *info, value *out) {
                 // Skip this element if it's an image element:
                 if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
 
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -239,7 +438,8 @@ bool functional_sumintegrand(vm *v, functional_mapinfo *info, value *out) {
                 // Skip this element if it's an image element
                 if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
 
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -290,10 +490,17 @@ bool functional_mapintegrand(vm *v, functional_mapinfo *info, value *out) {
         if (!new) { morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED); return false; }
     }
 
-    if (new) {
+    int *batchtable=(new ? functional_batchtable(info) : NULL);
+    if (batchtable) {
+        double *cached=(info->batch->size ? mesh_getgeometry(v, mesh, MESH_GEOMETRY_SIZE, g) : NULL);
+        if (!functional_batchmap(info, n, batchtable, &imageids, cached, NULL, new, NULL)) goto functional_mapintegrand_cleanup;
+        *out = MORPHO_OBJECT(new);
+        ret=true;
+    } else if (new) {
         int vertexid; // Use this if looping over grade 0
         int *vid=(g==0 ? &vertexid : NULL),
             nv=(g==0 ? 1 : 0); // The vertex indices
+        int *table=functional_elementtable(mesh, g, &nv); // Fixed arity element-vertex table, if available
         int sindx=0; // Index into imageids array
         double result;
 
@@ -305,7 +512,8 @@ bool functional_mapintegrand(vm *v, functional_mapinfo *info, value *out) {
                 // Skip this element if it's an image element
                 if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
 
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -319,7 +527,8 @@ bool functional_mapintegrand(vm *v, functional_mapinfo *info, value *out) {
                 // Skip this element if it's an image element
                 if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
 
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -368,10 +577,19 @@ bool functional_mapgradient(vm *v, functional_mapinfo *info, value *out) {
         if (!frc)  { morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED); return false; }
     }
 
-    if (frc) {
+    int *batchtable=(frc ? functional_batchtable(info) : NULL);
+    if (batchtable) {
+        if (!functional_batchmap(info, n, batchtable, NULL, NULL, NULL, NULL, frc)) goto functional_mapgradient_cleanup;
+
+        if (sym==SYMMETRY_ADD) functional_symmetrysumforces(mesh, frc);
+
+        *out = MORPHO_OBJECT(frc);
+        ret=true;
+    } else if (frc) {
         int vertexid; // Use this if looping over grade 0
         int *vid=(g==0 ? &vertexid : NULL),
             nv=(g==0 ? 1 : 0); // The vertex indices
+        int *table=functional_elementtable(mesh, g, &nv); // Fixed arity element-vertex table, if available
 
 
         if (sel) { // Loop over selection
@@ -379,7 +597,8 @@ bool functional_mapgradient(vm *v, functional_mapinfo *info, value *out) {
                 if (!MORPHO_ISINTEGER(sel->selected[g].contents[k].key)) continue;
 
                 elementid i = MORPHO_GETINTEGERVALUE(sel->selected[g].contents[k].key);
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -388,7 +607,8 @@ bool functional_mapgradient(vm *v, functional_mapinfo *info, value *out) {
             }
         } else { // Loop over elements
             for (elementid i=0; i<n; i++) {
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -521,6 +741,7 @@ bool functional_mapnumericalgradient(vm *v, functional_mapinfo *info, value *out
         int vertexid; // Use this if looping over grade 0
         int *vid=(g==0 ? &vertexid : NULL),
             nv=(g==0 ? 1 : 0); // The vertex indices
+        int *table=functional_elementtable(mesh, g, &nv); // Fixed arity element-vertex table, if available
         int sindx=0; // Index into imageids array
 
         if (sel) { // Loop over selection
@@ -528,7 +749,8 @@ bool functional_mapnumericalgradient(vm *v, functional_mapinfo *info, value *out
                 if (!MORPHO_ISINTEGER(sel->selected[g].contents[k].key)) continue;
 
                 elementid i = MORPHO_GETINTEGERVALUE(sel->selected[g].contents[k].key);
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 // Skip this element if it's an image element
@@ -551,7 +773,8 @@ bool functional_mapnumericalgradient(vm *v, functional_mapinfo *info, value *out
                 // Skip this element if it's an image element
                 if ((imageids.count>0) && (sindx<imageids.count) && imageids.data[sindx]==i) { sindx++; continue; }
 
-                if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
+                if (table) vid=table+i*nv;
+                else if (s) sparseccs_getrowindices(&s->ccs, i, &nv, &vid);
                 else vertexid=i;
 
                 if (vid && nv>0) {
@@ -695,12 +918,22 @@ void functional_veccross(double *a, double *b, double *out) {
     out[2]=a[0]*b[1]-a[1]*b[0];
 }
 
+/** Gathers pointers to the positions of a fixed number of vertices; n should be a compile time constant so that the loop unrolls */
+static inline void functional_gathervertices(objectmesh *mesh, int n, int *vid, double **x) {
+    double *vert=mesh->vert->elements;
+    int stride=mesh->vert->nrows;
+    for (int j=0; j<n; j++) x[j]=vert+vid[j]*stride;
+}
+
 bool length_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out);
 bool area_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out);
 bool volume_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out);
 
-/** Calculate element size */
+/** Calculate element size, using the mesh's cached sizes if they are up to date */
 bool functional_elementsize(vm *v, objectmesh *mesh, grade g, elementid id, int nv, int *vid, double *out) {
+    double *cached=mesh_cachedgeometry(mesh, MESH_GEOMETRY_SIZE, g);
+    if (cached) { *out=cached[id]; return true; }
+
     switch (g) {
         case 1: return length_integrand(v, mesh, id, nv, vid, NULL, out);
         case 2: return area_integrand(v, mesh, id, nv, vid, NULL, out);
@@ -719,27 +952,30 @@ bool functional_elementsize(vm *v, objectmesh *mesh, grade g, elementid id, int
     return MORPHO_NIL; \
 }
 
-/** Evaluate an integrand */
-#define FUNCTIONAL_INTEGRAND(name, grade, integrandfn) value name##_integrand(vm *v, int nargs, value *args) { \
+/** Evaluate an integrand, using a batched kernel (or NULL) where possible */
+#define FUNCTIONAL_BATCHINTEGRAND(name, grade, integrandfn, batchfn) value name##_integrand(vm *v, int nargs, value *args) { \
     functional_mapinfo info; \
     value out=MORPHO_NIL; \
     \
     if (functional_validateargs(v, nargs, args, &info)) { \
-        info.g = grade; info.integrand = integrandfn; \
+        info.g = grade; info.integrand = integrandfn; info.batch = batchfn; \
         functional_mapintegrand(v, &info, &out); \
     } \
     if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out); \
     return out; \
 }
 
-/** Evaluate a gradient */
-#define FUNCTIONAL_GRADIENT(name, grade, gradientfn, symbhvr) \
+/** Evaluate an integrand */
+#define FUNCTIONAL_INTEGRAND(name, grade, integrandfn) FUNCTIONAL_BATCHINTEGRAND(name, grade, integrandfn, NULL)
+
+/** Evaluate a gradient, using a batched kernel (or NULL) where possible */
+#define FUNCTIONAL_BATCHGRADIENT(name, grade, gradientfn, symbhvr, batchfn) \
 value name##_gradient(vm *v, int nargs, value *args) { \
     functional_mapinfo info; \
     value out=MORPHO_NIL; \
     \
     if (functional_validateargs(v, nargs, args, &info)) { \
-        info.g = grade; info.grad = gradientfn; info.sym = symbhvr; \
+        info.g = grade; info.grad = gradientfn; info.sym = symbhvr; info.batch = batchfn; \
         functional_mapgradient(v, &info, &out); \
     } \
     if (!MORPHO_ISNIL(out)) morpho_bindobjects(v, 1, &out); \
@@ -747,20 +983,26 @@ value name##_gradient(vm *v, int nargs, value *args) { \
     return out; \
 }
 
-/** Total an integrand */
-#define FUNCTIONAL_TOTAL(name, grade, totalfn) \
+/** Evaluate a gradient */
+#define FUNCTIONAL_GRADIENT(name, grade, gradientfn, symbhvr) FUNCTIONAL_BATCHGRADIENT(name, grade, gradientfn, symbhvr, NULL)
+
+/** Total an integrand, using a batched kernel (or NULL) where possible */
+#define FUNCTIONAL_BATCHTOTAL(name, grade, totalfn, batchfn) \
 value name##_total(vm *v, int nargs, value *args) { \
     functional_mapinfo info; \
     value out=MORPHO_NIL; \
     \
     if (functional_validateargs(v, nargs, args, &info)) { \
-        info.g = grade; info.integrand = totalfn; \
+        info.g = grade; info.integrand = totalfn; info.batch = batchfn; \
         functional_sumintegrand(v, &info, &out); \
     } \
     \
     return out; \
 }
 
+/** Total an integrand */
+#define FUNCTIONAL_TOTAL(name, grade, totalfn) FUNCTIONAL_BATCHTOTAL(name, grade, totalfn, NULL)
+
 /* Alternative way of defining methods that use a reference */
 #define FUNCTIONAL_METHOD(class, name, grade, reftype, prepare, integrandfn, integrandmapfn, deps, err, symbhvr) value class##_##name(vm *v, int nargs, value *args) { \
     functional_mapinfo info; \
@@ -787,8 +1029,8 @@ value name##_total(vm *v, int nargs, value *args) { \
 
 /** Calculate area */
 bool length_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
-    double *x[nv], s0[mesh->dim];
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[2], s0[mesh->dim];
+    functional_gathervertices(mesh, 2, vid, x);
 
     functional_vecsub(mesh->dim, x[1], x[0], s0);
 
@@ -798,8 +1040,8 @@ bool length_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, v
 
 /** Calculate gradient */
 bool length_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
-    double *x[nv], s0[mesh->dim], norm;
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[2], s0[mesh->dim], norm;
+    functional_gathervertices(mesh, 2, vid, x);
 
     functional_vecsub(mesh->dim, x[1], x[0], s0);
     norm=functional_vecnorm(mesh->dim, s0);
@@ -811,10 +1053,35 @@ bool length_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, vo
     return true;
 }
 
+/** Batched length and gradient */
+FUNCTIONAL_INLINE bool length_batchkernel(functional_block *b, int n, bool grad) {
+    double s[3][FUNCTIONAL_LANES];
+
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        for (int k=0; k<3; k++) s[k][l]=b->x[1][k][l]-b->x[0][k][l];
+        b->size[l]=s[0][l]*s[0][l]+s[1][l]*s[1][l]+s[2][l]*s[2][l];
+    }
+    for (int l=0; l<FUNCTIONAL_LANES; l++) b->size[l]=sqrt(b->size[l]);
+    if (!grad) return true;
+
+    for (int l=0; l<n; l++) if (b->size[l]<MORPHO_EPS) return false;
+
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        double r=1.0/b->size[l];
+        for (int k=0; k<3; k++) {
+            b->grad[0][k][l]=-r*s[k][l];
+            b->grad[1][k][l]=r*s[k][l];
+        }
+    }
+    return true;
+}
+
+FUNCTIONAL_BATCHKERNEL(length_batchkernel, 2, true)
+
 FUNCTIONAL_INIT(Length, MESH_GRADE_LINE)
-FUNCTIONAL_INTEGRAND(Length, MESH_GRADE_LINE, length_integrand)
-FUNCTIONAL_GRADIENT(Length, MESH_GRADE_LINE, length_gradient, SYMMETRY_ADD)
-FUNCTIONAL_TOTAL(Length, MESH_GRADE_LINE, length_integrand)
+FUNCTIONAL_BATCHINTEGRAND(Length, MESH_GRADE_LINE, length_integrand, &length_batchkernel_batch)
+FUNCTIONAL_BATCHGRADIENT(Length, MESH_GRADE_LINE, length_gradient, SYMMETRY_ADD, &length_batchkernel_batch)
+FUNCTIONAL_BATCHTOTAL(Length, MESH_GRADE_LINE, length_integrand, &length_batchkernel_batch)
 
 MORPHO_BEGINCLASS(Length)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, Length_init, BUILTIN_FLAGSEMPTY),
@@ -829,8 +1096,8 @@ MORPHO_ENDCLASS
 
 /** Calculate area enclosed */
 bool areaenclosed_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
-    double *x[nv], cx[mesh->dim];
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[2], cx[mesh->dim];
+    functional_gathervertices(mesh, 2, vid, x);
 
     functional_veccross(x[0], x[1], cx);
 
@@ -840,9 +1107,9 @@ bool areaenclosed_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *
 
 /** Calculate gradient */
 bool areaenclosed_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
-    double *x[nv], cx[mesh->dim], s[mesh->dim];
+    double *x[2], cx[mesh->dim], s[mesh->dim];
     double norm;
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    functional_gathervertices(mesh, 2, vid, x);
 
     functional_veccross(x[0], x[1], cx);
     norm=functional_vecnorm(mesh->dim, cx);
@@ -875,8 +1142,8 @@ MORPHO_ENDCLASS
 
 /** Calculate area */
 bool area_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
-    double *x[nv], s0[mesh->dim], s1[mesh->dim], cx[mesh->dim];
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[3], s0[mesh->dim], s1[mesh->dim], cx[mesh->dim];
+    functional_gathervertices(mesh, 3, vid, x);
 
     functional_vecsub(mesh->dim, x[1], x[0], s0);
     functional_vecsub(mesh->dim, x[2], x[1], s1);
@@ -889,9 +1156,9 @@ bool area_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, voi
 
 /** Calculate gradient */
 bool area_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
-    double *x[nv], s0[3], s1[3], s01[3], s010[3], s011[3];
+    double *x[3], s0[3], s1[3], s01[3], s010[3], s011[3];
     double norm;
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    functional_gathervertices(mesh, 3, vid, x);
 
     functional_vecsub(mesh->dim, x[1], x[0], s0);
     functional_vecsub(mesh->dim, x[2], x[1], s1);
@@ -913,10 +1180,49 @@ bool area_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void
     return true;
 }
 
+/** Batched area and gradient */
+FUNCTIONAL_INLINE bool area_batchkernel(functional_block *b, int n, bool grad) {
+    double norm[FUNCTIONAL_LANES];
+
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        double s0[3], s1[3], s01[3];
+        for (int k=0; k<3; k++) {
+            s0[k]=b->x[1][k][l]-b->x[0][k][l];
+            s1[k]=b->x[2][k][l]-b->x[1][k][l];
+        }
+        functional_lanecross(s0, s1, s01);
+        norm[l]=s01[0]*s01[0]+s01[1]*s01[1]+s01[2]*s01[2];
+    }
+    for (int l=0; l<FUNCTIONAL_LANES; l++) norm[l]=sqrt(norm[l]);
+    for (int l=0; l<FUNCTIONAL_LANES; l++) b->size[l]=0.5*norm[l];
+    if (!grad) return true;
+
+    for (int l=0; l<n; l++) if (norm[l]<MORPHO_EPS) return false;
+
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        double s0[3], s1[3], s01[3], s010[3], s011[3], r=0.5/norm[l];
+        for (int k=0; k<3; k++) {
+            s0[k]=b->x[1][k][l]-b->x[0][k][l];
+            s1[k]=b->x[2][k][l]-b->x[1][k][l];
+        }
+        functional_lanecross(s0, s1, s01);
+        functional_lanecross(s01, s0, s010);
+        functional_lanecross(s01, s1, s011);
+        for (int k=0; k<3; k++) {
+            b->grad[0][k][l]=r*s011[k];
+            b->grad[1][k][l]=-r*(s010[k]+s011[k]);
+            b->grad[2][k][l]=r*s010[k];
+        }
+    }
+    return true;
+}
+
+FUNCTIONAL_BATCHKERNEL(area_batchkernel, 3, true)
+
 FUNCTIONAL_INIT(Area, MESH_GRADE_AREA)
-FUNCTIONAL_INTEGRAND(Area, MESH_GRADE_AREA, area_integrand)
-FUNCTIONAL_GRADIENT(Area, MESH_GRADE_AREA, area_gradient, SYMMETRY_ADD)
-FUNCTIONAL_TOTAL(Area, MESH_GRADE_AREA, area_integrand)
+FUNCTIONAL_BATCHINTEGRAND(Area, MESH_GRADE_AREA, area_integrand, &area_batchkernel_batch)
+FUNCTIONAL_BATCHGRADIENT(Area, MESH_GRADE_AREA, area_gradient, SYMMETRY_ADD, &area_batchkernel_batch)
+FUNCTIONAL_BATCHTOTAL(Area, MESH_GRADE_AREA, area_integrand, &area_batchkernel_batch)
 
 MORPHO_BEGINCLASS(Area)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, Area_init, BUILTIN_FLAGSEMPTY),
@@ -931,8 +1237,8 @@ MORPHO_ENDCLASS
 
 /** Calculate enclosed volume */
 bool volumeenclosed_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
-    double *x[nv], cx[mesh->dim];
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[3], cx[mesh->dim];
+    functional_gathervertices(mesh, 3, vid, x);
 
     functional_veccross(x[0], x[1], cx);
 
@@ -942,8 +1248,8 @@ bool volumeenclosed_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int
 
 /** Calculate gradient */
 bool volumeenclosed_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
-    double *x[nv], cx[mesh->dim], dot;
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[3], cx[mesh->dim], dot;
+    functional_gathervertices(mesh, 3, vid, x);
 
     functional_veccross(x[0], x[1], cx);
     dot=functional_vecdot(mesh->dim, cx, x[2]);
@@ -960,10 +1266,34 @@ bool volumeenclosed_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int
     return true;
 }
 
+/** Batched enclosed volume and gradient */
+FUNCTIONAL_INLINE bool volumeenclosed_batchkernel(functional_block *b, int n, bool grad) {
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        double x0[3], x1[3], x2[3], cx[3], dot, sgn;
+        for (int k=0; k<3; k++) {
+            x0[k]=b->x[0][k][l]; x1[k]=b->x[1][k][l]; x2[k]=b->x[2][k][l];
+        }
+        functional_lanecross(x0, x1, cx);
+        dot=cx[0]*x2[0]+cx[1]*x2[1]+cx[2]*x2[2];
+        b->size[l]=fabs(dot)/6.0;
+        if (!grad) continue;
+
+        sgn=dot/fabs(dot)/6.0;
+        for (int k=0; k<3; k++) b->grad[2][k][l]=sgn*cx[k];
+        functional_lanecross(x1, x2, cx);
+        for (int k=0; k<3; k++) b->grad[0][k][l]=sgn*cx[k];
+        functional_lanecross(x2, x0, cx);
+        for (int k=0; k<3; k++) b->grad[1][k][l]=sgn*cx[k];
+    }
+    return true;
+}
+
+FUNCTIONAL_BATCHKERNEL(volumeenclosed_batchkernel, 3, false)
+
 FUNCTIONAL_INIT(VolumeEnclosed, MESH_GRADE_AREA)
-FUNCTIONAL_INTEGRAND(VolumeEnclosed, MESH_GRADE_AREA, volumeenclosed_integrand)
-FUNCTIONAL_GRADIENT(VolumeEnclosed, MESH_GRADE_AREA, volumeenclosed_gradient, SYMMETRY_ADD)
-FUNCTIONAL_TOTAL(VolumeEnclosed, MESH_GRADE_AREA, volumeenclosed_integrand)
+FUNCTIONAL_BATCHINTEGRAND(VolumeEnclosed, MESH_GRADE_AREA, volumeenclosed_integrand, &volumeenclosed_batchkernel_batch)
+FUNCTIONAL_BATCHGRADIENT(VolumeEnclosed, MESH_GRADE_AREA, volumeenclosed_gradient, SYMMETRY_ADD, &volumeenclosed_batchkernel_batch)
+FUNCTIONAL_BATCHTOTAL(VolumeEnclosed, MESH_GRADE_AREA, volumeenclosed_integrand, &volumeenclosed_batchkernel_batch)
 
 MORPHO_BEGINCLASS(VolumeEnclosed)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, VolumeEnclosed_init, BUILTIN_FLAGSEMPTY),
@@ -978,8 +1308,8 @@ MORPHO_ENDCLASS
 
 /** Calculate enclosed volume */
 bool volume_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, double *out) {
-    double *x[nv], s10[mesh->dim], s20[mesh->dim], s30[mesh->dim], cx[mesh->dim];
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    double *x[4], s10[mesh->dim], s20[mesh->dim], s30[mesh->dim], cx[mesh->dim];
+    functional_gathervertices(mesh, 4, vid, x);
 
     functional_vecsub(mesh->dim, x[1], x[0], s10);
     functional_vecsub(mesh->dim, x[2], x[0], s20);
@@ -993,9 +1323,9 @@ bool volume_integrand(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, v
 
 /** Calculate gradient */
 bool volume_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, void *ref, objectmatrix *frc) {
-    double *x[nv], s10[mesh->dim], s20[mesh->dim], s30[mesh->dim];
+    double *x[4], s10[mesh->dim], s20[mesh->dim], s30[mesh->dim];
     double s31[mesh->dim], s21[mesh->dim], cx[mesh->dim], uu;
-    for (int j=0; j<nv; j++) matrix_getcolumn(mesh->vert, vid[j], &x[j]);
+    functional_gathervertices(mesh, 4, vid, x);
 
     functional_vecsub(mesh->dim, x[1], x[0], s10);
     functional_vecsub(mesh->dim, x[2], x[0], s20);
@@ -1021,10 +1351,40 @@ bool volume_gradient(vm *v, objectmesh *mesh, elementid id, int nv, int *vid, vo
     return true;
 }
 
+/** Batched volume and gradient */
+FUNCTIONAL_INLINE bool volume_batchkernel(functional_block *b, int n, bool grad) {
+    for (int l=0; l<FUNCTIONAL_LANES; l++) {
+        double s10[3], s20[3], s30[3], s31[3], s21[3], cx[3], uu;
+        for (int k=0; k<3; k++) {
+            s10[k]=b->x[1][k][l]-b->x[0][k][l];
+            s20[k]=b->x[2][k][l]-b->x[0][k][l];
+            s30[k]=b->x[3][k][l]-b->x[0][k][l];
+            s31[k]=b->x[3][k][l]-b->x[1][k][l];
+            s21[k]=b->x[2][k][l]-b->x[1][k][l];
+        }
+        functional_lanecross(s20, s30, cx);
+        uu=s10[0]*cx[0]+s10[1]*cx[1]+s10[2]*cx[2];
+        b->size[l]=fabs(uu)/6.0;
+        if (!grad) continue;
+
+        uu=(uu>0 ? 1.0 : -1.0)/6.0;
+        for (int k=0; k<3; k++) b->grad[1][k][l]=uu*cx[k];
+        functional_lanecross(s31, s21, cx);
+        for (int k=0; k<3; k++) b->grad[0][k][l]=uu*cx[k];
+        functional_lanecross(s30, s10, cx);
+        for (int k=0; k<3; k++) b->grad[2][k][l]=uu*cx[k];
+        functional_lanecross(s10, s20, cx);
+        for (int k=0; k<3; k++) b->grad[3][k][l]=uu*cx[k];
+    }
+    return true;
+}
+
+FUNCTIONAL_BATCHKERNEL(volume_batchkernel, 4, true)
+
 FUNCTIONAL_INIT(Volume, MESH_GRADE_VOLUME)
-FUNCTIONAL_INTEGRAND(Volume, MESH_GRADE_VOLUME, volume_integrand)
-FUNCTIONAL_GRADIENT(Volume, MESH_GRADE_VOLUME, volume_gradient, SYMMETRY_ADD)
-FUNCTIONAL_TOTAL(Volume, MESH_GRADE_VOLUME, volume_integrand)
+FUNCTIONAL_BATCHINTEGRAND(Volume, MESH_GRADE_VOLUME, volume_integrand, &volume_batchkernel_batch)
+FUNCTIONAL_BATCHGRADIENT(Volume, MESH_GRADE_VOLUME, volume_gradient, SYMMETRY_ADD, &volume_batchkernel_batch)
+FUNCTIONAL_BATCHTOTAL(Volume, MESH_GRADE_VOLUME, volume_integrand, &volume_batchkernel_batch)
 
 MORPHO_BEGINCLASS(Volume)
 MORPHO_METHOD(MORPHO_INITIALIZER_METHOD, Volume_init, BUILTIN_FLAGSEMPTY),
@@ -1033,6 +1393,44 @@ MORPHO_METHOD(FUNCTIONAL_GRADIENT_METHOD, Volume_gradient, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(FUNCTIONAL_TOTAL_METHOD, Volume_total, BUILTIN_FLAGSEMPTY)
 MORPHO_ENDCLASS
 
+/* ----------------------------------------------
+ * Element sizes
+ * ---------------------------------------------- */
+
+/** Calculates the size of every element of a given grade, using batched kernels where possible
+ * @param[in] v - the vm in use
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of elements
+ * @param[out] out - a 1 x nel matrix to hold the sizes
+ * @returns true on success */
+bool functional_elementsizes(vm *v, objectmesh *mesh, grade g, objectmatrix *out) {
+    functional_mapinfo info;
+    functional_clearmapinfo(&info);
+    info.mesh=mesh;
+    info.g=g;
+
+    switch (g) {
+        case MESH_GRADE_LINE: info.batch=&length_batchkernel_batch; break;
+        case MESH_GRADE_AREA: info.batch=&area_batchkernel_batch; break;
+        case MESH_GRADE_VOLUME: info.batch=&volume_batchkernel_batch; break;
+        default: return false;
+    }
+
+    int *table=functional_batchtable(&info);
+    if (table) return functional_batchmap(&info, out->ncols, table, NULL, NULL, NULL, out, NULL);
+
+    objectsparse *conn=mesh_getconnectivityelement(mesh, 0, g);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+
+    int nv, *vid;
+    for (elementid id=0; id<out->ncols; id++) {
+        if (!sparseccs_getrowindices(&conn->ccs, id, &nv, &vid)) return false;
+        if (!functional_elementsize(v, mesh, g, id, nv, vid, out->elements+id)) return false;
+    }
+
+    return true;
+}
+
 /* ----------------------------------------------
  * Scalar potential
  * ---------------------------------------------- */
@@ -1264,6 +1662,7 @@ bool linearelasticity_prepareref(objectinstance *self, linearelasticityref *ref)
 
         ref->mu=0.5/(1+nu);
         ref->lambda=nu/(1+nu)/(1-2*nu);
+        mesh_getgeometry(NULL, ref->refmesh, MESH_GEOMETRY_SIZE, ref->grade); // Reference sizes are reused by every element
         success=true;
     }
     return success;
@@ -1403,6 +1802,7 @@ bool hydrogel_prepareref(objectinstance *self, objectmesh *mesh, grade g, object
             morpho_valuetofloat(d, &ref->d) &&
             morpho_valuetofloat(phiref, &ref->phiref)) {
             ref->phi0 = phi0;
+            mesh_getgeometry(NULL, ref->refmesh, MESH_GEOMETRY_SIZE, ref->grade); // Reference sizes are reused by every element
             success=true;
         }
     }
@@ -2989,6 +3389,7 @@ MORPHO_ENDCLASS
 void functional_initialize(void) {
     functional_gradeproperty=builtin_internsymbolascstring(FUNCTIONAL_GRADE_PROPERTY);
     functional_fieldproperty=builtin_internsymbolascstring(FUNCTIONAL_FIELD_PROPERTY);
+    functional_detectsimd();
     scalarpotential_functionproperty=builtin_internsymbolascstring(SCALARPOTENTIAL_FUNCTION_PROPERTY);
     scalarpotential_gradfunctionproperty=builtin_internsymbolascstring(SCALARPOTENTIAL_GRADFUNCTION_PROPERTY);
     linearelasticity_referenceproperty=builtin_internsymbolascstring(LINEARELASTICITY_REFERENCE_PROPERTY);
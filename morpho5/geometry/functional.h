@@ -8,6 +8,7 @@
 #define functional_h
 
 #include <stdio.h>
+#include "mesh.h"
 
 /* Functional properties */
 #define FUNCTIONAL_GRADE_PROPERTY             "grade"
@@ -108,6 +109,9 @@
 #define FUNCTIONAL_ARGS                "FnctlArgs"
 #define FUNCTIONAL_ARGS_MSG            "Invalid args passed to method."
 
+bool functional_elementsize(vm *v, objectmesh *mesh, grade g, elementid id, int nv, int *vid, double *out);
+bool functional_elementsizes(vm *v, objectmesh *mesh, grade g, objectmatrix *out);
+
 void functional_initialize(void);
 
 #endif /* functional_h */
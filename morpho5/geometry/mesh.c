@@ -14,10 +14,12 @@
 #include "sparse.h"
 #include "matrix.h"
 #include "selection.h"
+#include "functional.h"
 
 #include <limits.h>
 
 void mesh_link(objectmesh *mesh, object *obj);
+static void mesh_freegeometrycache(objectmesh *mesh);
 
 DEFINE_VARRAY(elementid, elementid);
 
@@ -48,10 +50,19 @@ void objectmesh_freefn(object *obj) {
         }
     }
     if (m->conn) object_free((object *) m->conn);
+    mesh_freegeometrycache(m);
 }
 
 size_t objectmesh_sizefn(object *obj) {
-    return sizeof(objectmesh);
+    objectmesh *m = (objectmesh *) obj;
+    size_t size=sizeof(objectmesh);
+    if (m->cache) {
+        size+=sizeof(meshgeometrycache);
+        for (int i=0; i<MESH_GEOMETRY_NKINDS; i++) {
+            for (int j=0; j<MESH_GEOMETRY_NGRADES; j++) size+=sizeof(double)*m->cache->entry[i][j].size;
+        }
+    }
+    return size;
 }
 
 objecttypedefn objectmeshdefn = {
@@ -66,15 +77,15 @@ objecttypedefn objectmeshdefn = {
  * ********************************************************************** */
 
 objectmesh *object_newmesh(unsigned int dim, unsigned int nv, double *v) {
-    objectmesh *new = MORPHO_MALLOC(sizeof(objectmesh));
+    objectmesh *new = (objectmesh *) object_new(sizeof(objectmesh), OBJECT_MESH);
 
     if (new) {
-        object_init((object *) new, OBJECT_MESH);
-
         new->dim=dim;
         new->conn=NULL;
         new->vert=object_newmatrix(dim, nv, false);
         new->link=NULL;
+        new->version=0;
+        new->cache=NULL;
         if (new->vert) {
             mesh_link(new, (object *) new->vert);
             if (dim>0){
@@ -193,14 +204,17 @@ bool mesh_checkconnectivity(objectmesh *mesh) {
     return (mesh->conn);
 }
 
-/** Freezes mesh connectivity, converting subsidiary data structures to fixed but efficient versions */
+/** Freezes mesh connectivity, converting subsidiary data structures to fixed but efficient versions
+ * @details Connectivity matrices are held in compact pattern-only form; symmetry matrices on the diagonal retain their DOK since their entries carry the symmetry objects. */
 void mesh_freezeconnectivity(objectmesh *mesh) {
     if (!mesh_checkconnectivity(mesh)) return;
 
     for (unsigned int i=0; i<mesh->dim+1; i++) {
         for (unsigned int j=0; j<mesh->dim+1; j++) {
             objectsparse *s=mesh_getconnectivityelement(mesh, i, j);
-            if (s) sparse_checkformat(s, SPARSE_CCS, true, false);
+            if (!s) continue;
+            if (i==j) sparse_checkformat(s, SPARSE_CCS, true, false);
+            else sparse_compactpattern(s);
         }
     }
 }
@@ -214,6 +228,7 @@ objectsparse *mesh_newconnectivityelement(objectmesh *mesh, unsigned int row, un
     if (out) array_setelement(mesh->conn, 2, indx, MORPHO_OBJECT(out));
 
     if (out) mesh_link(mesh, (object *) out);
+    mesh_changed(mesh);
 
     return out;
 }
@@ -237,6 +252,7 @@ bool mesh_setconnectivityelement(objectmesh *mesh, unsigned int row, unsigned in
         if (array_setelement(mesh->conn, 2, indx, val) == ARRAY_OK) {
             if (el && el->obj.status==OBJECT_ISUNMANAGED) mesh_link(mesh, (object *) el);
         }
+        mesh_changed(mesh);
     }
     return false;
 }
@@ -288,6 +304,22 @@ grade mesh_maxgrade(objectmesh *mesh) {
     return 0;
 }
 
+/** Gets a dense table of vertex ids for every element of a given grade
+ * @param[in] mesh - the mesh
+ * @param[in] g - the grade
+ * @returns a pointer to nel x (g+1) vertex ids stored element by element, or NULL if unavailable
+ * @details The table is the fixed arity storage of the (0, g) connectivity matrix, and so is invalidated together with its CCS. */
+int *mesh_elementvertextable(objectmesh *mesh, grade g) {
+    if (g<=MESH_GRADE_VERTEX) return NULL;
+
+    objectsparse *conn=mesh_getconnectivityelement(mesh, 0, g);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return NULL;
+
+    if (conn->ccs.cptr && !conn->ccs.values) sparseccs_compactpattern(&conn->ccs);
+
+    return (!conn->ccs.cptr && conn->ccs.arity==g+1 ? conn->ccs.rix : NULL);
+}
+
 /** Gets connectivitiy infornation for a given element
  * @param[in] conn - the connectivity matrix for the element
  * @param[in] id - the element id
@@ -634,6 +666,13 @@ bool mesh_addelementwithvertices(objectmesh *mesh, grade g, elementid *v) {
     if (!m) m=mesh_newconnectivityelement(mesh, 0, g);
     if (!m) return false;
 
+    /* Frozen connectivity must be restored to DOK format for editing */
+    if (!sparse_checkformat(m, SPARSE_DOK, false, false) && m->ccs.rix) {
+        if (!sparse_checkformat(m, SPARSE_DOK, true, false)) return false;
+    }
+    sparse_removeformat(m, SPARSE_CCS);
+    mesh_changed(mesh);
+
     int eid=m->dok.ncols; // The new element is one after the last element
 
     bool success=true;
@@ -819,6 +858,234 @@ int mesh_findneighbors(objectmesh *mesh, grade g, elementid id, grade target, va
     return (neighbors->count);
 }
 
+/* **********************************************************************
+ * Bulk geometry
+ * ********************************************************************** */
+
+/** Computes the centroid of every element of a given grade in a single pass
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of elements to use
+ * @param[out] out - a dim x nel matrix to hold the centroids
+ * @returns true on success */
+bool mesh_elementcentroids(objectmesh *mesh, grade g, objectmatrix *out) {
+    int dim=mesh->dim;
+    elementid nel=mesh_nelementsforgrade(mesh, g);
+    if (out->nrows!=dim || out->ncols!=nel) return false;
+
+    if (g==MESH_GRADE_VERTEX) {
+        memcpy(out->elements, mesh->vert->elements, sizeof(double)*dim*nel);
+        return true;
+    }
+
+    objectsparse *conn=mesh_getconnectivityelement(mesh, 0, g);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+
+    int nv, *vid;
+    double *x, *c;
+    for (elementid id=0; id<nel; id++) {
+        if (!sparseccs_getrowindices(&conn->ccs, id, &nv, &vid) || nv==0) continue;
+        c=out->elements+id*dim;
+        for (int j=0; j<nv; j++) {
+            x=mesh->vert->elements+vid[j]*dim;
+            for (int k=0; k<dim; k++) c[k]+=x[k];
+        }
+        for (int k=0; k<dim; k++) c[k]/=nv;
+    }
+
+    return true;
+}
+
+/** Computes the size (length, area or volume) of every element of a given grade
+ * @param[in] v - the vm in use
+ * @param[in] mesh - the mesh
+ * @param[in] g - grade of elements to use
+ * @param[out] out - a 1 x nel matrix to hold the sizes
+ * @returns true on success */
+bool mesh_elementsizes(vm *v, objectmesh *mesh, grade g, objectmatrix *out) {
+    elementid nel=mesh_nelementsforgrade(mesh, g);
+    if (g<MESH_GRADE_LINE || g>MESH_GRADE_VOLUME || out->ncols!=nel) return false;
+
+    return functional_elementsizes(v, mesh, g, out);
+}
+
+/** Computes the (unnormalized) normal of a triangle, whose length is twice the area */
+static void mesh_facecross(objectmesh *mesh, int *vid, double *out) {
+    double *x0=mesh->vert->elements+3*vid[0],
+           *x1=mesh->vert->elements+3*vid[1],
+           *x2=mesh->vert->elements+3*vid[2];
+    double s0[3], s1[3];
+
+    for (int k=0; k<3; k++) { s0[k]=x1[k]-x0[k]; s1[k]=x2[k]-x1[k]; }
+
+    out[0]=s0[1]*s1[2]-s0[2]*s1[1];
+    out[1]=s0[2]*s1[0]-s0[0]*s1[2];
+    out[2]=s0[0]*s1[1]-s0[1]*s1[0];
+}
+
+/** Normalizes a 3-vector in place, leaving degenerate vectors as zero */
+static void mesh_normalize3(double *x) {
+    double norm=sqrt(x[0]*x[0]+x[1]*x[1]+x[2]*x[2]);
+    if (norm>MORPHO_EPS) for (int k=0; k<3; k++) x[k]/=norm;
+    else for (int k=0; k<3; k++) x[k]=0.0;
+}
+
+/** Computes unit normals for every area element of a three dimensional mesh
+ * @param[in] mesh - the mesh
+ * @param[out] out - a 3 x nfaces matrix to hold the normals
+ * @returns true on success */
+bool mesh_facenormals(objectmesh *mesh, objectmatrix *out) {
+    elementid nel=mesh_nelementsforgrade(mesh, MESH_GRADE_AREA);
+    if (mesh->dim!=3 || out->nrows!=3 || out->ncols!=nel) return false;
+
+    objectsparse *conn=mesh_getconnectivityelement(mesh, 0, MESH_GRADE_AREA);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+
+    int nv, *vid;
+    for (elementid id=0; id<nel; id++) {
+        if (!sparseccs_getrowindices(&conn->ccs, id, &nv, &vid) || nv!=3) continue;
+        mesh_facecross(mesh, vid, out->elements+3*id);
+        mesh_normalize3(out->elements+3*id);
+    }
+
+    return true;
+}
+
+/** Computes area-weighted unit normals at every vertex of a three dimensional mesh
+ * @param[in] mesh - the mesh
+ * @param[out] out - a 3 x nv matrix to hold the normals
+ * @returns true on success */
+bool mesh_vertexnormals(objectmesh *mesh, objectmatrix *out) {
+    elementid nvert=mesh_nvertices(mesh);
+    elementid nel=mesh_nelementsforgrade(mesh, MESH_GRADE_AREA);
+    if (mesh->dim!=3 || out->nrows!=3 || out->ncols!=nvert) return false;
+
+    objectsparse *conn=mesh_getconnectivityelement(mesh, 0, MESH_GRADE_AREA);
+    if (!conn || !sparse_checkformat(conn, SPARSE_CCS, true, false)) return false;
+
+    int nv, *vid;
+    double cx[3];
+    for (elementid id=0; id<nel; id++) {
+        if (!sparseccs_getrowindices(&conn->ccs, id, &nv, &vid) || nv!=3) continue;
+        mesh_facecross(mesh, vid, cx);
+        for (int j=0; j<3; j++) {
+            double *n=out->elements+3*vid[j];
+            for (int k=0; k<3; k++) n[k]+=cx[k];
+        }
+    }
+
+    for (elementid i=0; i<nvert; i++) mesh_normalize3(out->elements+3*i);
+
+    return true;
+}
+
+/* **********************************************************************
+ * Geometry cache
+ * ********************************************************************** */
+
+/** Records that the vertices or elements of a mesh have changed, invalidating cached geometry
+ * @details Changes made to the vertex matrix in place are detected through its own version counter */
+void mesh_changed(objectmesh *mesh) {
+    mesh->version++;
+}
+
+/** Frees a mesh's geometry cache */
+static void mesh_freegeometrycache(objectmesh *mesh) {
+    if (!mesh->cache) return;
+    for (int i=0; i<MESH_GEOMETRY_NKINDS; i++) {
+        for (int j=0; j<MESH_GEOMETRY_NGRADES; j++) {
+            if (mesh->cache->entry[i][j].data) MORPHO_FREE(mesh->cache->entry[i][j].data);
+        }
+    }
+    MORPHO_FREE(mesh->cache);
+    mesh->cache=NULL;
+}
+
+/** Determines the shape of a kind of cached geometry
+ * @returns true if the geometry is available for this mesh and grade */
+static bool mesh_geometrydimensions(objectmesh *mesh, meshgeometry kind, grade g, unsigned int *nrows, unsigned int *ncols) {
+    if (g<0 || g>=MESH_GEOMETRY_NGRADES || g>mesh->dim) return false;
+    if (g>MESH_GRADE_VERTEX && !mesh_getconnectivityelement(mesh, 0, g)) return false;
+
+    switch (kind) {
+        case MESH_GEOMETRY_CENTROID:
+            *nrows=mesh->dim;
+            break;
+        case MESH_GEOMETRY_SIZE:
+            if (g==MESH_GRADE_VERTEX) return false;
+            *nrows=1;
+            break;
+        case MESH_GEOMETRY_NORMAL:
+            if (mesh->dim!=3 || !(g==MESH_GRADE_VERTEX || g==MESH_GRADE_AREA)) return false;
+            if (!mesh_getconnectivityelement(mesh, 0, MESH_GRADE_AREA)) return false;
+            *nrows=3;
+            break;
+        default:
+            return false;
+    }
+
+    *ncols=mesh_nelementsforgrade(mesh, g);
+    return true;
+}
+
+/** Gets cached geometry for a mesh without computing it
+ * @param[in] mesh - the mesh
+ * @param[in] kind - kind of geometry
+ * @param[in] g - grade of elements
+ * @returns the cached values, stored column by column, or NULL if they are absent or out of date */
+double *mesh_cachedgeometry(objectmesh *mesh, meshgeometry kind, grade g) {
+    if (!mesh->cache || g<0 || g>=MESH_GEOMETRY_NGRADES) return NULL;
+    meshgeometryentry *e=&mesh->cache->entry[kind][g];
+
+    if (e->valid && e->version==mesh->version && e->vertversion==mesh->vert->version) return e->data;
+    return NULL;
+}
+
+/** Gets geometry for a mesh, computing and caching it if necessary
+ * @param[in] v - the vm in use
+ * @param[in] mesh - the mesh
+ * @param[in] kind - kind of geometry
+ * @param[in] g - grade of elements; for normals, grade 0 gives vertex normals
+ * @returns the values, stored column by column, or NULL if unavailable
+ * @details The pointer remains valid until the mesh is changed or the geometry next recomputed. */
+double *mesh_getgeometry(vm *v, objectmesh *mesh, meshgeometry kind, grade g) {
+    double *data=mesh_cachedgeometry(mesh, kind, g);
+    if (data) return data;
+
+    unsigned int nrows, ncols;
+    if (!mesh_geometrydimensions(mesh, kind, g, &nrows, &ncols)) return NULL;
+    unsigned int size=(nrows*ncols>0 ? nrows*ncols : 1);
+
+    if (!mesh->cache) {
+        mesh->cache=MORPHO_MALLOC(sizeof(meshgeometrycache));
+        if (!mesh->cache) return NULL;
+        memset(mesh->cache, 0, sizeof(meshgeometrycache));
+    }
+
+    meshgeometryentry *e=&mesh->cache->entry[kind][g];
+    e->valid=false;
+    if (e->size<size) {
+        double *new=MORPHO_REALLOC(e->data, sizeof(double)*size);
+        if (!new) return NULL;
+        e->data=new;
+        e->size=size;
+    }
+    memset(e->data, 0, sizeof(double)*size);
+
+    objectmatrix out=MORPHO_STATICMATRIX(e->data, nrows, ncols);
+    switch (kind) {
+        case MESH_GEOMETRY_CENTROID: e->valid=mesh_elementcentroids(mesh, g, &out); break;
+        case MESH_GEOMETRY_SIZE: e->valid=mesh_elementsizes(v, mesh, g, &out); break;
+        case MESH_GEOMETRY_NORMAL:
+            e->valid=(g==MESH_GRADE_AREA ? mesh_facenormals(mesh, &out) : mesh_vertexnormals(mesh, &out));
+            break;
+        default: break;
+    }
+
+    e->version=mesh->version;
+    e->vertversion=mesh->vert->version;
+    return (e->valid ? e->data : NULL);
+}
+
 /* **********************************************************************
  * Mesh loader
  * ********************************************************************** */
@@ -1086,6 +1353,7 @@ value Mesh_setvertexmatrix(vm *v, int nargs, value *args) {
         } else {
             if (m->dim==0) m->dim=mat->nrows;
             m->vert=mat;
+            mesh_changed(m);
         }
     }
 
@@ -1240,6 +1508,75 @@ value Mesh_count(vm *v, int nargs, value *args) {
     return out;
 }
 
+/** Gets the grade argument for a bulk geometry method, checking that elements of that grade exist */
+static bool mesh_gradearg(vm *v, objectmesh *m, int nargs, value *args, grade *g) {
+    if (nargs==1 && MORPHO_ISINTEGER(MORPHO_GETARG(args, 0))) {
+        *g = MORPHO_GETINTEGERVALUE(MORPHO_GETARG(args, 0));
+        if (*g==MESH_GRADE_VERTEX || (*g>0 && *g<=m->dim && mesh_getconnectivityelement(m, 0, *g))) return true;
+        morpho_runtimeerror(v, MESH_GRDNTFND, *g);
+    } else morpho_runtimeerror(v, MESH_GRDARGS);
+    return false;
+}
+
+/** Returns a copy of cached geometry as a new matrix */
+static value mesh_bindgeometry(vm *v, objectmesh *m, meshgeometry kind, grade g, unsigned int nrows, unsigned int ncols) {
+    value out=MORPHO_NIL;
+    double *data=mesh_getgeometry(v, m, kind, g);
+    if (!data) return out;
+
+    objectmatrix *new=object_newmatrix(nrows, ncols, false);
+    if (new) {
+        memcpy(new->elements, data, sizeof(double)*nrows*ncols);
+        out=MORPHO_OBJECT(new);
+        morpho_bindobjects(v, 1, &out);
+    } else morpho_runtimeerror(v, ERROR_ALLOCATIONFAILED);
+    return out;
+}
+
+/** Centroids of all elements of a given grade */
+value Mesh_elementcentroids(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    grade g;
+    if (!mesh_gradearg(v, m, nargs, args, &g)) return MORPHO_NIL;
+
+    return mesh_bindgeometry(v, m, MESH_GEOMETRY_CENTROID, g, m->dim, mesh_nelementsforgrade(m, g));
+}
+
+/** Sizes of all elements of a given grade */
+value Mesh_elementsizes(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    grade g;
+    if (!mesh_gradearg(v, m, nargs, args, &g)) return MORPHO_NIL;
+    if (g==MESH_GRADE_VERTEX) {
+        morpho_runtimeerror(v, MESH_GRDARGS);
+        return MORPHO_NIL;
+    }
+
+    return mesh_bindgeometry(v, m, MESH_GEOMETRY_SIZE, g, 1, mesh_nelementsforgrade(m, g));
+}
+
+/** Unit normals of all area elements */
+value Mesh_facenormals(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    if (m->dim!=3 || !mesh_getconnectivityelement(m, 0, MESH_GRADE_AREA)) {
+        morpho_runtimeerror(v, MESH_NRMLS);
+        return MORPHO_NIL;
+    }
+
+    return mesh_bindgeometry(v, m, MESH_GEOMETRY_NORMAL, MESH_GRADE_AREA, 3, mesh_nelementsforgrade(m, MESH_GRADE_AREA));
+}
+
+/** Area weighted unit normals at each vertex */
+value Mesh_vertexnormals(vm *v, int nargs, value *args) {
+    objectmesh *m=MORPHO_GETMESH(MORPHO_SELF(args));
+    if (m->dim!=3 || !mesh_getconnectivityelement(m, 0, MESH_GRADE_AREA)) {
+        morpho_runtimeerror(v, MESH_NRMLS);
+        return MORPHO_NIL;
+    }
+
+    return mesh_bindgeometry(v, m, MESH_GEOMETRY_NORMAL, MESH_GRADE_VERTEX, 3, mesh_nvertices(m));
+}
+
 /** Clones a mesh */
 value Mesh_clone(vm *v, int nargs, value *args) {
     value out=MORPHO_NIL;
@@ -1259,6 +1596,10 @@ MORPHO_METHOD(MESH_VERTEXMATRIX_METHOD, Mesh_vertexmatrix, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_SETVERTEXMATRIX_METHOD, Mesh_setvertexmatrix, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_VERTEXPOSITION_METHOD, Mesh_vertexposition, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_SETVERTEXPOSITION_METHOD, Mesh_setvertexposition, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_ELEMENTCENTROIDS_METHOD, Mesh_elementcentroids, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_ELEMENTSIZES_METHOD, Mesh_elementsizes, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_FACENORMALS_METHOD, Mesh_facenormals, BUILTIN_FLAGSEMPTY),
+MORPHO_METHOD(MESH_VERTEXNORMALS_METHOD, Mesh_vertexnormals, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_RESETCONNECTIVITY_METHOD, Mesh_resetconnectivity, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_CONNECTIVITYMATRIX_METHOD, Mesh_connectivitymatrix, BUILTIN_FLAGSEMPTY),
 MORPHO_METHOD(MESH_ADDGRADE_METHOD, Mesh_addgrade, BUILTIN_FLAGSEMPTY),
@@ -1299,4 +1640,7 @@ void mesh_initialize(void) {
     morpho_defineerror(MESH_ADDSYMARGS, ERROR_HALT, MESH_ADDSYMARGS_MSG);
     morpho_defineerror(MESH_ADDSYMMSNGTRNSFRM, ERROR_HALT, MESH_ADDSYMMSNGTRNSFRM_MSG);
     morpho_defineerror(MESH_CONSTRUCTORARGS, ERROR_HALT, MESH_CONSTRUCTORARGS_MSG);
+    morpho_defineerror(MESH_GRDARGS, ERROR_HALT, MESH_GRDARGS_MSG);
+    morpho_defineerror(MESH_GRDNTFND, ERROR_HALT, MESH_GRDNTFND_MSG);
+    morpho_defineerror(MESH_NRMLS, ERROR_HALT, MESH_NRMLS_MSG);
 }
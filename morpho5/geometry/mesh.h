@@ -19,12 +19,39 @@
 extern objecttype objectmeshtype;
 #define OBJECT_MESH objectmeshtype
 
+/** Kinds of derived geometry that a mesh can cache */
+typedef enum {
+    MESH_GEOMETRY_CENTROID, // Element centroids, dim x nel
+    MESH_GEOMETRY_SIZE, // Element lengths, areas or volumes, 1 x nel
+    MESH_GEOMETRY_NORMAL, // Unit normals of area elements (grade 2) or vertices (grade 0), 3 x n
+    MESH_GEOMETRY_NKINDS
+} meshgeometry;
+
+/** Number of grades for which geometry is cached */
+#define MESH_GEOMETRY_NGRADES 4
+
+/** A cached block of derived geometry */
+typedef struct {
+    double *data; // Cached values, or NULL
+    unsigned int size; // Number of doubles allocated
+    unsigned int version; // Mesh version for which data is valid
+    unsigned int vertversion; // Vertex matrix version for which data is valid
+    bool valid; // Whether data has been computed
+} meshgeometryentry;
+
+/** Cache of derived geometry, validated against version stamps */
+typedef struct {
+    meshgeometryentry entry[MESH_GEOMETRY_NKINDS][MESH_GEOMETRY_NGRADES];
+} meshgeometrycache;
+
 typedef struct {
     object obj;
     unsigned int dim;
     objectmatrix *vert;
     objectarray *conn;
     object *link;
+    unsigned int version; // Incremented when the vertex matrix is replaced or elements change
+    meshgeometrycache *cache; // Cached geometry, if any
 } objectmesh;
 
 /** Tests whether an object is a mesh */
@@ -53,6 +80,11 @@ objectmesh *object_newmesh(unsigned int dim, unsigned int nv, double *v);
 #define MESH_VERTEXPOSITION_METHOD         "vertexposition"
 #define MESH_SETVERTEXPOSITION_METHOD      "setvertexposition"
 
+#define MESH_ELEMENTCENTROIDS_METHOD       "elementcentroids"
+#define MESH_ELEMENTSIZES_METHOD           "elementsizes"
+#define MESH_FACENORMALS_METHOD            "facenormals"
+#define MESH_VERTEXNORMALS_METHOD          "vertexnormals"
+
 #define MESH_RESETCONNECTIVITY_METHOD      "resetconnectivity"
 #define MESH_CONNECTIVITYMATRIX_METHOD     "connectivitymatrix"
 #define MESH_ADDGRADE_METHOD               "addgrade"
@@ -125,6 +157,15 @@ DECLARE_VARRAY(elementid, elementid);
 #define MESH_CONSTRUCTORARGS                  "MshArgs"
 #define MESH_CONSTRUCTORARGS_MSG              "Mesh expects either a single file name or no argurments"
 
+#define MESH_GRDARGS                         "MshGrdArgs"
+#define MESH_GRDARGS_MSG                     "Method expects an integer grade as the argument."
+
+#define MESH_GRDNTFND                        "MshGrdNtFnd"
+#define MESH_GRDNTFND_MSG                    "Mesh does not provide elements of grade %d."
+
+#define MESH_NRMLS                           "MshNrmls"
+#define MESH_NRMLS_MSG                       "Normals require a three dimensional mesh with area elements."
+
 /* Tolerances */
 
 /** This controls how close two points can be before they're indistinct */
@@ -144,6 +185,7 @@ objectsparse *mesh_addconnectivityelement(objectmesh *mesh, unsigned int row, un
 objectsparse *mesh_getconnectivityelement(objectmesh *mesh, unsigned int row, unsigned int col);
 
 bool mesh_getconnectivity(objectsparse *conn, elementid id, int *nentries, int **entries);
+int *mesh_elementvertextable(objectmesh *mesh, grade g);
 void mesh_freezeconnectivity(objectmesh *mesh);
 
 bool mesh_getvertexcoordinates(objectmesh *mesh, elementid id, double *val);
@@ -153,6 +195,15 @@ bool mesh_getvertexcoordinatesasvalues(objectmesh *mesh, elementid id, value *va
 bool mesh_getsynonyms(objectmesh *mesh, grade g, elementid id, varray_elementid *synonymids);
 int mesh_findneighbors(objectmesh *mesh, grade g, elementid id, grade target, varray_elementid *neighbors);
 
+bool mesh_elementcentroids(objectmesh *mesh, grade g, objectmatrix *out);
+bool mesh_elementsizes(vm *v, objectmesh *mesh, grade g, objectmatrix *out);
+bool mesh_facenormals(objectmesh *mesh, objectmatrix *out);
+bool mesh_vertexnormals(objectmesh *mesh, objectmatrix *out);
+
+void mesh_changed(objectmesh *mesh);
+double *mesh_cachedgeometry(objectmesh *mesh, meshgeometry kind, grade g);
+double *mesh_getgeometry(vm *v, objectmesh *mesh, meshgeometry kind, grade g);
+
 void mesh_initialize(void);
 
 #endif /* mesh_h */
@@ -47,6 +47,9 @@ void cli_reporterror(error *err, vm *v) {
 
 const char *cli_file;
 
+/** Pause target for incremental garbage collection in VMs created by the cli */
+size_t cli_gcpausetarget = MORPHO_GCPAUSETARGET;
+
 /** Define colors for different token types */
 linedit_color cli_tokencolors[] = {
     LINEDIT_DEFAULTCOLOR,                          // TOKEN_NONE
@@ -220,6 +223,8 @@ void cli(clioptions opt) {
     /* Set up program and compiler */
     program *p = morpho_newprogram();
     compiler *c = morpho_newcompiler(p);
+    if (opt & CLI_NOOPTIMIZE) morpho_setoptimize(c, false);
+    if (opt & CLI_NOCACHE) morpho_setcache(c, false);
     
     bool help = help_initialize();
     
@@ -230,6 +235,7 @@ void cli(clioptions opt) {
     
     /* Always enable debugging in interactive mode */
     morpho_setdebug(v, true);
+    morpho_setgcpausetarget(v, cli_gcpausetarget);
     
     linedit_init(&edit);
     linedit_setprompt(&edit, CLI_PROMPT);
@@ -296,7 +302,11 @@ void cli_run(const char *in, clioptions opt) {
     compiler *c = morpho_newcompiler(p);
     vm *v = morpho_newvm();
     
+    /* Optimization is turned off when debugging so that registers keep the values the debugger expects */
     if (opt & CLI_DEBUG) morpho_setdebug(v, true);
+    if (opt & (CLI_DEBUG | CLI_NOOPTIMIZE)) morpho_setoptimize(c, false);
+    if (opt & CLI_NOCACHE) morpho_setcache(c, false);
+    morpho_setgcpausetarget(v, cli_gcpausetarget);
     
     char *src = cli_loadsource(in);
     
@@ -36,9 +36,13 @@
 #define CLI_DISASSEMBLE         0x2
 #define CLI_DISASSEMBLESHOWSRC  0x4
 #define CLI_DEBUG               0x8
+#define CLI_NOOPTIMIZE          0x10
+#define CLI_NOCACHE             0x20
 
 typedef unsigned int clioptions;
 
+extern size_t cli_gcpausetarget;
+
 void cli_run(const char *in, clioptions opt);
 void cli(clioptions opt);
 
@@ -7,11 +7,13 @@
 #include <string.h>
 #include <ctype.h>
 #include <dirent.h>
+#include <sys/stat.h>
 #include "help.h"
 #include "dictionary.h"
 #include "parse.h"
 #include "common.h"
 #include "veneer.h"
+#include "file.h"
 
 /** The interactive help system uses a collection of Markdown files, located in
  *  MORPHO_HELPDIRECTORY, that define available topics. Help files are all
@@ -26,11 +28,15 @@
  *  [tag]: # (<TAG>)      is used to define additional synonyms for the topic.
  *
  *  The help system also recognizes code blocks etc.
+ *
+ *  Help files are only parsed when help is first requested, and the topics they
+ *  define are cached in an index so that later sessions needn't parse them at all.
  */
 
 static dictionary helpdict;
 static char *helpdir = MORPHO_HELPDIRECTORY;
 static objecthelptopic *topics = NULL;
+static bool helploaded = false;
 
 /* **********************************************************************
  * Help topics
@@ -84,6 +90,8 @@ void help_cleartopic (objecthelptopic *topic) {
  * Search
  * ********************************************************************** */
 
+static void help_loadtopics(void);
+
 #define HELP_LINELENGTH 2048
 
 /** Determine starting point and length of a query
@@ -133,6 +141,8 @@ objecthelptopic *help_query(dictionary *dict, char *query, bool recurse) {
 
 /** Searches for a given query in the help system */
 objecthelptopic *help_search(char *query) {
+    help_loadtopics();
+    
     objecthelptopic *topic = NULL;
     dictionary *dict = &helpdict;
     char *p;
@@ -391,15 +401,59 @@ int help_parsetopiclevel(char *line) {
     return (level>=HELP_MAXLEVEL ? HELP_MAXLEVEL-1 : level-1);
 }
 
+/** Tracks the topics being defined from a help file */
+typedef struct {
+    char *file; /** The help file */
+    objecthelptopic *topic[HELP_MAXLEVEL]; /** Most recent topic at each level */
+    int level; /** Level of the current topic */
+    bool toplevel; /** Whether tags are inserted into the top level dictionary */
+} helpfile;
+
+/** Initializes a helpfile structure */
+static void help_initfile(helpfile *h, char *file) {
+    h->file=file;
+    for (unsigned int i=0; i<HELP_MAXLEVEL; i++) h->topic[i]=NULL;
+    h->level=0;
+    h->toplevel=false;
+}
+
+/** Defines a topic from a header */
+static void help_definetopic(helpfile *h, value key, int level, long int location) {
+    h->level=level;
+    h->topic[level]=help_newtopic(MORPHO_GETCSTRING(key), h->file, location,
+                                  (level>0 ? h->topic[level-1] : NULL) );
+    if (h->topic[level]) {
+        /* Insert the topic... */
+        dictionary *dict = &helpdict; /* ... either into the global dictionary */
+        if (level>0) dict=&h->topic[level-1]->subtopics; /* or into the parent's dictionary */
+        
+        dictionary_insert(dict, key, MORPHO_OBJECT(h->topic[level]));
+#ifdef MORPHO_DEBUG_LOGHELPFILES
+        printf("Parsed topic '%s' level %i\n", MORPHO_GETCSTRING(key), level);
+#endif
+    }
+}
+
+/** Defines an additional search term for the current topic */
+static void help_definetag(helpfile *h, value key) {
+    /* Insert the topic... */
+    dictionary *dict = &helpdict; /* ... either into the global dictionary */
+    if (!h->toplevel && h->level>0) dict=&h->topic[h->level-1]->subtopics; /* or into the parent's dictionary */
+    dictionary_insert(dict, key, MORPHO_OBJECT(h->topic[h->level]));
+#ifdef MORPHO_DEBUG_LOGHELPFILES
+    printf("Parsed tag '%s' level %i\n", MORPHO_GETCSTRING(key), h->level);
+#endif
+}
+
 /** Loads a help file
  *  @param file     file to load
+ *  @param index    (optional) appended with index entries for the topics found
  *  @returns true if any help entries were successfully loaded */
-bool help_load(char *file) {
+bool help_load(char *file, varray_char *index) {
     char line[HELP_LINELENGTH];
-    objecthelptopic *topic[HELP_MAXLEVEL];
-    for (unsigned int i=0; i<HELP_MAXLEVEL; i++) topic[i]=NULL;
-    int level = 0;
-    bool toplevel = false;
+    char entry[HELP_LINELENGTH+64];
+    helpfile h;
+    help_initfile(&h, file);
     
 #ifdef MORPHO_DEBUG_LOGHELPFILES
     printf("Loading help file '%s'\n",file);
@@ -407,6 +461,14 @@ bool help_load(char *file) {
     FILE *f = fopen(file, "r");
     
     if (f) {
+        if (index) {
+            struct stat st;
+            if (stat(file, &st)==0) {
+                snprintf(entry, sizeof(entry), "F %lld %lld %s\n", (long long) st.st_size, (long long) st.st_mtime, file);
+                varray_charadd(index, entry, (int) strlen(entry));
+            }
+        }
+        
         while (!feof(f)) {
             long int cloc = ftell(f); /* Store the current position */
             
@@ -414,37 +476,25 @@ bool help_load(char *file) {
                 if (line[0]=='#') {
                     /* Headers define available topics */
                     value key = help_parsetopicname(line);
-                    level = help_parsetopiclevel(line);
+                    int level = help_parsetopiclevel(line);
                     if (MORPHO_ISOBJECT(key)) {
-                        topic[level]=help_newtopic(MORPHO_GETCSTRING(key), file, cloc,
-                                                   (level>0 ? topic[level-1] : NULL) );
-                        if (topic[level]) {
-                            /* Insert the topic... */
-                            dictionary *dict = &helpdict; /* ... either into the global dictionary */
-                            if (level>0) dict=&topic[level-1]->subtopics; /* or into the parent's dictionary */
-                            
-                            dictionary_insert(dict, key, MORPHO_OBJECT(topic[level]));
-#ifdef MORPHO_DEBUG_LOGHELPFILES
-                            printf("Parsed topic '%s' level %i\n", MORPHO_GETCSTRING(key), level);
-#endif
-                        }
+                        help_definetopic(&h, key, level, cloc);
+                        if (index) snprintf(entry, sizeof(entry), "H %i %ld %s\n", level, cloc, MORPHO_GETCSTRING(key));
                     }
                 } else if (strncmp(line, "[tag", 4)==0) {
                     /* Unused links that start with 'tag' define additional search terms */
                     value key = help_parsetag(line);
                     if (MORPHO_ISOBJECT(key)) {
-                        /* Insert the topic... */
-                        dictionary *dict = &helpdict; /* ... either into the global dictionary */
-                        if (!toplevel && level>0) dict=&topic[level-1]->subtopics; /* or into the parent's dictionary */
-                        dictionary_insert(dict, key, MORPHO_OBJECT(topic[level]));
-#ifdef MORPHO_DEBUG_LOGHELPFILES
-                        printf("Parsed tag '%s' level %i\n", MORPHO_GETCSTRING(key), level);
-#endif
+                        help_definetag(&h, key);
+                        if (index) snprintf(entry, sizeof(entry), "T %s\n", MORPHO_GETCSTRING(key));
                     }
                 } else if (strncmp(line, "[toplevel]", 10)==0) {
                     /* Toggles insertion into top level dictionary */
-                    toplevel = !toplevel;
-                }
+                    h.toplevel = !h.toplevel;
+                    if (index) snprintf(entry, sizeof(entry), "L\n");
+                } else continue;
+                
+                if (index) varray_charadd(index, entry, (int) strlen(entry));
             }
         }
         fclose(f);
@@ -453,52 +503,221 @@ bool help_load(char *file) {
     return false;
 }
 
+/** Constructs the path of a file in the help directory
+ *  @param path     directory
+ *  @param name     name of the file
+ *  @param[out] file    filled out with the zero terminated path */
+static void help_filepath(char *path, char *name, varray_char *file) {
+    file->count=0;
+    varray_charadd(file, path, (int) strlen(path));
+    varray_charadd(file, MORPHO_SEPARATOR, (int) strlen(MORPHO_SEPARATOR));
+    varray_charadd(file, name, (int) strlen(name)+1);
+}
+
 /** Searches for help files
- *  @param path     directory to search (recursively)
- *  @returns true if any help files were successfully processed. */
-bool help_searchpath(char *path) {
+ *  @param path     directory to search
+ *  @param index    (optional) appended with index entries for each file, or NULL to count files only
+ *  @param load     whether to load the files found
+ *  @returns the number of files found */
+static int help_searchpath(char *path, varray_char *index, bool load) {
     DIR *d; /* Handle for the directory */
     struct dirent *entry; /* Entries in the directory */
-    bool success=false; /* Did we load any entries? */
+    int nfiles=0; /* How many files did we find? */
     
 #ifdef MORPHO_DEBUG_LOGHELPFILES
-    printf("Searching help directory '%s'\n", helpdir);
+    printf("Searching help directory '%s'\n", path);
 #endif
     
-    d = opendir(helpdir);
+    d = opendir(path);
     
     if (d) {
+        varray_char file;
+        varray_charinit(&file);
+        
         while ((entry = readdir(d)) != NULL) {
-            /* Contruct the file name */
-            char file[strlen(path)+strlen(entry->d_name)+2];
-            strcpy(file, path);
-            strcat(file, "/");
-            strcat(file, entry->d_name);
+            help_filepath(path, entry->d_name, &file);
             
             /* If it's not a directory, try to open it */
-            if (!morpho_isdirectory(file)) {
-                bool res=help_load(file);
-                if (res) success=true;
+            if (!morpho_isdirectory(file.data)) {
+                if (load) help_load(file.data, index);
+                nfiles++;
             }
         }
+        
+        varray_charclear(&file);
         closedir(d);
     }
     
+    return nfiles;
+}
+
+/* **********************************************************************
+ * Help index
+ * ********************************************************************** */
+
+/** The help index, stored in the cache directory, records the topics and tags in each help file
+ *  so that the help files needn't be parsed to start the help system. It is a text file with
+ *  one entry per line:
+ *
+ *  F <size> <mtime> <file>      begins the entries for a help file
+ *  H <level> <offset> <topic>    defines a topic at a given offset in the file
+ *  T <tag>                       defines a tag for the current topic
+ *  L                             toggles insertion of tags into the top level dictionary
+ *
+ *  The index begins with HELP_INDEXHEADER and the help directory, and ends with HELP_INDEXEND.
+ *  It is rebuilt whenever any help file is added, removed or modified. */
+
+/** Checks that an index entry describes a help file that is unchanged */
+static bool help_checkfile(char *line, int *nfiles) {
+    long long size, mtime;
+    int n=0;
+    struct stat st;
+    
+    if (sscanf(line, "F %lld %lld %n", &size, &mtime, &n)!=2 || n==0) return false;
+    if (stat(line+n, &st)!=0) return false;
+    
+    (*nfiles)++;
+    return ((long long) st.st_size==size && (long long) st.st_mtime==mtime);
+}
+
+/** Loads the help index
+ *  @param index    contents of the index, which are modified in the process
+ *  @returns true if the index was valid and loaded */
+static bool help_loadindex(varray_char *index) {
+    char *start = index->data, *end = index->data+index->count, *eol;
+    bool success=false;
+    int nfiles=0, defined=0;
+    long long size, mtime;
+    helpfile h;
+    
+    varray_ptrdiff lines;
+    varray_ptrdiffinit(&lines);
+    
+    /* Split into lines */
+    for (char *c=start; c<end; c=eol+1) {
+        eol=memchr(c, '\n', end-c);
+        if (!eol) goto help_loadindex_cleanup;
+        *eol='\0';
+        varray_ptrdiffwrite(&lines, c-start);
+    }
+    
+#define HELP_INDEXLINE(i) (start+lines.data[i])
+    if (lines.count<3 ||
+        strcmp(HELP_INDEXLINE(0), HELP_INDEXHEADER)!=0 ||
+        strcmp(HELP_INDEXLINE(1), helpdir)!=0 ||
+        strcmp(HELP_INDEXLINE(lines.count-1), HELP_INDEXEND)!=0) goto help_loadindex_cleanup;
+    
+    /* Check the index is complete and up to date before defining any topics */
+    for (unsigned int i=2; i<lines.count-1; i++) {
+        char *line = HELP_INDEXLINE(i);
+        int level, n=0;
+        long int location;
+        
+        switch (line[0]) {
+            case 'F':
+                if (!help_checkfile(line, &nfiles)) goto help_loadindex_cleanup;
+                defined=0;
+                break;
+            case 'H':
+                if (sscanf(line, "H %i %ld %n", &level, &location, &n)!=2 || n==0 ||
+                    level<0 || level>=HELP_MAXLEVEL) goto help_loadindex_cleanup;
+                /* Subtopics must follow a parent topic */
+                if (level>0 && !(defined & (1<<(level-1)))) goto help_loadindex_cleanup;
+                defined |= 1<<level;
+                break;
+            case 'T': if (line[1]!=' ') goto help_loadindex_cleanup; break;
+            case 'L': break;
+            default: goto help_loadindex_cleanup;
+        }
+    }
+    if (nfiles!=help_searchpath(helpdir, NULL, false)) goto help_loadindex_cleanup;
+    
+    /* Now define the topics */
+    help_initfile(&h, NULL);
+    for (unsigned int i=2; i<lines.count-1; i++) {
+        char *line = HELP_INDEXLINE(i);
+        int level, n=0;
+        long int location;
+        
+        switch (line[0]) {
+            case 'F':
+                sscanf(line, "F %lld %lld %n", &size, &mtime, &n);
+                help_initfile(&h, line+n);
+                break;
+            case 'H':
+                sscanf(line, "H %i %ld %n", &level, &location, &n);
+                help_definetopic(&h, object_stringfromcstring(line+n, strlen(line+n)), level, location);
+                break;
+            case 'T':
+                help_definetag(&h, object_stringfromcstring(line+2, strlen(line+2)));
+                break;
+            case 'L':
+                h.toplevel = !h.toplevel;
+                break;
+        }
+    }
+#undef HELP_INDEXLINE
+    success=true;
+    
+help_loadindex_cleanup:
+    varray_ptrdiffclear(&lines);
+    
     return success;
 }
 
+/** Loads the help topics, from the help index if it is up to date or otherwise from the help files, rebuilding the index */
+static void help_loadtopics(void) {
+    if (helploaded) return;
+    helploaded=true;
+    
+    varray_char path;
+    varray_charinit(&path);
+    varray_char index;
+    varray_charinit(&index);
+    
+    if (morpho_cachepath(HELP_INDEXFILE, false, &path)) {
+        FILE *f = fopen(path.data, "r");
+        if (f) {
+            bool success=file_readintovarray(f, &index);
+            fclose(f);
+            
+            if (success && index.count>0) {
+                index.count--; /* Remove the terminating zero */
+                if (help_loadindex(&index)) goto help_loadtopics_cleanup;
+            }
+        }
+    }
+    
+    /* Otherwise parse the help files and build a new index */
+    index.count=0;
+    varray_charadd(&index, HELP_INDEXHEADER "\n", (int) strlen(HELP_INDEXHEADER "\n"));
+    varray_charadd(&index, helpdir, (int) strlen(helpdir));
+    varray_charwrite(&index, '\n');
+    
+    help_searchpath(helpdir, &index, true);
+    
+    varray_charadd(&index, HELP_INDEXEND "\n", (int) strlen(HELP_INDEXEND "\n"));
+    
+    path.count=0;
+    if (morpho_cachepath(HELP_INDEXFILE, true, &path)) morpho_replacefile(path.data, index.data, index.count);
+    
+help_loadtopics_cleanup:
+    varray_charclear(&index);
+    varray_charclear(&path);
+}
+
 /* **********************************************************************
  * Public interface
  * ********************************************************************** */
 
-/** Initializes the help system
+/** Initializes the help system; topics are loaded on first use
  *  @returns true if help is available */
 bool help_initialize(void) {
     objecthelptopictype=object_addtype(&objecthelptopicdefn);
     
     dictionary_init(&helpdict);
     
-    return help_searchpath(MORPHO_HELPDIRECTORY);
+    return morpho_isdirectory(helpdir);
 }
 
 /** Finalizes the help system */
@@ -27,6 +27,13 @@ typedef struct sobjecthelptopic {
 } objecthelptopic;
 
 #define HELP_INDEXPAGE "help"
+
+/** @brief Name of the help index in the cache directory */
+#define HELP_INDEXFILE "help.idx"
+
+/** @brief First and last lines of the help index; increment the version whenever its format changes */
+#define HELP_INDEXHEADER "morpho help index 1"
+#define HELP_INDEXEND "E"
 #define HELP_TOPICS "Topics:\n"
 #define HELP_SUBTOPICS "Subtopics:\n"
 
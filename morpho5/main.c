@@ -38,6 +38,15 @@ int main(int argc, const char * argv[]) {
                         }
                     }
                     break;
+                case 'O': /* Optimization level; -O0 turns the optimizer off */
+                    if (option[2]=='0') opt |= CLI_NOOPTIMIZE;
+                    break;
+                case 'n': /* -nocache compiles imported modules from source without using the bytecode cache */
+                    if (strncmp(option+1, "nocache", strlen("nocache"))==0) opt |= CLI_NOCACHE;
+                    break;
+                case 'g': /* Pause target for incremental garbage collection in kilobytes; -g0 collects without interruption */
+                    cli_gcpausetarget = ((size_t) strtoul(option+2, NULL, 10))*1024;
+                    break;
             }
         } else {
             file = option;
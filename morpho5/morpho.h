@@ -125,10 +125,15 @@ void morpho_usererror(vm *v, errorid id, char *message);
 /* Activate/deactivate the debugger */
 void morpho_setdebug(vm *v, bool active);
 
+/* Garbage collection */
+void morpho_setgcpausetarget(vm *v, size_t target);
+
 /* Compilation */
 compiler *morpho_newcompiler(program *out);
 void morpho_freecompiler(compiler *c);
 bool morpho_compile(char *in, compiler *c, error *err);
+void morpho_setoptimize(compiler *c, bool optimize);
+void morpho_setcache(compiler *c, bool cache);
 const char *morpho_compilerrestartpoint(compiler *c);
 void morpho_resetentry(program *p);
 
@@ -5,13 +5,14 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <ctype.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include "common.h"
 #include "object.h"
-#include "sparse.h"
 #include "cmplx.h"
 
 /* **********************************************************************
@@ -73,12 +74,6 @@ int morpho_comparevalue (value a, value b) {
                         size_t len = (astring->length > bstring->length ? astring->length : bstring->length);
                         
                         return -strncmp(astring->string, bstring->string, len);
-                    } else if (MORPHO_ISDOKKEY(a) && MORPHO_ISDOKKEY(b)) {
-                        objectdokkey *akey = MORPHO_GETDOKKEY(a);
-                        objectdokkey *bkey = MORPHO_GETDOKKEY(b);
-                        
-                        return ((MORPHO_GETDOKKEYCOL(akey)==MORPHO_GETDOKKEYCOL(bkey) &&
-                                 MORPHO_GETDOKKEYROW(akey)==MORPHO_GETDOKKEYROW(bkey)) ? EQUAL : NOTEQUAL);
                     } else if (MORPHO_ISCOMPLEX(a) && MORPHO_ISCOMPLEX(b)) {
                         objectcomplex *acomp = MORPHO_GETCOMPLEX(a);
                         objectcomplex *bcomp = MORPHO_GETCOMPLEX(b);
@@ -246,6 +241,70 @@ bool morpho_isdirectory(const char *path) {
    return (bool) S_ISDIR(statbuf.st_mode);
 }
 
+/** Finds the path of a file in the cache directory, which is MORPHO_CACHEDIRECTORY within the user's home directory
+ * @param[in] fname     name of the file
+ * @param[in] create    whether to create the cache directory if it doesn't exist
+ * @param[out] path     appended with the path of the file, zero terminated
+ * @returns true if a path was found */
+bool morpho_cachepath(const char *fname, bool create, varray_char *path) {
+    char *home = getenv("HOME");
+    if (!home || home[0]=='\0') return false;
+    
+    varray_charadd(path, home, (int) strlen(home));
+    varray_charadd(path, MORPHO_SEPARATOR, (int) strlen(MORPHO_SEPARATOR));
+    unsigned int base=path->count;
+    varray_charadd(path, MORPHO_CACHEDIRECTORY, (int) strlen(MORPHO_CACHEDIRECTORY));
+    varray_charwrite(path, '\0');
+    
+    /* Create each directory along the way */
+    if (create) {
+        for (unsigned int i=base; i<path->count; i++) {
+            char ch=path->data[i];
+            if (ch=='/' || ch=='\0') {
+                path->data[i]='\0';
+                mkdir(path->data, 0755);
+                path->data[i]=ch;
+            }
+        }
+    }
+    path->count--;
+    
+    varray_charadd(path, MORPHO_SEPARATOR, (int) strlen(MORPHO_SEPARATOR));
+    varray_charadd(path, (char *) fname, (int) strlen(fname));
+    varray_charwrite(path, '\0');
+    
+    return true;
+}
+
+/** Writes a file by way of a temporary file that is then renamed, so that other processes never see it incomplete
+ * @param[in] path      path of the file
+ * @param[in] data      contents of the file
+ * @param[in] size      size of the contents
+ * @returns true on success */
+bool morpho_replacefile(const char *path, char *data, size_t size) {
+    bool success=false;
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%ld.tmp", (long) getpid());
+    
+    varray_char tmp;
+    varray_charinit(&tmp);
+    varray_charadd(&tmp, (char *) path, (int) strlen(path));
+    varray_charadd(&tmp, suffix, (int) strlen(suffix)+1);
+    
+    FILE *f = fopen(tmp.data, "wb");
+    if (f) {
+        success=(fwrite(data, sizeof(char), size, f)==size);
+        if (fclose(f)!=0) success=false;
+        
+        if (success && rename(tmp.data, path)!=0) success=false;
+        if (!success) remove(tmp.data);
+    }
+    
+    varray_charclear(&tmp);
+    
+    return success;
+}
+
 /** Determine weather the rest of a string is white space */
 bool white_space_remainder(const char *s, int start){
 	s += start;
@@ -108,6 +108,8 @@ int morpho_utf8numberofbytes(uint8_t *string);
 unsigned int morpho_powerof2ceiling(unsigned int n);
 
 bool morpho_isdirectory(const char *path);
+bool morpho_cachepath(const char *fname, bool create, varray_char *path);
+bool morpho_replacefile(const char *path, char *data, size_t size);
 bool white_space_remainder(const char *s, int start);
 
 #ifdef MORPHO_DEBUG
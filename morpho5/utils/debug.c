@@ -126,11 +126,22 @@ assemblyrule assemblyrules[] ={
     
     { OP_B, "b", "+" },
     { OP_BIF, "bif", "F rA +" },
+    { OP_LTBIF, "ltbif", "?B, ?C A" }, // a forward branch
+    { OP_LEBIF, "lebif", "?B, ?C A" },
+    { OP_INCB, "incb", "rA, ?C N" }, // b backward branch
+    
+    { OP_ADDII, "addii", "rA, ?B, ?C" },
+    { OP_ADDFF, "addff", "rA, ?B, ?C" },
+    { OP_SUBII, "subii", "rA, ?B, ?C" },
+    { OP_SUBFF, "subff", "rA, ?B, ?C" },
+    { OP_MULII, "mulii", "rA, ?B, ?C" },
+    { OP_MULFF, "mulff", "rA, ?B, ?C" },
+    { OP_DIVFF, "divff", "rA, ?B, ?C" },
     
     { OP_CALL, "call", "rA, B" }, // b literal
     { OP_INVOKE, "invoke", "rA, ?B, C" }, // c literal
     
-    { OP_RETURN, "return", "rB" }, // c literal
+    { OP_RETURN, "return", "?B" }, // b only if a>0
 
     { OP_CLOSURE, "closure", "rA, pB" }, // b prototype
     
@@ -193,8 +204,11 @@ void debug_disassembleinstruction(instruction instruction, instructionindx indx,
     
     assemblyrule *show=debug_getassemblyrule(op);
     if (show) {
+        char *display=show->display;
+        if (op==OP_RETURN && DECODE_A(instruction)==0) display=""; /* No value is returned */
+        
         n+=printf("%s ", show->label);
-        for (char *c=show->display; *c!='\0'; c++) {
+        for (char *c=display; *c!='\0'; c++) {
             switch (*c) {
                 case 'A': n+=printf("%u", DECODE_A(instruction)); break;
                 case 'B': {
@@ -208,6 +222,7 @@ void debug_disassembleinstruction(instruction instruction, instructionindx indx,
                 }
                     break;
                 case '+': n+=printf("%i", DECODE_sBx(instruction)); break;
+                case 'N': n+=printf("%i", -(int) DECODE_B(instruction)); break;
                 case 'C': {
                     cm=mode; nc=DECODE_C(instruction);
                     n+=printf("%u", DECODE_C(instruction));
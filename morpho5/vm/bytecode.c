@@ -0,0 +1,1305 @@
+/** @file bytecode.c
+ *  @author T J Atherton
+ *
+ *  @brief Caches the compiled bytecode of imported modules
+ *  @details When a module is compiled, the instructions, constants, functions, classes and debugging annotations that it adds to the program are written to a cache file together with a record of everything the compiler found outside the module: globals, classes and other modules. The next time the module is imported, the cache file is used in place of the source provided the source is unchanged and every one of these lookups would give the same result, so that the code loaded is equivalent to what the compiler would produce. Constant and global indices are relocated to wherever the module is loaded. If anything is amiss the module is compiled from source as usual.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "bytecode.h"
+#include "morpho.h"
+#include "vm.h"
+#include "builtin.h"
+#include "cmplx.h"
+#include "file.h"
+#include "debug.h"
+
+/* **********************************************************************
+ * Hashing
+ * ********************************************************************** */
+
+#define BYTECODE_FNVOFFSET 0xcbf29ce484222325ULL
+#define BYTECODE_FNVPRIME  0x100000001b3ULL
+
+/** 64 bit FNV-1a hash of a block of data */
+static uint64_t bytecode_fnv(const char *data, size_t length) {
+    uint64_t hash=BYTECODE_FNVOFFSET;
+    
+    for (size_t i=0; i<length; i++) {
+        hash^=(unsigned char) data[i];
+        hash*=BYTECODE_FNVPRIME;
+    }
+    
+    return hash;
+}
+
+/** Hashes the source of a module
+ * @param[in] src   the source
+ * @returns the hash as a string object, which the caller must free */
+value bytecode_hash(char *src) {
+    char str[17];
+    snprintf(str, sizeof(str), "%016llx", (unsigned long long) bytecode_fnv(src, strlen(src)));
+    return object_stringfromcstring(str, strlen(str));
+}
+
+/* **********************************************************************
+ * Cache files
+ * ********************************************************************** */
+
+/** Finds the cache file for a module, which is named after the module and a hash of its full path
+ * @param[in] fname     file name of the module
+ * @param[out] path     filled out with the path of the cache file
+ * @param[in] create    whether to create the cache directory if it doesn't exist
+ * @returns true if a path was found */
+static bool bytecode_cachepath(char *fname, varray_char *path, bool create) {
+    /* Find the module's path */
+    varray_char name;
+    varray_charinit(&name);
+    file_relativepath(fname, &name);
+    char *full = name.data;
+    
+    /* Name the cache file after the module */
+    char *start = strrchr(full, '/');
+    start = (start ? start+1 : full);
+    size_t length = strlen(start), extlength = strlen(MORPHO_EXTENSION);
+    if (length>extlength && strcmp(start+length-extlength, MORPHO_EXTENSION)==0) length-=extlength;
+    
+    char hash[20];
+    snprintf(hash, sizeof(hash), "-%016llx", (unsigned long long) bytecode_fnv(full, strlen(full)));
+    
+    varray_char file;
+    varray_charinit(&file);
+    varray_charadd(&file, start, (int) length);
+    varray_charadd(&file, hash, (int) strlen(hash));
+    varray_charadd(&file, MORPHO_CACHEEXTENSION, (int) strlen(MORPHO_CACHEEXTENSION));
+    varray_charwrite(&file, '\0');
+    
+    bool success=morpho_cachepath(file.data, create, path);
+    
+    varray_charclear(&file);
+    varray_charclear(&name);
+    
+    return success;
+}
+
+/** Reads a cache file into a buffer */
+static bool bytecode_readfile(char *path, varray_char *data) {
+    bool success=false;
+    size_t size;
+    
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    
+    if (file_getsize(f, &size) && size<INT_MAX &&
+        varray_charresize(data, (int) size+1)) {
+        data->count=(int) fread(data->data, sizeof(char), size, f);
+        success=(data->count==size);
+    }
+    
+    fclose(f);
+    
+    return success;
+}
+
+/* **********************************************************************
+ * Instructions
+ * ********************************************************************** */
+
+/** Identifies which operands of an instruction refer to the constant table
+ * @param[in] instr     the instruction
+ * @param[out] b        set if B refers to a constant
+ * @param[out] c        set if C refers to a constant
+ * @param[out] bx       set if Bx refers to a constant
+ * @returns false if the instruction can't be cached */
+static bool bytecode_constantoperands(instruction instr, bool *b, bool *c, bool *bx) {
+    *b=false; *c=false; *bx=false;
+    
+    switch (DECODE_OP(instr)) {
+        case OP_LCT: case OP_PUSHERR:
+            *bx=true;
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_EQ: case OP_NEQ: case OP_LT: case OP_LE:
+        case OP_LPR: case OP_SPR:
+            *b=DECODE_ISBCONSTANT(instr);
+            *c=DECODE_ISCCONSTANT(instr);
+            break;
+        case OP_NOT: case OP_INVOKE: case OP_SUP: case OP_PRINT:
+            *b=DECODE_ISBCONSTANT(instr);
+            break;
+        case OP_RETURN: /* B is only used if A is set */
+            *b=(DECODE_A(instr)>0 && DECODE_ISBCONSTANT(instr));
+            break;
+        case OP_NOP: case OP_MOV: case OP_B: case OP_BIF: case OP_CALL:
+        case OP_CLOSURE: case OP_LUP: case OP_CLOSEUP: case OP_LIX: case OP_SIX:
+        case OP_LGL: case OP_SGL: case OP_POPERR: case OP_CAT: case OP_BREAK:
+            break;
+        default:
+            /* Fused and specialised instructions are never produced by the compiler */
+            return false;
+    }
+    
+    return true;
+}
+
+/** Identifies the instructions of a module that belong to its global code rather than to a function; these are the instructions that use the global constant table
+ * @param[in] p         the program
+ * @param[in] deps      dependencies of the module
+ * @param[in] end       end of the module's code
+ * @returns an array with one flag per instruction that the caller must free, or NULL if the module's functions couldn't be delimited */
+static char *bytecode_globalcode(program *p, compilerdeps *deps, instructionindx end) {
+    instructionindx start=deps->start;
+    char *flags = MORPHO_MALLOC(sizeof(char)*(end-start+1));
+    if (!flags) return NULL;
+    memset(flags, 1, end-start+1);
+    
+    /* Each function's code is preceded by a branch over it */
+    for (unsigned int i=0; i<deps->objects.count; i++) {
+        if (!MORPHO_ISFUNCTION(deps->objects.data[i])) continue;
+        objectfunction *func = MORPHO_GETFUNCTION(deps->objects.data[i]);
+    
+        if (func->entry<=start || func->entry>end ||
+            DECODE_OP(p->code.data[func->entry-1])!=OP_B) {
+            MORPHO_FREE(flags);
+            return NULL;
+        }
+    
+        instructionindx fend = func->entry+DECODE_Bx(p->code.data[func->entry-1]);
+        if (fend>end) { MORPHO_FREE(flags); return NULL; }
+        for (instructionindx j=func->entry; j<fend; j++) flags[j-start]=0;
+    }
+    
+    return flags;
+}
+
+/* **********************************************************************
+ * Writing
+ * ********************************************************************** */
+
+/** Tracks the state of a cache file being written */
+typedef struct {
+    varray_char out; /** The file contents */
+    compiler *cc; /** Compiler of the module */
+    program *p; /** Program the module was compiled into */
+    bool ok; /** Cleared if something couldn't be written */
+} bytecodewriter;
+
+static void bytecode_write(bytecodewriter *w, void *data, size_t size) {
+    if (!varray_charadd(&w->out, (char *) data, (int) size)) w->ok=false;
+}
+
+static void bytecode_writebyte(bytecodewriter *w, uint8_t b) {
+    bytecode_write(w, &b, sizeof(uint8_t));
+}
+
+static void bytecode_writeint(bytecodewriter *w, int32_t i) {
+    bytecode_write(w, &i, sizeof(int32_t));
+}
+
+static void bytecode_writedouble(bytecodewriter *w, double d) {
+    bytecode_write(w, &d, sizeof(double));
+}
+
+/** Strings are written with their length and a terminating zero, so that they can be used in place when read */
+static void bytecode_writecstring(bytecodewriter *w, char *str, size_t length) {
+    bytecode_writeint(w, (int32_t) length);
+    bytecode_write(w, str, length);
+    bytecode_writebyte(w, 0);
+}
+
+static void bytecode_writestring(bytecodewriter *w, value str) {
+    if (MORPHO_ISSTRING(str)) {
+        bytecode_writecstring(w, MORPHO_GETCSTRING(str), MORPHO_GETSTRINGLENGTH(str));
+    } else w->ok=false;
+}
+
+/** Checks if a string is interned in the program's symbol table */
+static bool bytecode_isinterned(program *p, value str) {
+    return (dictionary_get(&p->symboltable, str, NULL) &&
+            MORPHO_GETOBJECT(dictionary_intern(&p->symboltable, str))==MORPHO_GETOBJECT(str));
+}
+
+/** Writes a value; objects from outside the module are written as a reference that can be resolved when the cache is loaded */
+static void bytecode_writevalue(bytecodewriter *w, value v) {
+    compilerdeps *deps = &w->cc->deps;
+    unsigned int indx;
+    value val;
+    
+    if (MORPHO_ISNIL(v)) {
+        bytecode_writebyte(w, BYTECODE_NIL);
+    } else if (MORPHO_ISBOOL(v)) {
+        bytecode_writebyte(w, (MORPHO_GETBOOLVALUE(v) ? BYTECODE_TRUE : BYTECODE_FALSE));
+    } else if (MORPHO_ISINTEGER(v)) {
+        bytecode_writebyte(w, BYTECODE_INTEGER);
+        bytecode_writeint(w, MORPHO_GETINTEGERVALUE(v));
+    } else if (MORPHO_ISFLOAT(v)) {
+        bytecode_writebyte(w, BYTECODE_FLOAT);
+        bytecode_writedouble(w, MORPHO_GETFLOATVALUE(v));
+    } else if (MORPHO_ISSTRING(v)) {
+        bytecode_writebyte(w, (bytecode_isinterned(w->p, v) ? BYTECODE_SYMBOL : BYTECODE_STRING));
+        bytecode_writestring(w, v);
+    } else if (MORPHO_ISCOMPLEX(v)) {
+        objectcomplex *z = MORPHO_GETCOMPLEX(v);
+        bytecode_writebyte(w, BYTECODE_COMPLEX);
+        bytecode_writedouble(w, creal(z->Z));
+        bytecode_writedouble(w, cimag(z->Z));
+    } else if (varray_valuefindsame(&deps->objects, v, &indx)) {
+        bytecode_writebyte(w, BYTECODE_OBJECT);
+        bytecode_writeint(w, indx);
+    } else if (MORPHO_ISFUNCTION(v) && MORPHO_GETFUNCTION(v)==w->p->global) {
+        bytecode_writebyte(w, BYTECODE_GLOBALFUNCTION);
+    } else if (MORPHO_ISBUILTINFUNCTION(v)) {
+        value name = MORPHO_GETBUILTINFUNCTION(v)->name;
+        if (MORPHO_ISSTRING(name) && MORPHO_ISSAME(builtin_findfunction(name), v)) {
+            bytecode_writebyte(w, BYTECODE_BUILTINFUNCTION);
+            bytecode_writestring(w, name);
+        } else w->ok=false;
+    } else if (MORPHO_ISCLASS(v)) {
+        value name = MORPHO_GETCLASS(v)->name;
+        if (MORPHO_ISSAME(builtin_findclass(name), v)) {
+            bytecode_writebyte(w, BYTECODE_BUILTINCLASS);
+            bytecode_writestring(w, name);
+        } else if (dictionary_get(&deps->classes, name, &val) && MORPHO_ISSAME(val, v)) {
+            bytecode_writebyte(w, BYTECODE_CLASS);
+            bytecode_writestring(w, name);
+        } else w->ok=false;
+    } else w->ok=false;
+}
+
+/** Writes the header, which identifies the file and the source it was compiled from */
+static void bytecode_writeheader(bytecodewriter *w, value hash) {
+    bytecode_write(w, BYTECODE_MAGIC, strlen(BYTECODE_MAGIC));
+    bytecode_writeint(w, BYTECODE_FORMAT);
+    bytecode_writecstring(w, MORPHO_VERSIONSTRING, strlen(MORPHO_VERSIONSTRING));
+    bytecode_writeint(w, BYTECODE_ENDIANCHECK);
+    bytecode_writestring(w, hash);
+}
+
+/** Writes what the module found outside itself */
+static void bytecode_writedependencies(bytecodewriter *w) {
+    compilerdeps *deps = &w->cc->deps;
+    dictionary *dicts[] = { &deps->globals, &deps->classes, &deps->unbound, &deps->modules };
+    
+    for (unsigned int k=0; k<4; k++) {
+        dictionary *dict = dicts[k];
+    
+        /* Names found as classes are checked along with the classes */
+        unsigned int n=0;
+        for (unsigned int i=0; i<dict->capacity; i++) {
+            value key = dict->contents[i].key;
+            if (MORPHO_ISNIL(key)) continue;
+            if (dict==&deps->unbound && dictionary_get(&deps->classes, key, NULL)) continue;
+            n++;
+        }
+        bytecode_writeint(w, n);
+    
+        for (unsigned int i=0; i<dict->capacity; i++) {
+            value key = dict->contents[i].key, val = dict->contents[i].val;
+            unsigned int indx;
+            if (MORPHO_ISNIL(key)) continue;
+            if (dict==&deps->unbound && dictionary_get(&deps->classes, key, NULL)) continue;
+    
+            bytecode_writestring(w, key);
+            if (dict==&deps->globals) {
+                bytecode_writeint(w, MORPHO_GETINTEGERVALUE(val));
+            } else if (dict==&deps->classes) {
+                /* Classes defined by the module are written by index; otherwise -1 */
+                if (varray_valuefindsame(&deps->objects, val, &indx)) bytecode_writeint(w, indx);
+                else bytecode_writeint(w, -1);
+            } else if (dict==&deps->modules) {
+                bytecode_writebyte(w, MORPHO_ISSTRING(val));
+                if (MORPHO_ISSTRING(val)) bytecode_writestring(w, val);
+            }
+        }
+    }
+}
+
+/** Checks that a global index used by the module can be relocated */
+static bool bytecode_checkglobal(bytecodewriter *w, unsigned int g, unsigned int nglobals) {
+    compilerdeps *deps = &w->cc->deps;
+    if (g>=deps->nglobals && g<nglobals) return true;
+    
+    for (unsigned int i=0; i<deps->globals.capacity; i++) {
+        value val = deps->globals.contents[i].val;
+        if (!MORPHO_ISNIL(deps->globals.contents[i].key) &&
+            MORPHO_GETINTEGERVALUE(val)==(int) g) return true;
+    }
+    return false;
+}
+
+/** Writes the module's instructions, with a flag for each that identifies it as part of the global code */
+static void bytecode_writecode(bytecodewriter *w, varray_value *prerefs) {
+    compilerdeps *deps = &w->cc->deps;
+    program *p = w->p;
+    instructionindx start=deps->start, end=p->code.count;
+    
+    char *flags = bytecode_globalcode(p, deps, end);
+    if (!flags) { w->ok=false; return; }
+    
+    /* Check every instruction, collecting constants the global code uses that were there before the module */
+    for (instructionindx i=start; i<end && w->ok; i++) {
+        instruction instr = p->code.data[i];
+        bool b, c, bx;
+    
+        if (!bytecode_constantoperands(instr, &b, &c, &bx)) w->ok=false;
+    
+        if (flags[i-start]) {
+            unsigned int k[3] = { DECODE_B(instr), DECODE_C(instr), DECODE_Bx(instr) };
+            bool isk[3] = { b, c, bx };
+    
+            for (unsigned int j=0; j<3; j++) {
+                if (isk[j] && k[j]>=p->global->konst.count) w->ok=false;
+                if (isk[j] && k[j]<deps->nkonst &&
+                    !varray_valuefindsame(prerefs, MORPHO_INTEGER(k[j]), NULL)) {
+                    varray_valuewrite(prerefs, MORPHO_INTEGER(k[j]));
+                }
+            }
+    
+            /* Closures in the global code would use prototypes of the global function */
+            if (DECODE_OP(instr)==OP_CLOSURE) w->ok=false;
+        }
+    
+        if (DECODE_OP(instr)==OP_LGL || DECODE_OP(instr)==OP_SGL) {
+            if (!bytecode_checkglobal(w, DECODE_Bx(instr), p->nglobals)) w->ok=false;
+        }
+    }
+    
+    bytecode_writeint(w, (int32_t) start);
+    bytecode_writeint(w, deps->nkonst);
+    bytecode_writeint(w, p->global->konst.count-deps->nkonst);
+    bytecode_writeint(w, deps->nglobals);
+    bytecode_writeint(w, p->nglobals-deps->nglobals);
+    bytecode_writeint(w, (w->cc->fstack[0].nreg>deps->nreg ? w->cc->fstack[0].nreg : deps->nreg));
+    
+    bytecode_writeint(w, prerefs->count);
+    for (unsigned int i=0; i<prerefs->count; i++) bytecode_writeint(w, MORPHO_GETINTEGERVALUE(prerefs->data[i]));
+    
+    bytecode_writeint(w, (int32_t) (end-start));
+    bytecode_write(w, p->code.data+start, sizeof(instruction)*(end-start));
+    bytecode_write(w, flags, sizeof(char)*(end-start));
+    
+    MORPHO_FREE(flags);
+}
+
+/** Writes the functions, classes and dictionaries created by the module; all objects are created before their contents are filled in, as they may refer to each other */
+static void bytecode_writeobjects(bytecodewriter *w) {
+    compilerdeps *deps = &w->cc->deps;
+    instructionindx start=deps->start;
+    
+    bytecode_writeint(w, deps->objects.count);
+    for (unsigned int i=0; i<deps->objects.count; i++) {
+        value obj = deps->objects.data[i];
+    
+        if (MORPHO_ISFUNCTION(obj)) {
+            objectfunction *func = MORPHO_GETFUNCTION(obj);
+            bytecode_writebyte(w, BYTECODE_FUNCTIONOBJECT);
+            bytecode_writevalue(w, func->name);
+            bytecode_writevalue(w, (func->parent ? MORPHO_OBJECT(func->parent) : MORPHO_NIL));
+            bytecode_writeint(w, func->nargs);
+            bytecode_writeint(w, (int32_t) (func->entry-start));
+        } else if (MORPHO_ISCLASS(obj)) {
+            bytecode_writebyte(w, BYTECODE_CLASSOBJECT);
+            bytecode_writevalue(w, MORPHO_GETCLASS(obj)->name);
+        } else if (MORPHO_ISDICTIONARY(obj)) {
+            bytecode_writebyte(w, BYTECODE_DICTIONARYOBJECT);
+        } else w->ok=false;
+    }
+    
+    for (unsigned int i=0; i<deps->objects.count && w->ok; i++) {
+        value obj = deps->objects.data[i];
+    
+        if (MORPHO_ISFUNCTION(obj)) {
+            objectfunction *func = MORPHO_GETFUNCTION(obj);
+            bytecode_writeint(w, func->nupvalues);
+            bytecode_writeint(w, func->nregs);
+    
+            bytecode_writeint(w, func->konst.count);
+            for (unsigned int j=0; j<func->konst.count; j++) bytecode_writevalue(w, func->konst.data[j]);
+    
+            bytecode_writeint(w, func->prototype.count);
+            for (unsigned int j=0; j<func->prototype.count; j++) {
+                varray_upvalue *proto = &func->prototype.data[j];
+                bytecode_writeint(w, proto->count);
+                for (unsigned int k=0; k<proto->count; k++) {
+                    bytecode_writebyte(w, proto->data[k].islocal);
+                    bytecode_writeint(w, (int32_t) proto->data[k].reg);
+                }
+            }
+    
+            bytecode_writeint(w, func->opt.count);
+            for (unsigned int j=0; j<func->opt.count; j++) {
+                bytecode_writevalue(w, func->opt.data[j].symbol);
+                bytecode_writeint(w, (int32_t) func->opt.data[j].def);
+                bytecode_writeint(w, (int32_t) func->opt.data[j].reg);
+            }
+        } else if (MORPHO_ISCLASS(obj)) {
+            objectclass *klass = MORPHO_GETCLASS(obj);
+            dictionary *super = (klass->superclass ? &klass->superclass->methods : NULL);
+            bytecode_writevalue(w, (klass->superclass ? MORPHO_OBJECT(klass->superclass) : MORPHO_NIL));
+    
+            /* Only methods defined by the class itself are written, since the rest are copied from the superclass */
+            for (unsigned int pass=0; pass<2; pass++) {
+                unsigned int n=0;
+                for (unsigned int j=0; j<klass->methods.capacity; j++) {
+                    value key = klass->methods.contents[j].key, method = klass->methods.contents[j].val, smethod;
+                    if (MORPHO_ISNIL(key)) continue;
+                    if (super && dictionary_get(super, key, &smethod) && MORPHO_ISSAME(smethod, method)) continue;
+    
+                    if (pass==0) n++;
+                    else {
+                        bytecode_writevalue(w, key);
+                        bytecode_writevalue(w, method);
+                    }
+                }
+                if (pass==0) bytecode_writeint(w, n);
+            }
+        } else if (MORPHO_ISDICTIONARY(obj)) {
+            /* Dictionaries map error identifiers to handlers, which are written relative to the start of the module */
+            dictionary *dict = &MORPHO_GETDICTIONARY(obj)->dict;
+            bytecode_writeint(w, dict->count);
+            for (unsigned int j=0; j<dict->capacity; j++) {
+                value key = dict->contents[j].key, val = dict->contents[j].val;
+                if (MORPHO_ISNIL(key)) continue;
+                if (!MORPHO_ISINTEGER(val)) { w->ok=false; continue; }
+                bytecode_writevalue(w, key);
+                bytecode_writeint(w, MORPHO_GETINTEGERVALUE(val)-(int32_t) start);
+            }
+        }
+    }
+}
+
+/** Writes the constants the module added to the global constant table, followed by earlier ones its global code uses */
+static void bytecode_writeconstants(bytecodewriter *w, varray_value *prerefs) {
+    varray_value *konst = &w->p->global->konst;
+    
+    for (unsigned int i=w->cc->deps.nkonst; i<konst->count; i++) bytecode_writevalue(w, konst->data[i]);
+    
+    for (unsigned int i=0; i<prerefs->count; i++) {
+        bytecode_writevalue(w, konst->data[MORPHO_GETINTEGERVALUE(prerefs->data[i])]);
+    }
+}
+
+/** Writes the module's globals */
+static void bytecode_writeglobals(bytecodewriter *w) {
+    compilerdeps *deps = &w->cc->deps;
+    dictionary *globals = &w->cc->globals;
+    
+    bytecode_writeint(w, globals->count);
+    for (unsigned int i=0; i<globals->capacity; i++) {
+        value key = globals->contents[i].key, val = globals->contents[i].val;
+        if (MORPHO_ISNIL(key)) continue;
+    
+        int g = MORPHO_GETINTEGERVALUE(val);
+        if (g<(int) deps->nglobals || g>=(int) w->p->nglobals) w->ok=false;
+    
+        bytecode_writestring(w, key);
+        bytecode_writeint(w, g-deps->nglobals);
+    }
+}
+
+/** Writes the module's debugging annotations */
+static void bytecode_writeannotations(bytecodewriter *w) {
+    compilerdeps *deps = &w->cc->deps;
+    varray_debugannotation *list = &w->p->annotations;
+    
+    /* The first instructions may have been added to the last annotation before the module */
+    int ninstr=0;
+    for (unsigned int i=deps->nannotations; i<list->count; i++) {
+        if (list->data[i].type==DEBUG_ELEMENT) ninstr+=list->data[i].content.element.ninstr;
+    }
+    int lead=(int) (w->p->code.count-deps->start)-ninstr;
+    
+    if (lead<0 || (lead>0 && (deps->nannotations==0 || list->data[deps->nannotations-1].type!=DEBUG_ELEMENT))) {
+        w->ok=false;
+        return;
+    }
+    
+    bytecode_writeint(w, list->count-deps->nannotations+(lead>0 ? 1 : 0));
+    if (lead>0) {
+        debugannotation *prev = &list->data[deps->nannotations-1];
+        bytecode_writebyte(w, DEBUG_ELEMENT);
+        bytecode_writeint(w, lead);
+        bytecode_writeint(w, prev->content.element.line);
+        bytecode_writeint(w, prev->content.element.posn);
+    }
+    
+    for (unsigned int i=deps->nannotations; i<list->count; i++) {
+        debugannotation *ann = &list->data[i];
+        bytecode_writebyte(w, ann->type);
+    
+        switch (ann->type) {
+            case DEBUG_FUNCTION:
+                bytecode_writevalue(w, MORPHO_OBJECT(ann->content.function.function));
+                break;
+            case DEBUG_CLASS:
+                bytecode_writevalue(w, (ann->content.klass.klass ? MORPHO_OBJECT(ann->content.klass.klass) : MORPHO_NIL));
+                break;
+            case DEBUG_REGISTER:
+                bytecode_writeint(w, (int32_t) ann->content.reg.reg);
+                bytecode_writevalue(w, ann->content.reg.symbol);
+                break;
+            case DEBUG_ELEMENT:
+                bytecode_writeint(w, ann->content.element.ninstr);
+                bytecode_writeint(w, ann->content.element.line);
+                bytecode_writeint(w, ann->content.element.posn);
+                break;
+            case DEBUG_PUSHERR:
+                bytecode_writevalue(w, MORPHO_OBJECT(ann->content.errorhandler.handler));
+                break;
+            case DEBUG_POPERR:
+                break;
+            default:
+                w->ok=false;
+        }
+    }
+}
+
+/** Saves the bytecode of a module that has just been compiled to the cache
+ * @param[in] cc        the module's compiler
+ * @param[in] fname     file name of the module
+ * @param[in] hash      hash of the module's source */
+void bytecode_save(compiler *cc, char *fname, value hash) {
+    program *p = cc->out;
+    bytecodewriter w = { .cc = cc, .p = p, .ok = true };
+    varray_value prerefs;
+    varray_char path;
+    
+    /* Closure prototypes of the global function can't be relocated */
+    if (p->global->prototype.count!=cc->deps.nprototypes) return;
+    
+    varray_charinit(&w.out);
+    varray_valueinit(&prerefs);
+    varray_charinit(&path);
+    
+    bytecode_writeheader(&w, hash);
+    bytecode_writedependencies(&w);
+    if (w.ok) bytecode_writecode(&w, &prerefs);
+    if (w.ok) bytecode_writeobjects(&w);
+    if (w.ok) bytecode_writeconstants(&w, &prerefs);
+    if (w.ok) bytecode_writeglobals(&w);
+    if (w.ok) bytecode_writeannotations(&w);
+    
+    if (w.ok) {
+        uint64_t checksum = bytecode_fnv(w.out.data, w.out.count);
+        bytecode_write(&w, &checksum, sizeof(uint64_t));
+    }
+    
+    if (w.ok && bytecode_cachepath(fname, &path, true)) morpho_replacefile(path.data, w.out.data, w.out.count);
+    
+    varray_charclear(&path);
+    varray_valueclear(&prerefs);
+    varray_charclear(&w.out);
+}
+
+/* **********************************************************************
+ * Reading
+ * ********************************************************************** */
+
+/** Tracks the state of a cache file being loaded */
+typedef struct {
+    char *data; /** The file contents */
+    size_t length; /** Length of the file */
+    size_t posn; /** Current position */
+    bool ok; /** Cleared if the file is found to be invalid */
+    
+    compiler *c; /** Compiler that imports the module */
+    program *p; /** Program the module is loaded into */
+    instructionindx start; /** Where the module's code is loaded */
+    varray_value objects; /** Objects created by the module */
+    varray_value definedclasses; /** Indices of the objects that define classes the module depends on */
+    dictionary classes; /** Classes from outside the module that it uses, by name */
+    dictionary globals; /** Maps global indices from outside the module to their current values */
+} bytecodeloader;
+
+static bool bytecode_read(bytecodeloader *l, void *out, size_t size) {
+    if (!l->ok || l->posn+size>l->length) {
+        l->ok=false;
+        memset(out, 0, size);
+        return false;
+    }
+    memcpy(out, l->data+l->posn, size);
+    l->posn+=size;
+    return true;
+}
+
+static uint8_t bytecode_readbyte(bytecodeloader *l) {
+    uint8_t b;
+    bytecode_read(l, &b, sizeof(uint8_t));
+    return b;
+}
+
+static int32_t bytecode_readint(bytecodeloader *l) {
+    int32_t i;
+    bytecode_read(l, &i, sizeof(int32_t));
+    return i;
+}
+
+static double bytecode_readdouble(bytecodeloader *l) {
+    double d;
+    bytecode_read(l, &d, sizeof(double));
+    return d;
+}
+
+/** Reads a string in place
+ * @returns a pointer to the zero terminated string within the file, or NULL if it is invalid */
+static char *bytecode_readcstring(bytecodeloader *l) {
+    int32_t length = bytecode_readint(l);
+    if (!l->ok || length<0 || l->posn+length+1>l->length ||
+        l->data[l->posn+length]!='\0' || strlen(l->data+l->posn)!=(size_t) length) {
+        l->ok=false;
+        return NULL;
+    }
+    
+    char *out = l->data+l->posn;
+    l->posn+=length+1;
+    return out;
+}
+
+/** Reads a value
+ * @param[in] l         the loader
+ * @param[out] out      the value
+ * @param[out] isnew    (optional) set if a new string or complex number was created; the caller should bind or free this
+ * @returns true on success */
+static bool bytecode_readvalue(bytecodeloader *l, value *out, bool *isnew) {
+    uint8_t tag = bytecode_readbyte(l);
+    char *str=NULL;
+    *out=MORPHO_NIL;
+    if (isnew) *isnew=false;
+    if (!l->ok) return false;
+    
+    switch (tag) {
+        case BYTECODE_NIL: break;
+        case BYTECODE_TRUE: *out=MORPHO_TRUE; break;
+        case BYTECODE_FALSE: *out=MORPHO_FALSE; break;
+        case BYTECODE_INTEGER: *out=MORPHO_INTEGER(bytecode_readint(l)); break;
+        case BYTECODE_FLOAT: *out=MORPHO_FLOAT(bytecode_readdouble(l)); break;
+        case BYTECODE_STRING:
+            str=bytecode_readcstring(l);
+            if (str) *out=object_stringfromcstring(str, strlen(str));
+            if (isnew) *isnew=true;
+            break;
+        case BYTECODE_SYMBOL:
+            str=bytecode_readcstring(l);
+            if (str) {
+                objectstring symbol = MORPHO_STATICSTRING(str);
+                *out=program_internsymbol(l->p, MORPHO_OBJECT(&symbol));
+            }
+            break;
+        case BYTECODE_COMPLEX: {
+            double re=bytecode_readdouble(l), im=bytecode_readdouble(l);
+            objectcomplex *z = object_newcomplex(re, im);
+            if (z) *out=MORPHO_OBJECT(z);
+            if (isnew) *isnew=true;
+        }
+            break;
+        case BYTECODE_OBJECT: {
+            int32_t indx = bytecode_readint(l);
+            if (indx>=0 && indx<l->objects.count) *out=l->objects.data[indx];
+            else l->ok=false;
+        }
+            break;
+        case BYTECODE_GLOBALFUNCTION: *out=MORPHO_OBJECT(l->p->global); break;
+        case BYTECODE_BUILTINFUNCTION:
+        case BYTECODE_BUILTINCLASS:
+        case BYTECODE_CLASS:
+            str=bytecode_readcstring(l);
+            if (str) {
+                objectstring name = MORPHO_STATICSTRING(str);
+                if (tag==BYTECODE_BUILTINFUNCTION) *out=builtin_findfunction(MORPHO_OBJECT(&name));
+                else if (tag==BYTECODE_BUILTINCLASS) *out=builtin_findclass(MORPHO_OBJECT(&name));
+                else dictionary_get(&l->classes, MORPHO_OBJECT(&name), out);
+            }
+            if (MORPHO_ISNIL(*out)) l->ok=false;
+            break;
+        default:
+            l->ok=false;
+    }
+    
+    if (l->ok && (tag==BYTECODE_STRING || tag==BYTECODE_COMPLEX) && MORPHO_ISNIL(*out)) l->ok=false;
+    
+    return l->ok;
+}
+
+/** Reads a value, binding it to the program if it is new */
+static bool bytecode_readboundvalue(bytecodeloader *l, value *out) {
+    bool isnew;
+    if (!bytecode_readvalue(l, out, &isnew)) return false;
+    if (isnew) program_bindobject(l->p, MORPHO_GETOBJECT(*out));
+    return true;
+}
+
+/** Checks the header matches this version of morpho and the current source */
+static bool bytecode_readheader(bytecodeloader *l, value hash) {
+    char magic[sizeof(BYTECODE_MAGIC)-1];
+    bytecode_read(l, magic, sizeof(magic));
+    if (!l->ok || memcmp(magic, BYTECODE_MAGIC, sizeof(magic))!=0) return false;
+    if (bytecode_readint(l)!=BYTECODE_FORMAT) return false;
+    
+    char *version = bytecode_readcstring(l);
+    if (!version || strcmp(version, MORPHO_VERSIONSTRING)!=0) return false;
+    if (bytecode_readint(l)!=BYTECODE_ENDIANCHECK) return false;
+    
+    char *srchash = bytecode_readcstring(l);
+    return (srchash && strcmp(srchash, MORPHO_GETCSTRING(hash))==0);
+}
+
+/** Checks that a module imported by a cached module is unchanged */
+static bool bytecode_checkmodule(char *fname, char *hash) {
+    bool success=false;
+    
+    FILE *f = file_openrelative(fname, "r");
+    if (!f) return false;
+    
+    varray_char src;
+    varray_charinit(&src);
+    
+    if (file_readintovarray(f, &src)) {
+        value current = bytecode_hash(src.data);
+        success=(strcmp(MORPHO_GETCSTRING(current), hash)==0);
+        morpho_freeobject(current);
+    }
+    
+    varray_charclear(&src);
+    fclose(f);
+    
+    return success;
+}
+
+/** Reads the module's dependencies. This is done twice: first to check that the module would compile to the same code, then to record the dependencies as if it had been compiled
+ * @param[in] l         the loader
+ * @param[in] record    whether to check or record the dependencies
+ * @returns true if the module would compile to the same code */
+static bool bytecode_readdependencies(bytecodeloader *l, bool record) {
+    compiler *c = l->c;
+    compiler *root = compiler_root(c);
+    objectfunction *global = l->p->global;
+    
+    /* Globals from outside the module must have been defined already */
+    int n = bytecode_readint(l);
+    for (int i=0; i<n && l->ok; i++) {
+        char *name = bytecode_readcstring(l);
+        int32_t indx = bytecode_readint(l);
+        if (!name) return false;
+        objectstring symbol = MORPHO_STATICSTRING(name);
+    
+        if (record) {
+            compiler_resolveglobal(c, MORPHO_OBJECT(&symbol));
+        } else {
+            globalindx g = compiler_findglobal(c, MORPHO_OBJECT(&symbol));
+            if (g==GLOBAL_UNALLOCATED) return false;
+            dictionary_insert(&l->globals, MORPHO_INTEGER(indx), MORPHO_INTEGER(g));
+        }
+    }
+    
+    /* Classes defined by the module mustn't be shadowed by one defined earlier; others must be found */
+    n = bytecode_readint(l);
+    for (int i=0; i<n && l->ok; i++) {
+        char *name = bytecode_readcstring(l);
+        int32_t indx = bytecode_readint(l);
+        if (!name) return false;
+        objectstring symbol = MORPHO_STATICSTRING(name);
+    
+        if (record) {
+            if (indx>=0 && indx<l->objects.count && MORPHO_ISCLASS(l->objects.data[indx])) {
+                compiler_addclassdependency(c, MORPHO_OBJECT(&symbol), MORPHO_GETCLASS(l->objects.data[indx]));
+            } else if (indx<0) {
+                value klass=MORPHO_NIL;
+                dictionary_get(&l->classes, MORPHO_OBJECT(&symbol), &klass);
+                compiler_addclassdependency(c, MORPHO_OBJECT(&symbol), MORPHO_GETCLASS(klass));
+            } else return false;
+        } else {
+            objectclass *klass = compiler_findclass(global, MORPHO_OBJECT(&symbol));
+            if (indx>=0) {
+                if (klass) return false;
+                varray_valuewrite(&l->definedclasses, MORPHO_INTEGER(indx));
+            } else {
+                if (!klass) return false;
+                dictionary_insert(&l->classes, klass->name, MORPHO_OBJECT(klass));
+            }
+        }
+    }
+    
+    /* Symbols that weren't found must still not be */
+    n = bytecode_readint(l);
+    for (int i=0; i<n && l->ok; i++) {
+        char *name = bytecode_readcstring(l);
+        if (!name) return false;
+        objectstring symbol = MORPHO_STATICSTRING(name);
+    
+        if (record) {
+            compiler_resolveglobal(c, MORPHO_OBJECT(&symbol));
+        } else if (compiler_findglobal(c, MORPHO_OBJECT(&symbol))!=GLOBAL_UNALLOCATED ||
+                   compiler_findclass(global, MORPHO_OBJECT(&symbol))) return false;
+    }
+    
+    /* Modules that were imported must be unchanged, and those that had been imported already must still be */
+    n = bytecode_readint(l);
+    for (int i=0; i<n && l->ok; i++) {
+        char *name = bytecode_readcstring(l);
+        char *hash = (bytecode_readbyte(l) ? bytecode_readcstring(l) : NULL);
+        if (!name) return false;
+        objectstring modname = MORPHO_STATICSTRING(name);
+        bool imported = dictionary_get(&root->modules, MORPHO_OBJECT(&modname), NULL);
+    
+        if (record) {
+            if (hash) {
+                objectstring modhash = MORPHO_STATICSTRING(hash);
+                if (!imported) dictionary_insert(&root->modules, object_clonestring(MORPHO_OBJECT(&modname)), MORPHO_NIL);
+                compiler_addmoduledependency(c, MORPHO_OBJECT(&modname), MORPHO_OBJECT(&modhash));
+            } else {
+                compiler_addmoduledependency(c, MORPHO_OBJECT(&modname), MORPHO_NIL);
+            }
+        } else if (hash) {
+            if (imported || !bytecode_checkmodule(name, hash)) return false;
+        } else if (!imported) return false;
+    }
+    
+    return l->ok;
+}
+
+/** Header of the code section */
+typedef struct {
+    instructionindx start; /** Where the module's code began when it was cached */
+    unsigned int nkonst; /** Size of the global constant table before the module */
+    unsigned int nnew; /** Number of constants the module added */
+    unsigned int nglobals; /** Number of globals before the module */
+    unsigned int nnewglobals; /** Number of globals the module added */
+    unsigned int nreg; /** Registers used by the global code, including that of modules it imported */
+    char *prerefs; /** Earlier constants the global code uses */
+    unsigned int nprerefs;
+    char *code; /** The instructions */
+    char *flags; /** Flags identifying global code */
+    unsigned int ninstr;
+} bytecodecode;
+
+/* Data within the file may not be aligned, so it is copied out */
+static int32_t bytecode_preref(bytecodecode *code, unsigned int i) {
+    int32_t k;
+    memcpy(&k, code->prerefs+sizeof(int32_t)*i, sizeof(int32_t));
+    return k;
+}
+
+static instruction bytecode_instruction(bytecodecode *code, unsigned int i) {
+    instruction instr;
+    memcpy(&instr, code->code+sizeof(instruction)*i, sizeof(instruction));
+    return instr;
+}
+
+/** Finds where a constant used by the global code is relocated to
+ * @param[in] code      the code section
+ * @param[in] k         the original index
+ * @param[in] base      index of the first constant loaded
+ * @param[in] map       map from constants in the file to their index, or NULL to find a bound on the index
+ * @returns the new index, or UINT_MAX if the constant is unknown */
+static unsigned int bytecode_relocateconstant(bytecodecode *code, unsigned int k, unsigned int base, unsigned int *map) {
+    unsigned int i=UINT_MAX;
+    
+    if (k>=code->nkonst) {
+        if (k-code->nkonst<code->nnew) i=k-code->nkonst;
+    } else for (unsigned int j=0; j<code->nprerefs; j++) {
+        if (bytecode_preref(code, j)==(int32_t) k) { i=code->nnew+j; break; }
+    }
+    if (i==UINT_MAX) return i;
+    
+    return (map ? map[i] : base+i);
+}
+
+/** Finds where a global is relocated to
+ * @returns the new index, or GLOBAL_UNALLOCATED if it is unknown */
+static globalindx bytecode_relocateglobal(bytecodeloader *l, bytecodecode *code, unsigned int g) {
+    value out;
+    if (g>=code->nglobals && g<code->nglobals+code->nnewglobals) return (globalindx) (l->p->nglobals+g-code->nglobals);
+    if (dictionary_get(&l->globals, MORPHO_INTEGER(g), &out)) return MORPHO_GETINTEGERVALUE(out);
+    return GLOBAL_UNALLOCATED;
+}
+
+/** Relocates an instruction
+ * @param[in] l         the loader
+ * @param[in] code      the code section
+ * @param[in] i         index of the instruction
+ * @param[in] map       map from constants in the file to their index, or NULL to check the relocation is possible
+ * @param[out] out      the relocated instruction
+ * @returns true if the instruction could be relocated */
+static bool bytecode_relocate(bytecodeloader *l, bytecodecode *code, unsigned int i, unsigned int *map, instruction *out) {
+    instruction instr = bytecode_instruction(code, i);
+    bool b, c, bx;
+    
+    if (!bytecode_constantoperands(instr, &b, &c, &bx)) return false;
+    
+    /* Only global code uses the global constant table */
+    if (code->flags[i]) {
+        unsigned int base = l->p->global->konst.count;
+        if (b || c) {
+            unsigned int kb=DECODE_B(instr), kc=DECODE_C(instr);
+            if (b) kb=bytecode_relocateconstant(code, kb, base, map);
+            if (c) kc=bytecode_relocateconstant(code, kc, base, map);
+            if (kb>0xff || kc>0xff) return false;
+            instr = (instr & ~((0xff << 9) | 0xff)) | (kb << 9) | kc;
+        } else if (bx) {
+            unsigned int k=bytecode_relocateconstant(code, DECODE_Bx(instr), base, map);
+            if (k>0xffff) return false;
+            instr = (instr & ~0xffff) | k;
+        }
+    }
+    
+    if (DECODE_OP(instr)==OP_LGL || DECODE_OP(instr)==OP_SGL) {
+        globalindx g=bytecode_relocateglobal(l, code, DECODE_Bx(instr));
+        if (g==GLOBAL_UNALLOCATED || g>0xffff) return false;
+        instr = (instr & ~0xffff) | g;
+    }
+    
+    *out=instr;
+    return true;
+}
+
+/** Reads the code section and checks that it can be relocated to the end of the program */
+static bool bytecode_readcode(bytecodeloader *l, bytecodecode *code) {
+    code->start=bytecode_readint(l);
+    code->nkonst=bytecode_readint(l);
+    code->nnew=bytecode_readint(l);
+    code->nglobals=bytecode_readint(l);
+    code->nnewglobals=bytecode_readint(l);
+    code->nreg=bytecode_readint(l);
+    
+    code->nprerefs=bytecode_readint(l);
+    if (!l->ok || code->nprerefs>l->length) return false;
+    code->prerefs=l->data+l->posn;
+    l->posn+=sizeof(int32_t)*code->nprerefs;
+    
+    code->ninstr=bytecode_readint(l);
+    if (!l->ok || code->ninstr>l->length) return false;
+    code->code=l->data+l->posn;
+    l->posn+=sizeof(instruction)*code->ninstr;
+    code->flags=l->data+l->posn;
+    l->posn+=code->ninstr;
+    if (l->posn>l->length) return false;
+    
+    if (l->p->global->konst.count+code->nnew+code->nprerefs>MORPHO_MAXCONSTANTS) return false;
+    
+    /* Check each instruction can be relocated assuming no constants are shared with the program */
+    for (unsigned int i=0; i<code->ninstr; i++) {
+        instruction instr;
+        if (!bytecode_relocate(l, code, i, NULL, &instr)) return false;
+    }
+    
+    return true;
+}
+
+/** Creates the functions, classes and dictionaries of the module */
+static bool bytecode_readobjects(bytecodeloader *l) {
+    int n = bytecode_readint(l);
+    
+    for (int i=0; i<n && l->ok; i++) {
+        object *obj = NULL;
+    
+        switch (bytecode_readbyte(l)) {
+            case BYTECODE_FUNCTIONOBJECT: {
+                value name, parent;
+                bool isnew;
+                bytecode_readvalue(l, &name, &isnew);
+                bytecode_readvalue(l, &parent, NULL);
+                int32_t nargs = bytecode_readint(l), entry = bytecode_readint(l);
+    
+                if (l->ok && (MORPHO_ISNIL(parent) || MORPHO_ISFUNCTION(parent))) {
+                    obj = (object *) object_newfunction(l->start+entry, name, (MORPHO_ISNIL(parent) ? NULL : MORPHO_GETFUNCTION(parent)), nargs);
+                }
+                if (isnew) morpho_freeobject(name);
+            }
+                break;
+            case BYTECODE_CLASSOBJECT: {
+                value name;
+                bool isnew;
+                bytecode_readvalue(l, &name, &isnew);
+                if (l->ok) obj = (object *) object_newclass(name);
+                if (isnew) morpho_freeobject(name);
+            }
+                break;
+            case BYTECODE_DICTIONARYOBJECT:
+                obj = (object *) object_newdictionary();
+                break;
+            default:
+                l->ok=false;
+        }
+    
+        if (!obj) return false;
+    
+        value v = MORPHO_OBJECT(obj);
+        varray_valuewrite(&l->objects, v);
+        program_bindobject(l->p, obj);
+    }
+    
+    for (int i=0; i<n && l->ok; i++) {
+        value obj = l->objects.data[i];
+    
+        if (MORPHO_ISFUNCTION(obj)) {
+            objectfunction *func = MORPHO_GETFUNCTION(obj);
+            func->nupvalues=bytecode_readint(l);
+            func->nregs=bytecode_readint(l);
+    
+            int nk = bytecode_readint(l);
+            for (int j=0; j<nk && l->ok; j++) {
+                value k;
+                if (bytecode_readboundvalue(l, &k)) varray_valuewrite(&func->konst, k);
+            }
+    
+            int np = bytecode_readint(l);
+            for (int j=0; j<np && l->ok; j++) {
+                varray_upvalue proto;
+                varray_upvalueinit(&proto);
+                int nu = bytecode_readint(l);
+                for (int k=0; k<nu && l->ok; k++) {
+                    upvalue up;
+                    up.islocal=bytecode_readbyte(l);
+                    up.reg=bytecode_readint(l);
+                    varray_upvaluewrite(&proto, up);
+                }
+                object_functionaddprototype(func, &proto, NULL);
+                varray_upvalueclear(&proto);
+            }
+    
+            int nopt = bytecode_readint(l);
+            for (int j=0; j<nopt && l->ok; j++) {
+                optionalparam param;
+                bytecode_readboundvalue(l, &param.symbol);
+                param.def=bytecode_readint(l);
+                param.reg=bytecode_readint(l);
+                varray_optionalparamwrite(&func->opt, param);
+            }
+        } else if (MORPHO_ISCLASS(obj)) {
+            objectclass *klass = MORPHO_GETCLASS(obj);
+            value super;
+            bytecode_readvalue(l, &super, NULL);
+            if (MORPHO_ISCLASS(super)) {
+                klass->superclass=MORPHO_GETCLASS(super);
+                dictionary_copy(&klass->superclass->methods, &klass->methods);
+            } else if (!MORPHO_ISNIL(super)) l->ok=false;
+    
+            int nm = bytecode_readint(l);
+            for (int j=0; j<nm && l->ok; j++) {
+                value symbol, method;
+                bytecode_readboundvalue(l, &symbol);
+                bytecode_readvalue(l, &method, NULL);
+                if (l->ok) dictionary_insert(&klass->methods, symbol, method);
+            }
+            CLASS_MODIFIED(klass);
+        } else if (MORPHO_ISDICTIONARY(obj)) {
+            objectdictionary *dict = MORPHO_GETDICTIONARY(obj);
+            int nentries = bytecode_readint(l);
+            for (int j=0; j<nentries && l->ok; j++) {
+                value key;
+                bytecode_readboundvalue(l, &key);
+                int32_t entry = bytecode_readint(l);
+                if (l->ok) dictionary_insert(&dict->dict, key, MORPHO_INTEGER(l->start+entry));
+            }
+        }
+    }
+    
+    return l->ok;
+}
+
+/** Checks that the objects the module's dependencies refer to as its classes are classes */
+static bool bytecode_checkclasses(bytecodeloader *l) {
+    for (unsigned int i=0; i<l->definedclasses.count; i++) {
+        int indx = MORPHO_GETINTEGERVALUE(l->definedclasses.data[i]);
+        if (indx>=l->objects.count || !MORPHO_ISCLASS(l->objects.data[indx])) return false;
+    }
+    return true;
+}
+
+/** Finds a constant in the global constant table that can be shared with one loaded */
+static bool bytecode_findconstant(varray_value *konst, value v, unsigned int *indx) {
+    if (MORPHO_ISSTRING(v)) {
+        return (varray_valuefind(konst, v, indx) && MORPHO_ISSTRING(konst->data[*indx]));
+    }
+    return varray_valuefindsame(konst, v, indx);
+}
+
+/** Adds the module's constants to the global constant table
+ * @param[in] l         the loader
+ * @param[in] code      the code section
+ * @param[out] map      map from constants in the file to their new index */
+static bool bytecode_readconstants(bytecodeloader *l, bytecodecode *code, unsigned int *map) {
+    varray_value *konst = &l->p->global->konst;
+    
+    for (unsigned int i=0; i<code->nnew+code->nprerefs && l->ok; i++) {
+        value k;
+        bool isnew;
+        unsigned int indx;
+    
+        if (!bytecode_readvalue(l, &k, &isnew)) break;
+    
+        if (bytecode_findconstant(konst, k, &indx)) {
+            if (isnew) morpho_freeobject(k);
+        } else {
+            indx=konst->count;
+            varray_valuewrite(konst, k);
+            if (isnew) program_bindobject(l->p, MORPHO_GETOBJECT(k));
+        }
+        map[i]=indx;
+    }
+    
+    return l->ok;
+}
+
+/** Adds the module's globals, making those requested available to the importing code
+ * @param[in] l         the loader
+ * @param[in] fordict   (optional) globals to make available to the importing code
+ * @param[in] record    whether to add the globals or only check they can be read */
+static bool bytecode_readglobals(bytecodeloader *l, dictionary *fordict, bool record) {
+    int n = bytecode_readint(l);
+    
+    for (int i=0; i<n && l->ok; i++) {
+        char *name = bytecode_readcstring(l);
+        int32_t g = bytecode_readint(l);
+        if (!name) break;
+        if (!record) continue;
+    
+        objectstring symbol = MORPHO_STATICSTRING(name);
+        value key = MORPHO_OBJECT(&symbol);
+        if (fordict && !dictionary_get(fordict, key, NULL)) continue;
+    
+        if (!dictionary_get(&l->c->globals, key, NULL)) key=object_clonestring(key);
+        dictionary_insert(&l->c->globals, key, MORPHO_INTEGER(l->p->nglobals+g));
+    }
+    
+    return l->ok;
+}
+
+/** Adds the module's debugging annotations */
+static bool bytecode_readannotations(bytecodeloader *l) {
+    varray_debugannotation *list = &l->p->annotations;
+    int n = bytecode_readint(l);
+    
+    for (int i=0; i<n && l->ok; i++) {
+        debugannotation ann = { .type = bytecode_readbyte(l) };
+        value v;
+    
+        switch (ann.type) {
+            case DEBUG_FUNCTION:
+                if (bytecode_readvalue(l, &v, NULL) && MORPHO_ISFUNCTION(v)) ann.content.function.function=MORPHO_GETFUNCTION(v);
+                else l->ok=false;
+                break;
+            case DEBUG_CLASS:
+                if (bytecode_readvalue(l, &v, NULL)) ann.content.klass.klass=(MORPHO_ISCLASS(v) ? MORPHO_GETCLASS(v) : NULL);
+                break;
+            case DEBUG_REGISTER:
+                ann.content.reg.reg=bytecode_readint(l);
+                bytecode_readvalue(l, &ann.content.reg.symbol, NULL);
+                break;
+            case DEBUG_ELEMENT:
+                ann.content.element.ninstr=bytecode_readint(l);
+                ann.content.element.line=bytecode_readint(l);
+                ann.content.element.posn=bytecode_readint(l);
+                break;
+            case DEBUG_PUSHERR:
+                if (bytecode_readvalue(l, &v, NULL) && MORPHO_ISDICTIONARY(v)) ann.content.errorhandler.handler=MORPHO_GETDICTIONARY(v);
+                else l->ok=false;
+                break;
+            case DEBUG_POPERR:
+                break;
+            default:
+                l->ok=false;
+        }
+    
+        if (l->ok) debug_addannotation(list, &ann);
+    }
+    
+    return l->ok;
+}
+
+/** Loads the bytecode of a module from the cache if it is fresh
+ * @param[in] c         the importing compiler
+ * @param[in] fname     file name of the module
+ * @param[in] hash      hash of the module's source
+ * @param[in] fordict   (optional) globals to make available to the importing code
+ * @returns true if the module was loaded; otherwise it should be compiled from source */
+bool bytecode_load(compiler *c, char *fname, value hash, dictionary *fordict) {
+    bool success=false;
+    varray_char path, data;
+    varray_charinit(&path);
+    varray_charinit(&data);
+    
+    bytecodeloader l = { .c = c, .p = c->out, .ok = true };
+    varray_valueinit(&l.objects);
+    varray_valueinit(&l.definedclasses);
+    dictionary_init(&l.classes);
+    dictionary_init(&l.globals);
+    
+    if (!bytecode_cachepath(fname, &path, false) ||
+        !bytecode_readfile(path.data, &data) ||
+        data.count<sizeof(uint64_t)) goto bytecode_load_cleanup;
+    
+    /* The checksum guards against files that are incomplete or corrupt */
+    uint64_t checksum;
+    memcpy(&checksum, data.data+data.count-sizeof(uint64_t), sizeof(uint64_t));
+    if (bytecode_fnv(data.data, data.count-sizeof(uint64_t))!=checksum) goto bytecode_load_cleanup;
+    
+    l.data=data.data;
+    l.length=data.count-sizeof(uint64_t);
+    l.start=c->out->code.count;
+    
+    /* Check the cache is fresh without changing anything */
+    if (!bytecode_readheader(&l, hash)) goto bytecode_load_cleanup;
+    size_t deps=l.posn;
+    if (!bytecode_readdependencies(&l, false)) goto bytecode_load_cleanup;
+    
+    bytecodecode code;
+    if (!bytecode_readcode(&l, &code)) goto bytecode_load_cleanup;
+    size_t objects=l.posn;
+    
+    /* Load the module */
+    unsigned int *map = MORPHO_MALLOC(sizeof(unsigned int)*(code.nnew+code.nprerefs+1));
+    if (!map) goto bytecode_load_cleanup;
+    
+    unsigned int nkonst=l.p->global->konst.count, nannotations=l.p->annotations.count;
+    
+    l.posn=objects;
+    success=bytecode_readobjects(&l) && bytecode_checkclasses(&l) && bytecode_readconstants(&l, &code, map);
+    
+    for (unsigned int i=0; i<code.ninstr && success; i++) {
+        instruction instr;
+        success=bytecode_relocate(&l, &code, i, map, &instr);
+        varray_instructionwrite(&l.p->code, instr);
+    }
+    MORPHO_FREE(map);
+    
+    size_t globals=l.posn;
+    success=success && bytecode_readglobals(&l, fordict, false) && bytecode_readannotations(&l);
+    
+    if (!success) {
+        /* Remove what was loaded and the cache file, so that the module is compiled from source instead */
+        l.p->code.count=l.start;
+        l.p->global->konst.count=nkonst;
+        l.p->annotations.count=nannotations;
+        remove(path.data);
+        goto bytecode_load_cleanup;
+    }
+    
+    /* Record the dependencies before the module's globals become visible */
+    for (unsigned int i=0; i<l.objects.count; i++) compiler_addobjectdependency(c, l.objects.data[i]);
+    compiler_addregisterdependency(c, code.nreg);
+    l.posn=deps;
+    bytecode_readdependencies(&l, true);
+    
+    l.posn=globals;
+    bytecode_readglobals(&l, fordict, true);
+    
+    l.p->nglobals+=code.nnewglobals;
+    if (code.nreg>l.p->global->nregs) l.p->global->nregs=code.nreg;
+    program_setentry(l.p, l.start);
+    
+bytecode_load_cleanup:
+    dictionary_clear(&l.globals);
+    dictionary_clear(&l.classes);
+    varray_valueclear(&l.definedclasses);
+    varray_valueclear(&l.objects);
+    varray_charclear(&data);
+    varray_charclear(&path);
+    
+    return success;
+}
@@ -0,0 +1,60 @@
+/** @file bytecode.h
+ *  @author T J Atherton
+ *
+ *  @brief Caches the compiled bytecode of imported modules
+ */
+
+#ifndef bytecode_h
+#define bytecode_h
+
+#define MORPHO_CORE
+
+#include "core.h"
+#include "compile.h"
+
+/* **********************************************************************
+ * Cache file format
+ * ********************************************************************** */
+
+/** @brief Identifies a cache file */
+#define BYTECODE_MAGIC "MORPHOBC"
+
+/** @brief Version of the cache file format; increment whenever the layout or the instruction set changes */
+#define BYTECODE_FORMAT 2
+
+/** @brief Word written in native byte order to detect files written on a different architecture */
+#define BYTECODE_ENDIANCHECK 0x01020304
+
+/** @brief Tags that identify how a value is stored */
+typedef enum {
+    BYTECODE_NIL,
+    BYTECODE_TRUE,
+    BYTECODE_FALSE,
+    BYTECODE_INTEGER,
+    BYTECODE_FLOAT,
+    BYTECODE_STRING,
+    BYTECODE_SYMBOL, /* An interned string */
+    BYTECODE_COMPLEX,
+    BYTECODE_OBJECT, /* A function, class or dictionary created by the module, by index */
+    BYTECODE_GLOBALFUNCTION, /* The program's global function */
+    BYTECODE_BUILTINFUNCTION, /* A builtin function, by name */
+    BYTECODE_BUILTINCLASS, /* A builtin class, by name */
+    BYTECODE_CLASS /* A class defined outside the module, by name */
+} bytecodetag;
+
+/** @brief Kinds of object created by a module */
+typedef enum {
+    BYTECODE_FUNCTIONOBJECT,
+    BYTECODE_CLASSOBJECT,
+    BYTECODE_DICTIONARYOBJECT
+} bytecodeobject;
+
+/* **********************************************************************
+ * Prototypes
+ * ********************************************************************** */
+
+value bytecode_hash(char *src);
+bool bytecode_load(compiler *c, char *fname, value hash, dictionary *fordict);
+void bytecode_save(compiler *cc, char *fname, value hash);
+
+#endif /* bytecode_h */
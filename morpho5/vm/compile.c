@@ -15,6 +15,8 @@
 #include "veneer.h"
 #include "builtin.h"
 #include "cmplx.h"
+#include "optimize.h"
+#include "bytecode.h"
 
 /** Base class for instances */
 static objectclass *baseclass;
@@ -839,6 +841,84 @@ static inline void compiler_addoptionalarg(compiler *c, syntaxtreenode *node, va
     }
 }
 
+/* ------------------------------------------
+ * Module dependencies
+ * ------------------------------------------- */
+
+/** Finds the compiler at the root of a chain of imports */
+compiler *compiler_root(compiler *c) {
+    compiler *root = c;
+    while (root->parent!=NULL) root=root->parent;
+    return root;
+}
+
+/** Adds an entry to one of the dictionaries that record dependencies, cloning the key if necessary */
+static void compiler_adddependency(dictionary *dict, value key, value val) {
+    if (!dictionary_get(dict, key, NULL)) key=object_clonestring(key);
+    dictionary_insert(dict, key, val);
+}
+
+/** Prevents the bytecode of a module, and of any module that imports it, from being cached */
+static void compiler_nocache(compiler *c) {
+    for (compiler *m=c; m!=NULL && m->parent!=NULL; m=m->parent) m->deps.cacheable=false;
+}
+
+/** Records a function, class or dictionary created by a module */
+void compiler_addobjectdependency(compiler *c, value obj) {
+    for (compiler *m=c; m!=NULL && m->parent!=NULL; m=m->parent) varray_valuewrite(&m->deps.objects, obj);
+}
+
+/** Records the number of registers used by the global code of an imported module, which shares the global function's registers */
+void compiler_addregisterdependency(compiler *c, unsigned int nreg) {
+    for (compiler *m=c; m!=NULL && m->parent!=NULL; m=m->parent) if (nreg>m->deps.nreg) m->deps.nreg=nreg;
+}
+
+/** Records that a module found a class by name */
+void compiler_addclassdependency(compiler *c, value name, objectclass *klass) {
+    if (!klass) return;
+    for (compiler *m=c; m!=NULL && m->parent!=NULL; m=m->parent) compiler_adddependency(&m->deps.classes, name, MORPHO_OBJECT(klass));
+}
+
+/** Records that a module imported another
+ * @param[in] c     the compiler
+ * @param[in] name  file name of the module imported
+ * @param[in] hash  hash of the source of the module, or nil if it had already been imported */
+void compiler_addmoduledependency(compiler *c, value name, value hash) {
+    for (compiler *m=c; m!=NULL && m->parent!=NULL; m=m->parent) {
+        if (dictionary_get(&m->deps.modules, name, NULL)) continue;
+        compiler_adddependency(&m->deps.modules, name, (MORPHO_ISSTRING(hash) ? object_clonestring(hash) : MORPHO_NIL));
+    }
+}
+
+/** Initializes the record of a module's dependencies */
+static void compiler_depsinit(compilerdeps *deps) {
+    deps->cacheable=true;
+    deps->start=0;
+    deps->nkonst=0;
+    deps->nglobals=0;
+    deps->nannotations=0;
+    deps->nprototypes=0;
+    deps->nreg=0;
+    varray_valueinit(&deps->objects);
+    dictionary_init(&deps->globals);
+    dictionary_init(&deps->unbound);
+    dictionary_init(&deps->classes);
+    dictionary_init(&deps->modules);
+}
+
+/** Clears the record of a module's dependencies */
+static void compiler_depsclear(compilerdeps *deps) {
+    varray_valueclear(&deps->objects);
+    dictionary_freecontents(&deps->globals, true, false);
+    dictionary_clear(&deps->globals);
+    dictionary_freecontents(&deps->unbound, true, false);
+    dictionary_clear(&deps->unbound);
+    dictionary_freecontents(&deps->classes, true, false);
+    dictionary_clear(&deps->classes);
+    dictionary_freecontents(&deps->modules, true, true);
+    dictionary_clear(&deps->modules);
+}
+
 /* ------------------------------------------
  * Global variables
  * ------------------------------------------- */
@@ -866,6 +946,26 @@ static globalindx compiler_getglobal(compiler *c, value symbol, bool recurse) {
     return GLOBAL_UNALLOCATED;
 }
 
+/** Finds a global symbol, searching through parent compilers */
+globalindx compiler_findglobal(compiler *c, value symbol) {
+    return compiler_getglobal(c, symbol, true);
+}
+
+/** Finds a global symbol, searching through parent compilers, and records the outcome as a dependency of any module being compiled */
+globalindx compiler_resolveglobal(compiler *c, value symbol) {
+    for (compiler *cc=c; cc!=NULL; cc=cc->parent) {
+        globalindx indx=compiler_getglobal(cc, symbol, false);
+        if (indx!=GLOBAL_UNALLOCATED) {
+            for (compiler *m=c; m!=cc; m=m->parent) compiler_adddependency(&m->deps.globals, symbol, MORPHO_INTEGER(indx));
+            return indx;
+        }
+    }
+    
+    for (compiler *m=c; m!=NULL && m->parent!=NULL; m=m->parent) compiler_adddependency(&m->deps.unbound, symbol, MORPHO_NIL);
+    
+    return GLOBAL_UNALLOCATED;
+}
+
 /** Adds a global variable to */
 static globalindx compiler_addglobal(compiler *c, syntaxtreenode *node, value symbol) {
     globalindx indx=compiler_getglobal(c, symbol, false);
@@ -2039,6 +2139,7 @@ static codeinfo compiler_try(compiler *c, syntaxtreenode *node, registerindx req
     
     objectdictionary *cdict = object_newdictionary();
     if (!cdict) { compiler_error(c, node, ERROR_ALLOCATIONFAILED); return out; }
+    compiler_addobjectdependency(c, MORPHO_OBJECT(cdict));
     
     registerindx cdictindx = compiler_addconstant(c, node, MORPHO_OBJECT(cdict), false, false);
     
@@ -2316,6 +2417,7 @@ static codeinfo compiler_function(compiler *c, syntaxtreenode *node, registerind
     bindx=compiler_addinstruction(c, ENCODE_BYTE(OP_NOP), node);
     
     objectfunction *func = object_newfunction(bindx+1, node->content, compiler_getcurrentfunction(c), 0);
+    compiler_addobjectdependency(c, MORPHO_OBJECT(func));
     
     /* Add the function as a constant */
     kindx=compiler_addconstant(c, node, MORPHO_OBJECT(func), false, false);
@@ -2698,6 +2800,7 @@ static codeinfo compiler_method(compiler *c, syntaxtreenode *node, registerindx
                 if (method) {
                     value symbol = program_internsymbol(c->out, node->content);
                     dictionary_insert(&klass->methods, symbol, MORPHO_OBJECT(method));
+                    CLASS_MODIFIED(klass);
                 }
             }
             break;
@@ -2751,6 +2854,7 @@ static codeinfo compiler_class(compiler *c, syntaxtreenode *node, registerindx r
     codeinfo mout;
     
     objectclass *klass=object_newclass(node->content);
+    compiler_addobjectdependency(c, MORPHO_OBJECT(klass));
     compiler_beginclass(c, klass);
     
     /* Store the object class as a constant */
@@ -2762,6 +2866,7 @@ static codeinfo compiler_class(compiler *c, syntaxtreenode *node, registerindx r
         
         if (snode->type==NODE_SYMBOL) {
             objectclass *superclass=compiler_findclass(c->out->global, snode->content);
+            compiler_addclassdependency(c, snode->content, superclass);
             
             if (superclass) {
                 if (superclass!=klass) {
@@ -2872,7 +2977,7 @@ static codeinfo compiler_symbol(compiler *c, syntaxtreenode *node, registerindx
     }
     
     /* Is it a global variable */
-    ret.dest=compiler_getglobal(c, node->content, true);
+    ret.dest=compiler_resolveglobal(c, node->content);
     if (ret.dest!=REGISTER_UNALLOCATED) {
         ret.returntype=GLOBAL;
         return ret;
@@ -2891,6 +2996,7 @@ static codeinfo compiler_symbol(compiler *c, syntaxtreenode *node, registerindx
     
     /* Is it a class? */
     objectclass *klass = compiler_findclass(compiler_getcurrentfunction(c), node->content);
+    compiler_addclassdependency(c, node->content, klass);
     if (klass) {
         /* It is; so add it to the constant table */
         ret.returntype=CONSTANT;
@@ -2949,7 +3055,7 @@ static codeinfo compiler_assign(compiler *c, syntaxtreenode *node, registerindx
             
             /* .. or a global? */
             if (reg==REGISTER_UNALLOCATED) {
-                reg=compiler_getglobal(c, var, true);
+                reg=compiler_resolveglobal(c, var);
                 if (reg!=REGISTER_UNALLOCATED) {
                     if (indxnode) {
                         /* If an indexed global, move the global into a register */
@@ -3239,12 +3345,12 @@ static codeinfo compiler_import(compiler *c, syntaxtreenode *node, registerindx
             fname=MORPHO_GETCSTRING(module->content);
         }
         
-        compiler *root = c;
-        while (root->parent!=NULL) root=root->parent;
+        compiler *root = compiler_root(c);
         
         if (fname) {
             objectstring chkmodname = MORPHO_STATICSTRING(fname);
             if (dictionary_get(&root->modules, MORPHO_OBJECT(&chkmodname), NULL)) {
+                compiler_addmoduledependency(c, MORPHO_OBJECT(&chkmodname), MORPHO_NIL);
                 goto compiler_import_cleanup;
             }
         }
@@ -3267,24 +3373,44 @@ static codeinfo compiler_import(compiler *c, syntaxtreenode *node, registerindx
             /* Remember the initial position of the code */
             start=c->out->code.count;
             
-            /* Set up the compiler */
-            compiler cc;
-            compiler_init(src.data, c->out, &cc);
-            cc.parent=c; /* Ensures global variables can be found */
-        
-            morpho_compile(src.data, &cc, &c->err);
+            /* Code imported within a function can't be told apart from the function's own code */
+            if (c->fstackp>0) compiler_nocache(c);
             
-            if (ERROR_SUCCEEDED(c->err)) {
-                compiler_stripend(c);
-                compiler_copyglobals(&cc, c, (fordict.count>0 ? &fordict : NULL));
-            } else {
-                c->err.module = MORPHO_GETCSTRING(modname);
-            }
+            value hash=bytecode_hash(src.data);
+            compiler_addmoduledependency(c, modname, hash);
             
-            compiler_clear(&cc);
+            /* Use the cached bytecode for the module if it's fresh */
+            if (!(c->cache && bytecode_load(c, fname, hash, (fordict.count>0 ? &fordict : NULL)))) {
+                /* Set up the compiler */
+                compiler cc;
+                compiler_init(src.data, c->out, &cc);
+                cc.parent=c; /* Ensures global variables can be found */
+                cc.cache=c->cache;
+                
+                /* Note where the module begins */
+                cc.deps.start=start;
+                cc.deps.nkonst=c->out->global->konst.count;
+                cc.deps.nglobals=c->out->nglobals;
+                cc.deps.nannotations=c->out->annotations.count;
+                cc.deps.nprototypes=c->out->global->prototype.count;
+                
+                morpho_compile(src.data, &cc, &c->err);
+                
+                if (ERROR_SUCCEEDED(c->err)) {
+                    compiler_stripend(c);
+                    compiler_addregisterdependency(c, cc.fstack[0].nreg);
+                    if (cc.cache && cc.deps.cacheable) bytecode_save(&cc, fname, hash);
+                    compiler_copyglobals(&cc, c, (fordict.count>0 ? &fordict : NULL));
+                } else {
+                    c->err.module = MORPHO_GETCSTRING(modname);
+                }
+                
+                compiler_clear(&cc);
+            }
             
             end=c->out->code.count;
             
+            morpho_freeobject(hash);
             varray_charclear(&src);
         } else compiler_error(c, module, COMPILE_FILENOTFOUND, fname);
     }
@@ -3334,6 +3460,9 @@ void compiler_init(const char *source, program *out, compiler *c) {
     c->currentclass = NULL;
     c->currentmethod = NULL;
     c->parent = NULL;
+    c->optimize = true;
+    c->cache = true;
+    compiler_depsinit(&c->deps);
 }
 
 /** @brief Clear attached data structures from a compiler
@@ -3345,6 +3474,7 @@ void compiler_clear(compiler *c) {
     dictionary_clear(&c->globals);
     dictionary_freecontents(&c->modules, true, false);
     dictionary_clear(&c->modules);
+    compiler_depsclear(&c->deps);
 }
 
 /* **********************************************************************
@@ -3387,6 +3517,8 @@ bool morpho_compile(char *in, compiler *c, error *err) {
         compiler_tobytecode(c, out);
         if (ERROR_SUCCEEDED(c->err)) {
             compiler_setfunctionregistercount(c);
+            /* Imported modules are optimized along with the code that imports them */
+            if (c->optimize && !c->parent) optimize_program(out, last);
             program_setentry(out, last);
             success=true;
         } else {
@@ -3418,6 +3550,16 @@ void morpho_freecompiler(compiler *c) {
     MORPHO_FREE(c);
 }
 
+/** Activates or deactivates optimization of compiled code */
+void morpho_setoptimize(compiler *c, bool optimize) {
+    c->optimize=optimize;
+}
+
+/** Activates or deactivates the bytecode cache for imported modules */
+void morpho_setcache(compiler *c, bool cache) {
+    c->cache=cache;
+}
+
 /* **********************************************************************
 * Initialization/Finalization
 * ********************************************************************** */
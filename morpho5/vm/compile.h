@@ -199,6 +199,29 @@ typedef struct scompilerlist {
     struct scompilerlist *next;
 } compilerlist;
 
+/* -------------------------------------------------------
+ * Module dependencies
+ * ------------------------------------------------------- */
+
+/** @brief Records where a module was compiled to and what it found outside itself while it was compiled.
+ *  @details The bytecode cache uses this to check that a cached module would compile identically
+ *  where it is next imported. Lookups are recorded by every module between the one that made them and
+ *  the one where the symbol was found, since a module's code includes that of any module it imports. */
+typedef struct {
+    bool cacheable; /** Cleared if the module does something the bytecode cache can't reproduce */
+    instructionindx start; /** First instruction of the module */
+    unsigned int nkonst; /** Size of the global constant table before the module */
+    unsigned int nglobals; /** Number of globals before the module */
+    unsigned int nannotations; /** Number of debug annotations before the module */
+    unsigned int nprototypes; /** Number of closure prototypes of the global function before the module */
+    unsigned int nreg; /** Registers used by the global code of modules imported by the module */
+    varray_value objects; /** Functions, classes and dictionaries created by the module, in order of creation */
+    dictionary globals; /** Globals found outside the module, with their index */
+    dictionary unbound; /** Symbols that weren't found as globals */
+    dictionary classes; /** Classes found by name */
+    dictionary modules; /** Modules imported, with the hash of their source or nil if they had already been imported */
+} compilerdeps;
+
 /* -------------------------------------------------------
  * Overall state of the compiler
  * ------------------------------------------------------- */
@@ -236,6 +259,15 @@ typedef struct scompiler {
     
     /* The parent compiler */
     struct scompiler *parent;
+    
+    /* Whether to optimize the compiled code */
+    bool optimize;
+    
+    /* Whether to use the bytecode cache for imported modules */
+    bool cache;
+    
+    /* What the module being compiled depends on */
+    compilerdeps deps;
 } compiler;
 
 /* -------------------------------------------------------
@@ -254,4 +286,17 @@ typedef struct {
 void compiler_init(const char *source, program *out, compiler *c);
 void compiler_clear(compiler *c);
 
+/* -------------------------------------------------------
+ * Interface for the bytecode cache
+ * ------------------------------------------------------- */
+
+compiler *compiler_root(compiler *c);
+globalindx compiler_findglobal(compiler *c, value symbol);
+globalindx compiler_resolveglobal(compiler *c, value symbol);
+objectclass *compiler_findclass(objectfunction *f, value name);
+void compiler_addclassdependency(compiler *c, value name, objectclass *klass);
+void compiler_addmoduledependency(compiler *c, value name, value hash);
+void compiler_addobjectdependency(compiler *c, value obj);
+void compiler_addregisterdependency(compiler *c, unsigned int nreg);
+
 #endif /* compile_h */
@@ -69,6 +69,9 @@ typedef unsigned int instruction;
 /** Encodes an instruction with no operands */
 #define ENCODE_BYTE(op) ((((unsigned) op) & 0xff) << 26)
 
+/** Replaces the opcode of an instruction, keeping its operands */
+#define ENCODE_SETOP(x, op) ( ((x) & 0x3ffffff) | ((((unsigned) op) & 0xff) << 26) )
+
 /** Encodes an empty operand */
 #define ENCODE_EMPTYOPERAND 0
 
@@ -180,6 +183,40 @@ typedef struct {
 
 DECLARE_VARRAY(debugannotation, debugannotation)
 
+/* **********************************************************************
+ * Inline caches
+ * ********************************************************************** */
+
+/** @brief Inline cache for method dispatch, property access and arithmetic
+ *  @details Programs keep one entry beside each instruction. INVOKE records the class of the
+ *  receiver together with the method it found, so that the method dictionary is only searched
+ *  again when a different class is encountered or the class has gained methods since. LPR and
+ *  SPR record the shape of the receiver and the slot that holds the property; SPR additionally
+ *  records the shape reached when the store adds the property. ADD, SUB, MUL and DIV count how
+ *  often they see the same operand types before specialising, and stay generic once a
+ *  specialised form has had to deoptimize. */
+typedef struct {
+    union {
+        struct {
+            objectclass *klass; /** Class of the receiver, or NULL if the entry is empty */
+            unsigned int version; /** Version of the class when the entry was filled */
+            value method; /** The method found */
+        } invoke;
+        struct {
+            objectshape *shape; /** Shape of the receiver, or NULL if the entry is empty */
+            unsigned int slot; /** Slot that holds the property */
+            objectshape *next; /** Shape after the property is added, or NULL if shape already holds it */
+        } property;
+        struct {
+            unsigned int opcode; /** Specialised instruction the operands seen most recently suit */
+            unsigned int count; /** Number of consecutive executions the operands have suited it */
+            bool deoptimized; /** Set once a specialised form has deoptimized, so the instruction stays generic */
+        } arith;
+    } content;
+} inlinecache;
+
+DECLARE_VARRAY(inlinecache, inlinecache)
+
 /* **********************************************************************
  * Programs
  * ********************************************************************** */
@@ -187,6 +224,7 @@ DECLARE_VARRAY(debugannotation, debugannotation)
 /** @brief Morpho code program and associated data */
 struct sprogram {
     varray_instruction code; /** Compiled instructions */
+    varray_inlinecache icache; /** Inline caches, one per instruction */
     varray_debugannotation annotations; /** Information about how the code connects to the source */
     objectfunction *global;  /** Pseudofunction containing global data */
     unsigned int nglobals;
@@ -218,6 +256,7 @@ struct svm {
     errorhandler errorhandlers[MORPHO_ERRORHANDLERSTACKSIZE]; /** Error handler stack */
     
     instruction *instructions; /* Base of instructions */
+    inlinecache *icache; /* Base of inline caches, parallel to the instructions */
     value *konst; /* Current constant table */
     callframe *fp; /* Frame pointer saved on exit */
     errorhandler *ehp; /* Error handler pointer */
@@ -225,10 +264,32 @@ struct svm {
     error err; /** An error struct that will be filled out when an error occurs */
     callframe *errfp; /** Record frame pointer when an error occured */
     
-    object *objects; /** Linked list of objects */
+    object *objects; /** Linked list of objects that have survived a collection */
+    object *young; /** Linked list of objects bound since the last collection */
     graylist gray; /** Graylist for garbage collection */
+    graylist remembered; /** Old objects that may refer to young objects */
     size_t bound; /** Estimated size of bound bytes */
-    size_t nextgc; /** Next garbage collection threshold */
+    size_t youngbound; /** Estimated size of young objects */
+    size_t nextgc; /** Next full garbage collection threshold, for the size of old objects */
+    size_t nextyoung; /** Next minor garbage collection threshold */
+    enum {
+        VM_MARKALL, /* Mark every reachable object */
+        VM_MARKYOUNG, /* Mark only young objects, during a minor collection */
+        VM_MARKOLD /* Mark only old objects, during a slice of an incremental collection */
+    } marking; /** Which objects the collector is currently marking */
+    enum {
+        VM_GCIDLE, /* No incremental collection is in progress */
+        VM_GCMARKING, /* Marking in slices */
+        VM_GCSWEEPING /* Sweeping in slices */
+    } gcstate; /** Phase of the incremental collection */
+    graylist minorgray; /** Graylist used by minor collections that interrupt incremental marking */
+    object *sweep; /** Old objects that an incremental collection has yet to sweep */
+    size_t sweepbound; /** Estimated size of the old objects when sweeping began */
+    size_t swept; /** Size of objects found to be live by sweeping so far */
+    size_t gcpause; /** Pause target, as the bytes of heap to mark or sweep per slice; zero disables incremental collection */
+    size_t gcdebt; /** Bytes bound since the last slice */
+    size_t nextslice; /** Debt at which the next slice runs */
+    unsigned int nbuiltin; /** Number of builtin functions currently executing */
     
     bool debug; /** Is the debugger active or not */
     
@@ -108,6 +108,25 @@ OPCODE(PRINT)
 /** Raise error */
 //OPCODE(RAISE)
 
+/** Compare with LT and branch forward if the comparison fails */
+OPCODE(LTBIF)
+
+/** Compare with LE and branch forward if the comparison fails */
+OPCODE(LEBIF)
+
+/** Increment a register and branch back */
+OPCODE(INCB)
+
+/** Arithmetic specialised for integer or float operands
+ *  The generic instructions rewrite themselves into these once they repeatedly see matching operand types, and these rewrite themselves back, for good, on a mismatch. */
+OPCODE(ADDII)
+OPCODE(ADDFF)
+OPCODE(SUBII)
+OPCODE(SUBFF)
+OPCODE(MULII)
+OPCODE(MULFF)
+OPCODE(DIVFF)
+
 /** Breakpoint */
 OPCODE(BREAK)
 
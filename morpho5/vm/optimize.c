@@ -0,0 +1,1076 @@
+/** @file optimize.c
+ *  @author T J Atherton
+ *
+ *  @brief Optimizer for compiled bytecode
+ *  @details The optimizer works on the code produced by a call to morpho_compile. Instructions are assigned to the function they belong to and divided into basic blocks. A forward dataflow pass tracks registers known to hold a constant or a copy of another register, and drives constant folding and propagation and copy propagation; a backward liveness pass drives dead store elimination and register coalescing. Branches to branches are threaded. Deleted instructions are removed at the end of each pass, and branches, function entry points, error handlers and debugging annotations are updated to match.
+ *
+ *  Functions that contain error handlers are left untouched, because errors may transfer control to the handler from any instruction. Registers captured by closures are never optimized, because they may change during any call.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "optimize.h"
+#include "debug.h"
+
+/* **********************************************************************
+ * Register sets
+ * ********************************************************************** */
+
+#define OPTIMIZE_NREGISTERS (MORPHO_MAXREGISTERS+1)
+
+/** A set of registers */
+typedef struct {
+    uint64_t bits[OPTIMIZE_NREGISTERS/64];
+} optregset;
+
+static inline void optregset_clear(optregset *s) {
+    memset(s->bits, 0, sizeof(s->bits));
+}
+
+static inline void optregset_add(optregset *s, unsigned int r) {
+    s->bits[r>>6] |= ((uint64_t) 1)<<(r & 63);
+}
+
+static inline void optregset_addrange(optregset *s, unsigned int r1, unsigned int r2) {
+    for (unsigned int r=r1; r<=r2 && r<OPTIMIZE_NREGISTERS; r++) optregset_add(s, r);
+}
+
+static inline void optregset_remove(optregset *s, unsigned int r) {
+    s->bits[r>>6] &= ~(((uint64_t) 1)<<(r & 63));
+}
+
+static inline bool optregset_contains(optregset *s, unsigned int r) {
+    return s->bits[r>>6] & (((uint64_t) 1)<<(r & 63));
+}
+
+/** Adds the contents of src to dest, returning true if dest changed */
+static inline bool optregset_union(optregset *dest, optregset *src) {
+    bool changed=false;
+    for (unsigned int i=0; i<OPTIMIZE_NREGISTERS/64; i++) {
+        uint64_t new = dest->bits[i] | src->bits[i];
+        if (new!=dest->bits[i]) { dest->bits[i]=new; changed=true; }
+    }
+    return changed;
+}
+
+/* **********************************************************************
+ * Optimizer data structures
+ * ********************************************************************** */
+
+/** A function whose code is being optimized */
+typedef struct {
+    objectfunction *func;
+    bool skip; /** Set if the function's code should be left untouched */
+    unsigned int nregs; /** Number of registers referred to by the code */
+    optregset pinned; /** Registers captured by closures */
+} optfunction;
+
+DECLARE_VARRAY(optfunction, optfunction)
+DEFINE_VARRAY(optfunction, optfunction)
+
+/** A basic block */
+typedef struct {
+    instructionindx start; /** First instruction */
+    instructionindx end; /** One past the last instruction */
+    int func; /** Function the block belongs to */
+    bool reachable; /** Set once the block is found to be reachable */
+    int *facts; /** Facts known to hold on entry to the block */
+    optregset livein; /** Registers live on entry */
+    optregset liveout; /** Registers live on exit */
+} optblock;
+
+DECLARE_VARRAY(optblock, optblock)
+DEFINE_VARRAY(optblock, optblock)
+
+/** State of the optimizer */
+typedef struct {
+    program *prog;
+    instructionindx start; /** First instruction to optimize */
+    instructionindx end; /** One past the last instruction to optimize */
+    varray_optfunction funcs; /** Functions that own the code */
+    varray_optblock blocks; /** Basic blocks */
+    varray_value handlers; /** Error handler dictionaries */
+    int *owner; /** Function owning each instruction */
+    int *block; /** Block containing each instruction */
+    bool *leader; /** Whether each instruction begins a block */
+} optimizer;
+
+#define OPTIMIZE_INDX(opt, i) ((i)-(opt)->start)
+
+/* -------------------------------------------------------
+ * Facts about registers
+ * ------------------------------------------------------- */
+
+/** Facts record what is known about the contents of a register:
+ *  OPTIMIZE_UNKNOWN - nothing is known
+ *  k >= 0 - the register holds constant k
+ *  OPTIMIZE_COPY(r) - the register holds the same value as register r */
+#define OPTIMIZE_UNKNOWN -1
+#define OPTIMIZE_COPYBASE MORPHO_MAXCONSTANTS
+#define OPTIMIZE_COPY(r) (OPTIMIZE_COPYBASE+(int) (r))
+
+#define OPTIMIZE_ISCONSTANT(f) ((f)>=0 && (f)<OPTIMIZE_COPYBASE)
+#define OPTIMIZE_ISCOPY(f) ((f)>=OPTIMIZE_COPYBASE)
+#define OPTIMIZE_COPYREGISTER(f) ((unsigned int) ((f)-OPTIMIZE_COPYBASE))
+
+/* **********************************************************************
+ * Instruction properties
+ * ********************************************************************** */
+
+/** Does an instruction branch? */
+static inline bool optimize_isbranch(instruction instr) {
+    unsigned int op=DECODE_OP(instr);
+    return (op==OP_B || op==OP_BIF || op==OP_POPERR ||
+            op==OP_LTBIF || op==OP_LEBIF || op==OP_INCB);
+}
+
+/** Does an instruction end a function or the program? */
+static inline bool optimize_isterminator(instruction instr) {
+    unsigned int op=DECODE_OP(instr);
+    return (op==OP_RETURN || op==OP_END);
+}
+
+/** Can control pass from an instruction to the next one? */
+static inline bool optimize_fallsthrough(instruction instr) {
+    unsigned int op=DECODE_OP(instr);
+    return !(op==OP_B || op==OP_INCB || op==OP_RETURN || op==OP_END);
+}
+
+/** Destination of a branch instruction at index i */
+static inline instructionindx optimize_branchtarget(instruction instr, instructionindx i) {
+    switch (DECODE_OP(instr)) {
+        case OP_LTBIF: case OP_LEBIF: return i+1+DECODE_A(instr); /* Forward offset in A */
+        case OP_INCB: return i+1-DECODE_B(instr); /* Backward offset in B */
+        default: return i+1+DECODE_sBx(instr);
+    }
+}
+
+/** Replaces the offset of a branch instruction */
+static inline instruction optimize_setbranchoffset(instruction instr, int offset) {
+    switch (DECODE_OP(instr)) {
+        case OP_LTBIF: case OP_LEBIF: return (instr & ~(((instruction) 0xff)<<18)) | ((((unsigned) offset) & 0xff)<<18);
+        case OP_INCB: return (instr & ~(((instruction) 0xff)<<9)) | ((((unsigned) -offset) & 0xff)<<9);
+        default: return (instr & ~((instruction) 0xffff)) | (((unsigned) offset) & 0xffff);
+    }
+}
+
+/** Registers read by an instruction */
+static void optimize_uses(instruction instr, unsigned int nregs, optregset *use) {
+    unsigned int a=DECODE_A(instr), b=DECODE_B(instr), c=DECODE_C(instr);
+    
+    optregset_clear(use);
+    switch (DECODE_OP(instr)) {
+        case OP_MOV:
+            optregset_add(use, b);
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_EQ: case OP_NEQ: case OP_LT: case OP_LE:
+        case OP_LTBIF: case OP_LEBIF:
+            if (!DECODE_ISBCONSTANT(instr)) optregset_add(use, b);
+            if (!DECODE_ISCCONSTANT(instr)) optregset_add(use, c);
+            break;
+        case OP_INCB:
+            optregset_add(use, a);
+            if (!DECODE_ISCCONSTANT(instr)) optregset_add(use, c);
+            break;
+        case OP_NOT: case OP_PRINT: case OP_SUP:
+            if (!DECODE_ISBCONSTANT(instr)) optregset_add(use, b);
+            break;
+        case OP_BIF: case OP_SGL: case OP_CLOSURE:
+            optregset_add(use, a);
+            break;
+        case OP_CALL:
+            optregset_addrange(use, a, a+b);
+            break;
+        case OP_INVOKE:
+            optregset_add(use, 0); /* Invoking a method on a class reads self */
+            if (!DECODE_ISBCONSTANT(instr)) optregset_add(use, b);
+            optregset_addrange(use, a, a+c);
+            break;
+        case OP_RETURN:
+            if (a>0 && !DECODE_ISBCONSTANT(instr)) optregset_add(use, b);
+            break;
+        case OP_LPR:
+            optregset_add(use, 0); /* Looking up a method on a class reads self */
+            if (!DECODE_ISBCONSTANT(instr)) optregset_add(use, b);
+            if (!DECODE_ISCCONSTANT(instr)) optregset_add(use, c);
+            break;
+        case OP_SPR:
+            optregset_add(use, a);
+            if (!DECODE_ISBCONSTANT(instr)) optregset_add(use, b);
+            if (!DECODE_ISCCONSTANT(instr)) optregset_add(use, c);
+            break;
+        case OP_LIX: case OP_SIX:
+            optregset_add(use, a);
+            optregset_addrange(use, b, c);
+            break;
+        case OP_CAT:
+            optregset_addrange(use, b, c);
+            break;
+        case OP_CLOSEUP:
+            if (nregs>0) optregset_addrange(use, a, nregs-1);
+            break;
+        case OP_BREAK: case OP_END:
+            if (nregs>0) optregset_addrange(use, 0, nregs-1);
+            break;
+        default:
+            break;
+    }
+}
+
+/** Finds the register an instruction is certain to overwrite
+ * @param[in] instr - the instruction
+ * @param[out] r - the register written
+ * @returns true if the instruction writes a register */
+static bool optimize_defines(instruction instr, unsigned int *r) {
+    switch (DECODE_OP(instr)) {
+        case OP_MOV: case OP_LCT:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_NOT: case OP_EQ: case OP_NEQ: case OP_LT: case OP_LE:
+        case OP_CALL: case OP_INVOKE: case OP_CLOSURE: case OP_LUP:
+        case OP_LPR: case OP_LGL: case OP_CAT: case OP_INCB:
+            *r=DECODE_A(instr);
+            return true;
+        case OP_LIX:
+            *r=DECODE_B(instr);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Can an instruction be removed if the register it writes is not subsequently read? */
+static bool optimize_ispure(instruction instr) {
+    switch (DECODE_OP(instr)) {
+        case OP_MOV: case OP_LCT: case OP_LGL: case OP_LUP: case OP_NOT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Can the destination of an instruction be replaced by another register? */
+static bool optimize_isretargetable(instruction instr) {
+    switch (DECODE_OP(instr)) {
+        case OP_MOV: case OP_LCT:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_NOT: case OP_EQ: case OP_NEQ: case OP_LT: case OP_LE:
+        case OP_LUP: case OP_LPR: case OP_LGL: case OP_CAT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Replaces the A operand of an instruction */
+static inline instruction optimize_seta(instruction instr, unsigned int a) {
+    return (instr & ~(((instruction) 0xff)<<18)) | ((a & 0xff)<<18);
+}
+
+/** Replaces the B operand of an instruction, setting or clearing the constant flag */
+static inline instruction optimize_setb(instruction instr, bool constant, unsigned int b) {
+    return (instr & ~(((instruction) 0x1ff)<<9)) | ((constant ? 1 : 0)<<17) | ((b & 0xff)<<9);
+}
+
+/** Replaces the C operand of an instruction, setting or clearing the constant flag */
+static inline instruction optimize_setc(instruction instr, bool constant, unsigned int c) {
+    return (instr & ~((instruction) 0x1ff)) | ((constant ? 1 : 0)<<8) | (c & 0xff);
+}
+
+/* **********************************************************************
+ * Finding functions
+ * ********************************************************************** */
+
+/** Finds or adds a function to the optimizer's list */
+static int optimize_addfunction(optimizer *opt, objectfunction *func) {
+    for (unsigned int i=0; i<opt->funcs.count; i++) {
+        if (opt->funcs.data[i].func==func) return i;
+    }
+    
+    optfunction f = { .func = func, .skip = false, .nregs = (unsigned int) func->nregs };
+    optregset_clear(&f.pinned);
+    return varray_optfunctionwrite(&opt->funcs, f);
+}
+
+/** Uses the debugging annotations to identify the function that owns each instruction
+ * @returns true if the annotations cover the code being optimized */
+static bool optimize_findfunctions(optimizer *opt) {
+    program *p = opt->prog;
+    objectfunction *func = p->global;
+    instructionindx i=0;
+    int current=-1;
+    
+    for (unsigned int j=0; j<p->annotations.count; j++) {
+        debugannotation *ann = &p->annotations.data[j];
+        switch (ann->type) {
+            case DEBUG_ELEMENT:
+                for (unsigned int k=0; k<ann->content.element.ninstr; k++, i++) {
+                    if (i<opt->start || i>=opt->end) continue;
+                    if (current<0) current=optimize_addfunction(opt, func);
+                    opt->owner[OPTIMIZE_INDX(opt, i)]=current;
+                }
+                break;
+            case DEBUG_FUNCTION:
+                func=ann->content.function.function;
+                current=-1;
+                break;
+            case DEBUG_PUSHERR:
+                if (i>=opt->start) varray_valuewrite(&opt->handlers, MORPHO_OBJECT(ann->content.errorhandler.handler));
+                break;
+            default:
+                break;
+        }
+    }
+    
+    return (i==opt->end);
+}
+
+/** Checks whether each function's code is safe to optimize, and finds pinned registers */
+static void optimize_checkfunctions(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    
+    for (instructionindx i=opt->start; i<opt->end; i++) {
+        instruction instr = code[i];
+        int owner = opt->owner[OPTIMIZE_INDX(opt, i)];
+        optfunction *f = &opt->funcs.data[owner];
+        unsigned int op = DECODE_OP(instr);
+    
+        /* Errors may transfer control to a handler from any instruction */
+        if (op==OP_PUSHERR || op==OP_POPERR) f->skip=true;
+    
+        /* Registers captured by closures may change during any call */
+        if (op==OP_CLOSURE) {
+            unsigned int b = DECODE_B(instr);
+            if (b<f->func->prototype.count) {
+                varray_upvalue *up = &f->func->prototype.data[b];
+                for (unsigned int k=0; k<up->count; k++) {
+                    if (up->data[k].islocal) optregset_add(&f->pinned, (unsigned int) up->data[k].reg);
+                }
+            } else f->skip=true;
+        }
+    
+        /* Control must stay within the function */
+        if (optimize_isbranch(instr)) {
+            instructionindx t = optimize_branchtarget(instr, i);
+            if (t<opt->start || t>=opt->end || opt->owner[OPTIMIZE_INDX(opt, t)]!=owner) f->skip=true;
+        }
+    
+        if (optimize_fallsthrough(instr) &&
+            (i+1>=opt->end || opt->owner[OPTIMIZE_INDX(opt, i+1)]!=owner)) f->skip=true;
+    
+        /* Find the number of registers referred to */
+        optregset use;
+        unsigned int r;
+        optimize_uses(instr, f->nregs, &use);
+        if (optimize_defines(instr, &r)) optregset_add(&use, r);
+        for (unsigned int k=OPTIMIZE_NREGISTERS; k>f->nregs; k--) {
+            if (optregset_contains(&use, k-1)) { f->nregs=k; break; }
+        }
+    }
+}
+
+/** Is an instruction in a function that may be optimized? */
+static inline bool optimize_canoptimize(optimizer *opt, instructionindx i) {
+    return !opt->funcs.data[opt->owner[OPTIMIZE_INDX(opt, i)]].skip;
+}
+
+/* **********************************************************************
+ * Basic blocks
+ * ********************************************************************** */
+
+/** Marks an instruction as the start of a block */
+static inline void optimize_setleader(optimizer *opt, instructionindx i) {
+    if (i>=opt->start && i<opt->end) opt->leader[OPTIMIZE_INDX(opt, i)]=true;
+}
+
+/** Is an instruction an entry point, i.e. reachable other than by a branch or fallthrough? */
+static bool optimize_isentry(optimizer *opt, instructionindx i) {
+    if (i==opt->start) return true;
+    for (unsigned int k=0; k<opt->funcs.count; k++) {
+        if (opt->funcs.data[k].func->entry==i) return true;
+    }
+    return false;
+}
+
+/** Clears the list of blocks */
+static void optimize_clearblocks(optimizer *opt) {
+    for (unsigned int k=0; k<opt->blocks.count; k++) MORPHO_FREE(opt->blocks.data[k].facts);
+    opt->blocks.count=0;
+}
+
+/** Divides the code into basic blocks */
+static bool optimize_buildblocks(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    
+    optimize_clearblocks(opt);
+    memset(opt->leader, 0, sizeof(bool)*(opt->end-opt->start));
+    
+    for (instructionindx i=opt->start; i<opt->end; i++) {
+        if (i==opt->start || opt->owner[OPTIMIZE_INDX(opt, i)]!=opt->owner[OPTIMIZE_INDX(opt, i-1)] ||
+            optimize_isentry(opt, i)) optimize_setleader(opt, i);
+    
+        if (optimize_isbranch(code[i])) optimize_setleader(opt, optimize_branchtarget(code[i], i));
+        if (optimize_isbranch(code[i]) || optimize_isterminator(code[i])) optimize_setleader(opt, i+1);
+    }
+    
+    /* Error handlers are entry points too */
+    for (unsigned int k=0; k<opt->handlers.count; k++) {
+        dictionary *dict = &MORPHO_GETDICTIONARY(opt->handlers.data[k])->dict;
+        for (unsigned int j=0; j<dict->capacity; j++) {
+            value target = dict->contents[j].val;
+            if (!MORPHO_ISNIL(dict->contents[j].key) && MORPHO_ISINTEGER(target)) {
+                optimize_setleader(opt, (instructionindx) MORPHO_GETINTEGERVALUE(target));
+            }
+        }
+    }
+    
+    for (instructionindx i=opt->start; i<opt->end; i++) {
+        if (opt->leader[OPTIMIZE_INDX(opt, i)]) {
+            optblock blk = { .start = i, .end = i+1, .func = opt->owner[OPTIMIZE_INDX(opt, i)], .reachable = false, .facts = NULL };
+            optregset_clear(&blk.livein);
+            optregset_clear(&blk.liveout);
+            if (varray_optblockwrite(&opt->blocks, blk)<0) return false;
+        } else opt->blocks.data[opt->blocks.count-1].end=i+1;
+    
+        opt->block[OPTIMIZE_INDX(opt, i)]=opt->blocks.count-1;
+    }
+    
+    return true;
+}
+
+/** Finds the successors of a block
+ * @param[in] opt - the optimizer
+ * @param[in] blk - the block
+ * @param[out] succ - indices of successor blocks
+ * @returns the number of successors */
+static int optimize_successors(optimizer *opt, optblock *blk, int *succ) {
+    instruction last = opt->prog->code.data[blk->end-1];
+    int n=0;
+    
+    if (optimize_isbranch(last)) {
+        succ[n++]=opt->block[OPTIMIZE_INDX(opt, optimize_branchtarget(last, blk->end-1))];
+    }
+    
+    if (optimize_fallsthrough(last) && blk->end<opt->end) {
+        int next=opt->block[OPTIMIZE_INDX(opt, blk->end)];
+        if (n==0 || succ[0]!=next) succ[n++]=next;
+    }
+    
+    return n;
+}
+
+/* **********************************************************************
+ * Constant and copy propagation
+ * ********************************************************************** */
+
+/** Forgets everything known about a register, including copies of it */
+static void optimize_kill(optfunction *f, int *facts, unsigned int r) {
+    if (r>=f->nregs) return;
+    facts[r]=OPTIMIZE_UNKNOWN;
+    for (unsigned int k=0; k<f->nregs; k++) {
+        if (facts[k]==OPTIMIZE_COPY(r)) facts[k]=OPTIMIZE_UNKNOWN;
+    }
+}
+
+/** Updates facts to reflect the effect of an instruction */
+static void optimize_transfer(optfunction *f, instruction instr, int *facts) {
+    unsigned int op = DECODE_OP(instr), r;
+    
+    switch (op) {
+        case OP_CALL: case OP_INVOKE: /* The callee's frame overlaps registers from A upwards */
+            for (unsigned int k=DECODE_A(instr); k<f->nregs; k++) optimize_kill(f, facts, k);
+            return;
+        case OP_BREAK: /* The debugger may change any register */
+            for (unsigned int k=0; k<f->nregs; k++) facts[k]=OPTIMIZE_UNKNOWN;
+            return;
+        default:
+            break;
+    }
+    
+    if (!optimize_defines(instr, &r) || r>=f->nregs) return;
+    
+    int fact=OPTIMIZE_UNKNOWN;
+    if (op==OP_LCT) {
+        fact=DECODE_Bx(instr);
+    } else if (op==OP_MOV) {
+        unsigned int b=DECODE_B(instr);
+        if (b<f->nregs && !optregset_contains(&f->pinned, b)) {
+            fact=facts[b];
+            if (fact==OPTIMIZE_UNKNOWN) fact=OPTIMIZE_COPY(b);
+            if (fact==OPTIMIZE_COPY(r)) return; /* The register already holds this value */
+        }
+    }
+    
+    optimize_kill(f, facts, r);
+    if (!optregset_contains(&f->pinned, r)) facts[r]=fact;
+}
+
+/** Merges facts from a predecessor into those for a block
+ * @returns true if the facts for the block changed */
+static bool optimize_meet(optimizer *opt, optblock *blk, int *facts) {
+    optfunction *f = &opt->funcs.data[blk->func];
+    
+    if (!blk->reachable) {
+        memcpy(blk->facts, facts, sizeof(int)*f->nregs);
+        blk->reachable=true;
+        return true;
+    }
+    
+    bool changed=false;
+    for (unsigned int k=0; k<f->nregs; k++) {
+        if (blk->facts[k]!=facts[k] && blk->facts[k]!=OPTIMIZE_UNKNOWN) {
+            blk->facts[k]=OPTIMIZE_UNKNOWN;
+            changed=true;
+        }
+    }
+    return changed;
+}
+
+/** Finds the facts that hold on entry to each block */
+static bool optimize_propagate(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    int facts[OPTIMIZE_NREGISTERS];
+    int succ[2];
+    
+    for (unsigned int k=0; k<opt->blocks.count; k++) {
+        optblock *blk = &opt->blocks.data[k];
+        optfunction *f = &opt->funcs.data[blk->func];
+    
+        blk->facts=MORPHO_MALLOC(sizeof(int)*(f->nregs+1));
+        if (!blk->facts) return false;
+    
+        if (optimize_isentry(opt, blk->start)) {
+            for (unsigned int r=0; r<f->nregs; r++) blk->facts[r]=OPTIMIZE_UNKNOWN;
+            blk->reachable=true;
+        }
+    }
+    
+    bool changed;
+    do {
+        changed=false;
+        for (unsigned int k=0; k<opt->blocks.count; k++) {
+            optblock *blk = &opt->blocks.data[k];
+            optfunction *f = &opt->funcs.data[blk->func];
+            if (f->skip || !blk->reachable) continue;
+    
+            memcpy(facts, blk->facts, sizeof(int)*f->nregs);
+            for (instructionindx i=blk->start; i<blk->end; i++) optimize_transfer(f, code[i], facts);
+    
+            int n=optimize_successors(opt, blk, succ);
+            for (int j=0; j<n; j++) {
+                if (optimize_meet(opt, &opt->blocks.data[succ[j]], facts)) changed=true;
+            }
+        }
+    } while (changed);
+    
+    return true;
+}
+
+/** Finds or adds a constant to a function's constant table */
+static bool optimize_addconstant(objectfunction *func, value val, unsigned int *k) {
+    if (varray_valuefindsame(&func->konst, val, k)) return true;
+    if (func->konst.count>=MORPHO_MAXCONSTANTS) return false;
+    
+    int indx=varray_valuewrite(&func->konst, val);
+    if (indx<0) return false;
+    *k=(unsigned int) indx;
+    return true;
+}
+
+/** Evaluates an instruction with constant operands, following the rules used by the VM
+ * @param[in] op - the opcode
+ * @param[in] left - left operand
+ * @param[in] right - right operand, if any
+ * @param[out] out - the result
+ * @returns true if the instruction could be evaluated */
+static bool optimize_evaluate(unsigned int op, value left, value right, value *out) {
+    if (op==OP_NOT) {
+        if (MORPHO_ISOBJECT(left)) return false;
+        *out = (MORPHO_ISBOOL(left) ? MORPHO_BOOL(!MORPHO_GETBOOLVALUE(left)) : MORPHO_BOOL(MORPHO_ISNIL(left)));
+        return true;
+    }
+    
+    if (!MORPHO_ISNUMBER(left) || !MORPHO_ISNUMBER(right)) return false;
+    
+    if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+        int l=MORPHO_GETINTEGERVALUE(left), r=MORPHO_GETINTEGERVALUE(right);
+        switch (op) {
+            case OP_ADD: *out=MORPHO_INTEGER((int) ((unsigned) l + (unsigned) r)); return true;
+            case OP_SUB: *out=MORPHO_INTEGER((int) ((unsigned) l - (unsigned) r)); return true;
+            case OP_MUL: *out=MORPHO_INTEGER((int) ((unsigned) l * (unsigned) r)); return true;
+            case OP_DIV: *out=MORPHO_FLOAT((double) l / (double) r); return true;
+            default: break;
+        }
+    } else {
+        double l, r;
+        morpho_valuetofloat(left, &l);
+        morpho_valuetofloat(right, &r);
+        switch (op) {
+            case OP_ADD: *out=MORPHO_FLOAT(l + r); return true;
+            case OP_SUB: *out=MORPHO_FLOAT(l - r); return true;
+            case OP_MUL: *out=MORPHO_FLOAT(l * r); return true;
+            case OP_DIV: *out=MORPHO_FLOAT(l / r); return true;
+            default: break;
+        }
+    }
+    
+    MORPHO_CMPPROMOTETYPE(left, right);
+    int cmp=morpho_comparevalue(left, right);
+    switch (op) {
+        case OP_EQ: *out=MORPHO_BOOL(cmp==0); return true;
+        case OP_NEQ: *out=MORPHO_BOOL(cmp!=0); return true;
+        case OP_LT: *out=MORPHO_BOOL(cmp>0); return true;
+        case OP_LE: *out=MORPHO_BOOL(cmp>=0); return true;
+        default: break;
+    }
+    
+    return false;
+}
+
+/** Replaces a register operand with a constant or register known to hold the same value
+ * @param[in] f - the function
+ * @param[in] facts - current facts
+ * @param[in] allowconstant - whether the operand may be a constant
+ * @param[in,out] r - the operand
+ * @param[out] constant - set if the operand became a constant
+ * @returns true if the operand was replaced */
+static bool optimize_substitute(optfunction *f, int *facts, bool allowconstant, unsigned int *r, bool *constant) {
+    if (*r>=f->nregs) return false;
+    int fact=facts[*r];
+    
+    if (allowconstant && OPTIMIZE_ISCONSTANT(fact) && fact<=0xff) {
+        *r=(unsigned int) fact;
+        *constant=true;
+        return true;
+    } else if (OPTIMIZE_ISCOPY(fact)) {
+        *r=OPTIMIZE_COPYREGISTER(fact);
+        *constant=false;
+        return true;
+    }
+    return false;
+}
+
+/** Rewrites an instruction using the facts that hold before it */
+static instruction optimize_rewrite(optfunction *f, int *facts, instruction instr) {
+    unsigned int op=DECODE_OP(instr);
+    unsigned int a=DECODE_A(instr), b=DECODE_B(instr), c=DECODE_C(instr);
+    bool bconst=DECODE_ISBCONSTANT(instr), cconst=DECODE_ISCCONSTANT(instr);
+    
+    switch (op) {
+        case OP_MOV:
+            if (b<f->nregs && OPTIMIZE_ISCONSTANT(facts[b])) return ENCODE_LONG(OP_LCT, a, facts[b]);
+            if (optimize_substitute(f, facts, false, &b, &bconst)) instr=optimize_setb(instr, false, b);
+            if (a==b) return ENCODE_BYTE(OP_NOP);
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_EQ: case OP_NEQ: case OP_LT: case OP_LE:
+            if (!bconst && optimize_substitute(f, facts, true, &b, &bconst)) instr=optimize_setb(instr, bconst, b);
+            if (!cconst && optimize_substitute(f, facts, true, &c, &cconst)) instr=optimize_setc(instr, cconst, c);
+            if (bconst && cconst) {
+                value result;
+                unsigned int k;
+                if (optimize_evaluate(op, f->func->konst.data[b], f->func->konst.data[c], &result) &&
+                    optimize_addconstant(f->func, result, &k)) return ENCODE_LONG(OP_LCT, a, k);
+            }
+            break;
+        case OP_NOT:
+            if (!bconst && optimize_substitute(f, facts, true, &b, &bconst)) instr=optimize_setb(instr, bconst, b);
+            if (bconst) {
+                value result;
+                unsigned int k;
+                if (optimize_evaluate(op, f->func->konst.data[b], MORPHO_NIL, &result) &&
+                    optimize_addconstant(f->func, result, &k)) return ENCODE_LONG(OP_LCT, a, k);
+            }
+            break;
+        case OP_PRINT: case OP_SUP:
+            if (!bconst && optimize_substitute(f, facts, true, &b, &bconst)) instr=optimize_setb(instr, bconst, b);
+            break;
+        case OP_RETURN:
+            if (a>0 && !bconst && optimize_substitute(f, facts, true, &b, &bconst)) instr=optimize_setb(instr, bconst, b);
+            break;
+        case OP_SPR:
+            if (optimize_substitute(f, facts, false, &a, &bconst)) instr=optimize_seta(instr, a);
+            if (!cconst && optimize_substitute(f, facts, true, &c, &cconst)) instr=optimize_setc(instr, cconst, c);
+            break;
+        case OP_LPR:
+            if (!bconst && optimize_substitute(f, facts, false, &b, &bconst)) instr=optimize_setb(instr, false, b);
+            break;
+        case OP_SGL:
+            if (optimize_substitute(f, facts, false, &a, &bconst)) instr=optimize_seta(instr, a);
+            break;
+        case OP_BIF:
+            if (a<f->nregs && OPTIMIZE_ISCONSTANT(facts[a])) {
+                /* The condition is known, so the branch is either always or never taken */
+                value cond=f->func->konst.data[facts[a]];
+                if ((MORPHO_ISTRUE(cond) ? true : false) == DECODE_F(instr)) return ENCODE_LONG(OP_B, 0, DECODE_Bx(instr));
+                return ENCODE_BYTE(OP_NOP);
+            }
+            if (optimize_substitute(f, facts, false, &a, &bconst)) instr=optimize_seta(instr, a);
+            break;
+        default:
+            break;
+    }
+    
+    return instr;
+}
+
+/** Performs constant folding, constant propagation and copy propagation
+ * @returns true if the code changed */
+static bool optimize_constants(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    int facts[OPTIMIZE_NREGISTERS];
+    bool changed=false;
+    
+    for (unsigned int k=0; k<opt->blocks.count; k++) {
+        optblock *blk = &opt->blocks.data[k];
+        optfunction *f = &opt->funcs.data[blk->func];
+        if (f->skip || !blk->reachable) continue;
+    
+        memcpy(facts, blk->facts, sizeof(int)*f->nregs);
+        for (instructionindx i=blk->start; i<blk->end; i++) {
+            instruction new=optimize_rewrite(f, facts, code[i]);
+            if (new!=code[i]) { code[i]=new; changed=true; }
+            optimize_transfer(f, code[i], facts);
+        }
+    }
+    
+    return changed;
+}
+
+/** Removes blocks that can never be reached
+ * @returns true if the code changed */
+static bool optimize_unreachable(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    bool changed=false;
+    
+    for (unsigned int k=0; k<opt->blocks.count; k++) {
+        optblock *blk = &opt->blocks.data[k];
+        if (opt->funcs.data[blk->func].skip || blk->reachable) continue;
+    
+        for (instructionindx i=blk->start; i<blk->end; i++) {
+            if (DECODE_OP(code[i])==OP_END) continue;
+            if (DECODE_OP(code[i])!=OP_NOP) changed=true;
+            code[i]=ENCODE_BYTE(OP_NOP);
+        }
+    }
+    
+    return changed;
+}
+
+/* **********************************************************************
+ * Dead store elimination and register coalescing
+ * ********************************************************************** */
+
+/** Updates a set of live registers to reflect the state before an instruction */
+static void optimize_liveness(optfunction *f, instruction instr, optregset *live) {
+    optregset use;
+    unsigned int r;
+    
+    if (optimize_defines(instr, &r)) optregset_remove(live, r);
+    optimize_uses(instr, f->nregs, &use);
+    optregset_union(live, &use);
+}
+
+/** Finds the registers live on entry to and exit from each block */
+static void optimize_findlive(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    int succ[2];
+    bool changed;
+    
+    do {
+        changed=false;
+        for (int k=opt->blocks.count-1; k>=0; k--) {
+            optblock *blk = &opt->blocks.data[k];
+            optfunction *f = &opt->funcs.data[blk->func];
+            if (f->skip) continue;
+    
+            int n=optimize_successors(opt, blk, succ);
+            for (int j=0; j<n; j++) optregset_union(&blk->liveout, &opt->blocks.data[succ[j]].livein);
+    
+            optregset live = blk->liveout;
+            for (instructionindx i=blk->end; i>blk->start; i--) optimize_liveness(f, code[i-1], &live);
+    
+            if (optregset_union(&blk->livein, &live)) changed=true;
+        }
+    } while (changed);
+}
+
+/** Is a register free to be removed or renamed? */
+static inline bool optimize_isfree(optfunction *f, optregset *live, unsigned int r) {
+    return r<f->nregs && !optregset_contains(live, r) && !optregset_contains(&f->pinned, r);
+}
+
+/** Removes instructions whose results are never used, and merges moves with the instruction that computed the value moved
+ * @returns true if the code changed */
+static bool optimize_deadstores(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    bool changed=false;
+    
+    optimize_findlive(opt);
+    
+    for (unsigned int k=0; k<opt->blocks.count; k++) {
+        optblock *blk = &opt->blocks.data[k];
+        optfunction *f = &opt->funcs.data[blk->func];
+        if (f->skip || !blk->reachable) continue;
+    
+        optregset live = blk->liveout;
+        for (instructionindx i=blk->end; i>blk->start; i--) {
+            instruction instr = code[i-1];
+            unsigned int r;
+    
+            /* Remove stores to registers that are never read */
+            if (optimize_ispure(instr) && optimize_defines(instr, &r) && optimize_isfree(f, &live, r)) {
+                code[i-1]=ENCODE_BYTE(OP_NOP); changed=true;
+                continue;
+            }
+    
+            /* Coalesce: op rT, ... followed by mov rX, rT where rT is not used again becomes op rX, ... */
+            if (DECODE_OP(instr)==OP_MOV && i-1>blk->start) {
+                unsigned int a=DECODE_A(instr), b=DECODE_B(instr);
+                instruction prev = code[i-2];
+                if (a!=b && a<f->nregs && !optregset_contains(&f->pinned, a) &&
+                    optimize_isfree(f, &live, b) &&
+                    optimize_isretargetable(prev) && optimize_defines(prev, &r) && r==b) {
+                    code[i-2]=optimize_seta(prev, a);
+                    code[i-1]=ENCODE_BYTE(OP_NOP); changed=true;
+                    continue;
+                }
+            }
+    
+            /* A global loaded into the register that was just stored to or loaded from it */
+            if (DECODE_OP(instr)==OP_LGL && i-1>blk->start) {
+                instruction prev = code[i-2];
+                if ((DECODE_OP(prev)==OP_SGL || DECODE_OP(prev)==OP_LGL) &&
+                    DECODE_A(prev)==DECODE_A(instr) && DECODE_Bx(prev)==DECODE_Bx(instr)) {
+                    code[i-1]=ENCODE_BYTE(OP_NOP); changed=true;
+                    continue;
+                }
+            }
+    
+            optimize_liveness(f, instr, &live);
+        }
+    }
+    
+    return changed;
+}
+
+/* **********************************************************************
+ * Jump threading
+ * ********************************************************************** */
+
+#define OPTIMIZE_MAXTHREAD 16
+
+/** Redirects branches whose destination is an unconditional branch or return
+ * @returns true if the code changed */
+static bool optimize_threadjumps(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    bool changed=false;
+    
+    for (instructionindx i=opt->start; i<opt->end; i++) {
+        instruction instr = code[i];
+        unsigned int op = DECODE_OP(instr);
+        if ((op!=OP_B && op!=OP_BIF) || !optimize_canoptimize(opt, i)) continue;
+    
+        instructionindx t = optimize_branchtarget(instr, i);
+        for (int n=0; n<OPTIMIZE_MAXTHREAD && t!=i && DECODE_OP(code[t])==OP_B; n++) {
+            t=optimize_branchtarget(code[t], t);
+        }
+    
+        instruction new;
+        if (t==i+1) {
+            new=ENCODE_BYTE(OP_NOP); /* Branch to the next instruction */
+        } else if (op==OP_B && DECODE_OP(code[t])==OP_RETURN) {
+            new=code[t];
+        } else {
+            new=optimize_setbranchoffset(instr, (int) (t-i-1));
+        }
+    
+        if (new!=instr) { code[i]=new; changed=true; }
+    }
+    
+    return changed;
+}
+
+/* **********************************************************************
+ * Instruction fusion
+ * ********************************************************************** */
+
+/** Fuses common instruction pairs into superinstructions:
+ *  lt/le rT, X, Y; bif f rT -> ltbif/lebif X, Y   provided rT is dead afterwards
+ *  add rA, rA, X; b -n      -> incb rA, X         at the foot of a loop
+ * @returns true if the code changed */
+static bool optimize_fuse(optimizer *opt) {
+    instruction *code = opt->prog->code.data;
+    bool changed=false;
+    
+    for (unsigned int k=0; k<opt->blocks.count; k++) {
+        optblock *blk = &opt->blocks.data[k];
+        optfunction *f = &opt->funcs.data[blk->func];
+        if (f->skip || blk->end-blk->start<2) continue;
+    
+        instructionindx i = blk->end-2;
+        instruction first = code[i], last = code[i+1];
+        unsigned int op = DECODE_OP(first);
+        int offset = DECODE_sBx(last);
+    
+        if ((op==OP_LT || op==OP_LE) && DECODE_OP(last)==OP_BIF && !DECODE_F(last) &&
+            DECODE_A(last)==DECODE_A(first) && offset>=0 && offset<255 &&
+            optimize_isfree(f, &blk->liveout, DECODE_A(first))) {
+            /* The fused instruction sits one before the bif, so its offset is one larger */
+            code[i]=ENCODEC((op==OP_LT ? OP_LTBIF : OP_LEBIF), (offset+1), (DECODE_ISBCONSTANT(first) ? 1 : 0), DECODE_B(first), (DECODE_ISCCONSTANT(first) ? 1 : 0), DECODE_C(first));
+        } else if (op==OP_ADD && DECODE_OP(last)==OP_B &&
+                   !DECODE_ISBCONSTANT(first) && DECODE_B(first)==DECODE_A(first) &&
+                   offset<-1 && offset>=-256) {
+            code[i]=ENCODEC(OP_INCB, DECODE_A(first), 0, (-(offset+1)), (DECODE_ISCCONSTANT(first) ? 1 : 0), DECODE_C(first));
+        } else continue;
+    
+        code[i+1]=ENCODE_BYTE(OP_NOP);
+        changed=true;
+    }
+    
+    return changed;
+}
+
+/* **********************************************************************
+ * Removing deleted instructions
+ * ********************************************************************** */
+
+/** Removes NOP instructions from functions being optimized, fixing branches, entry points, error handlers and annotations to match */
+static void optimize_compact(optimizer *opt) {
+    program *p = opt->prog;
+    instruction *code = p->code.data;
+    instructionindx n = opt->end-opt->start;
+    
+    instructionindx *map = MORPHO_MALLOC(sizeof(instructionindx)*(n+1));
+    if (!map) return;
+    
+    /* Deleted instructions map onto the next instruction that survives */
+    instructionindx k=opt->start;
+    for (instructionindx i=opt->start; i<opt->end; i++) {
+        map[OPTIMIZE_INDX(opt, i)]=k;
+        if (!(DECODE_OP(code[i])==OP_NOP && optimize_canoptimize(opt, i))) k++;
+    }
+    map[n]=k;
+    
+    if (k==opt->end) { MORPHO_FREE(map); return; }
+    
+    /* Fix branches and move instructions */
+    for (instructionindx i=opt->start; i<opt->end; i++) {
+        instructionindx dest = map[OPTIMIZE_INDX(opt, i)];
+        if (map[OPTIMIZE_INDX(opt, i+1)]==dest) continue; /* Deleted */
+    
+        instruction instr = code[i];
+        if (optimize_isbranch(instr)) {
+            instructionindx t = optimize_branchtarget(instr, i);
+            instr=optimize_setbranchoffset(instr, (int) (map[OPTIMIZE_INDX(opt, t)]-dest-1));
+        }
+        code[dest]=instr;
+        opt->owner[OPTIMIZE_INDX(opt, dest)]=opt->owner[OPTIMIZE_INDX(opt, i)];
+    }
+    
+    /* Fix debugging annotations */
+    instructionindx i=0;
+    for (unsigned int j=0; j<p->annotations.count; j++) {
+        debugannotation *ann = &p->annotations.data[j];
+        if (ann->type!=DEBUG_ELEMENT) continue;
+    
+        int ninstr=ann->content.element.ninstr;
+        for (int m=0; m<ninstr; m++, i++) {
+            if (i<opt->start) continue;
+            if (map[OPTIMIZE_INDX(opt, i)]==map[OPTIMIZE_INDX(opt, i+1)]) ann->content.element.ninstr--;
+        }
+    }
+    
+    /* Fix function entry points */
+    for (unsigned int j=0; j<opt->funcs.count; j++) {
+        objectfunction *func = opt->funcs.data[j].func;
+        if (func->entry>=opt->start && func->entry<=opt->end) func->entry=map[OPTIMIZE_INDX(opt, func->entry)];
+    }
+    
+    /* Fix error handlers */
+    for (unsigned int j=0; j<opt->handlers.count; j++) {
+        dictionary *dict = &MORPHO_GETDICTIONARY(opt->handlers.data[j])->dict;
+        for (unsigned int m=0; m<dict->capacity; m++) {
+            value target = dict->contents[m].val;
+            if (MORPHO_ISNIL(dict->contents[m].key) || !MORPHO_ISINTEGER(target)) continue;
+            instructionindx t = (instructionindx) MORPHO_GETINTEGERVALUE(target);
+            if (t>=opt->start && t<=opt->end) dict->contents[m].val=MORPHO_INTEGER((int) map[OPTIMIZE_INDX(opt, t)]);
+        }
+    }
+    
+    /* Instructions after the optimized region move down */
+    instructionindx shift = opt->end-k;
+    for (instructionindx i=opt->end; i<p->code.count; i++) code[i-shift]=code[i];
+    p->code.count-=shift;
+    opt->end=k;
+    
+    MORPHO_FREE(map);
+}
+
+/* **********************************************************************
+ * Interface
+ * ********************************************************************** */
+
+/** Initializes an optimizer */
+static bool optimize_init(optimizer *opt, program *p, instructionindx start) {
+    opt->prog=p;
+    opt->start=start;
+    opt->end=p->code.count;
+    varray_optfunctioninit(&opt->funcs);
+    varray_optblockinit(&opt->blocks);
+    varray_valueinit(&opt->handlers);
+    
+    instructionindx n = opt->end-opt->start;
+    opt->owner=MORPHO_MALLOC(sizeof(int)*(n+1));
+    opt->block=MORPHO_MALLOC(sizeof(int)*(n+1));
+    opt->leader=MORPHO_MALLOC(sizeof(bool)*(n+1));
+    
+    return (opt->owner && opt->block && opt->leader);
+}
+
+/** Frees data attached to an optimizer */
+static void optimize_clear(optimizer *opt) {
+    optimize_clearblocks(opt);
+    varray_optfunctionclear(&opt->funcs);
+    varray_optblockclear(&opt->blocks);
+    varray_valueclear(&opt->handlers);
+    if (opt->owner) MORPHO_FREE(opt->owner);
+    if (opt->block) MORPHO_FREE(opt->block);
+    if (opt->leader) MORPHO_FREE(opt->leader);
+}
+
+/** Optimizes newly compiled code
+ * @param[in] p - the program
+ * @param[in] start - first instruction of the new code; earlier code is left untouched */
+void optimize_program(program *p, instructionindx start) {
+    optimizer opt;
+    
+    if (start>=p->code.count) return;
+    
+    if (optimize_init(&opt, p, start) &&
+        optimize_findfunctions(&opt)) {
+        optimize_checkfunctions(&opt);
+    
+        for (int pass=0; pass<MORPHO_OPTIMIZERPASSES; pass++) {
+            bool changed=optimize_threadjumps(&opt);
+    
+            if (!optimize_buildblocks(&opt) ||
+                !optimize_propagate(&opt)) break;
+    
+            changed |= optimize_constants(&opt);
+            changed |= optimize_deadstores(&opt);
+            changed |= optimize_unreachable(&opt);
+    
+            optimize_compact(&opt);
+            if (!changed) break;
+        }
+    
+        if (optimize_buildblocks(&opt)) {
+            optimize_findlive(&opt);
+            if (optimize_fuse(&opt)) optimize_compact(&opt);
+        }
+    }
+    
+    optimize_clear(&opt);
+}
@@ -0,0 +1,20 @@
+/** @file optimize.h
+ *  @author T J Atherton
+ *
+ *  @brief Optimizer for compiled bytecode
+ */
+
+#ifndef optimize_h
+#define optimize_h
+
+#define MORPHO_CORE
+
+#include "core.h"
+
+/* **********************************************************************
+ * Prototypes
+ * ********************************************************************** */
+
+void optimize_program(program *p, instructionindx start);
+
+#endif /* optimize_h */
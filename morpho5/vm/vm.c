@@ -36,10 +36,12 @@ value cloneselector = MORPHO_NIL;
 * ********************************************************************** */
 
 DEFINE_VARRAY(instruction, instruction);
+DEFINE_VARRAY(inlinecache, inlinecache);
 
 /** @brief Initializes a program */
 static void vm_programinit(program *p) {
     varray_instructioninit(&p->code);
+    varray_inlinecacheinit(&p->icache);
     varray_debugannotationinit(&p->annotations);
     p->global=object_newfunction(MORPHO_PROGRAMSTART, MORPHO_NIL, NULL, 0);
     p->boundlist=NULL;
@@ -52,6 +54,7 @@ static void vm_programinit(program *p) {
 static void vm_programclear(program *p) {
     if (p->global) object_free((object *) p->global);
     varray_instructionclear(&p->code);
+    varray_inlinecacheclear(&p->icache);
     debug_clear(&p->annotations);
     p->global=NULL;
     /* Free any objects bound to the program */
@@ -96,6 +99,19 @@ instructionindx program_getentry(program *p) {
     return out;
 }
 
+/** @brief Provides a program with one inline cache entry per instruction
+ *  @details All entries are emptied if the code has changed since the caches were created. */
+static bool vm_programinitcaches(program *p) {
+    if (p->icache.count==p->code.count) return true;
+    
+    p->icache.count=0;
+    if (!varray_inlinecacheresize(&p->icache, p->code.count)) return false;
+    memset(p->icache.data, 0, sizeof(inlinecache)*p->code.count);
+    p->icache.count=p->code.count;
+    
+    return true;
+}
+
 /** @brief Binds an object to a program
  *  @details Objects bound to the program are freed with the program; use for static data (e.g. held in constant tables) */
 void program_bindobject(program *p, object *obj) {
@@ -172,14 +188,29 @@ static void vm_init(vm *v) {
     globalvm=v;
     v->current=NULL;
     v->instructions=NULL;
+    v->icache=NULL;
     v->objects=NULL;
+    v->young=NULL;
     v->openupvalues=NULL;
     v->fp=NULL;
     v->ehp=NULL;
     v->bound=0;
+    v->youngbound=0;
     v->nextgc=MORPHO_GCINITIAL;
+    v->nextyoung=MORPHO_GCNURSERYSIZE;
+    v->marking=VM_MARKALL;
+    v->gcstate=VM_GCIDLE;
+    v->sweep=NULL;
+    v->sweepbound=0;
+    v->swept=0;
+    v->gcpause=MORPHO_GCPAUSETARGET;
+    v->gcdebt=0;
+    v->nextslice=SIZE_MAX;
+    v->nbuiltin=0;
     v->debug=false;
     vm_graylistinit(&v->gray);
+    vm_graylistinit(&v->minorgray);
+    vm_graylistinit(&v->remembered);
     varray_valueinit(&v->stack);
     varray_valueinit(&v->globals);
     varray_valueresize(&v->stack, MORPHO_STACKINITIALSIZE);
@@ -192,6 +223,8 @@ static void vm_clear(vm *v) {
     varray_valueclear(&v->stack);
     varray_valueclear(&v->globals);
     vm_graylistclear(&v->gray);
+    vm_graylistclear(&v->minorgray);
+    vm_graylistclear(&v->remembered);
     vm_freeobjects(v);
 }
 
@@ -207,6 +240,16 @@ void vm_freeobjects(vm *v) {
         object_free(e);
         k++;
     }
+    for (object *e=v->young; e!=NULL; e=next) {
+        next = e->next;
+        object_free(e);
+        k++;
+    }
+    for (object *e=v->sweep; e!=NULL; e=next) {
+        next = e->next;
+        object_free(e);
+        k++;
+    }
 
 #ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
     printf("--- Freed %li objects bound to VM ---\n", k);
@@ -218,6 +261,24 @@ dictionary sizecheck;
 #endif
 
 #include "object.h"
+
+/** Checks whether enough has been bound since the last collection to warrant another */
+static inline bool vm_gcneeded(vm *v) {
+    /* Minor collections are deferred while builtins execute, as survivors can't then be promoted */
+    size_t nursery = (v->nbuiltin ? v->nextyoung*MORPHO_GCGROWTHFACTOR : v->nextyoung);
+    return (v->bound>v->youngbound+v->nextgc || v->youngbound>nursery || v->gcdebt>v->nextslice);
+}
+
+/** Collects the old generation if it has outgrown its threshold, runs a slice of an incremental collection if one is due, or runs a minor collection otherwise */
+static void vm_gccollect(vm *v) {
+    if (v->bound>v->youngbound+v->nextgc) {
+        /* Large old generations are collected incrementally to bound the pause */
+        if (v->gcstate==VM_GCIDLE && v->gcpause && v->bound-v->youngbound>v->gcpause) vm_collectincremental(v);
+        else vm_collectgarbage(v); /* Also completes an incremental collection that has fallen behind */
+    } else if (v->gcdebt>v->nextslice) vm_collectincremental(v);
+    else vm_collectyoung(v);
+}
+
 /** @brief Binds an object to a Virtual Machine.
  *  @details Any object created during execution should be bound to a VM; this object is then managed by the garbage collector.
  *  @param v      the virtual machine
@@ -225,19 +286,22 @@ dictionary sizecheck;
 static void vm_bindobject(vm *v, value obj) {
     object *ob = MORPHO_GETOBJECT(obj);
     ob->status=OBJECT_ISUNMARKED;
-    ob->next=v->objects;
-    v->objects=ob;
+    ob->generation=OBJECT_ISYOUNG;
+    ob->next=v->young;
+    v->young=ob;
     size_t size=object_size(ob);
 #ifdef MORPHO_DEBUG_GCSIZETRACKING
     dictionary_insert(&sizecheck, obj, MORPHO_INTEGER(size));
 #endif
 
     v->bound+=size;
+    v->youngbound+=size;
+    v->gcdebt+=size;
 
 #ifdef MORPHO_DEBUG_STRESSGARBAGECOLLECTOR
     vm_collectgarbage(v);
 #else
-    if (v->bound>v->nextgc) vm_collectgarbage(v);
+    if (vm_gcneeded(v)) vm_gccollect(v);
 #endif
 }
 
@@ -245,18 +309,59 @@ static void vm_bindobject(vm *v, value obj) {
  * Garbage collector
  * ********************************************************************** */
 
-/** Recalculates the size of bound objects to the VM */
-size_t vm_gcrecalculatesize(vm *v) {
-    size_t size = 0;
-    for (object *ob=v->objects; ob!=NULL; ob=ob->next) {
-        size+=object_size(ob);
+/* The collector is generational: newly bound objects are young, and live on v->young until
+   they survive a collection, when they're promoted to v->objects. Minor collections trace
+   only young objects, treating old objects as live; references from old objects to young
+   ones are found through the remembered set, which the VM adds to when storing values in
+   objects. Builtin functions store values without this write barrier, so old objects passed
+   to them are remembered too, and objects aren't promoted while a builtin is executing in case
+   it goes on to write to them.
+
+   Once the old generation is larger than the pause target, it is collected incrementally using
+   tri-colour marking: marked objects on the gray list are gray, other marked objects are black.
+   Marking and sweeping proceed in slices of at most v->gcpause bytes, run as objects are bound.
+   Slices mark only old objects; while marking is in progress, the write barrier grays old objects
+   stored in marked ones, objects promoted by minor collections are grayed, and remembered objects
+   are retraced at the end since builtins may have written to them. Marking ends by marking the
+   roots again, which aren't covered by the barrier, together with the young generation. */
+
+void vm_gcmarkobject(vm *v, object *obj);
+
+/** Adds an old object to the remembered set */
+static void vm_gcremember(vm *v, object *obj) {
+    obj->generation=OBJECT_ISREMEMBERED;
+    vm_graylistadd(&v->remembered, obj);
+}
+
+/** Write barrier, called when the VM stores a value in an object */
+static inline void vm_gcwritebarrier(vm *v, object *obj, value val) {
+    if (!MORPHO_ISOBJECT(val)) return;
+    object *ref = MORPHO_GETOBJECT(val);
+    if (ref->generation==OBJECT_ISYOUNG) {
+        if (obj->generation==OBJECT_ISOLD) vm_gcremember(v, obj);
+    } else if (v->gcstate==VM_GCMARKING && obj->status==OBJECT_ISMARKED) {
+        vm_gcmarkobject(v, ref); /* Black objects mustn't refer to white ones */
     }
-    return size;
+}
+
+/** Empties the remembered set
+ * @param[in] v - the virtual machine
+ * @param[in] keepmarked - retain objects that have been marked, for use during a full or incremental collection */
+static void vm_gcforget(vm *v, bool keepmarked) {
+    unsigned int n=0;
+    for (unsigned int i=0; i<v->remembered.graycount; i++) {
+        object *obj = v->remembered.list[i];
+        if (keepmarked && obj->status==OBJECT_ISMARKED) v->remembered.list[n++]=obj;
+        else obj->generation=OBJECT_ISOLD;
+    }
+    v->remembered.graycount=n;
 }
 
 /** Marks an object as reachable */
 void vm_gcmarkobject(vm *v, object *obj) {
     if (!obj || obj->status!=OBJECT_ISUNMARKED) return;
+    if (v->marking==VM_MARKYOUNG && obj->generation!=OBJECT_ISYOUNG) return; /* Old objects are assumed live */
+    if (v->marking==VM_MARKOLD && obj->generation==OBJECT_ISYOUNG) return; /* Young objects are left to minor collections */
 
 #ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
         printf("Marking %p ", obj);
@@ -379,30 +484,37 @@ void vm_gctrace(vm *v) {
     }
 }
 
-/** Go through the VM's object list and free all unmarked objects */
-void vm_gcsweep(vm *v) {
+/** Frees an object found to be unreachable */
+static void vm_gcfreeobject(vm *v, object *unreached) {
+#ifdef MORPHO_DEBUG_GCSIZETRACKING
+    size_t size=object_size(unreached);
+    value xsize;
+    if (dictionary_get(&sizecheck, MORPHO_OBJECT(unreached), &xsize)) {
+        size_t isize = MORPHO_GETINTEGERVALUE(xsize);
+        if (size!=isize) {
+            morpho_printvalue(MORPHO_OBJECT(unreached));
+            UNREACHABLE("Object doesn't match its declared size");
+        }
+    }
+#else
+    object_free(unreached);
+#endif
+}
+
+/** Go through the VM's list of old objects and free all unmarked objects
+ * @returns the size of the surviving objects */
+size_t vm_gcsweep(vm *v) {
+    size_t survived=0;
     object *prev=NULL;
     object *obj = v->objects;
     while (obj!=NULL) {
         if (obj->status==OBJECT_ISMARKED) {
+            survived+=object_size(obj);
             prev=obj;
             obj->status=OBJECT_ISUNMARKED; /* Clear for the next cycle */
             obj=obj->next;
         } else {
             object *unreached = obj;
-            size_t size=object_size(obj);
-#ifdef MORPHO_DEBUG_GCSIZETRACKING
-            value xsize;
-            if (dictionary_get(&sizecheck, MORPHO_OBJECT(unreached), &xsize)) {
-                size_t isize = MORPHO_GETINTEGERVALUE(xsize);
-                if (size!=isize) {
-                    morpho_printvalue(MORPHO_OBJECT(unreached));
-                    UNREACHABLE("Object doesn't match its declared size");
-                }
-            }
-#endif
-
-            v->bound-=size;
 
             /* Delink */
             obj=obj->next;
@@ -412,11 +524,188 @@ void vm_gcsweep(vm *v) {
                 v->objects=obj;
             }
 
-#ifndef MORPHO_DEBUG_GCSIZETRACKING
-            object_free(unreached);
-#endif
+            vm_gcfreeobject(v, unreached);
         }
     }
+    return survived;
+}
+
+/** Go through the VM's list of young objects, freeing unmarked objects
+ * @param[in] v - the virtual machine
+ * @param[in] promote - whether to move surviving objects to the old generation */
+void vm_gcsweepyoung(vm *v, bool promote) {
+    object *prev=NULL, *next=NULL;
+    size_t old=(v->bound>v->youngbound ? v->bound-v->youngbound : 0);
+    size_t survived=0;
+    
+    for (object *obj = v->young; obj!=NULL; obj=next) {
+        next=obj->next;
+    
+        if (obj->status==OBJECT_ISMARKED) {
+            obj->status=OBJECT_ISUNMARKED; /* Clear for the next cycle */
+            survived+=object_size(obj);
+            if (promote) {
+                obj->generation=OBJECT_ISOLD;
+                if (v->gcstate==VM_GCMARKING) { /* Trace promoted objects as part of the incremental collection */
+                    obj->status=OBJECT_ISMARKED;
+                    vm_graylistadd(&v->gray, obj);
+                }
+                obj->next=v->objects;
+                v->objects=obj;
+            } else {
+                if (prev) prev->next=obj; else v->young=obj;
+                prev=obj;
+            }
+        } else vm_gcfreeobject(v, obj);
+    }
+    
+    if (prev) prev->next=NULL; else v->young=NULL;
+    
+    /* Young objects may have grown since they were bound, so their sizes are remeasured */
+    v->bound=old+survived;
+    v->youngbound=(promote ? 0 : survived);
+}
+
+/** Collects garbage in the young generation only */
+void vm_collectyoung(vm *v) {
+#ifdef MORPHO_DEBUG_DISABLEGARBAGECOLLECTOR
+    return;
+#endif
+#ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
+    size_t init=v->youngbound;
+    printf("--- begin minor garbage collection ---\n");
+#endif
+    bool promote=(v->nbuiltin==0);
+    
+    /* Set aside the gray list of any incremental collection in progress */
+    graylist pending=v->gray;
+    v->gray=v->minorgray;
+    
+    v->marking=VM_MARKYOUNG;
+    vm_gcmarkroots(v);
+    for (unsigned int i=0; i<v->remembered.graycount; i++) {
+        vm_gcmarkretainobject(v, v->remembered.list[i]);
+    }
+    vm_gctrace(v);
+    v->marking=(v->gcstate==VM_GCMARKING ? VM_MARKOLD : VM_MARKALL);
+    
+    v->minorgray=v->gray;
+    v->gray=pending;
+    
+    vm_gcsweepyoung(v, promote);
+    /* Marked objects stay remembered during incremental marking, so they're traced again once it ends */
+    if (promote) vm_gcforget(v, v->gcstate==VM_GCMARKING);
+    
+    v->nextyoung=v->youngbound*MORPHO_GCGROWTHFACTOR;
+    if (v->nextyoung<MORPHO_GCNURSERYSIZE) v->nextyoung=MORPHO_GCNURSERYSIZE;
+    
+#ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
+    printf("--- end minor garbage collection ---\n");
+    printf("    young generation from %zu to %zu bytes.\n", init, v->youngbound);
+#endif
+}
+
+/** Runs a minor collection that was deferred while builtin functions executed; call once their results are stored in registers */
+static inline void vm_gcsafepoint(vm *v) {
+    if (!v->nbuiltin && v->youngbound>v->nextyoung) vm_collectyoung(v);
+}
+
+/** Ends the marking phase of an incremental collection, and sets aside the old generation to be swept */
+static void vm_gcfinishmarking(vm *v) {
+    v->marking=VM_MARKALL;
+    vm_gcmarkroots(v);
+    for (unsigned int i=0; i<v->remembered.graycount; i++) {
+        object *obj = v->remembered.list[i];
+        if (obj->status==OBJECT_ISMARKED) vm_gcmarkretainobject(v, obj);
+    }
+    vm_gctrace(v);
+    
+    bool promote=(v->nbuiltin==0);
+    v->gcstate=VM_GCSWEEPING;
+    vm_gcforget(v, !promote);
+    
+    /* Objects promoted from here on join a fresh list, so they're not swept */
+    v->sweep=v->objects;
+    v->objects=NULL;
+    v->sweepbound=(v->bound>v->youngbound ? v->bound-v->youngbound : 0);
+    v->swept=0;
+    vm_gcsweepyoung(v, promote);
+    
+    v->nextyoung=v->youngbound*MORPHO_GCGROWTHFACTOR;
+    if (v->nextyoung<MORPHO_GCNURSERYSIZE) v->nextyoung=MORPHO_GCNURSERYSIZE;
+}
+
+/** Traces objects on the gray list until the budget is spent, ending the marking phase if none remain
+ * @returns the work done, in bytes */
+static size_t vm_gcmarkslice(vm *v, size_t budget) {
+    size_t work=0;
+    while (v->gray.graycount>0 && work<budget) {
+        object *obj=v->gray.list[v->gray.graycount-1];
+        v->gray.graycount--;
+        vm_gcmarkretainobject(v, obj);
+        work+=object_size(obj);
+    }
+    
+    if (!v->gray.graycount) vm_gcfinishmarking(v);
+    return work;
+}
+
+/** Sweeps old objects until the budget is spent, ending the collection if none remain */
+static void vm_gcsweepslice(vm *v, size_t budget) {
+    size_t work=0;
+    while (v->sweep && work<budget) {
+        object *obj=v->sweep;
+        v->sweep=obj->next;
+        size_t size=object_size(obj);
+        work+=size;
+        
+        if (obj->status==OBJECT_ISMARKED) {
+            obj->status=OBJECT_ISUNMARKED;
+            v->swept+=size;
+            obj->next=v->objects;
+            v->objects=obj;
+        } else vm_gcfreeobject(v, obj);
+    }
+    
+    if (!v->sweep) {
+        /* Replace the estimated size of the swept objects with that of the survivors */
+        size_t old=(v->bound>v->youngbound ? v->bound-v->youngbound : 0);
+        old=(old>v->sweepbound ? old-v->sweepbound : 0)+v->swept;
+        v->bound=old+v->youngbound;
+        v->nextgc=old*MORPHO_GCGROWTHFACTOR;
+        v->gcstate=VM_GCIDLE;
+        v->nextslice=SIZE_MAX;
+    }
+}
+
+/** Starts an incremental collection of the old generation, or runs the next slice of one in progress */
+void vm_collectincremental(vm *v) {
+#ifdef MORPHO_DEBUG_DISABLEGARBAGECOLLECTOR
+    return;
+#endif
+    size_t budget=(v->gcpause ? v->gcpause : SIZE_MAX);
+    
+    if (v->gcstate==VM_GCIDLE) {
+#ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
+        printf("--- begin incremental garbage collection ---\n");
+#endif
+        vm_collectyoung(v); /* Promote survivors so that what they refer to is marked in slices */
+        v->gcstate=VM_GCMARKING;
+        v->marking=VM_MARKOLD;
+        vm_gcmarkroots(v);
+        /* If the collection falls behind, it's completed once the old generation has grown by this much */
+        v->nextgc=(v->bound>v->youngbound ? v->bound-v->youngbound : 0)*MORPHO_GCGROWTHFACTOR;
+    } else {
+        size_t work=0;
+        if (v->gcstate==VM_GCMARKING) work=vm_gcmarkslice(v, budget);
+        if (v->gcstate==VM_GCSWEEPING && work<budget) vm_gcsweepslice(v, budget-work);
+#ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
+        if (v->gcstate==VM_GCIDLE) printf("--- end incremental garbage collection ---\n");
+#endif
+    }
+    
+    v->gcdebt=0;
+    if (v->gcstate!=VM_GCIDLE) v->nextslice=budget/MORPHO_GCSTEPMULTIPLIER;
 }
 
 /** Collects garbage */
@@ -426,27 +715,31 @@ void vm_collectgarbage(vm *v) {
 #endif
     vm *vc = (v!=NULL ? v : globalvm);
     if (!vc) return;
+    
+    /* Complete any incremental collection in progress without interruption */
+    if (vc->gcstate!=VM_GCIDLE) {
+        if (vc->gcstate==VM_GCMARKING) vm_gcmarkslice(vc, SIZE_MAX);
+        if (vc->gcstate==VM_GCSWEEPING) vm_gcsweepslice(vc, SIZE_MAX);
+        return;
+    }
 
     if (vc && vc->bound>0) {
-        size_t init=vc->bound;
 #ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
+        size_t init=vc->bound;
         printf("--- begin garbage collection ---\n");
 #endif
+        bool promote=(vc->nbuiltin==0);
+    
         vm_gcmarkroots(vc);
         vm_gctrace(vc);
-        vm_gcsweep(vc);
-
-        if (vc->bound>init) {
-#ifdef MORPHO_DEBUG_GCSIZETRACKING
-            printf("GC collected %ld bytes (from %zu to %zu) next at %zu.\n", init-vc->bound, init, vc->bound, vc->bound*MORPHO_GCGROWTHFACTOR);
-            UNREACHABLE("VM bound object size < 0");
-#else
-            // This catch has been put in to prevent the garbarge collector from completely seizing up.
-            vc->bound=vm_gcrecalculatesize(v);
-#endif
-        }
+    
+        vm_gcforget(vc, !promote);
+        vc->bound=vm_gcsweep(vc)+vc->youngbound; /* Remeasure old objects, which may have grown */
+        vm_gcsweepyoung(vc, promote);
 
-        vc->nextgc=vc->bound*MORPHO_GCGROWTHFACTOR;
+        vc->nextgc=(vc->bound>vc->youngbound ? vc->bound-vc->youngbound : 0)*MORPHO_GCGROWTHFACTOR;
+        vc->nextyoung=vc->youngbound*MORPHO_GCGROWTHFACTOR;
+        if (vc->nextyoung<MORPHO_GCNURSERYSIZE) vc->nextyoung=MORPHO_GCNURSERYSIZE;
 
 #ifdef MORPHO_DEBUG_LOGGARBAGECOLLECTOR
         printf("--- end garbage collection ---\n");
@@ -546,6 +839,7 @@ static inline void vm_closeupvalues(vm *v, value *reg) {
         objectupvalue *up = v->openupvalues;
 
         up->closed=*up->location; /* Store closed value */
+        vm_gcwritebarrier(v, (object *) up, up->closed);
         up->location=&up->closed; /* Point to closed value */
         v->openupvalues=up->next; /* Delink from openupvalues list */
         up->next=NULL;
@@ -696,6 +990,21 @@ static inline bool vm_call(vm *v, value fn, unsigned int shift, unsigned int nar
     return true;
 }
 
+/** Calls a builtin function
+ * @details Builtin functions store values in the objects they're passed without a write barrier,
+ *          so old objects among the arguments are remembered before the call. */
+static inline value vm_callbuiltin(vm *v, value fn, int nargs, value *args) {
+    for (int i=0; i<=nargs; i++) {
+        if (MORPHO_ISOBJECT(args[i]) && MORPHO_GETOBJECT(args[i])->generation==OBJECT_ISOLD) vm_gcremember(v, MORPHO_GETOBJECT(args[i]));
+    }
+    
+    v->nbuiltin++;
+    value ret = (MORPHO_GETBUILTINFUNCTION(fn)->function) (v, nargs, args);
+    v->nbuiltin--;
+    
+    return ret;
+}
+
 /** Invokes a method on a given object by name */
 static inline bool vm_invoke(vm *v, value obj, value method, int nargs, value *args, value *out) {
     if (MORPHO_ISINSTANCE(obj)) {
@@ -721,7 +1030,8 @@ static inline bool vm_invoke(vm *v, value obj, value method, int nargs, value *a
                     value sargs[nargs+1];
                     sargs[0]=obj;
                     for (unsigned int i=0; i<nargs; i++) sargs[i+1]=args[i];
-                    *out = (MORPHO_GETBUILTINFUNCTION(ifunc)->function) (v, nargs, sargs);
+                    *out = vm_callbuiltin(v, ifunc, nargs, sargs);
+                    vm_gcsafepoint(v);
                     return true;
                 }
             }
@@ -730,6 +1040,116 @@ static inline bool vm_invoke(vm *v, value obj, value method, int nargs, value *a
     return false;
 }
 
+/** Adds two values that aren't both numbers, by concatenating strings or invoking an add method
+ * @param[in] v - the virtual machine
+ * @param[in] pc - program counter, used to report errors
+ * @param[in] left - left operand
+ * @param[in] right - right operand
+ * @param[out] out - the result
+ * @returns true on success, or false if an error was raised */
+static inline bool vm_addobjects(vm *v, instruction *pc, value left, value right, value *out) {
+    if (MORPHO_ISSTRING(left) && MORPHO_ISSTRING(right)) {
+        *out = object_concatenatestring(left, right);
+        if (MORPHO_ISNIL(*out)) {
+            vm_runtimeerror(v, pc-v->instructions, VM_CNCTFLD);
+            return false;
+        }
+        vm_bindobject(v, *out);
+        return true;
+    }
+    
+    if (MORPHO_ISOBJECT(left)) {
+        if (vm_invoke(v, left, addselector, 1, &right, out)) return (v->err.cat==ERROR_NONE);
+    }
+    
+    if (MORPHO_ISOBJECT(right)) {
+        if (vm_invoke(v, right, addrselector, 1, &left, out)) return (v->err.cat==ERROR_NONE);
+    }
+    
+    vm_throwOpError(v, pc-v->instructions, VM_INVLDOP, "Add", left, right);
+    return false;
+}
+
+/** Looks up a method in a class, consulting and refilling an inline cache
+ * @param[in] ic - inline cache for the instruction, or NULL if the selector isn't constant
+ * @param[in] klass - class to search
+ * @param[in] selector - the method label, which must be interned
+ * @param[out] method - the method found
+ * @returns true if the class has the method */
+static inline bool vm_cachedlookup(inlinecache *ic, objectclass *klass, value selector, value *method) {
+    if (!ic) return dictionary_getintern(&klass->methods, selector, method);
+    
+    if (ic->content.invoke.klass==klass && ic->content.invoke.version==klass->version) {
+        *method=ic->content.invoke.method;
+        return true;
+    }
+    
+    if (dictionary_getintern(&klass->methods, selector, method)) {
+        ic->content.invoke.klass=klass;
+        ic->content.invoke.version=klass->version;
+        ic->content.invoke.method=*method;
+        return true;
+    }
+    return false;
+}
+
+/** Loads a property of an instance held in a slot, consulting and refilling an inline cache
+ * @param[in] ic - inline cache for the instruction, or NULL if the property name isn't constant
+ * @param[in] obj - the instance
+ * @param[in] key - property name, which must be interned
+ * @param[out] val - the property
+ * @returns true if the property is held in a slot */
+static inline bool vm_cachedgetproperty(inlinecache *ic, objectinstance *obj, value key, value *val) {
+    unsigned int slot;
+    
+    if (ic && ic->content.property.shape==obj->shape && !ic->content.property.next) {
+        *val=obj->slots[ic->content.property.slot];
+        return true;
+    }
+    
+    if (objectshape_getslot(obj->shape, key, &slot)) {
+        if (ic) {
+            ic->content.property.shape=obj->shape;
+            ic->content.property.slot=slot;
+            ic->content.property.next=NULL;
+        }
+        *val=obj->slots[slot];
+        return true;
+    }
+    return false;
+}
+
+/** Stores a property of an instance, consulting and refilling an inline cache
+ * @param[in] ic - inline cache for the instruction, or NULL if the property name isn't constant
+ * @param[in] obj - the instance
+ * @param[in] key - property name, which must be interned
+ * @param[in] val - value to store
+ * @returns true on success */
+static inline bool vm_cachedsetproperty(inlinecache *ic, objectinstance *obj, value key, value val) {
+    if (ic && ic->content.property.shape==obj->shape) {
+        objectshape *next=ic->content.property.next;
+        if (!next) { // The shape already holds the property
+            obj->slots[ic->content.property.slot]=val;
+            return true;
+        } else if (next->nslots<=obj->capacity && obj->fields.count==0) { // Follow the same transition as last time
+            obj->slots[ic->content.property.slot]=val;
+            obj->shape=next;
+            return true;
+        }
+    }
+    
+    objectshape *shape=obj->shape;
+    if (!objectinstance_setproperty(obj, key, val)) return false;
+    
+    unsigned int slot;
+    if (ic && objectshape_getslot(obj->shape, key, &slot)) {
+        ic->content.property.shape=shape;
+        ic->content.property.slot=slot;
+        ic->content.property.next=(obj->shape!=shape ? obj->shape : NULL);
+    }
+    return true;
+}
+
 /** @brief   Executes a sequence of code
  *  @param   v       The virtual machine to use
  *  @param   rstart  Starting register pointer
@@ -746,6 +1166,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
     int op=OP_NOP, a, b, c; /* Opcode and operands a, b, c */
     instruction bc; /* The current bytecode */
     value left, right;
+    inlinecache *ic; /* Inline cache for the current instruction */
 
 #ifdef MORPHO_DEBUG_PRINT_INSTRUCTIONS
 #define MORPHO_DISASSEMBLE_INSRUCTION(bc,pc,k,r) { printf("  "); debug_disassembleinstruction(bc, pc-1, k, r); printf("\n"); }
@@ -816,6 +1237,14 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
 #define OPERROR(op){vm_throwOpError(v,pc-v->instructions,VM_INVLDOP,op,left,right); goto vm_error; }
 #define ERRORCHK() if (v->err.cat!=ERROR_NONE) goto vm_error;
 
+/* Quickening: generic arithmetic instructions rewrite themselves into a variant specialised for the operand types once they
+   have seen them MORPHO_QUICKENTHRESHOLD times in a row; the variant checks its operands and, on a mismatch, rewrites itself
+   back to the generic instruction, which then stays generic, and reexecutes it. */
+#define QUICKEN(op) { inlinecache *qc=v->icache + (pc - v->instructions - 1); \
+                      if (qc->content.arith.opcode!=op) { qc->content.arith.opcode=op; qc->content.arith.count=0; } \
+                      if (!qc->content.arith.deoptimized && ++qc->content.arith.count>=MORPHO_QUICKENTHRESHOLD) pc[-1]=ENCODE_SETOP(bc, op); }
+#define DEOPTIMIZE(op) { pc--; *pc=ENCODE_SETOP(bc, op); v->icache[pc - v->instructions].content.arith.deoptimized=true; DISPATCH(); }
+
     INTERPRET_LOOP
     {
         CASE_CODE(NOP):
@@ -839,6 +1268,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
             if (MORPHO_ISFLOAT(left)) {
                 if (MORPHO_ISFLOAT(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) + MORPHO_GETFLOATVALUE(right));
+                    QUICKEN(OP_ADDFF);
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) + (double) MORPHO_GETINTEGERVALUE(right));
@@ -850,32 +1280,12 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) + MORPHO_GETINTEGERVALUE(right));
+                    QUICKEN(OP_ADDII);
                     DISPATCH();
                 }
-            } else if (MORPHO_ISSTRING(left) && MORPHO_ISSTRING(right)) {
-                reg[a] = object_concatenatestring(left, right);
-                if (!MORPHO_ISNIL(reg[a])) {
-                    vm_bindobject(v, reg[a]);
-                    DISPATCH();
-                } else {
-                    ERROR(VM_CNCTFLD);
-                }
             }
 
-            if (MORPHO_ISOBJECT(left)) {
-                if (vm_invoke(v, left, addselector, 1, &right, &reg[a])) {
-                    ERRORCHK();
-                    DISPATCH();
-                }
-            }
-
-            if (MORPHO_ISOBJECT(right)) {
-                if (vm_invoke(v, right, addrselector, 1, &left, &reg[a])) {
-                    ERRORCHK();
-                    DISPATCH();
-                }
-            }
-            OPERROR("Add");
+            if (!vm_addobjects(v, pc, left, right, &reg[a])) goto vm_error;
             DISPATCH();
 
         CASE_CODE(SUB):
@@ -886,6 +1296,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
             if (MORPHO_ISFLOAT(left)) {
                 if (MORPHO_ISFLOAT(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) - MORPHO_GETFLOATVALUE(right));
+                    QUICKEN(OP_SUBFF);
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) - (double) MORPHO_GETINTEGERVALUE(right));
@@ -897,6 +1308,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) - MORPHO_GETINTEGERVALUE(right));
+                    QUICKEN(OP_SUBII);
                     DISPATCH();
                 }
             }
@@ -926,6 +1338,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
             if (MORPHO_ISFLOAT(left)) {
                 if (MORPHO_ISFLOAT(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) * MORPHO_GETFLOATVALUE(right));
+                    QUICKEN(OP_MULFF);
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) * (double) MORPHO_GETINTEGERVALUE(right));
@@ -937,6 +1350,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) * MORPHO_GETINTEGERVALUE(right));
+                    QUICKEN(OP_MULII);
                     DISPATCH();
                 }
             }
@@ -966,6 +1380,7 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
             if (MORPHO_ISFLOAT(left)) {
                 if (MORPHO_ISFLOAT(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) / MORPHO_GETFLOATVALUE(right));
+                    QUICKEN(OP_DIVFF);
                     DISPATCH();
                 } else if (MORPHO_ISINTEGER(right)) {
                     reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) / (double) MORPHO_GETINTEGERVALUE(right));
@@ -998,6 +1413,83 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
             OPERROR("Divide");
             DISPATCH();
 
+        CASE_CODE(ADDII):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+                reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) + MORPHO_GETINTEGERVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_ADD);
+
+        CASE_CODE(ADDFF):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISFLOAT(left) && MORPHO_ISFLOAT(right)) {
+                reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) + MORPHO_GETFLOATVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_ADD);
+
+        CASE_CODE(SUBII):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+                reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) - MORPHO_GETINTEGERVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_SUB);
+
+        CASE_CODE(SUBFF):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISFLOAT(left) && MORPHO_ISFLOAT(right)) {
+                reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) - MORPHO_GETFLOATVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_SUB);
+
+        CASE_CODE(MULII):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+                reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) * MORPHO_GETINTEGERVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_MUL);
+
+        CASE_CODE(MULFF):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISFLOAT(left) && MORPHO_ISFLOAT(right)) {
+                reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) * MORPHO_GETFLOATVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_MUL);
+
+        CASE_CODE(DIVFF):
+            a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISFLOAT(left) && MORPHO_ISFLOAT(right)) {
+                reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) / MORPHO_GETFLOATVALUE(right));
+                DISPATCH();
+            }
+            DEOPTIMIZE(OP_DIV);
+
         CASE_CODE(POW):
             a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
             left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
@@ -1110,6 +1602,63 @@ bool morpho_interpret(vm *v, value *rstart, instructionindx istart) {
 
             DISPATCH();
 
+        CASE_CODE(LTBIF):
+            b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+                if (!(MORPHO_GETINTEGERVALUE(left) < MORPHO_GETINTEGERVALUE(right))) pc+=DECODE_A(bc);
+                DISPATCH();
+            }
+
+            if ( !( (MORPHO_ISFLOAT(left) || MORPHO_ISINTEGER(left)) &&
+                   (MORPHO_ISFLOAT(right) || MORPHO_ISINTEGER(right)) ) ) {
+                OPERROR("Compare");
+            }
+
+            MORPHO_CMPPROMOTETYPE(left,right);
+            if (!(morpho_comparevalue(left, right)>0)) pc+=DECODE_A(bc);
+            DISPATCH();
+
+        CASE_CODE(LEBIF):
+            b=DECODE_B(bc); c=DECODE_C(bc);
+            left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+                if (!(MORPHO_GETINTEGERVALUE(left) <= MORPHO_GETINTEGERVALUE(right))) pc+=DECODE_A(bc);
+                DISPATCH();
+            }
+
+            if ( !( (MORPHO_ISFLOAT(left) || MORPHO_ISINTEGER(left)) &&
+                   (MORPHO_ISFLOAT(right) || MORPHO_ISINTEGER(right)) ) ) {
+                OPERROR("Compare");
+            }
+
+            MORPHO_CMPPROMOTETYPE(left,right);
+            if (!(morpho_comparevalue(left, right)>=0)) pc+=DECODE_A(bc);
+            DISPATCH();
+
+        CASE_CODE(INCB):
+            a=DECODE_A(bc); c=DECODE_C(bc);
+            left = reg[a];
+            right = (DECODE_ISCCONSTANT(bc) ? v->konst[c] : reg[c]);
+
+            if (MORPHO_ISINTEGER(left) && MORPHO_ISINTEGER(right)) {
+                reg[a] = MORPHO_INTEGER( MORPHO_GETINTEGERVALUE(left) + MORPHO_GETINTEGERVALUE(right));
+            } else if (MORPHO_ISFLOAT(left) && MORPHO_ISFLOAT(right)) {
+                reg[a] = MORPHO_FLOAT( MORPHO_GETFLOATVALUE(left) + MORPHO_GETFLOATVALUE(right));
+            } else if (MORPHO_ISNUMBER(left) && MORPHO_ISNUMBER(right)) {
+                double l, r;
+                morpho_valuetofloat(left, &l);
+                morpho_valuetofloat(right, &r);
+                reg[a] = MORPHO_FLOAT(l + r);
+            } else if (!vm_addobjects(v, pc, left, right, &reg[a])) goto vm_error;
+
+            pc-=DECODE_B(bc);
+            DISPATCH();
+
         CASE_CODE(CALL):
             a=DECODE_A(bc);
             left=reg[a];
@@ -1130,12 +1679,11 @@ callfunction: // Jump here if an instruction becomes a call
                 /* Save program counter in the old callframe */
                 v->fp->pc=pc;
 
-                objectbuiltinfunction *f = MORPHO_GETBUILTINFUNCTION(left);
-
-                value ret = (f->function) (v, c, reg+a);
+                value ret = vm_callbuiltin(v, left, c, reg+a);
                 ERRORCHK();
                 reg=v->stack.data+v->fp->roffset; /* Ensure register pointer is correct */
                 reg[a]=ret;
+                vm_gcsafepoint(v);
 
             } else if (MORPHO_ISCLASS(left)) {
                 /* A function call on a class instantiates it */
@@ -1152,8 +1700,9 @@ callfunction: // Jump here if an instruction becomes a call
                         if (MORPHO_ISFUNCTION(ifunc)) {
                             if (!vm_call(v, ifunc, a, c, &pc, &reg)) goto vm_error;
                         } else if (MORPHO_ISBUILTINFUNCTION(ifunc)) {
-                            (MORPHO_GETBUILTINFUNCTION(ifunc)->function) (v, c, reg+a);
+                            vm_callbuiltin(v, ifunc, c, reg+a);
                             ERRORCHK();
+                            vm_gcsafepoint(v);
                         }
                     } else {
                         if (c>0) {
@@ -1174,21 +1723,25 @@ callfunction: // Jump here if an instruction becomes a call
             c=DECODE_C(bc);
             left=reg[a];
             right=(DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
+            
+            /* Selectors held in registers may vary between executions, so only constant selectors are cached */
+            ic=(DECODE_ISBCONSTANT(bc) ? v->icache + (pc - v->instructions - 1) : NULL);
 
             if (MORPHO_ISINSTANCE(left)) {
                 objectinstance *instance = MORPHO_GETINSTANCE(left);
                 value ifunc;
 
                 /* Check if we have this method */
-                if (dictionary_getintern(&instance->klass->methods, right, &ifunc)) {
+                if (vm_cachedlookup(ic, instance->klass, right, &ifunc)) {
                     /* If so, call it */
                     if (MORPHO_ISFUNCTION(ifunc)) {
                         if (!vm_call(v, ifunc, a, c, &pc, &reg)) goto vm_error;
                     } else if (MORPHO_ISBUILTINFUNCTION(ifunc)) {
-                        reg[a] = (MORPHO_GETBUILTINFUNCTION(ifunc)->function) (v, c, reg+a);
+                        reg[a] = vm_callbuiltin(v, ifunc, c, reg+a);
                         ERRORCHK();
+                        vm_gcsafepoint(v);
                     }
-                } else if (dictionary_getintern(&instance->fields, right, &left)) {
+                } else if (objectinstance_getproperty(instance, right, &left)) {
                     /* Otherwise, if it's a property, try to call it */
                     if (MORPHO_ISFUNCTION(left) || MORPHO_ISCLOSURE(left) || MORPHO_ISBUILTINFUNCTION(left) || MORPHO_ISINVOCATION(left)) {
                         reg[a]=left; // Make sure the function is in r0
@@ -1205,15 +1758,16 @@ callfunction: // Jump here if an instruction becomes a call
                 objectclass *klass = MORPHO_GETCLASS(left);
                 value ifunc;
 
-                if (dictionary_getintern(&klass->methods, right, &ifunc)) {
+                if (vm_cachedlookup(ic, klass, right, &ifunc)) {
                     /* If we're not in the global context, invoke the method on self which is in r0 */
                     if (v->fp>v->frame) reg[a]=reg[0]; /* Copy self into r[a] and call */
 
                     if (MORPHO_ISFUNCTION(ifunc)) {
                         if (!vm_call(v, ifunc, a, c, &pc, &reg)) goto vm_error;
                     } else if (MORPHO_ISBUILTINFUNCTION(ifunc)) {
-                        reg[a] = (MORPHO_GETBUILTINFUNCTION(ifunc)->function) (v, c, reg+a);
+                        reg[a] = vm_callbuiltin(v, ifunc, c, reg+a);
                         ERRORCHK();
+                        vm_gcsafepoint(v);
                     }
                 } else {
                     /* Otherwise, raise an error */
@@ -1225,10 +1779,11 @@ callfunction: // Jump here if an instruction becomes a call
                 objectclass *klass = object_getveneerclass(MORPHO_GETOBJECTTYPE(left));
                 if (klass) {
                     value ifunc;
-                    if (dictionary_getintern(&klass->methods, right, &ifunc)) {
+                    if (vm_cachedlookup(ic, klass, right, &ifunc)) {
                         if (MORPHO_ISBUILTINFUNCTION(ifunc)) {
-                            reg[a] = (MORPHO_GETBUILTINFUNCTION(ifunc)->function) (v, c, reg+a);
+                            reg[a] = vm_callbuiltin(v, ifunc, c, reg+a);
                             ERRORCHK();
+                            vm_gcsafepoint(v);
                         }
                     } else {
                         char *p = (MORPHO_ISSTRING(right) ? MORPHO_GETCSTRING(right) : "");
@@ -1312,6 +1867,7 @@ callfunction: // Jump here if an instruction becomes a call
             right = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
             if (v->fp->closure && v->fp->closure->upvalues[a]) {
                 *v->fp->closure->upvalues[a]->location=right;
+                vm_gcwritebarrier(v, (object *) v->fp->closure->upvalues[a], right);
             } else {
                 UNREACHABLE("Closure unavailable");
             }
@@ -1342,8 +1898,11 @@ callfunction: // Jump here if an instruction becomes a call
 
             if (MORPHO_ISINSTANCE(left)) {
                 objectinstance *instance = MORPHO_GETINSTANCE(left);
+                ic=(DECODE_ISCCONSTANT(bc) ? v->icache + (pc - v->instructions - 1) : NULL);
+                
                 /* Is there a property with this id? */
-                if (dictionary_getintern(&instance->fields, right, &reg[a])) {
+                if (vm_cachedgetproperty(ic, instance, right, &reg[a])) {
+                } else if (instance->fields.count>0 && dictionary_getintern(&instance->fields, right, &reg[a])) {
                 } else if (dictionary_getintern(&instance->klass->methods, right, &reg[a])) {
                     /* ... or a method? */
                     objectinvocation *bound=object_newinvocation(left, reg[a]);
@@ -1352,7 +1911,7 @@ callfunction: // Jump here if an instruction becomes a call
                         reg[a]=MORPHO_OBJECT(bound);
                         vm_bindobject(v, reg[a]);
                     }
-                } else if (dictionary_get(&instance->fields, right, &reg[a])) {
+                } else if (objectinstance_getpropertybyname(instance, right, &reg[a])) {
                 } else {
                     /* Otherwise, raise an error */
                     char *p = (MORPHO_ISSTRING(right) ? MORPHO_GETCSTRING(right) : "");
@@ -1404,8 +1963,15 @@ callfunction: // Jump here if an instruction becomes a call
 
             if (MORPHO_ISINSTANCE(left)) {
                 objectinstance *instance = MORPHO_GETINSTANCE(left);
-                left = (DECODE_ISBCONSTANT(bc) ? v->konst[b] : reg[b]);
-                dictionary_insertintern(&instance->fields, left, right);
+                
+                if (DECODE_ISBCONSTANT(bc)) {
+                    ic=v->icache + (pc - v->instructions - 1);
+                    if (!vm_cachedsetproperty(ic, instance, v->konst[b], right)) ERROR(ERROR_ALLOCATIONFAILED);
+                } else {
+                    if (!objectinstance_setpropertybyname(instance, reg[b], right)) ERROR(ERROR_ALLOCATIONFAILED);
+                    vm_gcwritebarrier(v, (object *) instance, reg[b]); /* The key may be stored too */
+                }
+                vm_gcwritebarrier(v, (object *) instance, right);
             } else {
                 ERROR(VM_NOTANOBJECT);
             }
@@ -1416,6 +1982,11 @@ callfunction: // Jump here if an instruction becomes a call
             a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
             left = reg[a];
 
+            if (MORPHO_ISLIST(left) && b==c && MORPHO_ISINTEGER(reg[b]) &&
+                list_getelement(MORPHO_GETLIST(left), MORPHO_GETINTEGERVALUE(reg[b]), &reg[b])) {
+                DISPATCH();
+            }
+
             if (MORPHO_ISARRAY(left)) {
                 unsigned int ndim = c-b+1;
                 unsigned int indx[ndim];
@@ -1446,12 +2017,23 @@ callfunction: // Jump here if an instruction becomes a call
             a=DECODE_A(bc); b=DECODE_B(bc); c=DECODE_C(bc);
             left = reg[a];
 
+            if (MORPHO_ISLIST(left) && c==b+1 && MORPHO_ISINTEGER(reg[b])) {
+                objectlist *list = MORPHO_GETLIST(left);
+                int i = MORPHO_GETINTEGERVALUE(reg[b]);
+                if (i>=0 && i<list->val.count) {
+                    list->val.data[i]=reg[c];
+                    vm_gcwritebarrier(v, (object *) list, reg[c]);
+                    DISPATCH();
+                }
+            }
+
             if (MORPHO_ISARRAY(left)) {
                 unsigned int ndim = c-b;
                 unsigned int indx[ndim];
                 if (!array_valuelisttoindices(ndim, &reg[b], indx)) ERROR(VM_NONNUMINDX);
                 objectarrayerror err=array_setelement(MORPHO_GETARRAY(left), ndim, indx, reg[c]);
                 if (err!=ARRAY_OK) ERROR( array_error(err) );
+                vm_gcwritebarrier(v, MORPHO_GETOBJECT(left), reg[c]);
             } else {
                 if (!vm_invoke(v, left, setindexselector, c-b+1, &reg[b], &right)) {
                     ERROR(VM_NOTINDEXABLE);
@@ -1671,10 +2253,13 @@ void morpho_bindobjects(vm *v, int nobj, value *obj) {
         object *ob = MORPHO_GETOBJECT(obj[i]);
         if (MORPHO_ISOBJECT(obj[i]) && ob->status==OBJECT_ISUNMANAGED) {
             ob->status=OBJECT_ISUNMARKED;
-            ob->next=v->objects;
-            v->objects=ob;
+            ob->generation=OBJECT_ISYOUNG;
+            ob->next=v->young;
+            v->young=ob;
             size_t size=object_size(ob);
             v->bound+=size;
+            v->youngbound+=size;
+            v->gcdebt+=size;
 #ifdef MORPHO_DEBUG_GCSIZETRACKING
             dictionary_insert(&sizecheck, obj[i], MORPHO_INTEGER(size));
 #endif
@@ -1683,14 +2268,18 @@ void morpho_bindobjects(vm *v, int nobj, value *obj) {
 
     /* Check if size triggers garbage collection */
 #ifndef MORPHO_DEBUG_STRESSGARBAGECOLLECTOR
-    if (v->bound>v->nextgc)
+    if (vm_gcneeded(v))
 #endif
     {
         /* Temporarily store these objects at the top of the globals array */
         int gcount=v->globals.count;
         varray_valueadd(&v->globals, obj, nobj);
 
+#ifdef MORPHO_DEBUG_STRESSGARBAGECOLLECTOR
         vm_collectgarbage(v);
+#else
+        vm_gccollect(v);
+#endif
         /* Restore globals count */
         v->globals.count=gcount;
     }
@@ -1724,6 +2313,10 @@ void morpho_resizeobject(vm *v, object *obj, size_t oldsize, size_t newsize) {
     if (obj->status==OBJECT_ISUNMANAGED) return;
     v->bound-=oldsize;
     v->bound+=newsize;
+    if (obj->generation==OBJECT_ISYOUNG) {
+        v->youngbound-=oldsize;
+        v->youngbound+=newsize;
+    }
 }
 
 /** Runs a program
@@ -1750,9 +2343,11 @@ bool morpho_run(vm *v, program *p) {
     v->globals.count=p->nglobals;
     for (int i=oldsize; i<p->nglobals; i++) v->globals.data[i]=MORPHO_NIL; /* Zero out globals */
 
-    /* Set instruction base */
+    /* Set instruction base and the inline caches that sit beside it */
     v->instructions = p->code.data;
     if (!v->instructions) return false;
+    if (!vm_programinitcaches(p)) return false;
+    v->icache = p->icache.data;
 
     /* Set up the constant table */
     varray_value *konsttable=object_functiongetconstanttable(p->global);
@@ -1788,14 +2383,12 @@ bool morpho_call(vm *v, value f, int nargs, value *args, value *ret) {
     }
 
     if (MORPHO_ISBUILTINFUNCTION(fn)) {
-        objectbuiltinfunction *f = MORPHO_GETBUILTINFUNCTION(fn);
-
         /* Copy arguments across to comply with call standard */
         value xargs[nargs+1];
         xargs[0]=r0;
         for (unsigned int i=0; i<nargs; i++) xargs[i+1]=args[i];
 
-        *ret=(f->function) (v, nargs, xargs);
+        *ret=vm_callbuiltin(v, fn, nargs, xargs);
         success=true;
     } else if (MORPHO_ISFUNCTION(fn) || MORPHO_ISCLOSURE(fn)) {
         ptrdiff_t aoffset=0;
@@ -1877,6 +2470,13 @@ void morpho_setdebug(vm *v, bool active) {
     v->debug=active;
 }
 
+/** Sets the pause target for incremental garbage collection
+ * @param[in] v - the virtual machine
+ * @param[in] target - bytes of heap to mark or sweep in each slice; zero disables incremental collection */
+void morpho_setgcpausetarget(vm *v, size_t target) {
+    v->gcpause=target;
+}
+
 /* **********************************************************************
 * Initialization
 * ********************************************************************** */
@@ -25,6 +25,8 @@ value program_internsymbol(program *p, value symbol);
 
 void vm_freeobjects(vm *v);
 void vm_collectgarbage(vm *v);
+void vm_collectyoung(vm *v);
+void vm_collectincremental(vm *v);
 
 void morpho_initialize(void);
 void morpho_finalize(void);
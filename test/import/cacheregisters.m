@@ -0,0 +1,6 @@
+// A test library whose top level code uses few registers itself, but imports one that uses many
+
+import "cacheregistersnested.m"
+
+var columns = []
+for (d in dims) columns.append(d[1])
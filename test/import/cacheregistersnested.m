@@ -0,0 +1,12 @@
+// Builds a list at the top level, so that each element is held in a register of the
+// global function while the next ones are created; each creates a large matrix that
+// starts a collection
+
+var dims = [ Matrix(200, 200).dimensions(), Matrix(200, 201).dimensions(), Matrix(200, 202).dimensions(),
+             Matrix(200, 203).dimensions(), Matrix(200, 204).dimensions(), Matrix(200, 205).dimensions(),
+             Matrix(200, 206).dimensions(), Matrix(200, 207).dimensions(), Matrix(200, 208).dimensions(),
+             Matrix(200, 209).dimensions(), Matrix(200, 210).dimensions(), Matrix(200, 211).dimensions(),
+             Matrix(200, 212).dimensions(), Matrix(200, 213).dimensions(), Matrix(200, 214).dimensions(),
+             Matrix(200, 215).dimensions(), Matrix(200, 216).dimensions(), Matrix(200, 217).dimensions(),
+             Matrix(200, 218).dimensions(), Matrix(200, 219).dimensions(), Matrix(200, 220).dimensions(),
+             Matrix(200, 221).dimensions(), Matrix(200, 222).dimensions(), Matrix(200, 223).dimensions() ]
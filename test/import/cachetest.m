@@ -0,0 +1,38 @@
+// A test library that uses features the bytecode cache has to reproduce
+
+import "importtest.m"
+
+var scale = 2.5
+
+class Shape {
+  init(name) { self.name = name }
+  area() { return 0 }
+  describe() { return "${self.name} ${self.area()}" }
+}
+
+class Square is Shape {
+  init(side) {
+    super.init("square")
+    self.side = side
+  }
+  area() { return self.side*self.side*scale }
+}
+
+fn counter() {
+  var n = 0
+  fn inc() { n+=1; return n }
+  return inc
+}
+
+fn greet(name, greeting="Hello") {
+  return cat(greeting, name)
+}
+
+fn risky(x) {
+  try {
+    if (x>1) Error("Big", "Too big").throw()
+    return "ok"
+  } catch {
+    "Big": return "caught"
+  }
+}
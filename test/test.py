@@ -71,6 +71,13 @@ def remove(list, remove_list):
             pass
     return test_list
 
+# Find any command line flags the test requires
+def getflags(filepath):
+    file_object = open(filepath, 'r')
+    flags = rx.findall(r'// flags: ?(.*)', file_object.read())
+    file_object.close()
+    return ' '.join(flags)
+
 # Find what is expected
 def findexpected(str):
     out = finderror(str) # is it an error?
@@ -127,7 +134,7 @@ def test(file,testLog,CI):
     expected=getexpect(file)
 
     # Run the test
-    os.system(command + ' ' +file + ' > ' + tmp)
+    os.system(command + ' ' + getflags(file) + ' ' +file + ' > ' + tmp)
 
     # If we produced output
     if os.path.exists(tmp):